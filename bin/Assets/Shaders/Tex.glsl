@@ -2,8 +2,10 @@
 
 attribute vec3 vp_Vertex;
 attribute vec3 vp_TexCoord0;
+attribute mat4 vp_InstanceMatrix;
 
 uniform mat4 vp_ModelMatrix;
+uniform int vp_Instanced;
 uniform mat4 vp_ViewMatrix;
 uniform mat4 vp_ProjectionMatrix;
 
@@ -11,8 +13,10 @@ varying vec2 vp_TexCoord;
 
 void main()
 {
+	mat4 modelMatrix = (vp_Instanced != 0) ? vp_InstanceMatrix : vp_ModelMatrix;
+
 	vp_TexCoord = vp_TexCoord0.st;
-	gl_Position = vp_ProjectionMatrix * vp_ViewMatrix * vp_ModelMatrix * vec4(vp_Vertex, 1.0);
+	gl_Position = vp_ProjectionMatrix * vp_ViewMatrix * modelMatrix * vec4(vp_Vertex, 1.0);
 } 
 
 [fragment]
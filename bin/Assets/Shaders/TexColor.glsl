@@ -3,8 +3,10 @@
 attribute vec3 vp_Vertex;
 attribute vec3 vp_TexCoord0;
 attribute vec4 vp_Color;
+attribute mat4 vp_InstanceMatrix;
 
 uniform mat4 vp_ModelMatrix;
+uniform int vp_Instanced;
 uniform mat4 vp_ViewMatrix;
 uniform mat4 vp_ProjectionMatrix;
 
@@ -13,8 +15,10 @@ varying vec4 vp_color;
 
 void main()
 {
+	mat4 modelMatrix = (vp_Instanced != 0) ? vp_InstanceMatrix : vp_ModelMatrix;
+
 	vp_TexCoord = vp_TexCoord0.st;
-	gl_Position = vp_ProjectionMatrix * vp_ViewMatrix * vp_ModelMatrix * vec4(vp_Vertex, 1.0);
+	gl_Position = vp_ProjectionMatrix * vp_ViewMatrix * modelMatrix * vec4(vp_Vertex, 1.0);
 	vp_color = vp_Color;
 } 
 
@@ -2,15 +2,19 @@
 
 attribute vec3 vp_Vertex;
 attribute vec4 vp_Color;
+attribute mat4 vp_InstanceMatrix;
 
 uniform mat4 vp_ModelMatrix;
+uniform int vp_Instanced;
 uniform mat4 vp_ViewMatrix;
 uniform mat4 vp_ProjectionMatrix;
 
 void main()
 {
+	mat4 modelMatrix = (vp_Instanced != 0) ? vp_InstanceMatrix : vp_ModelMatrix;
+
 	gl_FrontColor = vec4(vp_Color);
-	gl_Position = vp_ProjectionMatrix * vp_ViewMatrix * vp_ModelMatrix * vec4(vp_Vertex, 1.0);
+	gl_Position = vp_ProjectionMatrix * vp_ViewMatrix * modelMatrix * vec4(vp_Vertex, 1.0);
 }
 
 [fragment]
@@ -6,8 +6,10 @@ attribute vec3 vp_Vertex;
 attribute vec3 vp_Color;
 attribute vec3 vp_TexCoord0;
 attribute vec3 vp_Normal;
+attribute mat4 vp_InstanceMatrix;
 
 uniform mat4 vp_ModelMatrix;
+uniform int vp_Instanced;
 uniform mat4 vp_ViewMatrix;
 uniform mat4 vp_ProjectionMatrix;
 
@@ -16,11 +18,13 @@ varying vec2 texCoord0;
 
 void main()
 {
+	mat4 modelMatrix = (vp_Instanced != 0) ? vp_InstanceMatrix : vp_ModelMatrix;
+
 	normal = vp_Normal; // * mat3(vp_ModelMatrix);
 
 	gl_FrontColor = vec4(vp_Color, 1.0);
 	texCoord0 = vp_TexCoord0.st;
-	gl_Position = vp_ProjectionMatrix * vp_ViewMatrix * vp_ModelMatrix * vec4(vp_Vertex, 1.0);
+	gl_Position = vp_ProjectionMatrix * vp_ViewMatrix * modelMatrix * vec4(vp_Vertex, 1.0);
 } 
 
 [fragment]
@@ -95,6 +95,8 @@ solution "Flood"
 		end
 
 		dofile( srcdir .. "/Tools/PackageGen/PackageGen.lua")
+		dofile( srcdir .. "/Tools/CoreBenchmark/CoreBenchmark.lua")
+		dofile( srcdir .. "/Tools/RenderBenchmark/RenderBenchmark.lua")
 		dofile( srcdir .. "/Tools/RPCGen/RPCGen.lua")
         dofile( srcdir .. "/Tools/RPCGen.Tests/RPCGen.Tests.lua")
 		dofile( srcdir .. "/Tools/Weaver/Weaver.lua")
@@ -28,6 +28,9 @@ struct API_CORE HandleManager
 {
 	HandleMap handles;
 	Atomic<uint32> nextHandle;
+
+	// Handles are resolved and released from several threads.
+	Mutex mutex;
 };
 
 API_CORE HandleManager*    HandleCreateManager( Allocator* );
@@ -342,6 +342,8 @@ void HashMap<T>::erase(const FindResult &fr)
         _data[last.data_prev].next = fr.data_i;
     else
         _hash[last.hash_i] = fr.data_i;
+
+    _data.popBack();
 }
 
 //-----------------------------------//
@@ -0,0 +1,148 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Core/API.h"
+#include "Core/Math/SpatialIndex.h"
+
+NAMESPACE_CORE_BEGIN
+
+//-----------------------------------//
+
+// Index of a node that does not exist.
+const int32 BoundingTreeNull = -1;
+
+struct API_CORE BoundingTreeNode
+{
+	// Checks if the node is a leaf with a proxy.
+	bool isLeaf() const { return left == BoundingTreeNull; }
+
+	// Fat box of the proxy or union of the boxes of the children.
+	BoundingBox box;
+
+	// User data of the proxy.
+	void* userdata;
+
+	// Parent of the node or next node in the free list.
+	int32 parent;
+
+	int32 left;
+	int32 right;
+
+	// Height of the node, zero for leaves and -1 for free nodes.
+	int32 height;
+};
+
+/**
+ * Dynamic bounding volume hierarchy of axis-aligned boxes. Each proxy is
+ * stored in a leaf with a box that is a bit bigger than the one given,
+ * so small movements do not change the tree. Proxies are inserted next
+ * to the node that increases the surface area of the tree the least,
+ * and the nodes are rotated as they are inserted or removed to keep the
+ * tree balanced, so the queries only visit a logarithmic part of it.
+ */
+
+class API_CORE BoundingTree : public SpatialIndex
+{
+	DECLARE_UNCOPYABLE(BoundingTree)
+
+public:
+
+	BoundingTree();
+
+	// Removes all the proxies.
+	virtual void clear() OVERRIDE;
+
+	// Creates a proxy for the box and returns its index.
+	virtual int32 createProxy( const BoundingBox& box, void* userdata ) OVERRIDE;
+
+	// Creates the proxies of many boxes at once. If the tree is empty, it
+	// is built top-down by splitting the boxes at the median of their
+	// centers, which gives a better tree than inserting them one by one.
+	virtual void createProxies( const BoundingBox* boxes, void* const* userdata,
+		size_t count, int32* proxies ) OVERRIDE;
+
+	// Destroys the proxy.
+	virtual void destroyProxy( int32 proxy ) OVERRIDE;
+
+	// Moves the proxy to the box. The proxy is only reinserted if the box
+	// is not inside its fat box anymore, in which case it returns true.
+	virtual bool moveProxy( int32 proxy, const BoundingBox& box ) OVERRIDE;
+
+	// Gets the user data of the proxy.
+	virtual void* getUserData( int32 proxy ) const OVERRIDE;
+
+	// Gets the fat box of the proxy.
+	const BoundingBox& getFatBox( int32 proxy ) const;
+
+	// Gets the proxies with fat boxes that intersect the frustum.
+	virtual void query( const Frustum& frustum, Array<int32>& proxies ) const OVERRIDE;
+
+	// Gets the proxies with fat boxes that intersect the box.
+	virtual void query( const BoundingBox& box, Array<int32>& proxies ) const OVERRIDE;
+
+	// Gets the proxies with fat boxes that intersect the ray.
+	virtual void query( const Ray& ray, Array<int32>& proxies ) const OVERRIDE;
+
+	// Gets the proxies with fat boxes that intersect the rays of the
+	// packet. The whole packet visits the tree once, and each node only
+	// tests the rays that hit its parent.
+	virtual void query( const RayPacket& packet, Array<int32>& proxies,
+		Array<uint32>& masks ) const OVERRIDE;
+
+	// Gets the number of proxies.
+	virtual uint32 getNumProxies() const OVERRIDE { return numProxies; }
+
+	// Gets the height of the tree.
+	int32 getHeight() const;
+
+	// Checks the structure of the tree. Used for testing.
+	bool validate() const;
+
+	// Gets/sets how much the fat boxes are bigger than the proxy boxes.
+	ACCESSOR(Margin, float, margin)
+
+protected:
+
+	// Allocates a node from the free list.
+	int32 allocateNode();
+
+	// Returns a node to the free list.
+	void freeNode( int32 node );
+
+	// Inserts the leaf in the tree.
+	void insertLeaf( int32 leaf );
+
+	// Removes the leaf from the tree.
+	void removeLeaf( int32 leaf );
+
+	// Rotates the node if it is unbalanced and returns the new root of
+	// its subtree.
+	int32 balance( int32 node );
+
+	// Updates the boxes and heights from the node to the root.
+	void refit( int32 node );
+
+	// Checks the structure of the subtree.
+	bool validate( int32 node ) const;
+
+	// Builds a subtree over the leaves and returns its root.
+	int32 build( int32* leaves, size_t count );
+
+	Array<BoundingTreeNode> nodes;
+
+	int32 root;
+	int32 freeList;
+
+	uint32 numProxies;
+	float margin;
+};
+
+//-----------------------------------//
+
+NAMESPACE_CORE_END
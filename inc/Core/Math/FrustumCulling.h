@@ -0,0 +1,73 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Core/API.h"
+#include "Core/Math/Frustum.h"
+#include "Core/Math/BoundingBox.h"
+
+NAMESPACE_CORE_BEGIN
+
+//-----------------------------------//
+
+// Number of boxes tested in each iteration of the culling.
+const uint32 FrustumCullWidth = 4;
+
+/**
+ * Bounding boxes stored as a structure of arrays of centers and extents,
+ * so the culling can load the same axis of several boxes at once. The
+ * arrays are padded with empty boxes to a multiple of the culling width.
+ */
+
+struct API_CORE BoundingBoxArray
+{
+	BoundingBoxArray();
+
+	// Removes all the boxes.
+	void clear();
+
+	// Adds the box and returns its index.
+	uint32 add( const BoundingBox& box );
+
+	// Sets the box at the index.
+	void set( uint32 index, const BoundingBox& box );
+
+	// Gets the number of boxes.
+	GETTER(Size, uint32, size)
+
+	Array<float> centerX;
+	Array<float> centerY;
+	Array<float> centerZ;
+
+	Array<float> extentX;
+	Array<float> extentY;
+	Array<float> extentZ;
+
+	uint32 size;
+};
+
+/**
+ * Tests the boxes against the planes of the frustum and sets the bit of
+ * each box that intersects it in the visibility mask, which has a word
+ * for each 32 boxes. Each plane only tests the corner of the box that
+ * is the furthest along its normal, so the result is the same as of
+ * Frustum::intersects. Uses SSE when it is available.
+ */
+
+API_CORE void FrustumCullBoxes( const Frustum& frustum, const BoundingBoxArray& boxes,
+	Array<uint32>& visible );
+
+// Checks if the box is set in the visibility mask.
+inline bool FrustumCullIsVisible( const Array<uint32>& visible, uint32 index )
+{
+	return (visible[index / 32] & (1u << (index % 32))) != 0;
+}
+
+//-----------------------------------//
+
+NAMESPACE_CORE_END
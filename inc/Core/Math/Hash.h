@@ -19,4 +19,27 @@ API_CORE uint64 MurmurHash64(const void * key, size_t len, uint64 seed);
 
 //-----------------------------------//
 
+// Hashes some data using the xxHash64 hash.
+// https://github.com/Cyan4973/xxHash
+
+API_CORE uint64 XXHash64(const void* data, size_t len, uint64 seed);
+
+// Keeps the state of an incremental xxHash64 computation, so data
+// can be hashed in chunks without being fully loaded in memory.
+
+struct API_CORE HashStateXX64
+{
+	uint64 v[4];
+	uint64 seed;
+	uint64 totalSize;
+	uint8 buffer[32];
+	uint32 bufferSize;
+};
+
+API_CORE void XXHash64Init(HashStateXX64* state, uint64 seed);
+API_CORE void XXHash64Update(HashStateXX64* state, const void* data, size_t len);
+API_CORE uint64 XXHash64Digest(const HashStateXX64* state);
+
+//-----------------------------------//
+
 NAMESPACE_CORE_END
\ No newline at end of file
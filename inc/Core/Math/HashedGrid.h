@@ -0,0 +1,144 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Core/API.h"
+#include "Core/Math/SpatialIndex.h"
+
+NAMESPACE_CORE_BEGIN
+
+//-----------------------------------//
+
+struct API_CORE HashedGridCell
+{
+	BoundingBox box;
+
+	// First entry in the cell.
+	int32 firstEntry;
+	uint32 numEntries;
+};
+
+// Links a proxy to one of the cells it overlaps.
+struct API_CORE HashedGridEntry
+{
+	int32 proxy;
+	int32 cell;
+
+	// Entries in the same cell, or the next free entry.
+	int32 prev;
+	int32 next;
+
+	// Next entry of the same proxy.
+	int32 nextOfProxy;
+};
+
+struct API_CORE HashedGridProxy
+{
+	BoundingBox box;
+	void* userdata;
+
+	// Range of cells overlapped by the box.
+	int32 minCell[3];
+	int32 maxCell[3];
+
+	// First entry of the proxy, or the next free proxy.
+	int32 firstEntry;
+
+	bool isFree;
+};
+
+/**
+ * Sparse uniform grid of cubic cells, where only the cells that were
+ * used are stored in a hash map. Each proxy is linked to all the cells
+ * it overlaps, so moves inside the same range of cells only update the
+ * box. Boxes that span too many cells are kept in an overflow cell that
+ * all the queries test. Best for many boxes of similar size spread over
+ * a big area, like the props of a terrain.
+ */
+
+class API_CORE HashedGrid : public SpatialIndex
+{
+	DECLARE_UNCOPYABLE(HashedGrid)
+
+public:
+
+	HashedGrid( float cellSize );
+
+	// Removes all the proxies.
+	virtual void clear() OVERRIDE;
+
+	// Creates a proxy for the box and returns its index.
+	virtual int32 createProxy( const BoundingBox& box, void* userdata ) OVERRIDE;
+
+	// Destroys the proxy.
+	virtual void destroyProxy( int32 proxy ) OVERRIDE;
+
+	// Moves the proxy to the box. Returns true if it changed cells.
+	virtual bool moveProxy( int32 proxy, const BoundingBox& box ) OVERRIDE;
+
+	// Gets the user data of the proxy.
+	virtual void* getUserData( int32 proxy ) const OVERRIDE;
+
+	// Gets the proxies that intersect the frustum.
+	virtual void query( const Frustum& frustum, Array<int32>& proxies ) const OVERRIDE;
+
+	// Gets the proxies that intersect the box.
+	virtual void query( const BoundingBox& box, Array<int32>& proxies ) const OVERRIDE;
+
+	// Gets the proxies that intersect the ray.
+	virtual void query( const Ray& ray, Array<int32>& proxies ) const OVERRIDE;
+
+	// Gets the number of proxies.
+	virtual uint32 getNumProxies() const OVERRIDE { return numProxies; }
+
+	// Gets the number of cells that were used.
+	uint32 getNumCells() const { return (uint32) cells.size() - 1; }
+
+	// Gets the size of the cells.
+	GETTER(CellSize, float, cellSize)
+
+protected:
+
+	// Gets the range of cells overlapped by the box.
+	void getCellRange( const BoundingBox& box, int32* minCell, int32* maxCell ) const;
+
+	// Finds the cell at the coordinates, creating it if needed.
+	int32 findCell( int32 x, int32 y, int32 z );
+
+	// Links the proxy to the cells of its range.
+	void linkProxy( int32 proxy );
+
+	// Unlinks the proxy from its cells.
+	void unlinkProxy( int32 proxy );
+
+	// Adds an entry of the proxy to the cell.
+	void addEntry( int32 proxy, int32 cell );
+
+	// Adds the proxies of the cell that pass the test.
+	template<typename Test>
+	void queryCell( int32 cell, const Test& test, Array<int32>& proxies ) const;
+
+	// Index of the cells by their packed coordinates.
+	HashMap<int32> cellMap;
+
+	// The first cell is the overflow cell.
+	Array<HashedGridCell> cells;
+
+	Array<HashedGridEntry> entries;
+	int32 freeEntries;
+
+	Array<HashedGridProxy> proxyList;
+	int32 freeProxies;
+
+	uint32 numProxies;
+	float cellSize;
+};
+
+//-----------------------------------//
+
+NAMESPACE_CORE_END
@@ -0,0 +1,124 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Core/API.h"
+#include "Core/Math/SpatialIndex.h"
+
+NAMESPACE_CORE_BEGIN
+
+//-----------------------------------//
+
+struct API_CORE LooseOctreeNode
+{
+	Vector3 center;
+	float halfSize;
+
+	int32 parent;
+	int32 children[8];
+
+	// First proxy stored in the node.
+	int32 firstProxy;
+
+	// Number of proxies in the node and its children.
+	uint32 numProxies;
+};
+
+struct API_CORE LooseOctreeProxy
+{
+	BoundingBox box;
+	void* userdata;
+
+	// Node of the proxy, or -1 if the proxy is free.
+	int32 node;
+
+	// Proxies in the same node, or the next free proxy.
+	int32 prev;
+	int32 next;
+};
+
+/**
+ * Loose octree over a fixed region of the world. The nodes are twice as
+ * big as their cells, so each box is stored in the deepest node whose
+ * cell size is not smaller than the box and that contains its center,
+ * without looking at the sibling nodes. Moves only relink the proxy if
+ * its center changes cell or its size changes level, which suits big
+ * worlds with many props that rarely move. Boxes outside of the region
+ * are kept in the root node.
+ */
+
+class API_CORE LooseOctree : public SpatialIndex
+{
+	DECLARE_UNCOPYABLE(LooseOctree)
+
+public:
+
+	LooseOctree( const BoundingBox& bounds, uint32 maxDepth = 8 );
+
+	// Removes all the proxies.
+	virtual void clear() OVERRIDE;
+
+	// Creates a proxy for the box and returns its index.
+	virtual int32 createProxy( const BoundingBox& box, void* userdata ) OVERRIDE;
+
+	// Destroys the proxy.
+	virtual void destroyProxy( int32 proxy ) OVERRIDE;
+
+	// Moves the proxy to the box. Returns true if it changed node.
+	virtual bool moveProxy( int32 proxy, const BoundingBox& box ) OVERRIDE;
+
+	// Gets the user data of the proxy.
+	virtual void* getUserData( int32 proxy ) const OVERRIDE;
+
+	// Gets the proxies that intersect the frustum.
+	virtual void query( const Frustum& frustum, Array<int32>& proxies ) const OVERRIDE;
+
+	// Gets the proxies that intersect the box.
+	virtual void query( const BoundingBox& box, Array<int32>& proxies ) const OVERRIDE;
+
+	// Gets the proxies that intersect the ray.
+	virtual void query( const Ray& ray, Array<int32>& proxies ) const OVERRIDE;
+
+	// Gets the number of proxies.
+	virtual uint32 getNumProxies() const OVERRIDE { return numProxies; }
+
+	// Gets the number of nodes.
+	uint32 getNumNodes() const { return (uint32) nodes.size(); }
+
+protected:
+
+	// Finds the node for the box, creating it if needed.
+	int32 findNode( const BoundingBox& box );
+
+	// Links the proxy to the node.
+	void linkProxy( int32 proxy, int32 node );
+
+	// Unlinks the proxy from its node.
+	void unlinkProxy( int32 proxy );
+
+	// Gets the loose bounds of the node.
+	BoundingBox getLooseBox( const LooseOctreeNode& node ) const;
+
+	// Walks the nodes that pass the test and returns their proxies that
+	// pass it too.
+	template<typename Test>
+	void walk( const Test& test, Array<int32>& proxies ) const;
+
+	Array<LooseOctreeNode> nodes;
+	Array<LooseOctreeProxy> proxyList;
+
+	int32 freeList;
+	uint32 numProxies;
+
+	BoundingBox bounds;
+	uint32 maxDepth;
+};
+
+//-----------------------------------//
+
+NAMESPACE_CORE_END
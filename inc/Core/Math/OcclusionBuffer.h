@@ -0,0 +1,133 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Core/API.h"
+#include "Core/Memory.h"
+#include "Core/Math/BoundingBox.h"
+#include "Core/Math/Matrix4x3.h"
+#include "Core/Math/Matrix4x4.h"
+
+NAMESPACE_CORE_BEGIN
+
+//-----------------------------------//
+
+// Size in pixels of the tiles of the occlusion buffer.
+const uint32 OcclusionTileWidth = 8;
+const uint32 OcclusionTileHeight = 8;
+
+/**
+ * Occluder triangle set up for rasterization, with the edge functions,
+ * which are positive inside the triangle, and the depth plane in screen
+ * space, and the pixel bounds of the triangle in the buffer.
+ */
+
+struct API_CORE OcclusionTriangle
+{
+	float edgeX[3];
+	float edgeY[3];
+	float edgeOffset[3];
+
+	float depthX;
+	float depthY;
+	float depthOffset;
+
+	int32 minX;
+	int32 minY;
+	int32 maxX;
+	int32 maxY;
+};
+
+/**
+ * Low resolution depth buffer rasterized in software from the triangles
+ * of a few big occluders, used to cull the objects hidden behind them
+ * before they are sent to the renderer. The buffer is split in tiles that
+ * keep the furthest depth of their pixels, so most boxes are tested with
+ * a few tiles and only the tiles partly covered test their pixels. Rows
+ * are rasterized four pixels at a time with SSE, when it is available.
+ */
+
+class API_CORE OcclusionBuffer
+{
+	DECLARE_UNCOPYABLE(OcclusionBuffer)
+
+public:
+
+	OcclusionBuffer();
+
+	// Resizes the buffer, rounding the size up to whole tiles.
+	void resize( uint32 width, uint32 height );
+
+	// Removes the occluders and sets the view-projection matrix used to
+	// project the occluders and the boxes in the next frame.
+	void clear( const Matrix4x4& viewProjection );
+
+	// Adds the triangles of an occluder with the given transform. The
+	// positions have the given stride in bytes and the indices have the
+	// given size in bits. If there are no indices, each three positions
+	// make a triangle. The triangles are clipped to the near plane.
+	void addOccluder( const Matrix4x3& transform, const uint8* positions,
+		uint32 stride, uint32 numPositions, const uint8* indices,
+		uint32 indexSize, uint32 numIndices );
+
+	// Clears the rows, rasterizes the occluders in them and updates their
+	// tiles. The rows must start and end at tile boundaries, so different
+	// threads can rasterize different rows at the same time.
+	void rasterize( uint32 startRow, uint32 endRow );
+
+	// Rasterizes the occluders in all the rows.
+	void rasterize();
+
+	// Checks if some part of the box may be seen past the occluders. The
+	// boxes that cross the near plane are always visible.
+	bool isVisible( const BoundingBox& box ) const;
+
+	// Gets the depth of the pixel, from 0 at the near plane to 1.
+	float getDepth( uint32 x, uint32 y ) const;
+
+	// Gets the width of the buffer.
+	GETTER(Width, uint32, width)
+
+	// Gets the height of the buffer.
+	GETTER(Height, uint32, height)
+
+	// Gets the occluder triangles that were added.
+	GETTER(Triangles, const Array<OcclusionTriangle>&, triangles)
+
+protected:
+
+	// Sets up the triangle in clip space, if it can be seen.
+	void addTriangle( const Vector4& v0, const Vector4& v1, const Vector4& v2 );
+
+	// Rasterizes the triangle in the rows.
+	void rasterizeTriangle( const OcclusionTriangle& triangle, int32 startRow, int32 endRow );
+
+	// Updates the depths of the tiles in the rows.
+	void updateTiles( uint32 startRow, uint32 endRow );
+
+	// Checks if a pixel of the rectangle is not closer than the depth.
+	bool isVisible( int32 minX, int32 minY, int32 maxX, int32 maxY, float depth ) const;
+
+	uint32 width;
+	uint32 height;
+
+	// Depths of the pixels, row by row.
+	Array<float> depths;
+
+	// Furthest depth of the pixels of each tile.
+	Array<float> tileDepths;
+	uint32 numTilesX;
+	uint32 numTilesY;
+
+	Matrix4x4 viewProjection;
+	Array<OcclusionTriangle> triangles;
+};
+
+//-----------------------------------//
+
+NAMESPACE_CORE_END
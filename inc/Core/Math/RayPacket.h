@@ -0,0 +1,67 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Core/API.h"
+#include "Core/Math/BoundingBox.h"
+#include "Core/Math/Ray.h"
+
+NAMESPACE_CORE_BEGIN
+
+//-----------------------------------//
+
+// Number of rays in a packet, one for each bit of the ray masks.
+const uint32 RayPacketSize = 32;
+
+/**
+ * Rays stored as a structure of arrays of origins and inverse directions,
+ * so a box can be tested against several rays at once. Rays that start
+ * close together and go the same way visit mostly the same nodes of the
+ * spatial indices, so a packet of them is traced in a single traversal,
+ * with a mask of the rays still active in each node.
+ */
+
+struct API_CORE RayPacket
+{
+	RayPacket();
+
+	// Sets the rays of the packet, up to the packet size.
+	void set( const Ray* rays, uint32 count );
+
+	// Sets the rays of the packet from the rays at the indices.
+	void set( const Ray* rays, const uint32* indices, uint32 count );
+
+	// Gets the number of rays.
+	GETTER(Size, uint32, size)
+
+	// Gets the mask of all the rays.
+	uint32 getMask() const;
+
+	// Gets the ray at the index.
+	const Ray& getRay( uint32 index ) const { return rays[index]; }
+
+	// Tests the rays of the mask against the box and returns the mask of
+	// the rays that intersect it. Uses SSE when it is available.
+	uint32 intersects( const BoundingBox& box, uint32 mask ) const;
+
+	Ray rays[RayPacketSize];
+
+	float originX[RayPacketSize];
+	float originY[RayPacketSize];
+	float originZ[RayPacketSize];
+
+	float inverseX[RayPacketSize];
+	float inverseY[RayPacketSize];
+	float inverseZ[RayPacketSize];
+
+	uint32 size;
+};
+
+//-----------------------------------//
+
+NAMESPACE_CORE_END
@@ -0,0 +1,14 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+// Enables the SSE paths of the math code when the compiler targets SSE.
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#define FLD_MATH_SSE
+	#include <xmmintrin.h>
+#endif
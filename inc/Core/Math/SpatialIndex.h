@@ -0,0 +1,78 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Core/API.h"
+#include "Core/Math/BoundingBox.h"
+#include "Core/Math/Frustum.h"
+#include "Core/Math/Ray.h"
+#include "Core/Math/RayPacket.h"
+
+NAMESPACE_CORE_BEGIN
+
+//-----------------------------------//
+
+// Index of a proxy that does not exist.
+const int32 SpatialProxyNull = -1;
+
+/**
+ * Spatial indices keep proxies of axis-aligned boxes, so the boxes
+ * close to a frustum, box or ray can be found without testing all of
+ * them. The queries can return proxies that are a bit further than the
+ * exact boxes, so the results should be tested again when it matters.
+ */
+
+class API_CORE SpatialIndex
+{
+public:
+
+	virtual ~SpatialIndex() {}
+
+	// Removes all the proxies.
+	virtual void clear() = 0;
+
+	// Creates a proxy for the box and returns its index.
+	virtual int32 createProxy( const BoundingBox& box, void* userdata ) = 0;
+
+	// Creates the proxies of many boxes at once. Indices can build a
+	// better structure when they know all the boxes up front.
+	virtual void createProxies( const BoundingBox* boxes, void* const* userdata,
+		size_t count, int32* proxies );
+
+	// Destroys the proxy.
+	virtual void destroyProxy( int32 proxy ) = 0;
+
+	// Moves the proxy to the box. Returns true if the structure changed.
+	virtual bool moveProxy( int32 proxy, const BoundingBox& box ) = 0;
+
+	// Gets the user data of the proxy.
+	virtual void* getUserData( int32 proxy ) const = 0;
+
+	// Gets the proxies that intersect the frustum.
+	virtual void query( const Frustum& frustum, Array<int32>& proxies ) const = 0;
+
+	// Gets the proxies that intersect the box.
+	virtual void query( const BoundingBox& box, Array<int32>& proxies ) const = 0;
+
+	// Gets the proxies that intersect the ray.
+	virtual void query( const Ray& ray, Array<int32>& proxies ) const = 0;
+
+	// Gets the proxies that intersect the rays of the packet, each with
+	// the mask of the rays that hit it. A proxy can be returned more than
+	// once, with different rays. By default the rays are queried one at
+	// a time.
+	virtual void query( const RayPacket& packet, Array<int32>& proxies,
+		Array<uint32>& masks ) const;
+
+	// Gets the number of proxies.
+	virtual uint32 getNumProxies() const = 0;
+};
+
+//-----------------------------------//
+
+NAMESPACE_CORE_END
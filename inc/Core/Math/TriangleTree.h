@@ -0,0 +1,152 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Core/API.h"
+#include "Core/Memory.h"
+#include "Core/Math/BoundingBox.h"
+#include "Core/Math/Ray.h"
+#include "Core/Math/Helpers.h"
+
+NAMESPACE_CORE_BEGIN
+
+//-----------------------------------//
+
+// Number of children of each node and of triangles of each leaf.
+const uint32 TriangleTreeWidth = 4;
+
+// Child of a node or triangle of a leaf that does not exist.
+const int32 TriangleTreeEmpty = 0x7FFFFFFF;
+
+/**
+ * Node of a triangle tree with the boxes of its children stored as a
+ * structure of arrays, so the ray is tested against all of them at once.
+ * Children are the index of a node or, if negative, the complement of
+ * the index of a leaf.
+ */
+
+struct API_CORE TriangleTreeNode
+{
+	float minX[TriangleTreeWidth];
+	float minY[TriangleTreeWidth];
+	float minZ[TriangleTreeWidth];
+
+	float maxX[TriangleTreeWidth];
+	float maxY[TriangleTreeWidth];
+	float maxZ[TriangleTreeWidth];
+
+	int32 children[TriangleTreeWidth];
+};
+
+/**
+ * Leaf of a triangle tree with the first vertex and the two edges of
+ * its triangles stored as a structure of arrays, so the ray is tested
+ * against all of them at once.
+ */
+
+struct API_CORE TriangleTreeLeaf
+{
+	float vertexX[TriangleTreeWidth];
+	float vertexY[TriangleTreeWidth];
+	float vertexZ[TriangleTreeWidth];
+
+	float edge1X[TriangleTreeWidth];
+	float edge1Y[TriangleTreeWidth];
+	float edge1Z[TriangleTreeWidth];
+
+	float edge2X[TriangleTreeWidth];
+	float edge2Y[TriangleTreeWidth];
+	float edge2Z[TriangleTreeWidth];
+
+	// Indices of the triangles in the mesh.
+	int32 triangles[TriangleTreeWidth];
+};
+
+struct API_CORE TriangleTreeHit
+{
+	// Index of the triangle in the mesh.
+	uint32 triangle;
+
+	// Distance along the ray.
+	float distance;
+
+	// Barycentric coordinates of the hit in the triangle.
+	float u;
+	float v;
+};
+
+/**
+ * Static bounding volume hierarchy of the triangles of a mesh, used to
+ * find the triangle hit by a ray without testing all of them. The tree
+ * is built once, top-down, splitting the triangles where the surface
+ * area heuristic is the lowest. Each node has four children and each
+ * leaf up to four triangles, which are tested with SSE when available.
+ */
+
+class API_CORE TriangleTree
+{
+	DECLARE_UNCOPYABLE(TriangleTree)
+
+public:
+
+	TriangleTree();
+
+	// Builds the tree from the positions, with the given stride in bytes,
+	// and the indices of the triangles. If there are no indices, each
+	// three positions make a triangle.
+	void build( const uint8* positions, uint32 stride, uint32 numPositions,
+		const uint32* indices, uint32 numIndices );
+
+	// Removes all the triangles.
+	void clear();
+
+	// Finds the nearest triangle hit by the ray, closer than the maximum
+	// distance. The distance is measured in units of the ray direction.
+	bool raycast( const Ray& ray, TriangleTreeHit& hit,
+		float maxDistance = LimitsFloatMaximum ) const;
+
+	// Gets the number of triangles.
+	GETTER(NumTriangles, uint32, numTriangles)
+
+	// Gets the bounding box of the triangles.
+	GETTER(BoundingBox, const BoundingBox&, box)
+
+	// Gets the nodes of the tree.
+	GETTER(Nodes, const Array<TriangleTreeNode>&, nodes)
+
+	// Gets the leaves of the tree.
+	GETTER(Leaves, const Array<TriangleTreeLeaf>&, leaves)
+
+protected:
+
+	struct BuildTriangle;
+
+	// Builds a subtree over the triangles and returns the child that
+	// refers to its root.
+	int32 build( BuildTriangle* triangles, uint32 count, uint32 depth );
+
+	// Builds a leaf with the triangles and returns its child.
+	int32 buildLeaf( const BuildTriangle* triangles, uint32 count );
+
+	// Splits the triangles in two and returns the size of the first half.
+	// Deep subtrees are split at the median, to bound the traversal stack.
+	static uint32 split( BuildTriangle* triangles, uint32 count, uint32 depth );
+
+	Array<TriangleTreeNode> nodes;
+	Array<TriangleTreeLeaf> leaves;
+
+	// Child that refers to the root, which is a leaf for small meshes.
+	int32 root;
+
+	uint32 numTriangles;
+	BoundingBox box;
+};
+
+//-----------------------------------//
+
+NAMESPACE_CORE_END
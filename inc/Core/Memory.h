@@ -76,6 +76,26 @@ struct API_CORE BumpAllocator : public Allocator
 
 API_CORE Allocator* AllocatorCreateBump( Allocator*, int32 size );
 
+/**
+ * Manages allocations of objects of the same size in chunks of slots,
+ * so the objects are next to each other in memory. Freed slots are
+ * re-used by the next allocations, and allocations bigger than the slots
+ * are forwarded to the parent allocator. Reset frees all the chunks.
+ */
+
+struct API_CORE ChunkAllocator : public Allocator
+{
+	Allocator* parent;
+	int32 slotSize;
+	int32 slotsPerChunk;
+	int32 numChunks;
+	int32 numAllocations;
+	uint8* chunks;
+	uint8* freeSlots;
+};
+
+API_CORE Allocator* AllocatorCreateChunk( Allocator*, int32 size, int32 slotsPerChunk );
+
 /**
  * Manages memory allocation using Doug Lea's malloc implementation.
  * This is a boundary-tag allocator that manages memory by keeping
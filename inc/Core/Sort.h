@@ -0,0 +1,27 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+NAMESPACE_CORE_BEGIN
+
+//-----------------------------------//
+
+/**
+ * Sorts an array of 64-bit keys using a LSD radix sort, moving the values
+ * along with the keys. The sort is stable, so elements with the same key
+ * keep their original order. The temporary arrays need to hold as many
+ * elements as the sorted arrays. Passes where all the keys share the same
+ * digit are skipped, so sorting keys with unused high bits is cheaper.
+ */
+
+API_CORE void RadixSort(uint64* keys, uint32* values, size_t count,
+	uint64* tempKeys, uint32* tempValues);
+
+//-----------------------------------//
+
+NAMESPACE_CORE_END
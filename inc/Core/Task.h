@@ -9,6 +9,7 @@
 
 #include "Core/Concurrency.h"
 #include "Core/ConcurrentQueue.h"
+#include "Core/Timer.h"
 
 NAMESPACE_CORE_BEGIN
 
@@ -21,6 +22,7 @@ NAMESPACE_CORE_BEGIN
  */
 
 class Task;
+class TaskGroup;
 typedef Delegate1<Task*> TaskFunction;
 
 class API_CORE Task
@@ -34,16 +36,19 @@ public:
 	void run();
 
 	int16 group;
-	int16 priority; //!< task priority
+	int16 priority; //!< task priority, higher priorities run first
+	float deadline; //!< seconds after being queued by which the task should run, 0 if none
 	TaskFunction callback; //!< task function
 	void* userdata; //!< task function arguments
+	TaskGroup* taskGroup; //!< group waiting on the task, if any
 };
 
 enum class TaskState
 {
 	Added,
 	Started,
-	Finished
+	Finished,
+	Cancelled
 };
 
 struct API_CORE TaskEvent
@@ -52,7 +57,107 @@ struct API_CORE TaskEvent
 	TaskState state;
 };
 
-#include "Core/ConcurrentQueue.h"
+/**
+ * Queue of tasks waiting to be run. Tasks are serviced by priority and
+ * then in the order they were queued, except for tasks whose deadline
+ * has expired, which are serviced first in deadline order. The tasks are
+ * kept in a binary heap ordered by priority and in another ordered by
+ * deadline, so pushing and popping take logarithmic time.
+ */
+class API_CORE TaskQueue
+{
+public:
+
+	TaskQueue();
+
+	/**
+	 * Adds a task to the queue.
+	 * @param task task to add
+	 */
+	void push(Task* task);
+
+	/**
+	 * Removes the next task to run from the queue.
+	 * @param task popped task
+	 * @return false if the queue is empty
+	 */
+	bool tryPop(Task*& task);
+
+	/**
+	 * Waits until there is a task in the queue and removes it.
+	 * @param task popped task
+	 * @return false if the queue was closed while waiting
+	 */
+	bool waitAndPop(Task*& task);
+
+	/**
+	 * Removes a task from the queue if it is still queued.
+	 * @param task task to remove
+	 * @return true if the task was removed
+	 */
+	bool remove(Task* task);
+
+	/**
+	 * Changes the priority of a task if it is still queued.
+	 * @param task task to reprioritize
+	 * @param priority new task priority
+	 * @return true if the task was still queued
+	 */
+	bool setPriority(Task* task, int16 priority);
+
+	/**
+	 * Checks if the task is in the queue.
+	 */
+	bool has(Task* task) const;
+
+	/**
+	 * Checks if the queue is empty.
+	 */
+	bool empty() const;
+
+	/**
+	 * Wakes all the waiting threads and stops waiting for new tasks.
+	 */
+	void close();
+
+	/**
+	 * Allows waiting for new tasks again.
+	 */
+	void open();
+
+	struct Entry
+	{
+		Task* task;
+		float dueTime;
+		int16 priority;
+		uint32 sequence;
+		uint32 id;
+	};
+
+private:
+
+	void pushEntry(Entry entry);
+	bool popNext(Task*& task);
+	bool isQueued(const Entry& entry) const;
+	void compact();
+
+	// Entries of removed and reprioritized tasks are left in the heaps
+	// and skipped when popped. The live entry of each task is kept in a
+	// map keyed by the task.
+	Array<Entry> byPriority;
+	Array<Entry> byDeadline;
+	HashMap<Entry> queued;
+
+	Timer timer;
+	uint32 sequence;
+	uint32 nextId;
+	bool isClosed;
+
+	mutable Mutex mutex;
+	Condition condition;
+};
+
+//-----------------------------------//
 
 class API_CORE TaskPool
 {
@@ -66,6 +171,12 @@ public:
 	
 	~TaskPool();
 
+	/**
+	 * Adds task to taskpool using the priority and deadline of the task.
+	 * @param task task to add
+	 */
+	void add(Task* task);
+
 	/**
 	 * Adds task to taskpool.
 	 * @param task task to add
@@ -73,6 +184,34 @@ public:
 	 */
 	void add(Task* task, uint8 priority);
 
+	/**
+	 * Cancels a task that has not started running yet.
+	 * @param task task to cancel
+	 * @return true if the task was removed from the queue
+	 */
+	bool cancel(Task* task);
+
+	/**
+	 * Changes the priority of a task that has not started running yet.
+	 * @param task task to reprioritize
+	 * @param priority new priority of the task
+	 * @return true if the task was still queued
+	 */
+	bool setPriority(Task* task, int16 priority);
+
+
+	/**
+	 * Runs the next queued task in the calling thread.
+	 * @return false if there were no queued tasks
+	 */
+	bool runPendingTask();
+
+	/**
+	 * Runs a queued task in the calling thread if it has not started yet.
+	 * @param task task to run
+	 * @return false if the task was not queued
+	 */
+	bool runTask(Task* task);
 
 	/**
 	 * Waits on all threads to terminate.
@@ -85,7 +224,8 @@ public:
 	void restartThreads();
 
 	/**
-	 * Raise task event delegates.
+	 * Raises the task event delegates of the queued events. This should
+	 * be called regularly, or the events will keep piling up.
 	 */
 	void update();
 
@@ -108,7 +248,7 @@ private:
 public:
 
 	Array<Thread*> threads; //!< threads assigned to taskpool
-	ConcurrentQueue<Task*> tasks; //!< tasks for taskpool to execute
+	TaskQueue tasks; //!< tasks for taskpool to execute
 	ConcurrentQueue<TaskEvent> events; //!< task events
 	Event1<TaskEvent> onTaskEvent; //!< task event delegate
 	bool isStopping; //!< indicates when taskpool is shutting down
@@ -116,7 +256,57 @@ public:
 private:
 
 	int threadCount;
-	bool isWaiting;
+};
+
+//-----------------------------------//
+
+/**
+ * Set of tasks added to a task pool that can be waited on. While waiting,
+ * the calling thread runs the tasks of the group that have not started
+ * yet instead of sleeping, but never the other tasks of the pool, so it
+ * is not held up by unrelated work, like resource loading.
+ */
+class API_CORE TaskGroup
+{
+	DECLARE_UNCOPYABLE(TaskGroup)
+
+public:
+
+	TaskGroup();
+	~TaskGroup();
+
+	/**
+	 * Sets the task pool the tasks are added to.
+	 * @param pool task pool, or null to run the tasks when added
+	 */
+	void setTaskPool(TaskPool* pool);
+
+	/**
+	 * Adds the task to the task pool as part of the group.
+	 * @param task task to add
+	 */
+	void add(Task* task);
+
+	/**
+	 * Waits until all the tasks of the group have finished.
+	 */
+	void wait();
+
+	/**
+	 * Called by a task of the group when it has finished.
+	 */
+	void finishTask(Task* task);
+
+private:
+
+	TaskPool* pool;
+
+	// Tasks added to the pool that have not finished.
+	Array<Task*> tasks;
+	uint32 numPending;
+
+	Mutex mutex;
+	Condition finished;
 };
 
 //-----------------------------------//
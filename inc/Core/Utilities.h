@@ -36,6 +36,12 @@ API_CORE bool FileExists(const Path&);
 API_CORE void FileEnumerateFiles(const Path&, Array<Path>&);
 API_CORE void FileEnumerateDirectories(const Path&, Array<Path>&);
 
+// Gets the size and last modification time of a file.
+API_CORE bool FileGetInfo(const Path&, uint64& size, uint64& modifiedTime);
+
+// Creates a directory, if it does not exist already.
+API_CORE bool FileCreateDirectory(const Path&);
+
 //---------------------------------------------------------------------//
 // Locales
 //---------------------------------------------------------------------//
@@ -118,6 +118,9 @@ protected:
 	// Callback when buffer is uploaded.
 	void onBufferUploaded(AudioBuffer*);
 
+	// Queues the next decoded data of a sound still being decoded.
+	bool queueChunk(ALuint buffer);
+
 	// Holds the source state.
 	AudioSourceState state;
 
@@ -136,6 +139,16 @@ protected:
 	// Keeps if the source loops.
 	bool loop;
 
+	// Set while the source plays a sound that is still being decoded,
+	// which is queued from the decoded data like a streamed sound.
+	bool queueChunks;
+
+	// Offset in the sound data of the next data to queue.
+	uint32 chunkOffset;
+
+	// Buffers waiting for more data to be decoded.
+	Array<ALuint> idleBuffers;
+
 	// Holds the source id from OpenAL.
 	ALuint id;
 };
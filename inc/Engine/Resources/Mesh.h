@@ -11,6 +11,7 @@
 #include "Resources/Resource.h"
 #include "Core/Math/BoundingBox.h"
 #include "Core/Math/Vector.h"
+#include "Core/Concurrency.h"
 #include "Graphics/GeometryBuffer.h"
 
 FWD_DECL_INTRUSIVE(Animation)
@@ -21,6 +22,8 @@ NAMESPACE_ENGINE_BEGIN
 
 //-----------------------------------//
 
+class  TriangleTree;
+
 struct API_ENGINE MeshMaterial
 {
 	String name;
@@ -75,6 +78,14 @@ public:
 	// Gets the animations of the mesh.
 	GETTER(Animations, const Array<AnimationPtr>&, animations)
 
+	// Gets the triangle tree of the mesh, used for picking. It is built
+	// the first time it is needed and shared by all the models. It can
+	// be called from several threads at once.
+	const TriangleTree* getTriangleTree();
+
+	// Gets the group and the vertex indices of a triangle of the tree.
+	bool getTriangle( uint32 triangle, int32& group, uint32 (&indices)[3] ) const;
+
 	// Gets the resource group of this resource.
 	GETTER(ResourceGroup, ResourceGroup, ResourceGroup::Meshes)
 
@@ -86,6 +97,9 @@ public:
 	// Builds the mesh bounding volume.
 	void buildBounds();
 
+	// Builds the triangle tree from the groups.
+	TriangleTree* buildTriangleTree();
+
 	// Keeps track if the mesh is animated.
 	bool animated;
 
@@ -107,6 +121,15 @@ public:
 	// Geometry of the mesh.
 	GeometryBufferPtr geometryBuffer;
 
+	// Triangles of the groups, in a tree for picking.
+	TriangleTree* triangleTree;
+
+	// Set once the triangle tree is built, so it is read without locking.
+	Atomic<uint32> triangleTreeBuilt;
+
+	// Guards the lazy build of the triangle tree.
+	Mutex triangleTreeMutex;
+
 	// Keeps track if the mesh has been built.
 	bool built;
 };
@@ -45,6 +45,9 @@ public:
 	// Decode an OGG file to a buffer.
 	bool decode(ResourceLoadOptions&) OVERRIDE;
 
+	// Decodes the next chunk of an OGG file to the buffer.
+	bool decodeChunk(ResourceLoadOptions&) OVERRIDE;
+
 	// Gets the name of this codec.
 	GETTER(Name, const String, "OGG")
 
@@ -59,6 +62,9 @@ protected:
 	// Decodes the audio from the Ogg stream.
 	void decodeOgg( OggVorbis_File* vf, Array<byte>& buffer );
 
+	// Decodes a chunk of audio to the sound buffer.
+	void decodeOggChunk( OggVorbis_File* vf, ResourceLoadOptions& options );
+
 	// Used for providing libvorbisfile with I/O callbacks.
 	ov_callbacks callbacks;
 };
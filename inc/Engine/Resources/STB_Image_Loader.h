@@ -30,8 +30,8 @@ public:
 
 	STB_Image_Loader();
 
-	// Creates the resource with no data.
-	RESOURCE_LOADER_PREPARE(Image)
+	// Creates the resource with the image header data.
+	virtual Resource* prepare(ResourceLoadOptions&) OVERRIDE;
 
 	// Gets the class of the resource.
 	RESOURCE_LOADER_CLASS(Image)
@@ -51,9 +51,21 @@ public:
 	// Gets/sets the buffer containing the data.
 	ACCESSOR(Buffer, const Array<byte>&, dataBuffer)
 
+	// Checks if the sound data is fully decoded.
+	bool isDecoded() const;
+
+	// Gets the number of bytes of the sound data that are decoded.
+	uint32 getDecodedSize() const;
+
 	// Return the proper resource group for this resource.
 	GETTER(ResourceGroup, ResourceGroup, ResourceGroup::Audio)
 
+	// Gets the memory used by the sound data.
+	uint64 getMemoryUsage() const OVERRIDE;
+
+	// Releases the sound data.
+	bool unload() OVERRIDE;
+
 	// Sound frequency.
 	int32 frequency;
 
@@ -68,6 +80,12 @@ public:
 
 	// Holds the sound data.
 	Array<byte> dataBuffer;
+
+	// Number of bytes decoded when decoding in chunks.
+	Atomic<uint32> decodedSize;
+
+	// Set while the sound data is being decoded in chunks.
+	Atomic<uint32> decoding;
 };
 
 TYPEDEF_RESOURCE_HANDLE_FROM_TYPE( Sound );
@@ -9,7 +9,11 @@
 
 #include "Engine/Scene/Component.h"
 #include "Core/Math/Frustum.h"
+#include "Core/Math/FrustumCulling.h"
+#include "Core/Math/OcclusionBuffer.h"
 #include "Core/Math/Matrix4x3.h"
+#include "Core/Task.h"
+#include "Graphics/RenderQueue.h"
 #include "Engine/Geometry/DebugGeometry.h"
 
 FWD_DECL_INTRUSIVE(Transform)
@@ -22,6 +26,8 @@ NAMESPACE_ENGINE_BEGIN
 class  RenderView;
 class  RenderDevice;
 struct RenderBlock;
+struct CameraCullJob;
+struct CameraOcclusionJob;
 
 /**
  * Represents a view from a specific point in the world. Has an associated 
@@ -48,9 +54,19 @@ public:
 	// Renders the block to the current render view.
 	void render( RenderBlock& block, bool clearView = true );
 
-	// Performs hierarchical frustum culling on the nodes in the scene.
+	// Performs hierarchical frustum culling on the nodes in the scene. If
+	// the render device has a task pool, the visible entities are split
+	// in slices whose render states are built in parallel. Cameras only
+	// share read-only state while culling, so several cameras can cull
+	// the same scene at the same time. With occlusion culling, the
+	// entities tagged as occluders are rasterized first and the entities
+	// hidden behind them are skipped.
 	void cull( RenderBlock& queue, const Entity* entity );
 
+	// Performs frustum culling on the entities of the scene, using the
+	// scene bounding tree to skip the ones far from the frustum.
+	void cull( RenderBlock& queue, const Scene* scene );
+
 	// Gets the look-at vector of the camera.
 	GETTER(LookAtVector, const Vector3&, lookAtVector)
 
@@ -63,6 +79,12 @@ public:
 	// Sets the current view associated with the camera.
 	void setView(RenderView* view);
 
+	// Gets/sets if the entities hidden behind the occluders are culled.
+	ACCESSOR(OcclusionCulling, bool, occlusionCulling)
+
+	// Gets the occlusion buffer of the last culling.
+	GETTER(OcclusionBuffer, const OcclusionBuffer&, occlusionBuffer)
+
 	// Gets the camera frustum.
 	Frustum& getFrustum() { return frustum; }
 	const Frustum& getFrustum() const { return frustum; }
@@ -89,6 +111,46 @@ protected:
 	// Handles the transform notification.
 	void onTransformed();
 
+	// Collects the visible entities in the hierarchy and their bounds.
+	void collectEntities( const Entity* entity );
+
+	// Culls the collected entities and appends the visible ones.
+	void appendCollected( RenderBlock& block );
+
+	// Checks if the collected entity passed the culling.
+	bool isCollectedVisible( size_t index ) const;
+
+	// Culls the collected entities in the range against the occluders and
+	// appends the visible ones. Returns the number of hidden entities.
+	uint32 appendSlice( RenderQueue& queue, size_t start, size_t end,
+		float& occlusionTime );
+
+	// Appends the renderables of the visible entities in the range.
+	void appendEntities( RenderQueue& queue, size_t start, size_t end );
+
+	// Tests the collected entities in the range against the occluders.
+	// Returns the number of entities hidden by them.
+	uint32 occludeEntities( size_t start, size_t end );
+
+	// Rasterizes the collected occluders into the occlusion buffer, in
+	// bands split over the task pool. Returns the number of occluders.
+	uint32 rasterizeOccluders( TaskPool* taskPool );
+
+	// Adds the triangles of the occluder to the occlusion buffer.
+	void addOccluder( const Entity* entity );
+
+	// Appends the renderables of the entity to the queue.
+	void appendEntity( RenderQueue& queue, const Entity* entity );
+
+	// Runs the debug hooks of the components of the entity.
+	void drawEntityDebug( const Entity* entity );
+
+	// Runs a culling task in a task pool thread.
+	void runCullJob( Task* task );
+
+	// Runs an occluder rasterization task in a task pool thread.
+	void runOcclusionJob( Task* task );
+
 	// Called when it is time to draw debug data.
 	virtual void onDebugDraw( DebugDrawer&, DebugDrawFlags ) OVERRIDE;
 
@@ -98,6 +160,38 @@ protected:
 	// Frustum culling.
 	bool frustumCulling;
 
+	// Occlusion culling.
+	bool occlusionCulling;
+
+	// Entities that intersect the frustum in the scene bounding tree.
+	Array<Entity*> sceneEntities;
+
+	// Entities collected for culling and their world bounds.
+	Array<const Entity*> cullEntities;
+	BoundingBoxArray cullBoxes;
+
+	// Visibility mask of the collected entities.
+	Array<uint32> cullVisible;
+
+	// Depths of the occluders seen by the camera.
+	OcclusionBuffer occlusionBuffer;
+
+	// Keeps track of the collected entities hidden by the occluders.
+	Array<uint8> cullOccluded;
+
+	// Triangle indices of the occluders built from quads.
+	Array<uint32> occluderIndices;
+
+	// Bands of the occlusion buffer rasterized by other threads.
+	Array<CameraOcclusionJob*> occlusionJobs;
+
+	// Slices of the collected entities appended by other threads, each
+	// into its own queue.
+	Array<CameraCullJob*> cullJobs;
+
+	// Slices and bands still being processed by other threads.
+	TaskGroup cullTasks;
+
 	// Look-at vector.
 	Vector3 lookAtVector;
 
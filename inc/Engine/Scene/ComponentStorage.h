@@ -0,0 +1,206 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Engine/Scene/Component.h"
+#include "Core/HashMap.h"
+
+NAMESPACE_ENGINE_BEGIN
+
+//-----------------------------------//
+
+class Entity;
+
+// Index of an entity in a component storage.
+typedef int32 EntityHandle;
+const EntityHandle EntityHandleNull = -1;
+
+/**
+ * Components of one class, with the entities that own them. The array
+ * is sorted by address before it is iterated, so the components that
+ * were created with the allocator of the pool are visited in the order
+ * they are laid out in memory.
+ */
+
+class API_SCENE ComponentPool
+{
+	DECLARE_UNCOPYABLE(ComponentPool)
+
+public:
+
+	ComponentPool( Class* klass );
+	~ComponentPool();
+
+	// Gets the class of the components.
+	GETTER(Class, Class*, klass)
+
+	// Gets the allocator that keeps the components in chunks.
+	GETTER(Allocator, Allocator*, allocator)
+
+	// Adds the component of the entity.
+	void add( Component* component, EntityHandle entity );
+
+	// Removes the component.
+	void remove( Component* component );
+
+	// Gets the components, in memory order.
+	const Array<Component*>& getComponents();
+
+	// Gets the entities of the components.
+	const Array<EntityHandle>& getEntities();
+
+protected:
+
+	// Sorts the components by their address.
+	void sort();
+
+	Class* klass;
+	Allocator* allocator;
+
+	Array<Component*> components;
+	Array<EntityHandle> entities;
+
+	// Index of each component, keyed by its address.
+	HashMap<int32> indices;
+
+	// Do the components need to be sorted.
+	bool needsSort;
+};
+
+//-----------------------------------//
+
+/**
+ * Entities that have the same set of component classes. The components
+ * of each entity are kept in a row, in the order of the classes, so the
+ * systems that need several components of an entity get them at once.
+ */
+
+struct API_SCENE ComponentArchetype
+{
+	// Gets the column of the class, or -1 if it is not in the archetype.
+	int32 getColumn( const Class* klass ) const;
+
+	// Gets the component of the entity in the row.
+	Component* getComponent( size_t row, int32 column ) const
+	{
+		return components[row * classes.size() + column];
+	}
+
+	// Classes of the components, sorted by address.
+	Array<Class*> classes;
+
+	// Entities of the archetype.
+	Array<EntityHandle> entities;
+
+	// Components of the entities, one row per entity.
+	Array<Component*> components;
+};
+
+//-----------------------------------//
+
+/**
+ * Keeps the components of the entities of a scene grouped by class, and
+ * the entities grouped by archetype. Components created with the pool
+ * allocator of their class are stored in contiguous chunks, so systems
+ * that update all the components of a class stream through memory. The
+ * components are still the reflected, reference counted objects of the
+ * entities, so they can be created with any allocator.
+ */
+
+class API_SCENE ComponentStorage
+{
+	DECLARE_UNCOPYABLE(ComponentStorage)
+
+public:
+
+	ComponentStorage();
+	~ComponentStorage();
+
+	// Gets the allocator that stores the components of the class next
+	// to the others of the class.
+	Allocator* getAllocator( Class* klass );
+
+	// Creates a component of the class with the allocator of the class.
+	Component* createComponent( Class* klass );
+
+	// Adds the entity and its components. Returns its handle.
+	EntityHandle add( Entity* entity );
+
+	// Removes the entity and its components.
+	void remove( Entity* entity );
+
+	// Updates the components of the entity after they changed.
+	void refresh( Entity* entity );
+
+	// Gets the handle of the entity.
+	EntityHandle getHandle( const Entity* entity ) const;
+
+	// Gets the entity of the handle.
+	Entity* getEntity( EntityHandle handle ) const { return entities[handle]; }
+
+	// Gets the components of the class, in memory order.
+	const Array<Component*>& getComponents( Class* klass );
+
+	// Gets the pools of the components, one per class.
+	GETTER(Pools, const Array<ComponentPool*>&, pools)
+
+	// Gets the archetypes with components of all the classes.
+	void getArchetypes( Class* const* classes, size_t count,
+		Array<const ComponentArchetype*>& list ) const;
+
+	// Calls the function with each component of the class.
+	FLD_IGNORE template<typename T, typename Function>
+	void forEach( const Function& function )
+	{
+		const Array<Component*>& list = getComponents(T::getStaticType());
+
+		for( size_t i = 0; i < list.size(); i++ )
+			function( (T*) list[i] );
+	}
+
+	// Updates all the components, one class at a time. The geometries
+	// are updated first and then the transforms, like in the entities.
+	void update( float delta );
+
+protected:
+
+	// Finds the pool of the class, creating it if needed.
+	ComponentPool* findPool( Class* klass );
+
+	// Finds the archetype of the classes, creating it if needed.
+	int32 findArchetype( const Array<Class*>& classes );
+
+	// Adds the components of the entity to its archetype and pools.
+	void link( EntityHandle handle );
+
+	// Removes the components of the entity from its archetype and pools.
+	void unlink( EntityHandle handle );
+
+	// Pools of the components, keyed by class.
+	Array<ComponentPool*> pools;
+	HashMap<int32> poolMap;
+
+	// Order of the pools in the updates.
+	Array<ComponentPool*> updateOrder;
+	bool needsUpdateOrder;
+
+	Array<ComponentArchetype*> archetypes;
+
+	// Entities by handle, with their archetype and row in it.
+	Array<Entity*> entities;
+	Array<int32> entityArchetypes;
+	Array<int32> entityRows;
+	Array<EntityHandle> freeHandles;
+
+	// Handles of the entities, keyed by their address.
+	HashMap<int32> handleMap;
+};
+
+//-----------------------------------//
+
+NAMESPACE_ENGINE_END
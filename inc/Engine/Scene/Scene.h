@@ -9,10 +9,14 @@
 
 #include "Resources/Resource.h"
 #include "Engine/Scene/Group.h"
+#include "Engine/Scene/TransformSystem.h"
+#include "Engine/Scene/ComponentStorage.h"
+#include "Engine/Scene/SystemScheduler.h"
 #include "Graphics/RenderBatch.h"
 #include "Core/Math/Matrix4x3.h"
 #include "Core/Math/Ray.h"
 #include "Core/Math/Frustum.h"
+#include "Core/Math/SpatialIndex.h"
 
 NAMESPACE_ENGINE_BEGIN
 
@@ -47,12 +51,33 @@ struct API_SCENE RayTriangleQueryResult : public RayQueryResult
 
 //-----------------------------------//
 
+/**
+ * Layers of the scene, each with its own spatial index. Entities tagged
+ * as static when they are added go in the static layer, and are bulk
+ * loaded when the scene is.
+ */
+
+struct SceneLayer
+{
+	enum Enum
+	{
+		Static,
+		Dynamic,
+		Count
+	};
+};
+
+//-----------------------------------//
+
 /**
  * A scene instance holds all the entities that are attached to it.
  * You might have different scenes for different 'levels' of your game
  * and switch between them in runtime. The scene is also responsible
  * for updating all the game entities and will aswell call hooks like 
  * before performing frustum culling or before rendering the entity.
+ * The world bounds of the entities are kept in spatial indices, so the
+ * culling and the queries do not need to test every entity, and their
+ * transforms are updated together by a transform system.
  */
 
 API_SCENE REFLECT_DECLARE_CLASS(Scene)
@@ -83,8 +108,82 @@ public:
 	bool doRayTriangleQuery( const Ray& ray, RayTriangleQueryResult& res );
 	bool doRayTriangleQuery( const Ray& ray, RayTriangleQueryResult& res, const EntityPtr& );
 
+	// Finds the nearest entity hit by each ray via ray-box tests. The
+	// results are written to the buffer, one for each ray, with a null
+	// entity for the rays that hit nothing. The rays are traced in packets
+	// and big batches are split over the task pool, so the scene must not
+	// be updated meanwhile.
+	void doRayBoxQueries( const Ray* rays, size_t count, RayQueryResult* results );
+
+	// Finds the triangle hit by each ray, like doRayTriangleQuery, in
+	// batches like doRayBoxQueries.
+	void doRayTriangleQueries( const Ray* rays, size_t count, RayTriangleQueryResult* results );
+
+	// Gets the entities with bounds that intersect the frustum. The
+	// entities tagged as non-culled when added are always returned.
+	void queryEntities( const Frustum& frustum, Array<Entity*>& list ) const;
+
+	// Gets the entities with bounds closer than the radius to the point,
+	// for example to find what an agent or a sound source is near of.
+	void queryNeighbours( const Vector3& point, float radius, Array<Entity*>& list ) const;
+
+	// Gets the spatial index of the layer.
+	const SpatialIndex* getSpatialIndex( SceneLayer::Enum layer ) const;
+
+	// Sets the spatial index of the layer, which is then owned by the
+	// scene. The entities of the layer are moved to the new index. Both
+	// layers use a bounding tree by default.
+	void setSpatialIndex( SceneLayer::Enum layer, SpatialIndex* index );
+
+	// Fix-up serialization.
+	virtual void fixUp() OVERRIDE;
+
+	// Components of the entities, grouped by class and archetype. It is
+	// destroyed after the entities, so the pools outlive their components.
+	ComponentStorage components;
+
 	// Entities of the scene.
 	Group entities;
+
+	// Transforms of the entities, updated after the entities.
+	TransformSystem transforms;
+
+	// Systems that update the components of the storage.
+	SystemScheduler systems;
+
+	// Gets/sets if the components are updated one class at a time from
+	// the component storage by the systems, instead of one entity at a
+	// time.
+	ACCESSOR(UpdateByComponent, bool, updateByComponent)
+
+protected:
+
+	// Adds the entity and its children to the transform system and the
+	// spatial indices.
+	void addEntity( Entity* entity );
+
+	// Adds the entity and its children to the dynamic index, and gets
+	// the static ones to bulk load them.
+	void addEntity( Entity* entity, Array<Entity*>& staticEntities );
+
+	// Removes the entity and its children from the transform system and
+	// the spatial indices.
+	void removeEntity( Entity* entity );
+
+	// Callbacks of the changes in the groups.
+	void onEntityAdded( const EntityPtr& entity );
+	void onEntityRemoved( const EntityPtr& entity );
+	void onEntityComponentAdded( const ComponentPtr& component );
+	void onEntityComponentRemoved( const ComponentPtr& component );
+
+	// Bounds of the entities of each layer in world space.
+	SpatialIndex* spatialIndices[SceneLayer::Count];
+
+	// Entities that are never culled.
+	Array<Entity*> nonCulledEntities;
+
+	// Are the components updated by class.
+	bool updateByComponent;
 };
 
 TYPEDEF_INTRUSIVE_POINTER_FROM_TYPE( Scene );
@@ -0,0 +1,122 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Engine/Scene/Component.h"
+
+NAMESPACE_ENGINE_BEGIN
+
+//-----------------------------------//
+
+struct SystemFlags
+{
+	enum Enum
+	{
+		// The components can be updated in ranges by several threads.
+		Parallel = 1 << 0,
+
+		// The system runs in the thread of the scheduler.
+		MainThread = 1 << 1
+	};
+};
+
+/**
+ * Stages of the systems. The systems that conflict run in the order of
+ * their stages, and then in the order they were added.
+ */
+
+struct SystemStage
+{
+	enum Enum
+	{
+		Geometry,
+		Transform,
+		Update
+	};
+};
+
+/**
+ * A system updates the components of one class of the scene. Systems
+ * declare the classes of the components they read and write, so the
+ * scheduler knows which systems can run at the same time.
+ */
+
+class API_SCENE SceneSystem
+{
+	DECLARE_UNCOPYABLE(SceneSystem)
+
+public:
+
+	SceneSystem( Class* klass );
+	virtual ~SceneSystem();
+
+	// Gets the class of the components updated by the system. Components
+	// of the classes that inherit from it have their own systems.
+	GETTER(Class, Class*, klass)
+
+	// Declares that the system reads the components of the class.
+	void addRead( Class* klass );
+
+	// Declares that the system writes the components of the class.
+	void addWrite( Class* klass );
+
+	// Gets the classes of the components read by the system.
+	GETTER(Reads, const Array<Class*>&, reads)
+
+	// Gets the classes of the components written by the system.
+	GETTER(Writes, const Array<Class*>&, writes)
+
+	// Gets/sets the flags of the system.
+	ACCESSOR(Flags, uint32, flags)
+
+	// Gets/sets the stage of the system.
+	ACCESSOR(Stage, SystemStage::Enum, stage)
+
+	// Gets if both systems can't run at the same time.
+	bool conflicts( const SceneSystem* other ) const;
+
+	// Called before the components are updated, in the scheduler thread.
+	virtual void begin( float ) { }
+
+	// Updates a range of the components. Parallel systems are called
+	// with several ranges at the same time from different threads.
+	virtual void update( Component* const* components, size_t count, float delta ) = 0;
+
+	// Called after all the components are updated, in the scheduler thread.
+	virtual void end( float ) { }
+
+protected:
+
+	Class* klass;
+	Array<Class*> reads;
+	Array<Class*> writes;
+	uint32 flags;
+	SystemStage::Enum stage;
+};
+
+//-----------------------------------//
+
+/**
+ * Updates the components of a class with their update method. It only
+ * writes its own components, and runs in the scheduler thread unless
+ * the flags are changed.
+ */
+
+class API_SCENE ComponentSystem : public SceneSystem
+{
+public:
+
+	ComponentSystem( Class* klass );
+
+	// Updates the components.
+	virtual void update( Component* const* components, size_t count, float delta ) OVERRIDE;
+};
+
+//-----------------------------------//
+
+NAMESPACE_ENGINE_END
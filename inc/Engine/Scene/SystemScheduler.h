@@ -0,0 +1,110 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Engine/Scene/SceneSystem.h"
+#include "Core/Task.h"
+
+NAMESPACE_ENGINE_BEGIN
+
+//-----------------------------------//
+
+class  ComponentStorage;
+struct SystemJob;
+
+/**
+ * Runs the systems of a scene each frame. The systems that conflict are
+ * linked in a dependency graph, in the order of their stages, and the
+ * systems without pending dependencies run at the same time in the task
+ * pool, with the components of parallel systems split in ranges. Classes
+ * of components without a system get one that runs in the scheduler
+ * thread. In deterministic mode, used for replays, all the systems run
+ * in the scheduler thread in the order of the graph.
+ */
+
+class API_SCENE SystemScheduler
+{
+	DECLARE_UNCOPYABLE(SystemScheduler)
+
+public:
+
+	SystemScheduler();
+	~SystemScheduler();
+
+	// Adds the system, which is then owned by the scheduler.
+	void add( SceneSystem* system );
+
+	// Removes and destroys the system.
+	void remove( SceneSystem* system );
+
+	// Finds the system that updates the components of the class.
+	SceneSystem* findSystem( const Class* klass ) const;
+
+	// Gets the systems.
+	GETTER(Systems, const Array<SceneSystem*>&, systems)
+
+	// Gets/sets if the systems run in a fixed order in one thread.
+	ACCESSOR(Deterministic, bool, deterministic)
+
+	// Gets/sets the task pool. The engine task pool is used if null.
+	ACCESSOR(TaskPool, TaskPool*, taskPool)
+
+	// Updates the components of the storage with the systems.
+	void update( ComponentStorage& storage, float delta );
+
+protected:
+
+	// Builds the dependency graph of the systems.
+	void buildGraph();
+
+	// Starts updating the system.
+	void launch( int32 index );
+
+	// Finishes the system and readies the systems that depend on it.
+	void finish( int32 index );
+
+	// Runs a range of a system in a task pool thread.
+	void runJob( Task* task );
+
+	Array<SceneSystem*> systems;
+	size_t numPools;
+
+	// Systems in the order of their stages, with the systems that need
+	// to wait for each of them.
+	Array<SceneSystem*> sorted;
+	Array<int32> dependencyCounts;
+	Array<int32> dependentOffsets;
+	Array<int32> dependents;
+	bool needsGraph;
+
+	bool deterministic;
+	TaskPool* taskPool;
+
+	// State of the systems in the current update.
+	TaskPool* activePool;
+	float delta;
+	Array<const Array<Component*>*> componentLists;
+	Array<int32> pendingDependencies;
+	Array<int32> ready;
+	size_t numReady;
+	size_t numFinished;
+
+	// Jobs of the ranges run in the task pool.
+	Array<SystemJob*> jobs;
+	size_t numJobs;
+
+	// Ranges of each system run in the task pool, and the systems
+	// running there in the order they were launched.
+	Array<TaskGroup*> systemTasks;
+	Array<int32> running;
+	size_t numWaited;
+};
+
+//-----------------------------------//
+
+NAMESPACE_ENGINE_END
@@ -25,6 +25,8 @@ namespace Tags
 		NonCollidable			= 1 << 26,
 		NonCulled				= 1 << 27,
 		UpdateTransformsOnly	= 1 << 28,
+		Static					= 1 << 29,
+		Occluder				= 1 << 30,
 	};
 }
 
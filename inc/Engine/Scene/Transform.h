@@ -10,6 +10,7 @@
 #include "Core/Math/EulerAngles.h"
 #include "Core/Math/Quaternion.h"
 #include "Core/Math/BoundingBox.h"
+#include "Core/Math/SpatialIndex.h"
 #include "Engine/Scene/Component.h"
 
 NAMESPACE_ENGINE_BEGIN
@@ -17,6 +18,7 @@ NAMESPACE_ENGINE_BEGIN
 //-----------------------------------//
 
 class Transform;
+class TransformSystem;
 API_SCENE Transform* TransformCreate( Allocator* );
 
 /**
@@ -32,6 +34,7 @@ class API_SCENE Transform : public Component
 	REFLECT_DECLARE_OBJECT(Transform)
 	DECLARE_UNCOPYABLE(Transform)
 	DECLARE_FRIENDS(Transform)
+	friend class TransformSystem;
 
 	Transform();
 
@@ -82,7 +85,7 @@ public:
 	GETTER(BoundingVolume, const BoundingBox&, bounds)
 
 	// Gets the world bounding volume of the transform.
-	BoundingBox getWorldBoundingVolume() const;
+	const BoundingBox& getWorldBoundingVolume() const;
 
 	// Updates the bounding volume geometry.
 	void updateBoundingVolume();
@@ -93,7 +96,23 @@ public:
 	// Gets if the bounding volume need to be updated.
 	bool requiresBoundingVolumeUpdate() const;
 
-	// Called once per frame to update the component.
+	// Gets the proxy of the transform in the spatial index of the scene.
+	GETTER(SpatialProxy, int32, spatialProxy)
+
+	// Sets the proxy of the transform in the spatial index of the scene.
+	// The proxy is moved with the world bounding volume and destroyed
+	// with the transform.
+	void setSpatialProxy( SpatialIndex* index, int32 proxy );
+
+	// Gets the transform system of the scene.
+	GETTER(System, TransformSystem*, system)
+
+	// Sets the parent of the transform, which must be in the same system.
+	// The transform then moves with it. Returns false if it can't be set.
+	bool setParent( Transform* parent );
+
+	// Called once per frame to update the component. The transforms in
+	// a transform system only update their bounding volume here.
 	virtual void update( float delta );
 
 	// Gets fired when the transform is changed.
@@ -104,6 +123,12 @@ protected:
 	// Sets the notify state of the transform.
 	void setChanged(bool state = true);
 
+	// Copies the local transformation to the transform system.
+	void updateSystem();
+
+	// Called by the transform system when the world matrix changed.
+	void onWorldChanged();
+
 	// Called when it is time to draw debug data.
 	virtual void onDebugDraw( DebugDrawer&, DebugDrawFlags ) OVERRIDE;
 
@@ -119,9 +144,24 @@ protected:
 	// Local transform.
 	Matrix4x3 transform;
 
+	// Updates the world bounding volume from the absolute transform.
+	void updateWorldBoundingVolume();
+
 	// Bounding volume of the renderables.
 	BoundingBox bounds;
 
+	// Bounding volume in world space, so it is not transformed every time
+	// it is culled.
+	BoundingBox worldBounds;
+
+	// Spatial index of the scene and proxy of the transform in it.
+	SpatialIndex* spatialIndex;
+	int32 spatialProxy;
+
+	// Transform system that updates the world matrix and bounds.
+	TransformSystem* system;
+	int32 systemIndex;
+
 	// Tracks if the transform has been changed.
 	bool wasChanged;
 
@@ -0,0 +1,148 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Core/Event.h"
+#include "Core/Task.h"
+#include "Core/Math/Vector.h"
+#include "Core/Math/Quaternion.h"
+#include "Core/Math/Matrix4x3.h"
+#include "Core/Math/BoundingBox.h"
+
+NAMESPACE_ENGINE_BEGIN
+
+//-----------------------------------//
+
+class  Transform;
+struct TransformSystemJob;
+
+/**
+ * Flags of the transforms in the system.
+ */
+
+struct TransformFlags
+{
+	enum Enum
+	{
+		// The local transform or the local bounds were changed.
+		Dirty = 1 << 0,
+
+		// The world matrix is given by setWorldMatrix.
+		External = 1 << 1,
+
+		// The world matrix or bounds were changed in this update.
+		Changed = 1 << 2
+	};
+};
+
+/**
+ * Keeps the transforms of a scene in contiguous arrays, one per field,
+ * sorted so that the transforms of each subtree of the hierarchy follow
+ * its root. The world matrices and bounds of the changed transforms are
+ * updated in one linear pass per frame, split in slices of whole
+ * subtrees that run in the task pool, and the changes are notified in a
+ * single batch after it.
+ */
+
+class API_SCENE TransformSystem
+{
+	DECLARE_UNCOPYABLE(TransformSystem)
+
+public:
+
+	TransformSystem();
+	~TransformSystem();
+
+	// Adds the transform to the system.
+	void add( Transform* transform );
+
+	// Removes the transform from the system. Its children become roots.
+	void remove( Transform* transform );
+
+	// Sets the parent of the transform. The parent must be in the system,
+	// or -1 to make the transform a root. Returns false on cycles.
+	bool setParent( int32 index, int32 parent );
+
+	// Gets the parent of the transform.
+	int32 getParent( int32 index ) const { return parents[index]; }
+
+	// Sets the local transformation and marks it dirty.
+	void setLocalTransform( int32 index, const Vector3& position,
+		const Quaternion& rotation, const Vector3& scale );
+
+	// Sets the local bounds and marks them dirty.
+	void setLocalBounds( int32 index, const BoundingBox& bounds );
+
+	// Sets the world matrix of the transform, which is then not updated
+	// from its local transform. The world bounds are updated right away.
+	void setWorldMatrix( int32 index, const Matrix4x3& matrix );
+
+	// Gets the world matrix of the transform.
+	const Matrix4x3& getWorldMatrix( int32 index ) const { return worldMatrices[index]; }
+
+	// Gets the world bounds of the transform.
+	const BoundingBox& getWorldBounds( int32 index ) const { return worldBounds[index]; }
+
+	// Gets the number of transforms.
+	size_t getNumTransforms() const { return transforms.size(); }
+
+	// Updates the world matrices and bounds of the changed transforms and
+	// of their children, and then notifies the changes.
+	void update();
+
+	// Gets fired after an update with the transforms that changed.
+	Event1<const Array<Transform*>&> onTransformsChanged;
+
+protected:
+
+	// Sorts the transforms so each subtree is contiguous.
+	void sort();
+
+	// Updates the world matrices and bounds of a range of subtrees.
+	void updateRange( size_t start, size_t end );
+
+	// Runs an update slice in a task pool thread.
+	void runJob( Task* task );
+
+	// Moves the last transform to the index.
+	void moveLast( int32 index );
+
+	// Local transformations.
+	Array<Vector3> positions;
+	Array<Quaternion> rotations;
+	Array<Vector3> scales;
+	Array<BoundingBox> localBounds;
+
+	// World matrices and bounds.
+	Array<Matrix4x3> worldMatrices;
+	Array<BoundingBox> worldBounds;
+
+	// Hierarchy of the transforms.
+	Array<int32> parents;
+	Array<int32> numChildren;
+	Array<int32> subtreeSizes;
+
+	Array<uint8> flags;
+	Array<Transform*> transforms;
+
+	// Do the transforms need to be sorted before the update.
+	bool needsSort;
+
+	// Transforms that changed in the last update.
+	Array<Transform*> changed;
+
+	// Update jobs of the slices run in the task pool.
+	Array<TransformSystemJob*> jobs;
+
+	// Update jobs not finished yet.
+	TaskGroup jobTasks;
+};
+
+//-----------------------------------//
+
+NAMESPACE_ENGINE_END
@@ -49,6 +49,7 @@ enum struct BufferAccess : uint8
 //-----------------------------------//
 
 class GeometryBuffer;
+class BufferArena;
 
 /**
  * Represents a buffer of data stored in memory. They mainly store
@@ -86,6 +87,21 @@ public:
 
 	// Keeps the geometry buffer associated with this buffer.
 	const GeometryBuffer* gb;
+
+	// Size of the allocated storage in bytes.
+	uint32 size;
+
+	// Arena the storage is sub-allocated from, if any.
+	BufferArena* arena;
+
+	// Keeps if the data lives in the backend stream buffer.
+	bool isStreamed;
+
+	// Offset of the data in the arena or the stream buffer.
+	uint32 offset;
+
+	// Frame the data was last streamed in.
+	uint32 streamFrame;
 };
 
 TYPEDEF_INTRUSIVE_POINTER_FROM_TYPE( Buffer );
@@ -23,13 +23,62 @@ struct BufferEntry
 	IndexBufferPtr ib;
 };
 
-typedef HashMap<BufferEntry> BuffersMap; // keyed by const GeometryBuffer*
+typedef HashMap<BufferEntry*> BuffersMap; // keyed by const GeometryBuffer*
 
 class RenderBackend;
 class GeometryBuffer;
 
+//-----------------------------------//
+
+struct BufferArenaRange
+{
+	uint32 offset;
+	uint32 size;
+};
+
+/**
+ * Sub-allocates the storage of a big GPU buffer to many small buffers,
+ * so that they can share the same storage and be drawn without binding
+ * a different buffer for each of them. Keeps a list of the free ranges
+ * of the storage sorted by offset, which are merged when freed.
+ */
+
+class API_GRAPHICS BufferArena
+{
+	DECLARE_UNCOPYABLE(BufferArena)
+
+public:
+
+	BufferArena(Buffer* storage, uint32 capacity);
+
+	// Allocates a range of the storage. Returns false if it does not fit.
+	bool allocate(uint32 size, uint32 align, uint32& offset);
+
+	// Frees a range allocated from the storage.
+	void free(uint32 offset, uint32 size);
+
+	// Buffer that holds the storage of the arena.
+	Buffer* storage;
+
+	// Size of the storage in bytes.
+	uint32 capacity;
+
+	// Number of bytes allocated and the most that were ever allocated.
+	uint32 usedBytes;
+	uint32 peakBytes;
+
+	// Number of live allocations.
+	uint32 numAllocations;
+
+	// Free ranges of the storage, sorted by offset.
+	Array<BufferArenaRange> freeRanges;
+};
+
 /**
- * Manages a set of buffers.
+ * Manages a set of buffers. Static geometry is sub-allocated from shared
+ * vertex and index arenas, so that most meshes end up in a few GPU
+ * buffers. The GPU storage of a geometry buffer is released when the
+ * geometry buffer is destroyed.
  */
 
 class API_GRAPHICS BufferManager
@@ -50,13 +99,50 @@ public:
 	// Gets an index buffer with the geometry given.
 	IndexBufferPtr getIndexBuffer(const GeometryBuffer*);
 
+	// Allocates arena storage for the vertex buffer if it can be pooled.
+	// Returns true if the buffer got new storage and has to be rebuilt.
+	bool prepareVertexStorage(VertexBuffer*);
+
+	// Allocates arena storage for the index buffer if it can be pooled.
+	// Returns true if the buffer got new storage and has to be rebuilt.
+	bool prepareIndexStorage(IndexBuffer*);
+
+	// Releases the buffers of the geometry buffer.
+	void releaseBuffers(const GeometryBuffer*);
+
+	// Logs the memory usage of the arenas.
+	void logArenaStats() const;
+
+	// Gets the vertex arenas.
+	GETTER(VertexArenas, const Array<BufferArena*>&, vertexArenas)
+
+	// Gets the index arenas.
+	GETTER(IndexArenas, const Array<BufferArena*>&, indexArenas)
+
 	// Sets the rendering backend.
 	SETTER(RenderBackend, RenderBackend*, backend)
 
 protected:
 
+	// Allocates storage from the arenas, creating a new arena if needed.
+	BufferArena* allocateStorage(Array<BufferArena*>& arenas, bool isIndex,
+		uint32 size, uint32 align, uint32& offset);
+
+	// Frees the arena storage of the buffer.
+	void freeStorage(Buffer*);
+
+	// Called when a geometry buffer is destroyed.
+	void onGeometryBufferDestroyed(const GeometryBuffer*);
+
 	RenderBackend* backend;
 	BuffersMap buffers;
+
+	Array<BufferArena*> vertexArenas;
+	Array<BufferArena*> indexArenas;
+
+	// Buffers that hold the storage of the arenas.
+	Array<VertexBufferPtr> vertexStorages;
+	Array<IndexBufferPtr> indexStorages;
 };
 
 //-----------------------------------//
@@ -12,7 +12,8 @@ NAMESPACE_GRAPHICS_BEGIN
 //-----------------------------------//
 
 /**
- * Holds the timing statistics accumulated from rendering.
+ * Holds the timing statistics accumulated from rendering, and the
+ * render counters of the current and last frames.
  */
 
 class API_GRAPHICS FrameStatistics
@@ -35,6 +36,51 @@ public:
 	float avgFrameTime;
 	float sumFrameTime;
 	float lastFrameTime;
+
+	// Render state changes issued and elided in the current frame.
+	uint32 numStateChanges;
+	uint32 numStateChangesElided;
+
+	// Render state changes issued and elided in the last frame.
+	uint32 lastStateChanges;
+	uint32 lastStateChangesElided;
+
+	// Draw calls, instanced draw calls and instances drawn by
+	// them in the current frame.
+	uint32 numDrawCalls;
+	uint32 numInstancedDrawCalls;
+	uint32 numInstances;
+
+	// Draw calls, instanced draw calls and instances drawn by
+	// them in the last frame.
+	uint32 lastDrawCalls;
+	uint32 lastInstancedDrawCalls;
+	uint32 lastInstances;
+
+	// Bytes of streamed texture levels that can be uploaded in a frame,
+	// and the bytes uploaded in the current and last frames.
+	uint32 textureUploadBudget;
+	uint32 numTextureUploadBytes;
+	uint32 lastTextureUploadBytes;
+
+	// Number of textures that are still being streamed.
+	uint32 numStreamingTextures;
+
+	// Occluders and occluder triangles rasterized by the cameras, and
+	// entities hidden by them, in the current frame.
+	uint32 numOccluders;
+	uint32 numOccluderTriangles;
+	uint32 numOccludedEntities;
+
+	// Occluders, occluder triangles and hidden entities in the last frame.
+	uint32 lastOccluders;
+	uint32 lastOccluderTriangles;
+	uint32 lastOccludedEntities;
+
+	// Time spent in occlusion culling in the current and last frames,
+	// summed over the threads that took part in it.
+	float occlusionTime;
+	float lastOcclusionTime;
 };
 
 //-----------------------------------//
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "Core/References.h"
+#include "Core/Event.h"
 #include "Core/Math/Vector.h"
 #include "Graphics/Buffer.h"
 #include "Graphics/VertexBuffer.h"
@@ -39,6 +40,23 @@ public:
 	// Forces rebuild of geometry data.
 	void forceRebuild();
 
+	// Marks a byte range of the vertex data as changed.
+	void markDirty(uint32 offset, uint32 size);
+
+	// Marks a byte range of the index data as changed.
+	void markIndexDirty(uint32 offset, uint32 size);
+
+	// Marks the buffer as up to date with its data.
+	void clearDirty();
+
+	// Gets the changed byte range of the vertex data. Returns false if
+	// all of the data needs to be uploaded to storage of the given size.
+	bool getDirtyRange(uint32 storageSize, uint32& offset, uint32& size) const;
+
+	// Gets the changed byte range of the index data. Returns false if
+	// all of the data needs to be uploaded to storage of the given size.
+	bool getIndexDirtyRange(uint32 storageSize, uint32& offset, uint32& size) const;
+
 	// Clears the buffer.
 	void clear();
 
@@ -120,11 +138,21 @@ public:
 	// Holds if the buffer needs to be rebuilt.
 	bool needsRebuild;
 
+	// Changed byte ranges of the vertex and index data.
+	uint32 dirtyStart;
+	uint32 dirtyEnd;
+	uint32 indexDirtyStart;
+	uint32 indexDirtyEnd;
+
 	// Hash of the contents of the buffer.
 	uint32 hash;
 
 	// Holds the vertex declarations.
 	VertexDeclaration declarations;
+
+	// Sent when the buffer is destroyed, so the GPU storage made for it
+	// can be released.
+	mutable Event1<const GeometryBuffer*> onDestroyed;
 };
 
 TYPEDEF_INTRUSIVE_POINTER_FROM_TYPE( GeometryBuffer );
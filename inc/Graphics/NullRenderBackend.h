@@ -0,0 +1,192 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Graphics/RenderBackend.h"
+#include "Graphics/RenderContext.h"
+#include "Graphics/RenderTarget.h"
+
+NAMESPACE_GRAPHICS_BEGIN
+
+//-----------------------------------//
+
+/**
+ * Types of the commands issued to a render backend.
+ */
+
+enum struct RenderCommandType : uint8
+{
+	SetupRenderView,
+	ClearRenderView,
+	SetupRenderState,
+	UnsetupRenderState,
+	BindVertexBuffer,
+	UnbindVertexBuffer,
+	BuildVertexBuffer,
+	SetupVertexBuffer,
+	BindIndexBuffer,
+	UnbindIndexBuffer,
+	BuildIndexBuffer,
+	UploadTexture,
+	UploadTextureMip,
+	ReleaseTextureMips,
+	ConfigureTexture,
+	BindTexture,
+	UnbindTexture,
+	SetupTextureUnit,
+	UndoTextureUnit,
+	LinkProgram,
+	BindProgram,
+	UnbindProgram,
+	SetUniform,
+	Draw,
+	DrawInstanced,
+	EndFrame,
+	Count
+};
+
+// Gets the name of the render command type.
+API_GRAPHICS const char* RenderCommandTypeGetName(RenderCommandType type);
+
+//-----------------------------------//
+
+class Buffer;
+
+/**
+ * Render backend that implements all the backend operations without
+ * talking to any graphics API. This allows running the renderer on
+ * machines without a GPU, for example to measure its CPU-side cost.
+ * All the operations are reported to recordCommand, which does nothing
+ * here but can be overriden to keep track of the issued commands.
+ */
+
+class API_GRAPHICS NullRenderBackend : public RenderBackend
+{
+public:
+
+	NullRenderBackend();
+
+	bool init() OVERRIDE;
+	void cleanup() OVERRIDE;
+	void checkCapabilities(RenderCapabilities*) OVERRIDE;
+	void endFrame() OVERRIDE;
+	
+	void renderBatch(RenderBatch*) OVERRIDE;
+	void renderBatchInstanced(RenderBatch*, const Matrix4x4*, uint32) OVERRIDE;
+	void setupRenderState( const RenderState&, bool bindUniforms ) OVERRIDE;
+	void unsetupRenderState( const RenderState& ) OVERRIDE;
+	void setupRenderView(RenderView*) OVERRIDE;
+	void clearRenderView(RenderView*) OVERRIDE;
+
+	// Framebuffers.
+	Color getPixel(uint16 x, uint16 y) OVERRIDE;
+	void setClearColor(Color color) OVERRIDE;
+
+	// Vertex buffers.
+	VertexBuffer* createVertexBuffer() OVERRIDE;
+	void releaseVertexBuffer(VertexBuffer*) OVERRIDE;
+	void bindVertexBuffer(VertexBuffer*) OVERRIDE;
+	void unbindVertexBuffer(VertexBuffer*) OVERRIDE;
+	void buildVertexBuffer(VertexBuffer*) OVERRIDE;
+	void setupVertexBuffer(VertexBuffer*) OVERRIDE;
+
+	// Index buffers.
+	IndexBuffer* createIndexBuffer() OVERRIDE;
+	void releaseIndexBuffer(IndexBuffer*) OVERRIDE;
+	void bindIndexBuffer(IndexBuffer*) OVERRIDE;
+	void unbindIndexBuffer(IndexBuffer*) OVERRIDE;
+	void buildIndexBuffer(IndexBuffer*) OVERRIDE;
+
+	// Render buffers.
+	RenderBuffer* createRenderBuffer(const Settings&) OVERRIDE;
+
+	// Textures.
+	Texture* createTexture() OVERRIDE;
+	void releaseTexture(Texture*) OVERRIDE;
+	void uploadTexture(Texture*) OVERRIDE;
+	void uploadTextureMip(Texture*, uint8 level, uint32 width, uint32 height,
+		const uint8* data) OVERRIDE;
+	void releaseTextureMips(Texture*, uint8 level) OVERRIDE;
+	void configureTexture(Texture*) OVERRIDE;
+	void bindTexture(Texture*) OVERRIDE;
+	void unbindTexture(Texture*) OVERRIDE;
+	Image* readTexture(Texture*) OVERRIDE;
+
+	// Texture units.
+	void setupTextureUnit(Texture* texture, const TextureUnit& unit) OVERRIDE;
+	void undoTextureUnit(Texture* texture, const TextureUnit& unit) OVERRIDE;
+
+	// Shaders.
+	ShaderProgram* createProgram() OVERRIDE;
+	ShaderProgram* createShader() OVERRIDE;
+	void releaseShader(ShaderProgram*) OVERRIDE;
+	void compileShader(ShaderProgram*) OVERRIDE;
+
+	// Called for each command issued to the backend.
+	virtual void recordCommand(RenderCommandType type, const void* object, uint32 arg);
+
+	// Number of bytes uploaded to buffers in the current and last frame.
+	uint64 frameUploadBytes;
+	uint64 lastFrameUploadBytes;
+
+protected:
+
+	// Gets the number of bytes a backend uploads to build the buffer.
+	uint32 getUploadSize(Buffer* buffer, const Array<uint8>& data,
+		bool isDirtyRange, uint32 dirtySize);
+
+	// Identifier given to the next created object.
+	uint32 nextId;
+};
+
+//-----------------------------------//
+
+/**
+ * Render context for backends that do not need a graphics API context.
+ * The context takes ownership of the backend.
+ */
+
+class API_GRAPHICS NullRenderContext : public RenderContext
+{
+public:
+
+	NullRenderContext(RenderBackend* backend);
+
+	// Makes the context current.
+	void makeCurrent(RenderTarget* target) OVERRIDE;
+};
+
+//-----------------------------------//
+
+/**
+ * Render target that is not backed by any surface.
+ */
+
+class API_GRAPHICS NullRenderTarget : public RenderTarget
+{
+public:
+
+	NullRenderTarget(const Settings& settings);
+
+	// Sets this rendering target as the current.
+	void makeCurrent() OVERRIDE;
+
+	// Updates the render target.
+	void update() OVERRIDE;
+
+	// Gets the settings of this render target.
+	const Settings& getSettings() const OVERRIDE;
+
+protected:
+
+	Settings settings;
+};
+
+//-----------------------------------//
+
+NAMESPACE_GRAPHICS_END
\ No newline at end of file
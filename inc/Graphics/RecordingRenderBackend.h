@@ -0,0 +1,67 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Graphics/NullRenderBackend.h"
+
+NAMESPACE_GRAPHICS_BEGIN
+
+//-----------------------------------//
+
+/**
+ * Compact representation of a command issued to a render backend.
+ * The argument depends on the command: the number of elements drawn,
+ * the number of bytes uploaded, the texture unit or the uniform slot.
+ */
+
+struct API_GRAPHICS RenderCommand
+{
+	RenderCommandType type;
+	uint32 arg;
+	const void* object;
+};
+
+/**
+ * Null render backend that keeps a stream of all the commands issued
+ * to it, so the work done by the renderer can be inspected and counted
+ * without a GPU, for example in benchmarks or regression tests.
+ */
+
+class API_GRAPHICS RecordingRenderBackend : public NullRenderBackend
+{
+public:
+
+	RecordingRenderBackend();
+
+	// Adds the command to the command stream.
+	void recordCommand(RenderCommandType type, const void* object, uint32 arg) OVERRIDE;
+
+	// Gets the recorded commands.
+	GETTER(Commands, const Array<RenderCommand>&, commands)
+
+	// Gets the number of recorded commands of the type.
+	uint32 getCommandCount(RenderCommandType type) const;
+
+	// Clears the recorded commands.
+	void clearCommands();
+
+	// Logs the recorded commands.
+	void logCommands() const;
+
+	// Keeps the command stream, else only the counts are recorded.
+	bool keepCommands;
+
+protected:
+
+	Array<RenderCommand> commands;
+	uint32 commandCounts[(size_t) RenderCommandType::Count];
+};
+
+//-----------------------------------//
+
+NAMESPACE_GRAPHICS_END
\ No newline at end of file
@@ -27,6 +27,7 @@ class RenderBatch;
 class RenderState;
 class RenderView;
 class RenderCapabilities;
+struct Matrix4x4;
 
 class API_GRAPHICS RenderBackend
 {
@@ -36,8 +37,14 @@ public:
 	virtual void cleanup() = 0;
 	virtual void checkCapabilities(RenderCapabilities*) = 0;
 
+	// Called at the end of each frame, after its commands were issued.
+	virtual void endFrame() = 0;
+
 	// Render commands.
 	virtual void renderBatch(RenderBatch*) = 0;
+
+	// Draws the batch once for each of the instance model matrices.
+	virtual void renderBatchInstanced(RenderBatch*, const Matrix4x4* matrices, uint32 count) = 0;
 	virtual void setupRenderState( const RenderState&, bool bindUniforms ) = 0;
 	virtual void unsetupRenderState( const RenderState& ) = 0;
 
@@ -69,6 +76,9 @@ public:
 	virtual Texture* createTexture() = 0;
 	virtual void releaseTexture(Texture*) = 0;
 	virtual void uploadTexture(Texture*) = 0;
+	virtual void uploadTextureMip(Texture*, uint8 level, uint32 width, uint32 height,
+		const uint8* data) = 0;
+	virtual void releaseTextureMips(Texture*, uint8 level) = 0;
 	virtual void configureTexture(Texture*) = 0;
 	virtual void bindTexture(Texture*) = 0;
 	virtual void unbindTexture(Texture*) = 0;
@@ -7,8 +7,6 @@
 
 #pragma once
 
-#ifdef ENABLE_RENDERER_OPENGL
-
 NAMESPACE_GRAPHICS_BEGIN
 
 //-----------------------------------//
@@ -37,10 +35,10 @@ public:
 	bool supportsShaders;
 	bool supportsAnisotropic;
 	bool supportsFixedPipeline;
+	bool supportsUniformBuffers;
+	bool supportsInstancing;
 };
 
 //-----------------------------------//
 
-NAMESPACE_GRAPHICS_END
-
-#endif
\ No newline at end of file
+NAMESPACE_GRAPHICS_END
\ No newline at end of file
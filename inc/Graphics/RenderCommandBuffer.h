@@ -0,0 +1,69 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Graphics/RenderQueue.h"
+
+NAMESPACE_GRAPHICS_BEGIN
+
+//-----------------------------------//
+
+/**
+ * Draw recorded in a command buffer. Instanced draws also keep the
+ * states of the instances, so they can be replayed one by one when the
+ * shader program turns out not to support instancing.
+ */
+
+struct API_GRAPHICS RenderDrawCommand
+{
+	const RenderState* state;
+	const RenderState** instances;
+	Matrix4x4* instanceMatrices;
+	uint32 numInstances;
+};
+
+/**
+ * Holds a list of draws recorded from a slice of the sorted render queue.
+ * The commands do not depend on the render backend, so they can be
+ * recorded by worker threads in parallel and then replayed by the thread
+ * that owns the render context. Each buffer has its own frame allocator
+ * for the per-draw data, so threads recording different buffers do not
+ * share any state.
+ */
+
+class API_GRAPHICS RenderCommandBuffer
+{
+	DECLARE_UNCOPYABLE(RenderCommandBuffer)
+
+public:
+
+	RenderCommandBuffer();
+	~RenderCommandBuffer();
+
+	// Records a draw of the render state.
+	void draw(const RenderState& state);
+
+	// Records an instanced draw of the states. Returns false if there is
+	// not enough frame memory left, in which case nothing is recorded.
+	bool drawInstanced(const RenderState* const* states, uint32 numInstances);
+
+	// Removes the recorded commands and resets the frame allocator.
+	void reset();
+
+	// Gets the recorded commands.
+	GETTER(Commands, const Array<RenderDrawCommand>&, commands)
+
+protected:
+
+	Array<RenderDrawCommand> commands;
+	Allocator* frameAllocator;
+};
+
+//-----------------------------------//
+
+NAMESPACE_GRAPHICS_END
@@ -48,6 +48,9 @@ public:
 	RenderContext();
 	virtual ~RenderContext();
 
+	// Creates a context that uses the given backend.
+	RenderContext(RenderBackend* backend);
+
 	// Makes the context current.
 	virtual void makeCurrent(RenderTarget* target) = 0;
 
@@ -11,9 +11,14 @@
 #include "Core/Math/Color.h"
 #include "Core/Math/Vector.h"
 #include "Core/Math/Matrix4x3.h"
+#include "Core/Math/Matrix4x4.h"
+#include "Core/Concurrency.h"
+#include "Core/Task.h"
 
 #include "Graphics/RenderTarget.h"
 #include "Graphics/RenderQueue.h"
+#include "Graphics/RenderStateCache.h"
+#include "Graphics/TextureStreamer.h"
 
 NAMESPACE_GRAPHICS_BEGIN
 
@@ -43,6 +48,12 @@ class RenderBuffer;
 class RenderContext;
 class RenderBackend;
 class RenderBatch;
+class Buffer;
+class FrameStatistics;
+class RenderCommandBuffer;
+class TaskPool;
+class Task;
+struct RenderRecordJob;
 
 /**
  * Represents the rendering device we are using. At startup the application
@@ -102,11 +113,56 @@ public:
 	// Clears the active render view.
 	void clearView();
 
+	// Tells the backend that the commands of the frame were issued.
+	void endFrame();
+
 	// Returns true if device is using fixed pipeline.
 	bool isFixedPipeline() const;
 
+	// Gets/sets the statistics that the render counters are added to.
+	ACCESSOR(FrameStatistics, FrameStatistics*, frameStats)
+
+	// Gets/sets the task pool used to record the queue in parallel.
+	ACCESSOR(TaskPool, TaskPool*, taskPool)
+
+	// Gets the render state cache.
+	RenderStateCache& getStateCache() { return stateCache; }
+
+	// Gets the texture streamer.
+	TextureStreamer& getTextureStreamer() { return textureStreamer; }
+
 protected:
 
+	// Renders a renderable without unbinding its state. If the number
+	// of instances is given, it is drawn instanced with the instance
+	// matrices.
+	void renderState( const RenderState& state, const LightQueue& lights,
+		uint32 numInstances = 0, const Matrix4x4* instanceMatrices = nullptr );
+
+	// Records the sorted queue into the command buffers. If there is a
+	// task pool, the queue is split in slices recorded in parallel.
+	void recordRenderQueue( const RenderQueue& queue );
+
+	// Records a range of the sorted queue into the command buffer.
+	void recordCommands( RenderCommandBuffer& buffer, const RenderQueue& queue,
+		size_t start, size_t end );
+
+	// Runs a recording task in a task pool thread.
+	void runRecordJob(Task* task);
+
+	// Replays the recorded commands into the render backend.
+	void submitCommands( const RenderCommandBuffer& buffer, const LightQueue& lights );
+
+	// Counts the states from the start of the sorted queue range that
+	// can be drawn together with a single instanced draw.
+	uint32 countInstances( const RenderQueue& queue, size_t start, size_t end );
+
+	// Checks if the program of the state can draw instances.
+	bool isInstancingSupported( const RenderState& state );
+
+	// Unbinds the cached state and updates the frame statistics.
+	void flushState();
+
 	// Forward render state management.
 	bool setupRenderStateMatrix( const RenderState& state );
 	bool setupRenderStateShadow( LightQueue& lights );
@@ -114,11 +170,35 @@ protected:
 	bool setupRenderStateOverlay( const RenderState& );
 
 	void bindTextureUnits(const RenderState& state, bool bindUniforms);
-	void unbindTextureUnits(Material* material);
+
+	// Estimates the size in pixels the state covers in the active view.
+	float getScreenSize(const RenderState& state) const;
 
 	// Binds the buffers needed to draw the batch.
 	bool bindBuffers(RenderBatch*);
-	bool unbindBuffers(RenderBatch*);
+
+	// Checks if the buffer data was streamed in a previous frame.
+	bool isStreamExpired(const Buffer* buffer) const;
+
+	// Sorts the queue by the state keys into the sort order.
+	void sortRenderQueue( RenderQueue& queue );
+
+	// Sorted order of the render queue and sort buffers.
+	Array<uint32> sortOrder;
+	Array<uint32> sortTempOrder;
+	Array<uint64> sortKeys;
+	Array<uint64> sortTempKeys;
+
+	// Command buffers the queue slices are recorded into.
+	Array<RenderCommandBuffer*> commandBuffers;
+	Array<RenderRecordJob*> recordJobs;
+	size_t numCommandBuffers;
+
+	// Slices being recorded by other threads.
+	TaskGroup recordTasks;
+
+	// Task pool used to record the queue in parallel.
+	TaskPool* taskPool;
 
 	// Rendering pipeline.
 	RenderPipeline pipeline;
@@ -135,6 +215,18 @@ protected:
 	// Active view.
 	RenderView* activeView;
 
+	// Filters out the redundant state changes.
+	RenderStateCache stateCache;
+
+	// Uploads the big textures over several frames.
+	TextureStreamer textureStreamer;
+
+	// Statistics of the current frame.
+	FrameStatistics* frameStats;
+
+	// Number of the current frame.
+	uint32 frameNumber;
+
 #if 0
 	ShadowTextureMap shadowTextures;
 	RenderBuffer* shadowDepthBuffer;
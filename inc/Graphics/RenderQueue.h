@@ -41,8 +41,22 @@ public:
 	Material* material;
 	Matrix4x3 modelMatrix;
 	int32 priority;
+
+	// Packed key used to sort the queue (0 if not built yet).
+	uint64 sortKey;
 };
 
+/**
+ * Builds the sort key of a render state. From the most to the least
+ * significant bits it holds the layer, priority, translucency, shader
+ * program, material and texture, with the depth (normalized to [0, 1])
+ * in the lowest bits for opaque states so they draw front-to-back.
+ * Translucent states have the inverted depth in the highest bits after
+ * the translucency flag so they draw back-to-front.
+ */
+
+API_GRAPHICS uint64 RenderStateMakeSortKey(const RenderState& state, float depth);
+
 //-----------------------------------//
 
 /**
@@ -0,0 +1,95 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Graphics/RenderQueue.h"
+#include "Graphics/Texture.h"
+
+NAMESPACE_GRAPHICS_BEGIN
+
+//-----------------------------------//
+
+class RenderBackend;
+class VertexBuffer;
+class IndexBuffer;
+class ShaderProgram;
+
+// Number of texture units tracked by the state cache.
+const uint8 RenderStateCacheTextureUnits = 16;
+
+/**
+ * Sits in front of the render backend and keeps track of the currently
+ * bound program, buffers, textures and raster state. State changes that
+ * would not change what is bound are elided, so consecutive draws that
+ * share state (which is the common case with a sorted queue) only bind
+ * what is different. The state is unbound when the cache is flushed.
+ */
+
+class API_GRAPHICS RenderStateCache
+{
+	DECLARE_UNCOPYABLE(RenderStateCache)
+
+public:
+
+	RenderStateCache();
+
+	// Gets/sets the backend the state changes are issued to.
+	GETTER(Backend, RenderBackend*, backend)
+	void setBackend(RenderBackend* backend);
+
+	// Binds the vertex buffer and sets up its vertex format.
+	void bindVertexBuffer(VertexBuffer* vb);
+
+	// Binds the index buffer.
+	void bindIndexBuffer(IndexBuffer* ib);
+
+	// Binds the shader program.
+	void bindProgram(ShaderProgram* program);
+
+	// Binds the texture to the texture unit. The bind is only elided when
+	// the texture unit also has the same sampler modes.
+	void bindTexture(Texture* texture, const TextureUnit& unit);
+
+	// Sets up the raster state of the render state material.
+	void setRasterState(const RenderState& state);
+
+	// Forgets the bound buffers, for when the backend bound other ones.
+	void invalidateBuffers();
+
+	// Forgets the bound textures, for when the backend bound other ones.
+	void invalidateTextures();
+
+	// Unbinds all the bound state.
+	void flush();
+
+	// Number of state changes issued to the backend.
+	uint32 numStateChanges;
+
+	// Number of state changes elided by the cache.
+	uint32 numStateChangesElided;
+
+protected:
+
+	RenderBackend* backend;
+
+	VertexBuffer* vertexBuffer;
+	IndexBuffer* indexBuffer;
+	ShaderProgram* program;
+
+	Texture* textures[RenderStateCacheTextureUnits];
+
+	// Copies of the sampler modes of the bound texture units.
+	TextureUnit textureUnits[RenderStateCacheTextureUnits];
+
+	RenderState rasterState;
+	bool hasRasterState;
+};
+
+//-----------------------------------//
+
+NAMESPACE_GRAPHICS_END
@@ -93,6 +93,12 @@ public:
 	// Gets the buffer number of bytes.
 	uint32 getSize();
 
+	// Gets the memory used by the image data.
+	uint64 getMemoryUsage() const OVERRIDE;
+
+	// Releases the image data.
+	bool unload() OVERRIDE;
+
 	// Return the proper resource group for this resource.
 	GETTER(ResourceGroup, ResourceGroup, ResourceGroup::Images)
 
@@ -109,6 +109,12 @@ public:
 	// Gets/sets the backface culling of the material.
 	ACCESSOR(BackfaceCulling, bool, cullBackfaces)
 
+	// Gets/sets if the material uses the lighting permutation of its shader.
+	ACCESSOR(Lighting, bool, lighting)
+
+	// Gets/sets if the material uses the fog permutation of its shader.
+	ACCESSOR(Fog, bool, fog)
+
 	// Gets the blending options for this material.
 	GETTER(BlendSource, BlendSource, source)
 	
@@ -164,6 +170,10 @@ public:
 	bool lineSmooth;
 	float lineWidth;
 
+	// Shader permutation settings.
+	bool lighting;
+	bool fog;
+
 	// Blending settings.
 	BlendSource source;
 	BlendDestination destination;
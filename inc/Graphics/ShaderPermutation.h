@@ -0,0 +1,60 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Graphics/API.h"
+
+NAMESPACE_GRAPHICS_BEGIN
+
+//-----------------------------------//
+
+/**
+ * Features that select a permutation of a shader. A shader opts in to a
+ * feature by testing its define (FLD_SKINNING, FLD_LIGHTING or FLD_FOG)
+ * with the preprocessor, and each combination of the features it tests
+ * is compiled to its own program.
+ */
+
+struct ShaderFeature
+{
+	enum Enum
+	{
+		Skinning = 1 << 0,
+		Lighting = 1 << 1,
+		Fog      = 1 << 2
+	};
+};
+
+// Number of shader features.
+const uint32 ShaderFeatureCount = 3;
+
+// Mask of the features of a shader permutation.
+typedef uint32 ShaderPermutationKey;
+
+// Gets the preprocessor define of the feature.
+API_GRAPHICS const char* ShaderFeatureGetDefine(ShaderFeature::Enum);
+
+// Gets the mask of the features whose defines are used in the source.
+API_GRAPHICS ShaderPermutationKey ShaderPermutationGetFeatures(const char* source);
+
+// Gets the keys of all the permutations of the given features.
+API_GRAPHICS void ShaderPermutationGetKeys(ShaderPermutationKey features,
+	Array<ShaderPermutationKey>& keys);
+
+// Gets the source of the permutation, with the defines of its features
+// added after the version directive.
+API_GRAPHICS String ShaderPermutationExpand(const char* source, ShaderPermutationKey key);
+
+// Checks that the preprocessor conditionals of the source are balanced
+// and that the version directive comes first, so the defines can be
+// added. Returns false with the reason in the error.
+API_GRAPHICS bool ShaderPermutationValidate(const String& source, String& error);
+
+//-----------------------------------//
+
+NAMESPACE_GRAPHICS_END
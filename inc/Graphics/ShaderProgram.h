@@ -52,6 +52,9 @@ public:
 	// Returns if this program has been successfully linked.
 	virtual bool isLinked() const;
 
+	// Returns if the program can read the model matrix from instance data.
+	bool isInstancingSupported() const;
+
 	// Gets the linking log.
 	GETTER(Log, const String&, log)
 
@@ -82,6 +85,7 @@ protected:
 
 	String log;
 	bool linked;
+	bool supportsInstancing;
 };
 
 TYPEDEF_INTRUSIVE_POINTER_FROM_TYPE( ShaderProgram );
@@ -9,6 +9,7 @@
 
 #include "Graphics/API.h"
 #include "Core/References.h"
+#include "Graphics/ShaderPermutation.h"
 
 FWD_DECL_INTRUSIVE(ShaderProgram)
 
@@ -18,7 +19,17 @@ NAMESPACE_GRAPHICS_BEGIN
 
 class ShaderMaterial;
 
-typedef HashMap<ShaderProgramPtr> ShaderProgramsMap; // keyed by const ShaderMaterial*
+// Programs of the permutations of a shader.
+struct ShaderPermutations
+{
+	// Features used by the shader source.
+	ShaderPermutationKey features;
+
+	// Programs of the permutations that were requested.
+	HashMap<ShaderProgramPtr> programs; // keyed by ShaderPermutationKey
+};
+
+typedef HashMap<ShaderPermutations*> ShaderProgramsMap; // keyed by const ShaderMaterial*
 
 class ResourceManager;
 struct ResourceEvent;
@@ -40,14 +51,24 @@ public:
 	ProgramManager(RenderBackend* backend);
 	~ProgramManager();
 
-	// Gets a program given a shader identifier.
-	ShaderProgram* getProgram( const ShaderMaterial*, bool precompile = false );
+	// Gets the program of the shader permutation. The features of the key
+	// that the shader does not use are ignored.
+	ShaderProgram* getProgram( const ShaderMaterial*, ShaderPermutationKey key = 0 );
 
-	// Creates a program given a shader.
-	ShaderProgram* createProgram( const ShaderMaterial* shader );
+	// Creates the program of a shader permutation.
+	ShaderProgram* createProgram( const ShaderMaterial* shader, ShaderPermutationKey key );
 
 	// Registers a new program in the manager.
-	bool registerProgram( const ShaderMaterial*, ShaderProgram* program );
+	bool registerProgram( const ShaderMaterial*, ShaderPermutationKey, ShaderProgram* );
+
+	// Links the programs of all the permutations of the shader.
+	void precompileProgram( const ShaderMaterial* );
+
+	// Gets the number of programs linked by the precompilation.
+	GETTER(NumPrecompiled, uint32, numPrecompiled)
+
+	// Gets the time spent linking the programs by the precompilation.
+	GETTER(PrecompileTime, float, precompileTime)
 
 protected:
 
@@ -57,9 +78,15 @@ protected:
 	// Reloads a shader when the text file changes.
 	void onReload( const ResourceEvent& event );
 
+	// Gets the permutations of the shader, creating them if needed.
+	ShaderPermutations* getPermutations( const ShaderMaterial* );
+
 	// Maps the identifiers to the programs.
 	ShaderProgramsMap programs;
 
+	uint32 numPrecompiled;
+	float precompileTime;
+
 	RenderBackend* backend;
 };
 
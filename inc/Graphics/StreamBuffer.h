@@ -0,0 +1,72 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Graphics/API.h"
+
+NAMESPACE_GRAPHICS_BEGIN
+
+//-----------------------------------//
+
+// Maximum number of frames whose stream data can be in flight.
+const uint32 StreamBufferMaxFrames = 4;
+
+/**
+ * Keeps track of the space of a ring buffer used to stream dynamic data
+ * to the GPU. Each frame sub-allocates its data after the data of the
+ * previous frames, wrapping around at the end of the buffer. The space
+ * of a frame is only reused once the backend knows the GPU is done with
+ * it (usually by waiting on a fence inserted at the end of the frame),
+ * so the data can be written without synchronizing with the driver.
+ */
+
+class API_GRAPHICS StreamBuffer
+{
+public:
+
+	StreamBuffer();
+
+	// Resets the buffer to the given capacity, with no frames in flight.
+	void reset(uint32 capacity);
+
+	// Sub-allocates space in the current frame. Returns false if there
+	// is not enough space left without reusing frames still in flight.
+	bool allocate(uint32 size, uint32 align, uint32& offset);
+
+	// Ends the current frame. There can not be more than the maximum
+	// number of frames in flight when it is called.
+	void endFrame();
+
+	// Releases the space used by the oldest frame in flight.
+	void releaseFrame();
+
+	// Gets the number of frames in flight.
+	GETTER(NumFrames, uint32, numFrames)
+
+	// Gets the capacity of the buffer.
+	GETTER(Capacity, uint32, capacity)
+
+	// Gets the number of bytes allocated in the current frame.
+	GETTER(FrameSize, uint32, frameSize)
+
+protected:
+
+	uint32 capacity;
+	uint32 head;
+	uint32 used;
+	uint32 frameSize;
+
+	// Ring of the sizes of the frames in flight.
+	uint32 frameSizes[StreamBufferMaxFrames];
+	uint32 firstFrame;
+	uint32 numFrames;
+};
+
+//-----------------------------------//
+
+NAMESPACE_GRAPHICS_END
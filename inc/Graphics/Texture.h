@@ -90,6 +90,12 @@ public:
 	PixelFormat format;
 	float anisotropicFilter;
 
+	// Number of mip levels and the most detailed level uploaded. When
+	// the texture is streamed, no level is uploaded until it is equal
+	// to the number of levels minus one.
+	uint8 numMips;
+	uint8 residentMip;
+
 private:
 
     ImageHandle image;
@@ -0,0 +1,131 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Graphics/Texture.h"
+#include "Core/Concurrency.h"
+#include "Core/Task.h"
+
+NAMESPACE_GRAPHICS_BEGIN
+
+//-----------------------------------//
+
+class RenderBackend;
+class FrameStatistics;
+
+/**
+ * Mip chain of a texture staged in a worker thread. The most detailed
+ * level uses the data of the image, the other levels are filtered down
+ * from it.
+ */
+
+struct TextureStreamEntry
+{
+	TexturePtr texture;
+	ImageHandle image;
+
+	Task task;
+
+	// Filtered data of the levels after the first.
+	Array<Array<uint8>*> mips;
+
+	// Most detailed level requested by the draws of the frame.
+	uint8 requestedMip;
+
+	// Most detailed level requested since the resident levels were
+	// last needed, and the number of frames since then.
+	uint8 idleMip;
+	uint32 numIdleFrames;
+
+	// Keeps if the mips are being staged, if they are staged, and if
+	// the image changed while they were being staged.
+	bool isStaging;
+	bool isStaged;
+	bool isStale;
+};
+
+/**
+ * Streams big textures to the GPU over several frames. The mip chain of
+ * a texture is built in the task pool, then the levels are uploaded from
+ * the smallest to the most detailed, so the texture can be drawn with a
+ * blurry version right away. Each frame uploads levels up to a byte
+ * budget, and only up to the detail requested by the draws, which is
+ * estimated from the scale and distance of the objects. When no draw
+ * needed more than the resident levels for a while, the staged mips are
+ * freed and the levels finer than any draw requested are dropped. The
+ * mips are staged again when more detail is requested.
+ */
+
+class API_GRAPHICS TextureStreamer
+{
+	DECLARE_UNCOPYABLE(TextureStreamer)
+
+public:
+
+	TextureStreamer();
+	~TextureStreamer();
+
+	// Starts streaming the texture, staging it in the task pool if there
+	// is one. Returns false if the texture should be uploaded at once.
+	bool stream(Texture*, TaskPool*);
+
+	// Requests the detail needed to cover the estimated size on screen.
+	void request(Texture*, float screenSize);
+
+	// Uploads the staged levels that were requested, the smallest first,
+	// until the upload budget of the frame is spent, and drops the levels
+	// that went unused.
+	void update(RenderBackend*, FrameStatistics*);
+
+	// Checks if the texture is being streamed.
+	bool isStreaming(Texture*) const;
+
+	// Gets/sets the bytes that can be uploaded in a frame.
+	ACCESSOR(UploadBudget, uint32, uploadBudget)
+
+protected:
+
+	// Builds the mip chain of the texture in a task pool thread.
+	void stage(Task*);
+
+	// Starts staging the entry. If the levels are reset, none of the
+	// levels of the texture are considered uploaded.
+	void startStaging(TextureStreamEntry*, TaskPool*, bool resetLevels);
+
+	// Uploads the requested levels of the staged entries.
+	uint32 uploadLevels(RenderBackend*, const Array<TextureStreamEntry*>& staged);
+
+	// Frees the staged mips of the entry.
+	void freeMips(TextureStreamEntry*);
+
+	// Gets an entry that is not in use.
+	TextureStreamEntry* allocateEntry();
+
+	// Stops streaming the texture of the entry.
+	void removeEntry(TextureStreamEntry*);
+
+	// Entries of the textures being streamed.
+	typedef HashMap<TextureStreamEntry*> TextureStreamMap; // keyed by Texture*
+	TextureStreamMap entries;
+
+	// Entries of the textures that are not streamed anymore.
+	Array<TextureStreamEntry*> freeEntries;
+
+	// Tasks staging the mips of the entries.
+	TaskGroup stagingTasks;
+
+	// Protects the staging state of the entries.
+	Mutex mutex;
+
+	TaskPool* taskPool;
+	uint32 uploadBudget;
+};
+
+//-----------------------------------//
+
+NAMESPACE_GRAPHICS_END
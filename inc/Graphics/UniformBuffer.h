@@ -33,39 +33,105 @@ enum struct UniformDataType : uint8
 	Matrix4x3_F
 };
 
+/**
+ * Uniform names are mapped to global slots, so that programs can resolve
+ * the location of each uniform once when they are linked and buffers can
+ * store their uniforms in flat arrays instead of looking them up by name.
+ */
+
+typedef uint16 UniformSlot;
+const UniformSlot UniformSlotInvalid = 0xFFFF;
+
+// Gets the slot of the named uniform, registering it if needed.
+API_GRAPHICS UniformSlot UniformSlotGet(const char* name);
+
+// Gets the slot of the named uniform if it is registered.
+API_GRAPHICS UniformSlot UniformSlotFind(const char* name);
+
+// Gets the name of the uniform slot.
+API_GRAPHICS const char* UniformSlotGetName(UniformSlot slot);
+
+// Gets the number of registered uniform slots.
+API_GRAPHICS uint16 UniformSlotGetCount();
+
+//-----------------------------------//
+
 /**
  * Uniforms are named constants that can be set in programs.
- * These are allocated from a special frame bump allocator,
- * that frees all the memory when the frame ends.
+ * These are owned by the buffer and kept between frames, so
+ * they only need to be uploaded again when their data changes.
  */
 
 struct API_GRAPHICS UniformBufferElement
 {
 	const char* name;
+	UniformSlot slot;
 	UniformDataType type;
 	uint16 count;
+	uint32 size;
+	uint32 capacity;
 	uint8 data[1]; // Variable length data.
 };
 
 //-----------------------------------//
 
-typedef HashMap<UniformBufferElement*> UniformBufferElements; // keyed by String
+typedef Array<UniformBufferElement*> UniformBufferElements; // indexed by slot
+
+class ShaderProgram;
 
 /**
- * Represents a uniform buffer.
+ * Represents a uniform buffer. Each element has a dirty bit that is
+ * set when its data changes, so programs only have to upload the
+ * elements that changed since the buffer was last uploaded to them.
  */
 
 class API_GRAPHICS UniformBuffer : public ReferenceCounted
 {
 public:
 
+	UniformBuffer();
+	~UniformBuffer();
+
 	UniformBufferElements elements;
 
+	// Bits of the elements that changed since the last upload.
+	Array<uint32> dirty;
+
+	// Program the buffer was last uploaded to.
+	ShaderProgram* lastProgram;
+
 	// Gets the uniform if it exists or creates a new one.
 	UniformBufferElement* getElement(const char* name, size_t size);
+	UniformBufferElement* getElement(UniformSlot slot, size_t size);
+
+	// Gets the uniform in the slot if it exists.
+	UniformBufferElement* findElement(UniformSlot slot) const;
 
 	// Removes the named uniform.
 	void removeUniform( const char* slot );
+	void removeUniform( UniformSlot slot );
+
+	// Checks if the uniform in the slot changed since the last upload.
+	bool isDirty( UniformSlot slot ) const;
+
+	// Marks the uniform in the slot as changed.
+	void setDirty( UniformSlot slot );
+
+	// Marks all the uniforms as uploaded.
+	void clearDirty();
+
+	// Sets the uniform data, marking it dirty only if it changed.
+	void setElement( UniformSlot slot, UniformDataType type, uint16 count,
+		const void* data, size_t size );
+
+	// Slot-indexed versions of the named setters.
+	void setUniform( UniformSlot slot, int32 data );
+	void setUniform( UniformSlot slot, float value );
+	void setUniform( UniformSlot slot, const Array<Vector3>& vec );
+	void setUniform( UniformSlot slot, const Vector3& vec );
+	void setUniform( UniformSlot slot, const Matrix4x3& );
+	void setUniform( UniformSlot slot, const Matrix4x4& );
+	void setUniform( UniformSlot slot, const Array<Matrix4x4>& vec );
 
 	// Adds a uniform to the shader.
 	void setUniform( const char* slot, int32 data );
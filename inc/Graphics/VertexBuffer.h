@@ -34,6 +34,10 @@ enum class VertexAttribute : uint8
 	TexCoord5,
 	TexCoord6,
 	TexCoord7,
+
+	// Per-instance model matrix. Uses four consecutive locations,
+	// so it can not be used together with TexCoord6 and TexCoord7.
+	InstanceMatrix = TexCoord6,
 };
 
 enum class VertexDataType : uint8
@@ -0,0 +1,52 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "ResourceProcessor.h"
+#include "Graphics/Resources/ShaderMaterial.h"
+#include "Graphics/ShaderPermutation.h"
+
+NAMESPACE_PIPELINE_BEGIN
+
+//-----------------------------------//
+
+/**
+ * Generates the permutations of the shader features used by a shader and
+ * checks their sources, so broken permutations are found when building
+ * the assets instead of when they are first drawn.
+ */
+
+API_PIPELINE REFLECT_DECLARE_CLASS(ShaderProcessor)
+
+class API_PIPELINE ShaderProcessor : public ResourceProcessor
+{
+	REFLECT_DECLARE_OBJECT(ShaderProcessor)
+
+public:
+
+	ShaderProcessor();
+
+	// Gets metadata about this extension.
+	ExtensionMetadata* getMetadata() OVERRIDE;
+
+	// Processes the given resource.
+	bool Process(const ResourcePtr& resource);
+
+	// Gets the processed resource type.
+	Class* GetResourceType() { return ShaderMaterialGetType(); }
+
+	// Validates the sources of the permutations.
+	bool validatePermutations;
+
+	// Keys of the permutations of the last processed shader.
+	Array<ShaderPermutationKey> permutations;
+};
+
+//-----------------------------------//
+
+NAMESPACE_PIPELINE_END
@@ -28,7 +28,8 @@ enum class ResourceStatus
 	Error = 0,
 	Unloaded,
 	Loading,
-	Loaded
+	Loaded,
+	Evicted // unloaded to fit the memory budgets, reloaded when used
 };
 
 API_RESOURCE REFLECT_DECLARE_ENUM(ResourceStatus)
@@ -94,6 +95,13 @@ public:
 	/// Gets the resource group associated with this resource.
 	virtual ResourceGroup getResourceGroup() const = 0;
 
+	/// Gets the memory used by the resource data, or 0 if not known.
+	virtual uint64 getMemoryUsage() const;
+
+	/// Releases the resource data so that it can be loaded again later.
+	/// Returns false if the resource does not support being unloaded.
+	virtual bool unload();
+
 	/// Path to the resource.
 	Path path;
 
@@ -103,6 +111,9 @@ public:
 	/// Resource stream.
 	ResourceStream* stream;
 
+	/// Frame when the resource data was last used.
+	Atomic<uint32> lastAccess;
+
 protected:
 
 	Resource();
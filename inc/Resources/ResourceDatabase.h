@@ -18,8 +18,14 @@ API_RESOURCE REFLECT_DECLARE_CLASS(ResourceMetadata)
 
 struct API_RESOURCE ResourceMetadata
 {
+	ResourceMetadata() : hash(0), legacyHash(0) {}
+
 	// Hash of the resource.
-	uint32 hash;
+	uint64 hash;
+
+	// 32-bit hash of the databases saved before the hashes were widened.
+	// It is only kept so that those databases can still be read.
+	uint32 legacyHash;
 
 	// Path to the resource.
 	Path path;
@@ -32,7 +38,7 @@ struct API_RESOURCE ResourceMetadata
 };
 
 typedef Array<ResourceMetadata> ResourcesCache;
-typedef HashMap<ResourceMetadata> ResourcesCacheMap; // keyed by uint32
+typedef HashMap<ResourceMetadata> ResourcesCacheMap; // keyed by hash
 
 //-----------------------------------//
 
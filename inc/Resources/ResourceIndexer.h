@@ -21,30 +21,113 @@ NAMESPACE_RESOURCES_BEGIN
 class Archive;
 class ResourceDatabase;
 
+API_RESOURCE REFLECT_DECLARE_CLASS(ResourceIndexEntry)
+
+/**
+ * Indexing information of a resource file. The file size and modification
+ * time are used to know if the cached content hash is still up-to-date.
+ */
+
+struct API_RESOURCE ResourceIndexEntry
+{
+	// Path to the resource.
+	Path path;
+
+	// Size of the resource file.
+	uint64 size;
+
+	// Last modification time of the resource file.
+	uint64 modifiedTime;
+
+	// Content hash of the resource.
+	uint64 hash;
+
+	// Group of the resource.
+	ResourceGroup group;
+};
+
+typedef HashMap<uint32> ResourceIndexEntryMap; // keyed by path hash
+
+//-----------------------------------//
+
+/**
+ * Persistent cache of indexed resources. It is kept between runs so that
+ * only new or modified files need to be read and hashed when indexing.
+ */
+
+API_RESOURCE REFLECT_DECLARE_CLASS(ResourceIndexCache)
+
+class API_RESOURCE ResourceIndexCache : public Object
+{
+	REFLECT_DECLARE_OBJECT(ResourceIndexCache)
+
+public:
+
+	ResourceIndexCache();
+
+	// Finds an entry for the file if it has not changed since indexed.
+	bool findEntry(const Path& path, uint64 size, uint64 modifiedTime,
+		ResourceIndexEntry& entry);
+
+	// Adds or updates an entry in the cache.
+	void setEntry(const ResourceIndexEntry& entry);
+
+	// Serialization fix-up.
+	void fixUp() OVERRIDE;
+
+	Array<ResourceIndexEntry> entries;
+	ResourceIndexEntryMap entriesMap;
+	Mutex mutex;
+	bool isDirty;
+};
+
+//-----------------------------------//
+
 /**
- * Monitors the given archives and indexes all new resources.
+ * Monitors the given archives and indexes all new resources. Files are
+ * indexed in batches, and only the files not found in the index cache
+ * are streamed in and hashed.
  */
 
 class API_RESOURCE ResourceIndexer
 {
 public:
 
-	ResourceIndexer();
+	// Loads the index cache from the path, which is usually next to the
+	// resource database. The cache is saved when the queued files are
+	// indexed and when the indexer is destroyed. An empty path turns off
+	// the persistent cache.
+	explicit ResourceIndexer(const Path& cachePath);
 	~ResourceIndexer();
 
+	// Sets the path of the index cache and loads it. An empty path turns
+	// off the persistent cache.
+	void setCachePath(const Path& path);
+
 	// Adds a new archive to be indexed.
 	void addArchive(Archive* archive);
 
 	// Updates the resource indexer.
 	void update();
 
+	// Loads the index cache from a file.
+	bool loadCache(const Path& path);
+
+	// Saves the index cache to a file if it was modified.
+	bool saveCache(const Path& path);
+
 	// Called when a resource is indexed.
 	Event1<const ResourceMetadata&> onResourceIndexed;
 
-	// Indexes found resources.
+	// Indexes a batch of found resources.
 	void indexResources(Task*);
 
 	ConcurrentQueue<ResourceMetadata> resourcesIndexed;
+	ResourceIndexCache* cache;
+	Path cachePath;
+
+	// Number of batches of files still being indexed.
+	Atomic<int32> numPendingBatches;
 };
 
 //-----------------------------------//
@@ -0,0 +1,84 @@
+/************************************************************************
+*
+* Flood Project © (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Resources/API.h"
+#include "Core/Concurrency.h"
+#include "Core/Timer.h"
+
+NAMESPACE_RESOURCES_BEGIN
+
+//-----------------------------------//
+
+class TaskPool;
+
+/**
+ * Groups a set of resource loads so that their progress can be tracked.
+ * The batch acts as a future for its resources: it can be polled every
+ * frame (for example to update a loading screen) or waited on, in which
+ * case the waiting thread can help decoding the queued resources.
+ */
+
+class API_RESOURCE ResourceLoadBatch
+{
+	DECLARE_UNCOPYABLE(ResourceLoadBatch)
+
+public:
+
+	ResourceLoadBatch();
+	~ResourceLoadBatch();
+
+	// Gets the number of loaded resources.
+	uint32 getResourcesDone() const;
+
+	// Gets the number of resources in the batch.
+	uint32 getResourcesTotal() const;
+
+	// Gets the number of bytes of the loaded resources.
+	uint64 getBytesDone() const;
+
+	// Gets the number of bytes of all the resources in the batch.
+	uint64 getBytesTotal() const;
+
+	// Gets the loading progress, in the [0, 1] range.
+	float getProgress() const;
+
+	// Gets the estimated time left in seconds, or -1 if unknown.
+	float getEstimatedTimeLeft() const;
+
+	// Checks if all the resources in the batch are done loading.
+	bool isDone() const;
+
+	// Waits until all the resources are done loading. If a task pool is
+	// given, the calling thread runs its queued tasks while waiting.
+	void wait(TaskPool* helpPool = nullptr);
+
+	// Adds a resource of the given size to the batch.
+	void addResource(uint64 bytes);
+
+	// Marks a resource of the batch as loaded.
+	void finishResource(uint64 bytes);
+
+	// Removes a resource that will not be loaded from the batch.
+	void cancelResource(uint64 bytes);
+
+protected:
+
+	uint32 resourcesDone;
+	uint32 resourcesTotal;
+	uint64 bytesDone;
+	uint64 bytesTotal;
+
+	mutable Timer timer;
+	mutable Mutex mutex;
+	Condition finished;
+};
+
+//-----------------------------------//
+
+NAMESPACE_RESOURCES_END
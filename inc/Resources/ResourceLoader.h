@@ -26,6 +26,8 @@ struct API_RESOURCE ResourceLoadOption
 
 //-----------------------------------//
 
+class ResourceLoadBatch;
+
 struct API_RESOURCE ResourceLoadOptions
 {
 	ResourceLoadOptions();
@@ -39,11 +41,26 @@ struct API_RESOURCE ResourceLoadOptions
 	Resource* resource;
 	ResourceGroup group;
 
+	// Priority of the load, higher priorities are decoded first.
+	int16 priority;
+
+	// Seconds after which the load is decoded before any other, 0 if none.
+	float deadline;
+
+	// Batch used to track the progress of the load, if any.
+	ResourceLoadBatch* batch;
+
 	bool isHighPriority;
 	bool sendLoadEvent;
 	bool asynchronousLoad;
 	bool keepStreamOpen;
 
+	// Set by the loader when the remaining data is decoded in chunks.
+	bool decodeInChunks;
+
+	// Loader state kept between the decoded chunks.
+	void* decodeState;
+
 	ResourceLoadOption option;
 };
 
@@ -96,12 +113,18 @@ public:
 	// Gets metadata about this extension.
 	virtual ExtensionMetadata* getMetadata() OVERRIDE;
 
-	// Creates the resource with no data (no I/O here).
+	// Creates the resource with no data (only headers can be read here).
 	virtual Resource* prepare(ResourceLoadOptions&) = 0;
 
-	// Decodes a given file into a resource.
+	// Decodes a given file into a resource. Loaders of big resources can
+	// decode just enough data for the resource to be usable, and set the
+	// decodeInChunks option to have the rest decoded with decodeChunk.
 	virtual bool decode(ResourceLoadOptions&) = 0;
 
+	// Decodes the next chunk of a resource decoded in chunks. The loader
+	// clears the decodeInChunks option when the last chunk is decoded.
+	virtual bool decodeChunk(ResourceLoadOptions&);
+
 	// Gets the name of this loader.
 	virtual const String getName() const = 0;
 
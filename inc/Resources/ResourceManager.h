@@ -26,6 +26,11 @@ struct FileWatchEvent;
 class ResourceTask;
 class ResourceManager;
 
+void ResourceTaskRun(Task* task);
+void ResourceChunkTaskRun(Task* task);
+void ResourceTaskFinish(ResourceLoadOptions* options);
+bool ResourceChunkDecode(ResourceLoadOptions* options);
+
 FWD_DECL_INTRUSIVE(ResourceLoader)
 
 //-----------------------------------//
@@ -59,9 +64,11 @@ typedef ConcurrentQueue<ResourceEvent> ResourceEventQueue;
 
 /**
  * Responsible for managing a set of resources that are added by the app.
- * It should be possible to enforce a strict memory budget, and the manager
- * will automatically load or unload the resources from memory, using for 
- * example an LRU policy.
+ * A memory budget can be set for each resource group, and the manager will
+ * automatically unload the least recently used resources of the group that
+ * were not used for a while and are not held by anyone else. Evicted
+ * resources are loaded again as soon as they are used, either by name or
+ * through touchResource.
  *
  * Each resource is mapped by an extension to a specific resource handler.
  * Various resource handlers can be registered to the same type and the one
@@ -73,6 +80,9 @@ typedef ConcurrentQueue<ResourceEvent> ResourceEventQueue;
 class API_RESOURCE ResourceManager
 {
 	friend void ResourceTaskRun(Task* task);
+	friend void ResourceChunkTaskRun(Task* task);
+	friend void ResourceTaskFinish(ResourceLoadOptions* options);
+	friend bool ResourceChunkDecode(ResourceLoadOptions* options);
 
 public:
 
@@ -101,9 +111,30 @@ public:
 	// Removes unused resources.
 	void removeUnusedResources();
 
-	// Waits until all queued resources are loaded.
+	// Changes the priority of a resource that is still queued for loading.
+	bool setLoadPriority(const ResourceHandle& handle, int16 priority);
+
+	// Cancels the loading of a resource that did not start decoding yet.
+	// The resource is left unloaded and it is queued again when loaded.
+	bool cancelLoad(const ResourceHandle& handle);
+
+	// Waits until all queued resources are loaded. The calling thread
+	// helps decoding the queued resources while waiting.
 	void loadQueuedResources();
 
+	// Sets the memory budget in bytes of a resource group (0 for none).
+	void setMemoryBudget(ResourceGroup group, uint64 bytes);
+
+	// Gets the memory budget in bytes of a resource group.
+	uint64 getMemoryBudget(ResourceGroup group) const;
+
+	// Gets the memory used by the loaded resources of a resource group.
+	uint64 getMemoryUsage(ResourceGroup group) const;
+
+	// Marks the resource data as used in this frame. If the resource was
+	// unloaded to fit its memory budget it is queued to load again.
+	void touchResource(Resource* resource);
+
 	// Sends resource events to the subscribers.
 	void update();
 
@@ -173,6 +204,7 @@ public:
 	Event1< const ResourceEvent& > onResourceLoaded;
 	Event1< const ResourceEvent& > onResourceRemoved;
 	Event1< const ResourceEvent& > onResourceReloaded;
+	Event1< const ResourceEvent& > onResourceStreamed;
 	Event1< const ResourceLoader&> onResourceLoaderRegistered;
 
 protected:
@@ -186,12 +218,18 @@ protected:
 	// Processes the resource with the right resource loader.
 	void decodeResource( ResourceLoadOptions& options );
 
+	// Queues an unloaded resource to be decoded again.
+	bool requeueResource( Resource* resource, ResourceLoadOptions& options );
+
 	// Watches a resource for changes and auto-reloads it.
 	void handleWatchResource(Archive*, const FileWatchEvent& event);
 
 	// Sends pending resource events.
 	void sendPendingEvents();
 
+	// Unloads the least recently used resources of groups over budget.
+	void enforceMemoryBudgets();
+
 	// Destroy the resource handles.
 	void destroyHandles();
 
@@ -207,6 +245,9 @@ protected:
 	// When tasks finish, they queue an event.
 	ResourceEventQueue resourceEvents;
 
+	// When chunks of resources are decoded, they queue an event.
+	ResourceEventQueue resourceStreamEvents;
+
 	// Keeps track if asynchronous loading is enabled.
 	bool asynchronousLoading;
 
@@ -217,8 +258,21 @@ protected:
 	Condition* resourceFinishLoad;
 	Mutex* resourceFinishLoadMutex;
 
+	// Maps a name to the load tasks that did not start yet.
+	HashMap<Task*> pendingLoads;
+	Mutex* pendingLoadsMutex;
+
 	// Number of resources queued for loading.
 	Atomic<uint32> numResourcesQueuedLoad;
+
+	// Memory budgets of the resource groups.
+	HashMap<uint64> memoryBudgets; // keyed by group
+
+	// Guards the unloading and reloading of the evicted resources.
+	Mutex* evictionMutex;
+
+	// Current frame, used to track when resources were last used.
+	uint32 currentFrame;
 };
 
 //-----------------------------------//
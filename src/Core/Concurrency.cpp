@@ -9,6 +9,7 @@
 #include "Core/Concurrency.h"
 #include "Core/Log.h"
 #include "Core/Task.h"
+#include <algorithm>
 
 NAMESPACE_CORE_BEGIN
 
@@ -35,7 +36,9 @@ Thread::~Thread()
 Task::Task()
 	: group(0)
 	, priority(0)
+	, deadline(0)
 	, userdata(nullptr)
+	, taskGroup(nullptr)
 {
 }
 
@@ -43,17 +46,278 @@ Task::Task()
 
 void Task::run()
 {
+	TaskGroup* group = taskGroup;
+	taskGroup = nullptr;
+
 	callback(this);
+
+	if (group)
+		group->finishTask(this);
+}
+
+//-----------------------------------//
+
+TaskQueue::TaskQueue()
+	: sequence(0)
+	, nextId(0)
+	, isClosed(false)
+{
+}
+
+//-----------------------------------//
+
+void TaskQueue::push(Task* task)
+{
+	mutex.lock();
+
+	Entry entry;
+	entry.task = task;
+	entry.dueTime = (task->deadline > 0) ? timer.getElapsed() + task->deadline : 0;
+	entry.priority = task->priority;
+	entry.sequence = sequence++;
+	pushEntry(entry);
+
+	mutex.unlock();
+
+	condition.wakeOne();
+}
+
+//-----------------------------------//
+
+static uint64 GetTaskKey(Task* task)
+{
+	return (uint64) (uintptr_t) task;
+}
+
+// Orders the heap with the highest priority and then oldest task on top.
+static bool CompareTaskEntryPriority(const TaskQueue::Entry& a, const TaskQueue::Entry& b)
+{
+	if (a.priority != b.priority)
+		return a.priority < b.priority;
+
+	return a.sequence > b.sequence;
+}
+
+// Orders the heap with the earliest deadline on top.
+static bool CompareTaskEntryDeadline(const TaskQueue::Entry& a, const TaskQueue::Entry& b)
+{
+	if (a.dueTime != b.dueTime)
+		return a.dueTime > b.dueTime;
+
+	return a.sequence > b.sequence;
+}
+
+//-----------------------------------//
+
+void TaskQueue::pushEntry(Entry entry)
+{
+	entry.id = nextId++;
+	queued.set(GetTaskKey(entry.task), entry);
+
+	byPriority.pushBack(entry);
+	std::push_heap(byPriority.begin(), byPriority.end(), CompareTaskEntryPriority);
+
+	if (entry.dueTime > 0)
+	{
+		byDeadline.pushBack(entry);
+		std::push_heap(byDeadline.begin(), byDeadline.end(), CompareTaskEntryDeadline);
+	}
+
+	// Rebuild the heaps when most of their entries are stale.
+	size_t numQueued = queued.size();
+	
+	if (byPriority.size() + byDeadline.size() > 4 * numQueued + 64)
+		compact();
+}
+
+//-----------------------------------//
+
+bool TaskQueue::isQueued(const Entry& entry) const
+{
+	uint64 key = GetTaskKey(entry.task);
+	return queued.has(key) && queued.get(key, entry).id == entry.id;
+}
+
+//-----------------------------------//
+
+void TaskQueue::compact()
+{
+	size_t live = 0;
+
+	for (size_t i = 0; i < byPriority.size(); ++i)
+	{
+		if (isQueued(byPriority[i]))
+			byPriority[live++] = byPriority[i];
+	}
+
+	byPriority.resize(live);
+	std::make_heap(byPriority.begin(), byPriority.end(), CompareTaskEntryPriority);
+
+	live = 0;
+
+	for (size_t i = 0; i < byDeadline.size(); ++i)
+	{
+		if (isQueued(byDeadline[i]))
+			byDeadline[live++] = byDeadline[i];
+	}
+
+	byDeadline.resize(live);
+	std::make_heap(byDeadline.begin(), byDeadline.end(), CompareTaskEntryDeadline);
+}
+
+//-----------------------------------//
+
+bool TaskQueue::popNext(Task*& task)
+{
+	// Entries of removed or reprioritized tasks stay in the heaps until
+	// they reach the top, where they are discarded.
+	while (!byDeadline.empty() && !isQueued(byDeadline[0]))
+	{
+		std::pop_heap(byDeadline.begin(), byDeadline.end(), CompareTaskEntryDeadline);
+		byDeadline.popBack();
+	}
+
+	while (!byPriority.empty() && !isQueued(byPriority[0]))
+	{
+		std::pop_heap(byPriority.begin(), byPriority.end(), CompareTaskEntryPriority);
+		byPriority.popBack();
+	}
+
+	if (byPriority.empty())
+		return false;
+
+	// Tasks whose deadline has expired run before the others.
+	Array<Entry>& heap = (!byDeadline.empty() && byDeadline[0].dueTime <= timer.getElapsed())
+		? byDeadline : byPriority;
+
+	task = heap[0].task;
+	queued.remove(GetTaskKey(task));
+
+	auto compare = (&heap == &byDeadline) ? CompareTaskEntryDeadline : CompareTaskEntryPriority;
+	std::pop_heap(heap.begin(), heap.end(), compare);
+	heap.popBack();
+
+	return true;
+}
+
+//-----------------------------------//
+
+bool TaskQueue::tryPop(Task*& task)
+{
+	mutex.lock();
+	bool popped = popNext(task);
+	mutex.unlock();
+
+	return popped;
+}
+
+//-----------------------------------//
+
+bool TaskQueue::waitAndPop(Task*& task)
+{
+	mutex.lock();
+
+	while (queued.empty() && !isClosed)
+		condition.wait(mutex);
+
+	bool popped = popNext(task);
+
+	mutex.unlock();
+
+	return popped;
+}
+
+//-----------------------------------//
+
+bool TaskQueue::remove(Task* task)
+{
+	mutex.lock();
+
+	uint64 key = GetTaskKey(task);
+	bool found = queued.has(key);
+
+	if (found)
+		queued.remove(key);
+
+	mutex.unlock();
+
+	return found;
+}
+
+//-----------------------------------//
+
+bool TaskQueue::setPriority(Task* task, int16 priority)
+{
+	mutex.lock();
+
+	uint64 key = GetTaskKey(task);
+	bool found = queued.has(key);
+
+	// Queue the task again with the new priority. It keeps its sequence,
+	// so it stays in order with the tasks of the same priority, and the
+	// old entry is discarded when it reaches the top of the heaps.
+	if (found)
+	{
+		task->priority = priority;
+
+		Entry entry = queued.get(key, Entry());
+		entry.priority = priority;
+		pushEntry(entry);
+	}
+
+	mutex.unlock();
+
+	return found;
+}
+
+//-----------------------------------//
+
+bool TaskQueue::has(Task* task) const
+{
+	mutex.lock();
+	bool found = queued.has(GetTaskKey(task));
+	mutex.unlock();
+
+	return found;
+}
+
+//-----------------------------------//
+
+bool TaskQueue::empty() const
+{
+	mutex.lock();
+	bool empty = queued.empty();
+	mutex.unlock();
+
+	return empty;
+}
+
+
+//-----------------------------------//
+
+void TaskQueue::close()
+{
+	mutex.lock();
+	isClosed = true;
+	mutex.unlock();
+
+	condition.wakeAll();
 }
 
 //-----------------------------------//
 
-typedef Array<Thread*> ThreadQueue;
+void TaskQueue::open()
+{
+	mutex.lock();
+	isClosed = false;
+	mutex.unlock();
+}
+
+//-----------------------------------//
 
 TaskPool::TaskPool(int8 size)
-	: threadCount(size)
-	, isWaiting(false)
-	, isStopping(false)
+	: isStopping(false)
+	, threadCount(size)
 {
 	threads.reserve(threadCount);
 
@@ -79,6 +343,7 @@ TaskPool::~TaskPool()
 	LogDebug("Destroying task pool");
 	
 	isStopping = true;
+	tasks.close();
 
 	for(auto thread : threads)
 	{	
@@ -94,30 +359,83 @@ void TaskPool::pushEvent(Task* task, TaskState state)
 	event.task = task;
 	event.state = state;
 
+	// The delegates are raised by update, in the thread that owns the pool.
 	events.push_back(event);
-	
-	onTaskEvent(event);
 }
 //-----------------------------------//
 
 void TaskPool::add(Task* task, uint8 priority)
 {
-	if (tasks.find(task))
+	task->priority = priority;
+	add(task);
+}
+
+//-----------------------------------//
+
+void TaskPool::add(Task* task)
+{
+	if (tasks.has(task))
 	{
 		LogAssert("Task is already in the queue");
 		return;
 	}
 
-	if (priority > 0)
-		tasks.push_front(task);
-	else
-		tasks.push_back(task);
+	// Queue the event first so it is ahead of the events of the workers.
+	pushEvent(task, TaskState::Added);
 
-	TaskEvent event;
-	event.task = task;
-	event.state = TaskState::Added;
+	tasks.push(task);
+}
+
+//-----------------------------------//
+
+bool TaskPool::cancel(Task* task)
+{
+	if (!tasks.remove(task))
+		return false;
+
+	pushEvent(task, TaskState::Cancelled);
+	return true;
+}
+
+//-----------------------------------//
+
+bool TaskPool::setPriority(Task* task, int16 priority)
+{
+	return tasks.setPriority(task, priority);
+}
+
+//-----------------------------------//
+
+bool TaskPool::runPendingTask()
+{
+	Task* task;
+
+	if (!tasks.tryPop(task))
+		return false;
+
+	pushEvent(task, TaskState::Started);
+	
+	task->run();
+	
+	pushEvent(task, TaskState::Finished);
 
-	onTaskEvent(event);
+	return true;
+}
+
+//-----------------------------------//
+
+bool TaskPool::runTask(Task* task)
+{
+	if (!tasks.remove(task))
+		return false;
+
+	pushEvent(task, TaskState::Started);
+	
+	task->run();
+	
+	pushEvent(task, TaskState::Finished);
+
+	return true;
 }
 
 //-----------------------------------//
@@ -134,11 +452,12 @@ void TaskPool::update()
 
 void TaskPool::run(Thread* thread, void* userdata)
 {
-
-	while (!isStopping && (!tasks.empty() || !isWaiting))
+	while (!isStopping)
 	{
 		Task* task;
-		tasks.wait_and_pop_front(task);
+		
+		if (!tasks.waitAndPop(task))
+			break;
 
 		if (!task) continue;
 
@@ -154,7 +473,9 @@ void TaskPool::run(Thread* thread, void* userdata)
 
 void TaskPool::waitAll()
 {
-	isWaiting = true;
+	// Threads will exit once there are no more queued tasks.
+	tasks.close();
+
 	for(auto thread : threads)
 		thread->join();
 }
@@ -163,8 +484,8 @@ void TaskPool::waitAll()
 
 void TaskPool::restartThreads()
 {
+	tasks.open();
 
-	isWaiting = false;
 	for(auto thread : threads)
 	{
 		ThreadFunction taskFunction;
@@ -177,4 +498,95 @@ void TaskPool::restartThreads()
 
 //-----------------------------------//
 
+TaskGroup::TaskGroup()
+	: pool(nullptr)
+	, numPending(0)
+{
+}
+
+//-----------------------------------//
+
+TaskGroup::~TaskGroup()
+{
+	wait();
+}
+
+//-----------------------------------//
+
+void TaskGroup::setTaskPool(TaskPool* newPool)
+{
+	if (pool == newPool)
+		return;
+
+	wait();
+	pool = newPool;
+}
+
+//-----------------------------------//
+
+void TaskGroup::add(Task* task)
+{
+	task->taskGroup = this;
+
+	if (!pool)
+	{
+		mutex.lock();
+		numPending++;
+		mutex.unlock();
+
+		task->run();
+		return;
+	}
+
+	mutex.lock();
+	numPending++;
+	tasks.pushBack(task);
+	mutex.unlock();
+
+	pool->add(task);
+}
+
+//-----------------------------------//
+
+void TaskGroup::wait()
+{
+	// Run the tasks that no thread of the pool has started yet.
+	mutex.lock();
+	Array<Task*> unfinished = tasks;
+	mutex.unlock();
+
+	for (size_t i = 0; i < unfinished.size(); i++)
+		pool->runTask(unfinished[i]);
+
+	mutex.lock();
+
+	while (numPending > 0)
+		finished.wait(mutex);
+
+	mutex.unlock();
+}
+
+//-----------------------------------//
+
+void TaskGroup::finishTask(Task* task)
+{
+	mutex.lock();
+
+	for (size_t i = 0; i < tasks.size(); i++)
+	{
+		if (tasks[i] != task) continue;
+
+		tasks[i] = tasks.back();
+		tasks.popBack();
+		break;
+	}
+
+	numPending--;
+	finished.wakeAll();
+
+	mutex.unlock();
+}
+
+//-----------------------------------//
+
 NAMESPACE_CORE_END
\ No newline at end of file
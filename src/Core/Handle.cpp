@@ -48,7 +48,10 @@ HandleId HandleCreate(HandleManager* man, ReferenceCounted* ref)
 	HandleMap& handles = man->handles;
 	
 	HandleId id = man->nextHandle.increment();
+
+	man->mutex.lock();
 	handles.set(id, ref);
+	man->mutex.unlock();
 	
 	return id;
 }
@@ -58,7 +61,10 @@ HandleId HandleCreate(HandleManager* man, ReferenceCounted* ref)
 void HandleDestroy(HandleManager* man, HandleId id)
 {
 	if( !man ) return;
+
+	man->mutex.lock();
 	man->handles.remove(id);
+	man->mutex.unlock();
 }
 
 //-----------------------------------//
@@ -71,7 +77,11 @@ void HandleGarbageCollect(HandleManager* man)
 
 ReferenceCounted* HandleFind(HandleManager* man, HandleId id)
 {
-	return man->handles.get(id, HandleInvalid);
+	man->mutex.lock();
+	ReferenceCounted* ref = man->handles.get(id, HandleInvalid);
+	man->mutex.unlock();
+
+	return ref;
 }
 
 //-----------------------------------//
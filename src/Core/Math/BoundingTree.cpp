@@ -0,0 +1,646 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Core/API.h"
+#include "Core/Math/BoundingTree.h"
+#include <algorithm>
+
+NAMESPACE_CORE_BEGIN
+
+//-----------------------------------//
+
+// Maximum depth of the traversals. Balanced trees are far from it.
+static const int32 MaxQueryDepth = 128;
+
+static BoundingBox CombineBoxes( const BoundingBox& a, const BoundingBox& b )
+{
+	BoundingBox box(a);
+	box.add(b);
+
+	return box;
+}
+
+static float GetSurfaceArea( const BoundingBox& box )
+{
+	Vector3 size = box.max - box.min;
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+static bool ContainsBox( const BoundingBox& outer, const BoundingBox& inner )
+{
+	return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y
+		&& outer.min.z <= inner.min.z && outer.max.x >= inner.max.x
+		&& outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+static bool OverlapsBox( const BoundingBox& a, const BoundingBox& b )
+{
+	return a.min.x <= b.max.x && a.min.y <= b.max.y && a.min.z <= b.max.z
+		&& a.max.x >= b.min.x && a.max.y >= b.min.y && a.max.z >= b.min.z;
+}
+
+//-----------------------------------//
+
+BoundingTree::BoundingTree()
+	: root(BoundingTreeNull)
+	, freeList(BoundingTreeNull)
+	, numProxies(0)
+	, margin(0.1f)
+{
+}
+
+//-----------------------------------//
+
+void BoundingTree::clear()
+{
+	nodes.clear();
+
+	root = BoundingTreeNull;
+	freeList = BoundingTreeNull;
+	numProxies = 0;
+}
+
+//-----------------------------------//
+
+int32 BoundingTree::allocateNode()
+{
+	if( freeList == BoundingTreeNull )
+	{
+		BoundingTreeNode node;
+		node.parent = BoundingTreeNull;
+		node.height = -1;
+
+		freeList = (int32) nodes.size();
+		nodes.pushBack(node);
+	}
+
+	int32 index = freeList;
+	BoundingTreeNode& node = nodes[index];
+
+	freeList = node.parent;
+
+	node.userdata = nullptr;
+	node.parent = BoundingTreeNull;
+	node.left = BoundingTreeNull;
+	node.right = BoundingTreeNull;
+	node.height = 0;
+
+	return index;
+}
+
+//-----------------------------------//
+
+void BoundingTree::freeNode( int32 index )
+{
+	BoundingTreeNode& node = nodes[index];
+	node.parent = freeList;
+	node.height = -1;
+
+	freeList = index;
+}
+
+//-----------------------------------//
+
+int32 BoundingTree::createProxy( const BoundingBox& box, void* userdata )
+{
+	int32 proxy = allocateNode();
+
+	BoundingTreeNode& node = nodes[proxy];
+	node.box = BoundingBox(box.min - Vector3(margin), box.max + Vector3(margin));
+	node.userdata = userdata;
+
+	insertLeaf(proxy);
+	numProxies++;
+
+	return proxy;
+}
+
+//-----------------------------------//
+
+void BoundingTree::createProxies( const BoundingBox* boxes, void* const* userdata,
+	size_t count, int32* proxies )
+{
+	if( root != BoundingTreeNull || count < 2 )
+	{
+		SpatialIndex::createProxies(boxes, userdata, count, proxies);
+		return;
+	}
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		int32 proxy = allocateNode();
+
+		BoundingTreeNode& node = nodes[proxy];
+		node.box = BoundingBox(boxes[i].min - Vector3(margin), boxes[i].max + Vector3(margin));
+		node.userdata = userdata[i];
+
+		proxies[i] = proxy;
+	}
+
+	// The build reorders the leaves, so it works on a copy.
+	Array<int32> leaves;
+	leaves.resize(count);
+
+	for( size_t i = 0; i < count; i++ )
+		leaves[i] = proxies[i];
+
+	root = build(leaves.data(), count);
+	nodes[root].parent = BoundingTreeNull;
+
+	numProxies += (uint32) count;
+}
+
+//-----------------------------------//
+
+struct BoundingTreeCenterLess
+{
+	BoundingTreeCenterLess( const Array<BoundingTreeNode>& nodes, int axis )
+		: nodes(nodes), axis(axis) {}
+
+	bool operator()( int32 a, int32 b ) const
+	{
+		const BoundingBox& boxA = nodes[a].box;
+		const BoundingBox& boxB = nodes[b].box;
+
+		// Compare the doubled centers, which keeps the same order.
+		float centerA = (&boxA.min.x)[axis] + (&boxA.max.x)[axis];
+		float centerB = (&boxB.min.x)[axis] + (&boxB.max.x)[axis];
+
+		return centerA < centerB;
+	}
+
+	const Array<BoundingTreeNode>& nodes;
+	int axis;
+};
+
+int32 BoundingTree::build( int32* leaves, size_t count )
+{
+	if( count == 1 )
+		return leaves[0];
+
+	// Split along the axis where the centers are the most spread.
+	BoundingBox centers;
+	centers.reset();
+
+	for( size_t i = 0; i < count; i++ )
+		centers.add( nodes[leaves[i]].box.getCenter() );
+
+	Vector3 spread = centers.max - centers.min;
+
+	int axis = 0;
+	if( spread.y > spread.x ) axis = 1;
+	if( spread.z > (&spread.x)[axis] ) axis = 2;
+
+	size_t half = count / 2;
+	std::nth_element(leaves, leaves + half, leaves + count,
+		BoundingTreeCenterLess(nodes, axis));
+
+	int32 left = build(leaves, half);
+	int32 right = build(leaves + half, count - half);
+
+	int32 index = allocateNode();
+
+	BoundingTreeNode& node = nodes[index];
+	node.left = left;
+	node.right = right;
+	node.box = CombineBoxes(nodes[left].box, nodes[right].box);
+	node.height = 1 + std::max(nodes[left].height, nodes[right].height);
+
+	nodes[left].parent = index;
+	nodes[right].parent = index;
+
+	return index;
+}
+
+//-----------------------------------//
+
+void BoundingTree::destroyProxy( int32 proxy )
+{
+	assert( nodes[proxy].isLeaf() );
+
+	removeLeaf(proxy);
+	freeNode(proxy);
+
+	numProxies--;
+}
+
+//-----------------------------------//
+
+bool BoundingTree::moveProxy( int32 proxy, const BoundingBox& box )
+{
+	assert( nodes[proxy].isLeaf() );
+
+	if( ContainsBox(nodes[proxy].box, box) )
+		return false;
+
+	removeLeaf(proxy);
+
+	nodes[proxy].box = BoundingBox(box.min - Vector3(margin), box.max + Vector3(margin));
+	insertLeaf(proxy);
+
+	return true;
+}
+
+//-----------------------------------//
+
+void* BoundingTree::getUserData( int32 proxy ) const
+{
+	return nodes[proxy].userdata;
+}
+
+//-----------------------------------//
+
+const BoundingBox& BoundingTree::getFatBox( int32 proxy ) const
+{
+	return nodes[proxy].box;
+}
+
+//-----------------------------------//
+
+int32 BoundingTree::getHeight() const
+{
+	if( root == BoundingTreeNull ) return 0;
+	return nodes[root].height;
+}
+
+//-----------------------------------//
+
+void BoundingTree::insertLeaf( int32 leaf )
+{
+	if( root == BoundingTreeNull )
+	{
+		root = leaf;
+		nodes[root].parent = BoundingTreeNull;
+		return;
+	}
+
+	// Find the best sibling by walking down the tree, comparing the cost
+	// of pairing the leaf with the node against descending to a child.
+	// The cost of a node is its surface area, since it is proportional
+	// to the chance a random query visits it.
+	BoundingBox leafBox = nodes[leaf].box;
+	int32 index = root;
+
+	while( !nodes[index].isLeaf() )
+	{
+		const BoundingTreeNode& node = nodes[index];
+
+		float area = GetSurfaceArea(node.box);
+		float combinedArea = GetSurfaceArea(CombineBoxes(node.box, leafBox));
+
+		// Cost of creating a new parent for the node and the leaf.
+		float cost = 2.0f * combinedArea;
+
+		// Minimum cost of pushing the leaf further down the tree.
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float childCost[2];
+		int32 children[2] = { node.left, node.right };
+
+		for( size_t i = 0; i < 2; i++ )
+		{
+			const BoundingTreeNode& child = nodes[children[i]];
+			float childArea = GetSurfaceArea(CombineBoxes(child.box, leafBox));
+
+			if( !child.isLeaf() )
+				childArea -= GetSurfaceArea(child.box);
+
+			childCost[i] = childArea + inheritanceCost;
+		}
+
+		if( cost < childCost[0] && cost < childCost[1] )
+			break;
+
+		index = (childCost[0] < childCost[1]) ? children[0] : children[1];
+	}
+
+	int32 sibling = index;
+
+	// Create a new parent for the sibling and the leaf.
+	int32 oldParent = nodes[sibling].parent;
+	int32 newParent = allocateNode();
+
+	BoundingTreeNode& parent = nodes[newParent];
+	parent.parent = oldParent;
+	parent.box = CombineBoxes(leafBox, nodes[sibling].box);
+	parent.height = nodes[sibling].height + 1;
+	parent.left = sibling;
+	parent.right = leaf;
+
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	if( oldParent == BoundingTreeNull )
+		root = newParent;
+	else if( nodes[oldParent].left == sibling )
+		nodes[oldParent].left = newParent;
+	else
+		nodes[oldParent].right = newParent;
+
+	refit( nodes[leaf].parent );
+}
+
+//-----------------------------------//
+
+void BoundingTree::removeLeaf( int32 leaf )
+{
+	if( leaf == root )
+	{
+		root = BoundingTreeNull;
+		return;
+	}
+
+	int32 parent = nodes[leaf].parent;
+	int32 grandParent = nodes[parent].parent;
+
+	int32 sibling = (nodes[parent].left == leaf) ?
+		nodes[parent].right : nodes[parent].left;
+
+	// Replace the parent by the sibling.
+	if( grandParent == BoundingTreeNull )
+	{
+		root = sibling;
+		nodes[sibling].parent = BoundingTreeNull;
+		freeNode(parent);
+		return;
+	}
+
+	if( nodes[grandParent].left == parent )
+		nodes[grandParent].left = sibling;
+	else
+		nodes[grandParent].right = sibling;
+
+	nodes[sibling].parent = grandParent;
+	freeNode(parent);
+
+	refit(grandParent);
+}
+
+//-----------------------------------//
+
+void BoundingTree::refit( int32 index )
+{
+	while( index != BoundingTreeNull )
+	{
+		index = balance(index);
+
+		BoundingTreeNode& node = nodes[index];
+		const BoundingTreeNode& left = nodes[node.left];
+		const BoundingTreeNode& right = nodes[node.right];
+
+		node.box = CombineBoxes(left.box, right.box);
+		node.height = 1 + std::max(left.height, right.height);
+
+		index = node.parent;
+	}
+}
+
+//-----------------------------------//
+
+int32 BoundingTree::balance( int32 a )
+{
+	BoundingTreeNode& A = nodes[a];
+
+	if( A.isLeaf() )
+		return a;
+
+	int32 b = A.left;
+	int32 c = A.right;
+
+	int32 balance = nodes[c].height - nodes[b].height;
+
+	if( balance >= -1 && balance <= 1 )
+		return a;
+
+	// Rotate the taller child up, so it replaces the node.
+	int32 up = (balance > 1) ? c : b;
+	int32 other = (balance > 1) ? b : c;
+
+	BoundingTreeNode& U = nodes[up];
+
+	int32 f = U.left;
+	int32 g = U.right;
+
+	U.left = a;
+	U.parent = A.parent;
+	A.parent = up;
+
+	if( U.parent == BoundingTreeNull )
+		root = up;
+	else if( nodes[U.parent].left == a )
+		nodes[U.parent].left = up;
+	else
+		nodes[U.parent].right = up;
+
+	// The taller grandchild stays with the rotated node, the other one
+	// takes its place under the old node.
+	int32 keep = (nodes[f].height > nodes[g].height) ? f : g;
+	int32 move = (keep == f) ? g : f;
+
+	U.right = keep;
+
+	if( balance > 1 )
+		A.right = move;
+	else
+		A.left = move;
+
+	nodes[move].parent = a;
+
+	A.box = CombineBoxes(nodes[other].box, nodes[move].box);
+	A.height = 1 + std::max(nodes[other].height, nodes[move].height);
+
+	U.box = CombineBoxes(A.box, nodes[keep].box);
+	U.height = 1 + std::max(A.height, nodes[keep].height);
+
+	return up;
+}
+
+//-----------------------------------//
+
+void BoundingTree::query( const Frustum& frustum, Array<int32>& proxies ) const
+{
+	if( root == BoundingTreeNull ) return;
+
+	int32 stack[MaxQueryDepth];
+	int32 count = 0;
+
+	stack[count++] = root;
+
+	while( count > 0 )
+	{
+		int32 index = stack[--count];
+		const BoundingTreeNode& node = nodes[index];
+
+		if( !frustum.intersects(node.box) )
+			continue;
+
+		if( node.isLeaf() )
+		{
+			proxies.pushBack(index);
+			continue;
+		}
+
+		assert( count + 2 <= MaxQueryDepth );
+		stack[count++] = node.left;
+		stack[count++] = node.right;
+	}
+}
+
+//-----------------------------------//
+
+void BoundingTree::query( const BoundingBox& box, Array<int32>& proxies ) const
+{
+	if( root == BoundingTreeNull ) return;
+
+	int32 stack[MaxQueryDepth];
+	int32 count = 0;
+
+	stack[count++] = root;
+
+	while( count > 0 )
+	{
+		int32 index = stack[--count];
+		const BoundingTreeNode& node = nodes[index];
+
+		if( !OverlapsBox(node.box, box) )
+			continue;
+
+		if( node.isLeaf() )
+		{
+			proxies.pushBack(index);
+			continue;
+		}
+
+		assert( count + 2 <= MaxQueryDepth );
+		stack[count++] = node.left;
+		stack[count++] = node.right;
+	}
+}
+
+//-----------------------------------//
+
+void BoundingTree::query( const Ray& ray, Array<int32>& proxies ) const
+{
+	if( root == BoundingTreeNull ) return;
+
+	int32 stack[MaxQueryDepth];
+	int32 count = 0;
+
+	stack[count++] = root;
+
+	while( count > 0 )
+	{
+		int32 index = stack[--count];
+		const BoundingTreeNode& node = nodes[index];
+
+		float distance;
+
+		if( !node.box.intersects(ray, distance) )
+			continue;
+
+		if( node.isLeaf() )
+		{
+			proxies.pushBack(index);
+			continue;
+		}
+
+		assert( count + 2 <= MaxQueryDepth );
+		stack[count++] = node.left;
+		stack[count++] = node.right;
+	}
+}
+
+//-----------------------------------//
+
+void BoundingTree::query( const RayPacket& packet, Array<int32>& proxies,
+	Array<uint32>& masks ) const
+{
+	if( root == BoundingTreeNull ) return;
+
+	int32 stack[MaxQueryDepth];
+	uint32 stackMasks[MaxQueryDepth];
+	int32 count = 0;
+
+	stack[count] = root;
+	stackMasks[count++] = packet.getMask();
+
+	while( count > 0 )
+	{
+		--count;
+
+		int32 index = stack[count];
+		const BoundingTreeNode& node = nodes[index];
+
+		uint32 mask = packet.intersects(node.box, stackMasks[count]);
+		if( mask == 0 ) continue;
+
+		if( node.isLeaf() )
+		{
+			proxies.pushBack(index);
+			masks.pushBack(mask);
+			continue;
+		}
+
+		assert( count + 2 <= MaxQueryDepth );
+
+		stack[count] = node.left;
+		stackMasks[count++] = mask;
+
+		stack[count] = node.right;
+		stackMasks[count++] = mask;
+	}
+}
+
+//-----------------------------------//
+
+bool BoundingTree::validate() const
+{
+	if( root == BoundingTreeNull )
+		return numProxies == 0;
+
+	if( nodes[root].parent != BoundingTreeNull )
+		return false;
+
+	uint32 numFree = 0;
+
+	for( int32 i = freeList; i != BoundingTreeNull; i = nodes[i].parent )
+		numFree++;
+
+	// Each proxy has a leaf and all but the first also a parent.
+	if( numFree + 2 * numProxies - 1 != nodes.size() )
+		return false;
+
+	return validate(root);
+}
+
+//-----------------------------------//
+
+bool BoundingTree::validate( int32 index ) const
+{
+	const BoundingTreeNode& node = nodes[index];
+
+	if( node.isLeaf() )
+		return node.height == 0 && node.right == BoundingTreeNull;
+
+	const BoundingTreeNode& left = nodes[node.left];
+	const BoundingTreeNode& right = nodes[node.right];
+
+	if( left.parent != index || right.parent != index )
+		return false;
+
+	if( node.height != 1 + std::max(left.height, right.height) )
+		return false;
+
+	if( !ContainsBox(node.box, left.box) || !ContainsBox(node.box, right.box) )
+		return false;
+
+	return validate(node.left) && validate(node.right);
+}
+
+//-----------------------------------//
+
+NAMESPACE_CORE_END
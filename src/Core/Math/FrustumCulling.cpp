@@ -0,0 +1,201 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Core/API.h"
+#include "Core/Math/FrustumCulling.h"
+#include "Core/Math/Helpers.h"
+#include "Core/Math/SSE.h"
+
+NAMESPACE_CORE_BEGIN
+
+//-----------------------------------//
+
+BoundingBoxArray::BoundingBoxArray()
+	: size(0)
+{
+}
+
+//-----------------------------------//
+
+void BoundingBoxArray::clear()
+{
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	extentX.clear();
+	extentY.clear();
+	extentZ.clear();
+
+	size = 0;
+}
+
+//-----------------------------------//
+
+uint32 BoundingBoxArray::add( const BoundingBox& box )
+{
+	// Grow the arrays a full culling iteration at a time.
+	if( size == centerX.size() )
+	{
+		uint32 padded = size + FrustumCullWidth;
+
+		centerX.resize(padded);
+		centerY.resize(padded);
+		centerZ.resize(padded);
+		extentX.resize(padded);
+		extentY.resize(padded);
+		extentZ.resize(padded);
+
+		for( uint32 i = size; i < padded; i++ )
+			set(i, BoundingBox());
+	}
+
+	uint32 index = size++;
+	set(index, box);
+
+	return index;
+}
+
+//-----------------------------------//
+
+void BoundingBoxArray::set( uint32 index, const BoundingBox& box )
+{
+	Vector3 center = box.getCenter();
+	Vector3 extent = (box.max - box.min) * 0.5f;
+
+	// Boxes that were reset have no bounds, so they are never culled.
+	if( box.isInfinite() )
+	{
+		center = Vector3::Zero;
+		extent = Vector3(LimitsFloatMaximum);
+	}
+
+	centerX[index] = center.x;
+	centerY[index] = center.y;
+	centerZ[index] = center.z;
+
+	extentX[index] = extent.x;
+	extentY[index] = extent.y;
+	extentZ[index] = extent.z;
+}
+
+//-----------------------------------//
+
+#ifdef FLD_MATH_SSE
+
+static void CullBoxes( const Frustum& frustum, const BoundingBoxArray& boxes, uint32* visible )
+{
+	__m128 normalX[6], normalY[6], normalZ[6];
+	__m128 absNormalX[6], absNormalY[6], absNormalZ[6];
+	__m128 offset[6];
+
+	for( size_t i = 0; i < 6; i++ )
+	{
+		const Plane& plane = frustum.planes[i];
+
+		normalX[i] = _mm_set1_ps(plane.normal.x);
+		normalY[i] = _mm_set1_ps(plane.normal.y);
+		normalZ[i] = _mm_set1_ps(plane.normal.z);
+
+		absNormalX[i] = _mm_set1_ps(fabsf(plane.normal.x));
+		absNormalY[i] = _mm_set1_ps(fabsf(plane.normal.y));
+		absNormalZ[i] = _mm_set1_ps(fabsf(plane.normal.z));
+
+		offset[i] = _mm_set1_ps(plane.offset);
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+
+	for( uint32 i = 0; i < boxes.size; i += FrustumCullWidth )
+	{
+		__m128 cx = _mm_loadu_ps(&boxes.centerX[i]);
+		__m128 cy = _mm_loadu_ps(&boxes.centerY[i]);
+		__m128 cz = _mm_loadu_ps(&boxes.centerZ[i]);
+
+		__m128 ex = _mm_loadu_ps(&boxes.extentX[i]);
+		__m128 ey = _mm_loadu_ps(&boxes.extentY[i]);
+		__m128 ez = _mm_loadu_ps(&boxes.extentZ[i]);
+
+		__m128 inside = _mm_cmpeq_ps(zero, zero);
+
+		for( size_t j = 0; j < 6; j++ )
+		{
+			// Distance of the center to the plane.
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(normalX[j], cx), _mm_mul_ps(normalY[j], cy)),
+				_mm_add_ps(_mm_mul_ps(normalZ[j], cz), offset[j]));
+
+			// Projection of the extents on the normal.
+			__m128 radius = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(absNormalX[j], ex), _mm_mul_ps(absNormalY[j], ey)),
+				_mm_mul_ps(absNormalZ[j], ez));
+
+			__m128 furthest = _mm_add_ps(distance, radius);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(furthest, zero));
+		}
+
+		uint32 mask = (uint32) _mm_movemask_ps(inside);
+		visible[i / 32] |= mask << (i % 32);
+	}
+}
+
+#else
+
+static void CullBoxes( const Frustum& frustum, const BoundingBoxArray& boxes, uint32* visible )
+{
+	for( uint32 i = 0; i < boxes.size; i++ )
+	{
+		bool inside = true;
+
+		for( size_t j = 0; j < 6 && inside; j++ )
+		{
+			const Plane& plane = frustum.planes[j];
+
+			float distance = plane.normal.x * boxes.centerX[i]
+				+ plane.normal.y * boxes.centerY[i]
+				+ plane.normal.z * boxes.centerZ[i]
+				+ plane.offset;
+
+			float radius = fabsf(plane.normal.x) * boxes.extentX[i]
+				+ fabsf(plane.normal.y) * boxes.extentY[i]
+				+ fabsf(plane.normal.z) * boxes.extentZ[i];
+
+			inside = distance + radius >= 0;
+		}
+
+		if( inside )
+			visible[i / 32] |= 1u << (i % 32);
+	}
+}
+
+#endif
+
+//-----------------------------------//
+
+void FrustumCullBoxes( const Frustum& frustum, const BoundingBoxArray& boxes,
+	Array<uint32>& visible )
+{
+	uint32 numWords = (boxes.size + 31) / 32;
+
+	visible.resize(numWords);
+
+	for( uint32 i = 0; i < numWords; i++ )
+		visible[i] = 0;
+
+	if( boxes.size == 0 ) return;
+
+	CullBoxes(frustum, boxes, visible.data());
+
+	// Clear the bits of the padding boxes.
+	uint32 lastBits = boxes.size % 32;
+
+	if( lastBits != 0 )
+		visible[numWords - 1] &= (1u << lastBits) - 1;
+}
+
+//-----------------------------------//
+
+NAMESPACE_CORE_END
@@ -7,6 +7,7 @@
 
 #include "Core/API.h"
 #include "Core/Math/Hash.h"
+#include <cstring>
 
 NAMESPACE_CORE_BEGIN
 
@@ -130,4 +131,189 @@ uint64 MurmurHash64(const void * key, size_t len, uint64 seed)
 	return h;
 }
 
+//-----------------------------------//
+
+// xxHash64, by Yann Collet
+
+static const uint64 XXPrime64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64 XXPrime64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64 XXPrime64_3 = 0x165667B19E3779F9ULL;
+static const uint64 XXPrime64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64 XXPrime64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64 XXRotateLeft64(uint64 x, uint32 r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64 XXRead64(const uint8* p)
+{
+	uint64 v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint32 XXRead32(const uint8* p)
+{
+	uint32 v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint64 XXRound64(uint64 acc, uint64 input)
+{
+	acc += input * XXPrime64_2;
+	acc = XXRotateLeft64(acc, 31);
+	acc *= XXPrime64_1;
+	return acc;
+}
+
+static inline uint64 XXMergeRound64(uint64 acc, uint64 val)
+{
+	val = XXRound64(0, val);
+	acc ^= val;
+	acc = acc * XXPrime64_1 + XXPrime64_4;
+	return acc;
+}
+
+void XXHash64Init(HashStateXX64* state, uint64 seed)
+{
+	state->v[0] = seed + XXPrime64_1 + XXPrime64_2;
+	state->v[1] = seed + XXPrime64_2;
+	state->v[2] = seed;
+	state->v[3] = seed - XXPrime64_1;
+	state->seed = seed;
+	state->totalSize = 0;
+	state->bufferSize = 0;
+}
+
+void XXHash64Update(HashStateXX64* state, const void* data, size_t len)
+{
+	if( !data || len == 0 ) return;
+
+	const uint8* p = (const uint8*) data;
+	const uint8* end = p + len;
+
+	state->totalSize += len;
+
+	// Not enough data for a full stripe, keep it for later.
+	if( state->bufferSize + len < 32 )
+	{
+		memcpy(state->buffer + state->bufferSize, p, len);
+		state->bufferSize += (uint32) len;
+		return;
+	}
+
+	// Complete the pending stripe from the last update.
+	if( state->bufferSize > 0 )
+	{
+		size_t fill = 32 - state->bufferSize;
+		memcpy(state->buffer + state->bufferSize, p, fill);
+
+		const uint8* b = state->buffer;
+		state->v[0] = XXRound64(state->v[0], XXRead64(b + 0));
+		state->v[1] = XXRound64(state->v[1], XXRead64(b + 8));
+		state->v[2] = XXRound64(state->v[2], XXRead64(b + 16));
+		state->v[3] = XXRound64(state->v[3], XXRead64(b + 24));
+
+		p += fill;
+		state->bufferSize = 0;
+	}
+
+	// Process all the full stripes directly from the input.
+	if( p + 32 <= end )
+	{
+		uint64 v1 = state->v[0];
+		uint64 v2 = state->v[1];
+		uint64 v3 = state->v[2];
+		uint64 v4 = state->v[3];
+
+		const uint8* limit = end - 32;
+
+		do
+		{
+			v1 = XXRound64(v1, XXRead64(p)); p += 8;
+			v2 = XXRound64(v2, XXRead64(p)); p += 8;
+			v3 = XXRound64(v3, XXRead64(p)); p += 8;
+			v4 = XXRound64(v4, XXRead64(p)); p += 8;
+		} while( p <= limit );
+
+		state->v[0] = v1;
+		state->v[1] = v2;
+		state->v[2] = v3;
+		state->v[3] = v4;
+	}
+
+	if( p < end )
+	{
+		state->bufferSize = (uint32) (end - p);
+		memcpy(state->buffer, p, state->bufferSize);
+	}
+}
+
+uint64 XXHash64Digest(const HashStateXX64* state)
+{
+	uint64 h;
+
+	if( state->totalSize >= 32 )
+	{
+		const uint64* v = state->v;
+
+		h = XXRotateLeft64(v[0], 1) + XXRotateLeft64(v[1], 7)
+			+ XXRotateLeft64(v[2], 12) + XXRotateLeft64(v[3], 18);
+
+		h = XXMergeRound64(h, v[0]);
+		h = XXMergeRound64(h, v[1]);
+		h = XXMergeRound64(h, v[2]);
+		h = XXMergeRound64(h, v[3]);
+	}
+	else
+	{
+		h = state->seed + XXPrime64_5;
+	}
+
+	h += state->totalSize;
+
+	const uint8* p = state->buffer;
+	const uint8* end = p + state->bufferSize;
+
+	while( p + 8 <= end )
+	{
+		h ^= XXRound64(0, XXRead64(p));
+		h = XXRotateLeft64(h, 27) * XXPrime64_1 + XXPrime64_4;
+		p += 8;
+	}
+
+	if( p + 4 <= end )
+	{
+		h ^= (uint64) XXRead32(p) * XXPrime64_1;
+		h = XXRotateLeft64(h, 23) * XXPrime64_2 + XXPrime64_3;
+		p += 4;
+	}
+
+	while( p < end )
+	{
+		h ^= (*p) * XXPrime64_5;
+		h = XXRotateLeft64(h, 11) * XXPrime64_1;
+		p++;
+	}
+
+	// Final avalanche.
+	h ^= h >> 33;
+	h *= XXPrime64_2;
+	h ^= h >> 29;
+	h *= XXPrime64_3;
+	h ^= h >> 32;
+
+	return h;
+}
+
+uint64 XXHash64(const void* data, size_t len, uint64 seed)
+{
+	HashStateXX64 state;
+	XXHash64Init(&state, seed);
+	XXHash64Update(&state, data, len);
+	return XXHash64Digest(&state);
+}
+
 NAMESPACE_CORE_END
\ No newline at end of file
@@ -0,0 +1,403 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Core/API.h"
+#include "Core/Math/HashedGrid.h"
+#include <algorithm>
+
+NAMESPACE_CORE_BEGIN
+
+//-----------------------------------//
+
+static const int32 GridNull = -1;
+
+// Index of the cell with the boxes that span too many cells.
+static const int32 OverflowCell = 0;
+
+// Maximum number of cells a box is linked to.
+static const int32 MaxCellsPerProxy = 64;
+
+// Cell coordinates are packed in 21 bits each.
+static const int32 CellCoordinateBias = 1 << 20;
+
+static uint64 PackCell( int32 x, int32 y, int32 z )
+{
+	return ((uint64) (x + CellCoordinateBias) << 42)
+		| ((uint64) (y + CellCoordinateBias) << 21)
+		| (uint64) (z + CellCoordinateBias);
+}
+
+static bool OverlapsBox( const BoundingBox& a, const BoundingBox& b )
+{
+	return a.min.x <= b.max.x && a.min.y <= b.max.y && a.min.z <= b.max.z
+		&& a.max.x >= b.min.x && a.max.y >= b.min.y && a.max.z >= b.min.z;
+}
+
+// Removes the duplicated proxies added after the start.
+static void RemoveDuplicates( Array<int32>& proxies, size_t start )
+{
+	std::sort(proxies.begin() + start, proxies.end());
+
+	int32* end = std::unique(proxies.begin() + start, proxies.end());
+	proxies.resize(end - proxies.begin());
+}
+
+//-----------------------------------//
+
+HashedGrid::HashedGrid( float cellSize )
+	: freeEntries(GridNull)
+	, freeProxies(GridNull)
+	, numProxies(0)
+	, cellSize(cellSize)
+{
+	clear();
+}
+
+//-----------------------------------//
+
+void HashedGrid::clear()
+{
+	cellMap.clear();
+	cells.clear();
+	entries.clear();
+	proxyList.clear();
+
+	freeEntries = GridNull;
+	freeProxies = GridNull;
+	numProxies = 0;
+
+	HashedGridCell overflow;
+	overflow.box.reset();
+	overflow.firstEntry = GridNull;
+	overflow.numEntries = 0;
+
+	cells.pushBack(overflow);
+}
+
+//-----------------------------------//
+
+void HashedGrid::getCellRange( const BoundingBox& box, int32* minCell, int32* maxCell ) const
+{
+	const float* boxMin = &box.min.x;
+	const float* boxMax = &box.max.x;
+
+	float limit = float(CellCoordinateBias - 1);
+
+	for( size_t i = 0; i < 3; i++ )
+	{
+		float low = floorf(boxMin[i] / cellSize);
+		float high = floorf(boxMax[i] / cellSize);
+
+		minCell[i] = (int32) std::max(-limit, std::min(low, limit));
+		maxCell[i] = (int32) std::max(-limit, std::min(high, limit));
+	}
+}
+
+//-----------------------------------//
+
+int32 HashedGrid::findCell( int32 x, int32 y, int32 z )
+{
+	uint64 key = PackCell(x, y, z);
+	int32 index = cellMap.get(key, GridNull);
+
+	if( index != GridNull )
+		return index;
+
+	HashedGridCell cell;
+	cell.box.min = Vector3(x * cellSize, y * cellSize, z * cellSize);
+	cell.box.max = cell.box.min + Vector3(cellSize);
+	cell.firstEntry = GridNull;
+	cell.numEntries = 0;
+
+	index = (int32) cells.size();
+	cells.pushBack(cell);
+
+	cellMap.set(key, index);
+
+	return index;
+}
+
+//-----------------------------------//
+
+void HashedGrid::addEntry( int32 proxy, int32 cell )
+{
+	int32 index = freeEntries;
+
+	if( index == GridNull )
+	{
+		index = (int32) entries.size();
+		entries.resize(index + 1);
+	}
+	else
+	{
+		freeEntries = entries[index].next;
+	}
+
+	HashedGridEntry& entry = entries[index];
+	HashedGridCell& gridCell = cells[cell];
+
+	entry.proxy = proxy;
+	entry.cell = cell;
+	entry.prev = GridNull;
+	entry.next = gridCell.firstEntry;
+
+	if( gridCell.firstEntry != GridNull )
+		entries[gridCell.firstEntry].prev = index;
+
+	gridCell.firstEntry = index;
+	gridCell.numEntries++;
+
+	entry.nextOfProxy = proxyList[proxy].firstEntry;
+	proxyList[proxy].firstEntry = index;
+}
+
+//-----------------------------------//
+
+void HashedGrid::linkProxy( int32 index )
+{
+	HashedGridProxy& proxy = proxyList[index];
+	proxy.firstEntry = GridNull;
+
+	const int32* minCell = proxy.minCell;
+	const int32* maxCell = proxy.maxCell;
+
+	int64 numCells = int64(maxCell[0] - minCell[0] + 1)
+		* int64(maxCell[1] - minCell[1] + 1)
+		* int64(maxCell[2] - minCell[2] + 1);
+
+	if( numCells > MaxCellsPerProxy )
+	{
+		addEntry(index, OverflowCell);
+		return;
+	}
+
+	for( int32 x = minCell[0]; x <= maxCell[0]; x++ )
+	for( int32 y = minCell[1]; y <= maxCell[1]; y++ )
+	for( int32 z = minCell[2]; z <= maxCell[2]; z++ )
+		addEntry(index, findCell(x, y, z));
+}
+
+//-----------------------------------//
+
+void HashedGrid::unlinkProxy( int32 index )
+{
+	HashedGridProxy& proxy = proxyList[index];
+
+	int32 next = GridNull;
+
+	for( int32 i = proxy.firstEntry; i != GridNull; i = next )
+	{
+		HashedGridEntry& entry = entries[i];
+		HashedGridCell& cell = cells[entry.cell];
+
+		if( entry.prev != GridNull )
+			entries[entry.prev].next = entry.next;
+		else
+			cell.firstEntry = entry.next;
+
+		if( entry.next != GridNull )
+			entries[entry.next].prev = entry.prev;
+
+		cell.numEntries--;
+
+		next = entry.nextOfProxy;
+
+		entry.next = freeEntries;
+		freeEntries = i;
+	}
+
+	proxy.firstEntry = GridNull;
+}
+
+//-----------------------------------//
+
+int32 HashedGrid::createProxy( const BoundingBox& box, void* userdata )
+{
+	int32 index = freeProxies;
+
+	if( index == GridNull )
+	{
+		index = (int32) proxyList.size();
+		proxyList.resize(index + 1);
+	}
+	else
+	{
+		freeProxies = proxyList[index].firstEntry;
+	}
+
+	HashedGridProxy& proxy = proxyList[index];
+	proxy.box = box;
+	proxy.userdata = userdata;
+	proxy.isFree = false;
+
+	getCellRange(box, proxy.minCell, proxy.maxCell);
+	linkProxy(index);
+
+	numProxies++;
+
+	return index;
+}
+
+//-----------------------------------//
+
+void HashedGrid::destroyProxy( int32 index )
+{
+	assert( !proxyList[index].isFree );
+
+	unlinkProxy(index);
+
+	HashedGridProxy& proxy = proxyList[index];
+	proxy.isFree = true;
+	proxy.firstEntry = freeProxies;
+
+	freeProxies = index;
+	numProxies--;
+}
+
+//-----------------------------------//
+
+bool HashedGrid::moveProxy( int32 index, const BoundingBox& box )
+{
+	HashedGridProxy& proxy = proxyList[index];
+	assert( !proxy.isFree );
+
+	proxy.box = box;
+
+	int32 minCell[3], maxCell[3];
+	getCellRange(box, minCell, maxCell);
+
+	if( std::equal(minCell, minCell + 3, proxy.minCell)
+		&& std::equal(maxCell, maxCell + 3, proxy.maxCell) )
+		return false;
+
+	unlinkProxy(index);
+
+	std::copy(minCell, minCell + 3, proxy.minCell);
+	std::copy(maxCell, maxCell + 3, proxy.maxCell);
+
+	linkProxy(index);
+
+	return true;
+}
+
+//-----------------------------------//
+
+void* HashedGrid::getUserData( int32 index ) const
+{
+	return proxyList[index].userdata;
+}
+
+//-----------------------------------//
+
+template<typename Test>
+void HashedGrid::queryCell( int32 cell, const Test& test, Array<int32>& result ) const
+{
+	for( int32 i = cells[cell].firstEntry; i != GridNull; i = entries[i].next )
+	{
+		int32 proxy = entries[i].proxy;
+
+		if( test(proxyList[proxy].box) )
+			result.pushBack(proxy);
+	}
+}
+
+//-----------------------------------//
+
+void HashedGrid::query( const Frustum& frustum, Array<int32>& result ) const
+{
+	size_t start = result.size();
+
+	auto test = [&frustum](const BoundingBox& box) {
+		return frustum.intersects(box);
+	};
+
+	queryCell(OverflowCell, test, result);
+
+	for( size_t i = 1; i < cells.size(); i++ )
+	{
+		const HashedGridCell& cell = cells[i];
+
+		if( cell.numEntries > 0 && frustum.intersects(cell.box) )
+			queryCell((int32) i, test, result);
+	}
+
+	RemoveDuplicates(result, start);
+}
+
+//-----------------------------------//
+
+void HashedGrid::query( const BoundingBox& box, Array<int32>& result ) const
+{
+	size_t start = result.size();
+
+	auto test = [&box](const BoundingBox& proxyBox) {
+		return OverlapsBox(proxyBox, box);
+	};
+
+	queryCell(OverflowCell, test, result);
+
+	int32 minCell[3], maxCell[3];
+	getCellRange(box, minCell, maxCell);
+
+	int64 numCells = int64(maxCell[0] - minCell[0] + 1)
+		* int64(maxCell[1] - minCell[1] + 1)
+		* int64(maxCell[2] - minCell[2] + 1);
+
+	// Big boxes are faster to test against the cells that were used.
+	if( numCells > (int64) cells.size() )
+	{
+		for( size_t i = 1; i < cells.size(); i++ )
+		{
+			const HashedGridCell& cell = cells[i];
+
+			if( cell.numEntries > 0 && OverlapsBox(cell.box, box) )
+				queryCell((int32) i, test, result);
+		}
+	}
+	else
+	{
+		for( int32 x = minCell[0]; x <= maxCell[0]; x++ )
+		for( int32 y = minCell[1]; y <= maxCell[1]; y++ )
+		for( int32 z = minCell[2]; z <= maxCell[2]; z++ )
+		{
+			int32 cell = cellMap.get(PackCell(x, y, z), GridNull);
+
+			if( cell != GridNull )
+				queryCell(cell, test, result);
+		}
+	}
+
+	RemoveDuplicates(result, start);
+}
+
+//-----------------------------------//
+
+void HashedGrid::query( const Ray& ray, Array<int32>& result ) const
+{
+	size_t start = result.size();
+
+	auto test = [&ray](const BoundingBox& box) {
+		float distance;
+		return box.intersects(ray, distance);
+	};
+
+	queryCell(OverflowCell, test, result);
+
+	for( size_t i = 1; i < cells.size(); i++ )
+	{
+		const HashedGridCell& cell = cells[i];
+
+		if( cell.numEntries > 0 && test(cell.box) )
+			queryCell((int32) i, test, result);
+	}
+
+	RemoveDuplicates(result, start);
+}
+
+//-----------------------------------//
+
+NAMESPACE_CORE_END
@@ -0,0 +1,305 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Core/API.h"
+#include "Core/Math/LooseOctree.h"
+#include <algorithm>
+
+NAMESPACE_CORE_BEGIN
+
+//-----------------------------------//
+
+static const int32 OctreeNull = -1;
+
+// Maximum number of nodes waiting to be visited by the queries.
+static const size_t MaxQueryNodes = 512;
+
+static bool OverlapsBox( const BoundingBox& a, const BoundingBox& b )
+{
+	return a.min.x <= b.max.x && a.min.y <= b.max.y && a.min.z <= b.max.z
+		&& a.max.x >= b.min.x && a.max.y >= b.min.y && a.max.z >= b.min.z;
+}
+
+//-----------------------------------//
+
+LooseOctree::LooseOctree( const BoundingBox& bounds, uint32 maxDepth )
+	: freeList(OctreeNull)
+	, numProxies(0)
+	, bounds(bounds)
+	, maxDepth(maxDepth)
+{
+	clear();
+}
+
+//-----------------------------------//
+
+void LooseOctree::clear()
+{
+	nodes.clear();
+	proxyList.clear();
+
+	freeList = OctreeNull;
+	numProxies = 0;
+
+	// The root cell is the cube around the bounds.
+	Vector3 size = bounds.max - bounds.min;
+
+	LooseOctreeNode root;
+	root.center = bounds.getCenter();
+	root.halfSize = 0.5f * std::max(size.x, std::max(size.y, size.z));
+	root.parent = OctreeNull;
+	root.firstProxy = OctreeNull;
+	root.numProxies = 0;
+
+	for( size_t i = 0; i < 8; i++ )
+		root.children[i] = OctreeNull;
+
+	nodes.pushBack(root);
+}
+
+//-----------------------------------//
+
+BoundingBox LooseOctree::getLooseBox( const LooseOctreeNode& node ) const
+{
+	Vector3 extent( 2.0f * node.halfSize );
+	return BoundingBox(node.center - extent, node.center + extent);
+}
+
+//-----------------------------------//
+
+int32 LooseOctree::findNode( const BoundingBox& box )
+{
+	Vector3 center = box.getCenter();
+	Vector3 size = box.max - box.min;
+	float extent = 0.5f * std::max(size.x, std::max(size.y, size.z));
+
+	const LooseOctreeNode& root = nodes[0];
+	Vector3 offset = center - root.center;
+
+	if( fabsf(offset.x) > root.halfSize || fabsf(offset.y) > root.halfSize
+		|| fabsf(offset.z) > root.halfSize )
+		return 0;
+
+	int32 index = 0;
+
+	for( uint32 depth = 0; depth < maxDepth; depth++ )
+	{
+		// Boxes fit in the loose bounds of the cells that are not smaller
+		// than them and that contain their center.
+		float childHalfSize = 0.5f * nodes[index].halfSize;
+		if( extent > childHalfSize ) break;
+
+		const Vector3& nodeCenter = nodes[index].center;
+
+		int32 octant = (center.x >= nodeCenter.x ? 1 : 0)
+			| (center.y >= nodeCenter.y ? 2 : 0)
+			| (center.z >= nodeCenter.z ? 4 : 0);
+
+		int32 child = nodes[index].children[octant];
+
+		if( child == OctreeNull )
+		{
+			LooseOctreeNode node;
+			node.halfSize = childHalfSize;
+			node.center.x = nodeCenter.x + ((octant & 1) ? childHalfSize : -childHalfSize);
+			node.center.y = nodeCenter.y + ((octant & 2) ? childHalfSize : -childHalfSize);
+			node.center.z = nodeCenter.z + ((octant & 4) ? childHalfSize : -childHalfSize);
+			node.parent = index;
+			node.firstProxy = OctreeNull;
+			node.numProxies = 0;
+
+			for( size_t i = 0; i < 8; i++ )
+				node.children[i] = OctreeNull;
+
+			child = (int32) nodes.size();
+			nodes.pushBack(node);
+
+			nodes[index].children[octant] = child;
+		}
+
+		index = child;
+	}
+
+	return index;
+}
+
+//-----------------------------------//
+
+void LooseOctree::linkProxy( int32 index, int32 nodeIndex )
+{
+	LooseOctreeProxy& proxy = proxyList[index];
+	LooseOctreeNode& node = nodes[nodeIndex];
+
+	proxy.node = nodeIndex;
+	proxy.prev = OctreeNull;
+	proxy.next = node.firstProxy;
+
+	if( node.firstProxy != OctreeNull )
+		proxyList[node.firstProxy].prev = index;
+
+	node.firstProxy = index;
+
+	for( int32 i = nodeIndex; i != OctreeNull; i = nodes[i].parent )
+		nodes[i].numProxies++;
+}
+
+//-----------------------------------//
+
+void LooseOctree::unlinkProxy( int32 index )
+{
+	LooseOctreeProxy& proxy = proxyList[index];
+	LooseOctreeNode& node = nodes[proxy.node];
+
+	if( proxy.prev != OctreeNull )
+		proxyList[proxy.prev].next = proxy.next;
+	else
+		node.firstProxy = proxy.next;
+
+	if( proxy.next != OctreeNull )
+		proxyList[proxy.next].prev = proxy.prev;
+
+	for( int32 i = proxy.node; i != OctreeNull; i = nodes[i].parent )
+		nodes[i].numProxies--;
+
+	proxy.node = OctreeNull;
+}
+
+//-----------------------------------//
+
+int32 LooseOctree::createProxy( const BoundingBox& box, void* userdata )
+{
+	int32 index = freeList;
+
+	if( index == OctreeNull )
+	{
+		index = (int32) proxyList.size();
+		proxyList.resize(index + 1);
+	}
+	else
+	{
+		freeList = proxyList[index].next;
+	}
+
+	LooseOctreeProxy& proxy = proxyList[index];
+	proxy.box = box;
+	proxy.userdata = userdata;
+
+	linkProxy(index, findNode(box));
+	numProxies++;
+
+	return index;
+}
+
+//-----------------------------------//
+
+void LooseOctree::destroyProxy( int32 index )
+{
+	assert( proxyList[index].node != OctreeNull );
+
+	unlinkProxy(index);
+
+	proxyList[index].next = freeList;
+	freeList = index;
+
+	numProxies--;
+}
+
+//-----------------------------------//
+
+bool LooseOctree::moveProxy( int32 index, const BoundingBox& box )
+{
+	assert( proxyList[index].node != OctreeNull );
+
+	proxyList[index].box = box;
+
+	int32 node = findNode(box);
+
+	if( node == proxyList[index].node )
+		return false;
+
+	unlinkProxy(index);
+	linkProxy(index, node);
+
+	return true;
+}
+
+//-----------------------------------//
+
+void* LooseOctree::getUserData( int32 index ) const
+{
+	return proxyList[index].userdata;
+}
+
+//-----------------------------------//
+
+template<typename Test>
+void LooseOctree::walk( const Test& test, Array<int32>& result ) const
+{
+	int32 stack[MaxQueryNodes];
+	size_t count = 0;
+
+	stack[count++] = 0;
+
+	while( count > 0 )
+	{
+		int32 index = stack[--count];
+		const LooseOctreeNode& node = nodes[index];
+
+		if( node.numProxies == 0 )
+			continue;
+
+		// The root also keeps the boxes outside of its bounds.
+		if( index != 0 && !test(getLooseBox(node)) )
+			continue;
+
+		for( int32 i = node.firstProxy; i != OctreeNull; i = proxyList[i].next )
+		{
+			if( test(proxyList[i].box) )
+				result.pushBack(i);
+		}
+
+		for( size_t i = 0; i < 8; i++ )
+		{
+			if( node.children[i] == OctreeNull ) continue;
+
+			assert( count < MaxQueryNodes );
+			stack[count++] = node.children[i];
+		}
+	}
+}
+
+//-----------------------------------//
+
+void LooseOctree::query( const Frustum& frustum, Array<int32>& result ) const
+{
+	walk([&frustum](const BoundingBox& box) {
+		return frustum.intersects(box);
+	}, result);
+}
+
+//-----------------------------------//
+
+void LooseOctree::query( const BoundingBox& query, Array<int32>& result ) const
+{
+	walk([&query](const BoundingBox& box) {
+		return OverlapsBox(box, query);
+	}, result);
+}
+
+//-----------------------------------//
+
+void LooseOctree::query( const Ray& ray, Array<int32>& result ) const
+{
+	walk([&ray](const BoundingBox& box) {
+		float distance;
+		return box.intersects(ray, distance);
+	}, result);
+}
+
+//-----------------------------------//
+
+NAMESPACE_CORE_END
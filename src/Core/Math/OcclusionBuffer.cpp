@@ -0,0 +1,475 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Core/API.h"
+#include "Core/Math/OcclusionBuffer.h"
+#include "Core/Math/Helpers.h"
+#include "Core/Math/SSE.h"
+#include <algorithm>
+
+NAMESPACE_CORE_BEGIN
+
+//-----------------------------------//
+
+// Depth of the pixels that are not covered by any occluder.
+static const float ClearDepth = 1.0f;
+
+// Triangles with a smaller area in pixels are not rasterized.
+static const float MinTriangleArea = 1e-6f;
+
+OcclusionBuffer::OcclusionBuffer()
+	: width(0)
+	, height(0)
+	, numTilesX(0)
+	, numTilesY(0)
+{
+}
+
+//-----------------------------------//
+
+void OcclusionBuffer::resize( uint32 width, uint32 height )
+{
+	numTilesX = (width + OcclusionTileWidth - 1) / OcclusionTileWidth;
+	numTilesY = (height + OcclusionTileHeight - 1) / OcclusionTileHeight;
+
+	this->width = numTilesX * OcclusionTileWidth;
+	this->height = numTilesY * OcclusionTileHeight;
+
+	depths.resize(this->width * this->height);
+	std::fill(depths.begin(), depths.end(), ClearDepth);
+
+	tileDepths.resize(numTilesX * numTilesY);
+	std::fill(tileDepths.begin(), tileDepths.end(), ClearDepth);
+}
+
+//-----------------------------------//
+
+void OcclusionBuffer::clear( const Matrix4x4& viewProjection )
+{
+	this->viewProjection = viewProjection;
+	triangles.clear();
+}
+
+//-----------------------------------//
+
+static Vector4 ClipToNearPlane( const Vector4& a, const Vector4& b )
+{
+	// Find where the edge crosses the plane where z equals -w.
+	float distanceA = a.z + a.w;
+	float distanceB = b.z + b.w;
+
+	float t = distanceA / (distanceA - distanceB);
+	return a + (b - a) * t;
+}
+
+void OcclusionBuffer::addOccluder( const Matrix4x3& transform, const uint8* positions,
+	uint32 stride, uint32 numPositions, const uint8* indices, uint32 indexSize,
+	uint32 numIndices )
+{
+	if( width == 0 || height == 0 ) return;
+
+	Matrix4x4 matClip = Matrix4x4(transform) * viewProjection;
+
+	uint32 numVertices = indices ? numIndices : numPositions;
+	numVertices -= numVertices % 3;
+
+	for( uint32 i = 0; i < numVertices; i += 3 )
+	{
+		Vector4 vertices[3];
+		bool isValid = true;
+
+		for( uint32 j = 0; j < 3; j++ )
+		{
+			uint32 index = i + j;
+
+			if( indices && indexSize == 16 )
+				index = ((const uint16*) indices)[i + j];
+			else if( indices )
+				index = ((const uint32*) indices)[i + j];
+
+			if( index >= numPositions )
+			{
+				isValid = false;
+				break;
+			}
+
+			const Vector3& position = *(const Vector3*) (positions + index * stride);
+			vertices[j] = matClip * Vector4(position, 1.0f);
+		}
+
+		if( !isValid ) continue;
+
+		// Clip the triangle to the near plane, which can leave a quad.
+		Vector4 clipped[4];
+		uint32 numClipped = 0;
+
+		for( uint32 j = 0; j < 3; j++ )
+		{
+			const Vector4& a = vertices[j];
+			const Vector4& b = vertices[(j + 1) % 3];
+
+			bool isInsideA = a.z + a.w >= 0;
+			bool isInsideB = b.z + b.w >= 0;
+
+			if( isInsideA )
+				clipped[numClipped++] = a;
+
+			if( isInsideA != isInsideB )
+				clipped[numClipped++] = ClipToNearPlane(a, b);
+		}
+
+		for( uint32 j = 2; j < numClipped; j++ )
+			addTriangle(clipped[0], clipped[j - 1], clipped[j]);
+	}
+}
+
+//-----------------------------------//
+
+void OcclusionBuffer::addTriangle( const Vector4& v0, const Vector4& v1, const Vector4& v2 )
+{
+	const Vector4* clip[3] = { &v0, &v1, &v2 };
+
+	float x[3], y[3], z[3];
+
+	for( uint32 i = 0; i < 3; i++ )
+	{
+		const Vector4& v = *clip[i];
+		if( v.w <= 0 ) return;
+
+		float inverseW = 1.0f / v.w;
+
+		x[i] = (v.x * inverseW * 0.5f + 0.5f) * width;
+		y[i] = (v.y * inverseW * 0.5f + 0.5f) * height;
+		z[i] = v.z * inverseW * 0.5f + 0.5f;
+	}
+
+	// Find the pixels with the centers in the bounds of the triangle.
+	float minX = std::min(x[0], std::min(x[1], x[2]));
+	float maxX = std::max(x[0], std::max(x[1], x[2]));
+	float minY = std::min(y[0], std::min(y[1], y[2]));
+	float maxY = std::max(y[0], std::max(y[1], y[2]));
+
+	OcclusionTriangle tri;
+	tri.minX = (int32) std::max(ceilf(minX - 0.5f), 0.0f);
+	tri.minY = (int32) std::max(ceilf(minY - 0.5f), 0.0f);
+	tri.maxX = (int32) std::min(floorf(maxX - 0.5f), float(width - 1));
+	tri.maxY = (int32) std::min(floorf(maxY - 0.5f), float(height - 1));
+
+	if( tri.minX > tri.maxX || tri.minY > tri.maxY )
+		return;
+
+	// Each edge function is zero on its edge and has the sign of the
+	// opposite vertex on its side.
+	for( uint32 i = 0; i < 3; i++ )
+	{
+		uint32 j = (i + 1) % 3;
+
+		tri.edgeX[i] = y[i] - y[j];
+		tri.edgeY[i] = x[j] - x[i];
+		tri.edgeOffset[i] = x[i] * y[j] - y[i] * x[j];
+	}
+
+	float area = tri.edgeX[0] * x[2] + tri.edgeY[0] * y[2] + tri.edgeOffset[0];
+
+	if( fabsf(area) < MinTriangleArea )
+		return;
+
+	// Make the edge functions positive inside the triangle, whichever
+	// way it is facing, so the occluders do not need to be closed.
+	if( area < 0 )
+	{
+		for( uint32 i = 0; i < 3; i++ )
+		{
+			tri.edgeX[i] = -tri.edgeX[i];
+			tri.edgeY[i] = -tri.edgeY[i];
+			tri.edgeOffset[i] = -tri.edgeOffset[i];
+		}
+
+		area = -area;
+	}
+
+	// The edge functions divided by the area are the barycentric weights
+	// of the opposite vertices, which interpolate the depth.
+	float inverseArea = 1.0f / area;
+
+	float depth0 = z[2] * inverseArea;
+	float depth1 = z[0] * inverseArea;
+	float depth2 = z[1] * inverseArea;
+
+	tri.depthX = tri.edgeX[0] * depth0 + tri.edgeX[1] * depth1 + tri.edgeX[2] * depth2;
+	tri.depthY = tri.edgeY[0] * depth0 + tri.edgeY[1] * depth1 + tri.edgeY[2] * depth2;
+	tri.depthOffset = tri.edgeOffset[0] * depth0 + tri.edgeOffset[1] * depth1
+		+ tri.edgeOffset[2] * depth2;
+
+	// Evaluate the functions at the pixel centers.
+	for( uint32 i = 0; i < 3; i++ )
+		tri.edgeOffset[i] += (tri.edgeX[i] + tri.edgeY[i]) * 0.5f;
+
+	tri.depthOffset += (tri.depthX + tri.depthY) * 0.5f;
+
+	triangles.pushBack(tri);
+}
+
+//-----------------------------------//
+
+void OcclusionBuffer::rasterize()
+{
+	rasterize(0, height);
+}
+
+//-----------------------------------//
+
+void OcclusionBuffer::rasterize( uint32 startRow, uint32 endRow )
+{
+	endRow = std::min(endRow, height);
+	if( startRow >= endRow ) return;
+
+	float* first = depths.data() + startRow * width;
+	std::fill(first, first + (endRow - startRow) * width, ClearDepth);
+
+	for( size_t i = 0; i < triangles.size(); i++ )
+		rasterizeTriangle(triangles[i], (int32) startRow, (int32) endRow);
+
+	updateTiles(startRow, endRow);
+}
+
+//-----------------------------------//
+
+#ifdef FLD_MATH_SSE
+
+void OcclusionBuffer::rasterizeTriangle( const OcclusionTriangle& tri,
+	int32 startRow, int32 endRow )
+{
+	int32 minY = std::max(tri.minY, startRow);
+	int32 maxY = std::min(tri.maxY, endRow - 1);
+
+	// Rasterize four pixels at a time. The width is a multiple of the
+	// tile width, so the last pixels never go past the row.
+	int32 minX = tri.minX & ~3;
+
+	__m128 lanes = _mm_setr_ps(0, 1, 2, 3);
+	__m128 zero = _mm_setzero_ps();
+
+	__m128 edgeX0 = _mm_set1_ps(tri.edgeX[0]);
+	__m128 edgeX1 = _mm_set1_ps(tri.edgeX[1]);
+	__m128 edgeX2 = _mm_set1_ps(tri.edgeX[2]);
+	__m128 depthX = _mm_set1_ps(tri.depthX);
+
+	for( int32 y = minY; y <= maxY; y++ )
+	{
+		float* row = depths.data() + y * width;
+
+		__m128 edgeRow0 = _mm_set1_ps(tri.edgeY[0] * y + tri.edgeOffset[0]);
+		__m128 edgeRow1 = _mm_set1_ps(tri.edgeY[1] * y + tri.edgeOffset[1]);
+		__m128 edgeRow2 = _mm_set1_ps(tri.edgeY[2] * y + tri.edgeOffset[2]);
+		__m128 depthRow = _mm_set1_ps(tri.depthY * y + tri.depthOffset);
+
+		for( int32 x = minX; x <= tri.maxX; x += 4 )
+		{
+			__m128 pixelX = _mm_add_ps(_mm_set1_ps((float) x), lanes);
+
+			__m128 edge0 = _mm_add_ps(_mm_mul_ps(pixelX, edgeX0), edgeRow0);
+			__m128 edge1 = _mm_add_ps(_mm_mul_ps(pixelX, edgeX1), edgeRow1);
+			__m128 edge2 = _mm_add_ps(_mm_mul_ps(pixelX, edgeX2), edgeRow2);
+
+			__m128 inside = _mm_and_ps(_mm_cmpge_ps(edge0, zero),
+				_mm_and_ps(_mm_cmpge_ps(edge1, zero), _mm_cmpge_ps(edge2, zero)));
+
+			if( _mm_movemask_ps(inside) == 0 ) continue;
+
+			__m128 depth = _mm_add_ps(_mm_mul_ps(pixelX, depthX), depthRow);
+			__m128 old = _mm_loadu_ps(row + x);
+			__m128 closest = _mm_min_ps(old, depth);
+
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closest),
+				_mm_andnot_ps(inside, old)));
+		}
+	}
+}
+
+#else
+
+void OcclusionBuffer::rasterizeTriangle( const OcclusionTriangle& tri,
+	int32 startRow, int32 endRow )
+{
+	int32 minY = std::max(tri.minY, startRow);
+	int32 maxY = std::min(tri.maxY, endRow - 1);
+
+	for( int32 y = minY; y <= maxY; y++ )
+	{
+		float* row = depths.data() + y * width;
+
+		for( int32 x = tri.minX; x <= tri.maxX; x++ )
+		{
+			float edge0 = tri.edgeX[0] * x + tri.edgeY[0] * y + tri.edgeOffset[0];
+			float edge1 = tri.edgeX[1] * x + tri.edgeY[1] * y + tri.edgeOffset[1];
+			float edge2 = tri.edgeX[2] * x + tri.edgeY[2] * y + tri.edgeOffset[2];
+
+			if( edge0 < 0 || edge1 < 0 || edge2 < 0 )
+				continue;
+
+			float depth = tri.depthX * x + tri.depthY * y + tri.depthOffset;
+			row[x] = std::min(row[x], depth);
+		}
+	}
+}
+
+#endif
+
+//-----------------------------------//
+
+void OcclusionBuffer::updateTiles( uint32 startRow, uint32 endRow )
+{
+	uint32 startTile = startRow / OcclusionTileHeight;
+	uint32 endTile = (endRow + OcclusionTileHeight - 1) / OcclusionTileHeight;
+
+	for( uint32 tileY = startTile; tileY < endTile; tileY++ )
+	{
+		for( uint32 tileX = 0; tileX < numTilesX; tileX++ )
+		{
+			float furthest = 0;
+
+			for( uint32 y = 0; y < OcclusionTileHeight; y++ )
+			{
+				uint32 pixelY = tileY * OcclusionTileHeight + y;
+				const float* row = depths.data() + pixelY * width + tileX * OcclusionTileWidth;
+
+				for( uint32 x = 0; x < OcclusionTileWidth; x++ )
+					furthest = std::max(furthest, row[x]);
+			}
+
+			tileDepths[tileY * numTilesX + tileX] = furthest;
+		}
+	}
+}
+
+//-----------------------------------//
+
+bool OcclusionBuffer::isVisible( const BoundingBox& box ) const
+{
+	if( width == 0 || height == 0 ) return true;
+
+	float minX = LimitsFloatMaximum;
+	float minY = LimitsFloatMaximum;
+	float maxX = -LimitsFloatMaximum;
+	float maxY = -LimitsFloatMaximum;
+	float minZ = LimitsFloatMaximum;
+
+	for( uint32 i = 0; i < 8; i++ )
+	{
+		Vector3 corner = box.getCorner(i);
+		Vector4 v = viewProjection * Vector4(corner, 1.0f);
+
+		// Boxes that cross the near plane cover most of the view.
+		if( v.z + v.w < 0 || v.w <= 0 ) return true;
+
+		float inverseW = 1.0f / v.w;
+
+		float x = (v.x * inverseW * 0.5f + 0.5f) * width;
+		float y = (v.y * inverseW * 0.5f + 0.5f) * height;
+		float z = v.z * inverseW * 0.5f + 0.5f;
+
+		minX = std::min(minX, x);
+		minY = std::min(minY, y);
+		maxX = std::max(maxX, x);
+		maxY = std::max(maxY, y);
+		minZ = std::min(minZ, z);
+	}
+
+	// Find the pixels that the projected box touches.
+	int32 pixelMinX = (int32) std::max(floorf(minX), 0.0f);
+	int32 pixelMinY = (int32) std::max(floorf(minY), 0.0f);
+	int32 pixelMaxX = (int32) std::min(floorf(maxX), float(width - 1));
+	int32 pixelMaxY = (int32) std::min(floorf(maxY), float(height - 1));
+
+	// Leave the boxes out of the view to the frustum culling.
+	if( pixelMinX > pixelMaxX || pixelMinY > pixelMaxY )
+		return true;
+
+	int32 tileWidth = (int32) OcclusionTileWidth;
+	int32 tileHeight = (int32) OcclusionTileHeight;
+
+	for( int32 tileY = pixelMinY / tileHeight; tileY <= pixelMaxY / tileHeight; tileY++ )
+	{
+		for( int32 tileX = pixelMinX / tileWidth; tileX <= pixelMaxX / tileWidth; tileX++ )
+		{
+			// The box is hidden in the tile if all of its pixels are closer.
+			if( tileDepths[tileY * numTilesX + tileX] < minZ )
+				continue;
+
+			int32 tileMinX = std::max(pixelMinX, tileX * tileWidth);
+			int32 tileMinY = std::max(pixelMinY, tileY * tileHeight);
+			int32 tileMaxX = std::min(pixelMaxX, tileX * tileWidth + tileWidth - 1);
+			int32 tileMaxY = std::min(pixelMaxY, tileY * tileHeight + tileHeight - 1);
+
+			if( isVisible(tileMinX, tileMinY, tileMaxX, tileMaxY, minZ) )
+				return true;
+		}
+	}
+
+	return false;
+}
+
+//-----------------------------------//
+
+#ifdef FLD_MATH_SSE
+
+bool OcclusionBuffer::isVisible( int32 minX, int32 minY, int32 maxX, int32 maxY,
+	float depth ) const
+{
+	__m128 boxDepth = _mm_set1_ps(depth);
+
+	for( int32 y = minY; y <= maxY; y++ )
+	{
+		const float* row = depths.data() + y * width;
+
+		for( int32 x = minX & ~3; x <= maxX; x += 4 )
+		{
+			__m128 pixels = _mm_loadu_ps(row + x);
+			int32 mask = _mm_movemask_ps(_mm_cmpge_ps(pixels, boxDepth));
+
+			// Ignore the pixels out of the rectangle.
+			if( x < minX ) mask &= 0xF << (minX - x);
+			if( x + 3 > maxX ) mask &= 0xF >> (x + 3 - maxX);
+
+			if( mask != 0 ) return true;
+		}
+	}
+
+	return false;
+}
+
+#else
+
+bool OcclusionBuffer::isVisible( int32 minX, int32 minY, int32 maxX, int32 maxY,
+	float depth ) const
+{
+	for( int32 y = minY; y <= maxY; y++ )
+	{
+		const float* row = depths.data() + y * width;
+
+		for( int32 x = minX; x <= maxX; x++ )
+		{
+			if( row[x] >= depth ) return true;
+		}
+	}
+
+	return false;
+}
+
+#endif
+
+//-----------------------------------//
+
+float OcclusionBuffer::getDepth( uint32 x, uint32 y ) const
+{
+	return depths[y * width + x];
+}
+
+//-----------------------------------//
+
+NAMESPACE_CORE_END
@@ -0,0 +1,162 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Core/API.h"
+#include "Core/Math/RayPacket.h"
+#include "Core/Math/Helpers.h"
+#include "Core/Math/SSE.h"
+#include <algorithm>
+
+NAMESPACE_CORE_BEGIN
+
+//-----------------------------------//
+
+RayPacket::RayPacket()
+	: size(0)
+{
+}
+
+//-----------------------------------//
+
+static float GetInverse( float value )
+{
+	// Avoid infinities, so the slabs of flat boxes stay well defined.
+	if( value > -LimitsFloatEpsilon && value < LimitsFloatEpsilon )
+		value = (value < 0) ? -LimitsFloatEpsilon : LimitsFloatEpsilon;
+
+	return 1.0f / value;
+}
+
+void RayPacket::set( const Ray* rays, const uint32* indices, uint32 count )
+{
+	size = std::min(count, RayPacketSize);
+
+	for( uint32 i = 0; i < RayPacketSize; i++ )
+	{
+		// The padding rays are never in the masks.
+		Ray ray(Vector3::Zero, Vector3::Zero);
+
+		if( i < size )
+			ray = rays[indices ? indices[i] : i];
+
+		this->rays[i] = ray;
+
+		originX[i] = ray.origin.x;
+		originY[i] = ray.origin.y;
+		originZ[i] = ray.origin.z;
+
+		inverseX[i] = GetInverse(ray.direction.x);
+		inverseY[i] = GetInverse(ray.direction.y);
+		inverseZ[i] = GetInverse(ray.direction.z);
+	}
+}
+
+//-----------------------------------//
+
+void RayPacket::set( const Ray* rays, uint32 count )
+{
+	set(rays, nullptr, count);
+}
+
+//-----------------------------------//
+
+uint32 RayPacket::getMask() const
+{
+	if( size == RayPacketSize ) return 0xFFFFFFFF;
+	return (1u << size) - 1;
+}
+
+//-----------------------------------//
+
+#ifdef FLD_MATH_SSE
+
+uint32 RayPacket::intersects( const BoundingBox& box, uint32 mask ) const
+{
+	__m128 minX = _mm_set1_ps(box.min.x);
+	__m128 minY = _mm_set1_ps(box.min.y);
+	__m128 minZ = _mm_set1_ps(box.min.z);
+
+	__m128 maxX = _mm_set1_ps(box.max.x);
+	__m128 maxY = _mm_set1_ps(box.max.y);
+	__m128 maxZ = _mm_set1_ps(box.max.z);
+
+	__m128 zero = _mm_setzero_ps();
+
+	uint32 hits = 0;
+
+	for( uint32 i = 0; i < size; i += 4 )
+	{
+		uint32 lanes = (mask >> i) & 0xF;
+		if( lanes == 0 ) continue;
+
+		__m128 ox = _mm_loadu_ps(&originX[i]);
+		__m128 oy = _mm_loadu_ps(&originY[i]);
+		__m128 oz = _mm_loadu_ps(&originZ[i]);
+
+		__m128 ix = _mm_loadu_ps(&inverseX[i]);
+		__m128 iy = _mm_loadu_ps(&inverseY[i]);
+		__m128 iz = _mm_loadu_ps(&inverseZ[i]);
+
+		__m128 nearX = _mm_mul_ps(_mm_sub_ps(minX, ox), ix);
+		__m128 nearY = _mm_mul_ps(_mm_sub_ps(minY, oy), iy);
+		__m128 nearZ = _mm_mul_ps(_mm_sub_ps(minZ, oz), iz);
+
+		__m128 farX = _mm_mul_ps(_mm_sub_ps(maxX, ox), ix);
+		__m128 farY = _mm_mul_ps(_mm_sub_ps(maxY, oy), iy);
+		__m128 farZ = _mm_mul_ps(_mm_sub_ps(maxZ, oz), iz);
+
+		__m128 enter = _mm_max_ps(
+			_mm_max_ps(_mm_min_ps(nearX, farX), _mm_min_ps(nearY, farY)),
+			_mm_max_ps(_mm_min_ps(nearZ, farZ), zero));
+
+		__m128 exit = _mm_min_ps(
+			_mm_min_ps(_mm_max_ps(nearX, farX), _mm_max_ps(nearY, farY)),
+			_mm_max_ps(nearZ, farZ));
+
+		uint32 lanesHit = (uint32) _mm_movemask_ps(_mm_cmple_ps(enter, exit));
+		hits |= (lanesHit & lanes) << i;
+	}
+
+	return hits;
+}
+
+#else
+
+uint32 RayPacket::intersects( const BoundingBox& box, uint32 mask ) const
+{
+	uint32 hits = 0;
+
+	for( uint32 i = 0; i < size; i++ )
+	{
+		if( !(mask & (1u << i)) ) continue;
+
+		float nearX = (box.min.x - originX[i]) * inverseX[i];
+		float nearY = (box.min.y - originY[i]) * inverseY[i];
+		float nearZ = (box.min.z - originZ[i]) * inverseZ[i];
+
+		float farX = (box.max.x - originX[i]) * inverseX[i];
+		float farY = (box.max.y - originY[i]) * inverseY[i];
+		float farZ = (box.max.z - originZ[i]) * inverseZ[i];
+
+		float enter = std::max(std::max(std::min(nearX, farX), std::min(nearY, farY)),
+			std::max(std::min(nearZ, farZ), 0.0f));
+
+		float exit = std::min(std::min(std::max(nearX, farX), std::max(nearY, farY)),
+			std::max(nearZ, farZ));
+
+		if( enter <= exit )
+			hits |= 1u << i;
+	}
+
+	return hits;
+}
+
+#endif
+
+//-----------------------------------//
+
+NAMESPACE_CORE_END
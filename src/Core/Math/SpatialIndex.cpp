@@ -0,0 +1,39 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Core/API.h"
+#include "Core/Math/SpatialIndex.h"
+
+NAMESPACE_CORE_BEGIN
+
+//-----------------------------------//
+
+void SpatialIndex::createProxies( const BoundingBox* boxes, void* const* userdata,
+	size_t count, int32* proxies )
+{
+	for( size_t i = 0; i < count; i++ )
+		proxies[i] = createProxy(boxes[i], userdata[i]);
+}
+
+//-----------------------------------//
+
+void SpatialIndex::query( const RayPacket& packet, Array<int32>& proxies,
+	Array<uint32>& masks ) const
+{
+	for( uint32 i = 0; i < packet.size; i++ )
+	{
+		size_t first = proxies.size();
+		query(packet.getRay(i), proxies);
+
+		for( size_t j = first; j < proxies.size(); j++ )
+			masks.pushBack(1u << i);
+	}
+}
+
+//-----------------------------------//
+
+NAMESPACE_CORE_END
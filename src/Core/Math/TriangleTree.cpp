@@ -0,0 +1,656 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Core/API.h"
+#include "Core/Math/TriangleTree.h"
+#include "Core/Math/SSE.h"
+#include <algorithm>
+
+NAMESPACE_CORE_BEGIN
+
+//-----------------------------------//
+
+// Number of bins where the split planes are evaluated.
+static const uint32 NumSplitBins = 16;
+
+// Depth after which the triangles are split at the median.
+static const uint32 MaxSplitDepth = 32;
+
+// Size of the traversal stack. Each level pushes up to three siblings,
+// and the median splits bound the depth of the tree.
+static const uint32 MaxStackSize = 256;
+
+struct TriangleTree::BuildTriangle
+{
+	Vector3 vertices[3];
+	Vector3 center;
+	BoundingBox box;
+	int32 index;
+};
+
+static float GetSurfaceArea( const BoundingBox& box )
+{
+	Vector3 size = box.max - box.min;
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+static float GetAxis( const Vector3& v, int axis )
+{
+	return (&v.x)[axis];
+}
+
+//-----------------------------------//
+
+TriangleTree::TriangleTree()
+	: root(TriangleTreeEmpty)
+	, numTriangles(0)
+{
+	box.setZero();
+}
+
+//-----------------------------------//
+
+void TriangleTree::clear()
+{
+	nodes.clear();
+	leaves.clear();
+
+	root = TriangleTreeEmpty;
+	numTriangles = 0;
+
+	box.setZero();
+}
+
+//-----------------------------------//
+
+void TriangleTree::build( const uint8* positions, uint32 stride, uint32 numPositions,
+	const uint32* indices, uint32 numIndices )
+{
+	clear();
+
+	uint32 count = indices ? numIndices / 3 : numPositions / 3;
+
+	Array<BuildTriangle> triangles;
+	triangles.reserve(count);
+
+	box.reset();
+
+	for( uint32 i = 0; i < count; i++ )
+	{
+		BuildTriangle triangle;
+		triangle.index = (int32) i;
+		triangle.box.reset();
+
+		bool isValid = true;
+
+		for( uint32 j = 0; j < 3; j++ )
+		{
+			uint32 index = indices ? indices[i * 3 + j] : i * 3 + j;
+
+			if( index >= numPositions )
+			{
+				isValid = false;
+				break;
+			}
+
+			const Vector3& vertex = *(const Vector3*) (positions + index * stride);
+
+			triangle.vertices[j] = vertex;
+			triangle.box.add(vertex);
+		}
+
+		if( !isValid ) continue;
+
+		triangle.center = triangle.box.getCenter();
+		box.add(triangle.box);
+
+		triangles.pushBack(triangle);
+	}
+
+	numTriangles = triangles.size();
+
+	if( numTriangles == 0 )
+	{
+		box.setZero();
+		return;
+	}
+
+	root = build(triangles.data(), numTriangles, 0);
+}
+
+//-----------------------------------//
+
+struct BuildTriangleCenterLess
+{
+	BuildTriangleCenterLess( int axis ) : axis(axis) {}
+
+	template<typename T>
+	bool operator()( const T& a, const T& b ) const
+	{
+		return GetAxis(a.center, axis) < GetAxis(b.center, axis);
+	}
+
+	int axis;
+};
+
+uint32 TriangleTree::split( BuildTriangle* triangles, uint32 count, uint32 depth )
+{
+	BoundingBox centers;
+	centers.reset();
+
+	for( uint32 i = 0; i < count; i++ )
+		centers.add(triangles[i].center);
+
+	// Split along the axis where the centers are the most spread.
+	Vector3 spread = centers.max - centers.min;
+
+	int axis = 0;
+	if( spread.y > spread.x ) axis = 1;
+	if( spread.z > GetAxis(spread, axis) ) axis = 2;
+
+	float minCenter = GetAxis(centers.min, axis);
+	float size = GetAxis(spread, axis);
+
+	uint32 half = count / 2;
+
+	if( size <= 0 || depth >= MaxSplitDepth )
+	{
+		std::nth_element(triangles, triangles + half, triangles + count,
+			BuildTriangleCenterLess(axis));
+		return half;
+	}
+
+	// Bin the triangles by their centers and sweep the bins from both
+	// sides to find the split with the lowest surface area heuristic.
+	BoundingBox binBoxes[NumSplitBins];
+	uint32 binCounts[NumSplitBins];
+
+	for( uint32 i = 0; i < NumSplitBins; i++ )
+	{
+		binBoxes[i].reset();
+		binCounts[i] = 0;
+	}
+
+	float scale = NumSplitBins * 0.9999f / size;
+
+	for( uint32 i = 0; i < count; i++ )
+	{
+		float offset = GetAxis(triangles[i].center, axis) - minCenter;
+		uint32 bin = std::min((uint32) (offset * scale), NumSplitBins - 1);
+
+		binBoxes[bin].add(triangles[i].box);
+		binCounts[bin]++;
+	}
+
+	float rightCosts[NumSplitBins];
+
+	BoundingBox rightBox;
+	rightBox.reset();
+
+	uint32 rightCount = 0;
+
+	for( uint32 i = NumSplitBins - 1; i > 0; i-- )
+	{
+		rightBox.add(binBoxes[i]);
+		rightCount += binCounts[i];
+
+		rightCosts[i] = rightCount ? GetSurfaceArea(rightBox) * rightCount : 0;
+	}
+
+	BoundingBox leftBox;
+	leftBox.reset();
+
+	uint32 leftCount = 0;
+
+	float bestCost = LimitsFloatMaximum;
+	uint32 bestBin = 0;
+
+	for( uint32 i = 1; i < NumSplitBins; i++ )
+	{
+		leftBox.add(binBoxes[i - 1]);
+		leftCount += binCounts[i - 1];
+
+		if( leftCount == 0 || leftCount == count ) continue;
+
+		float cost = GetSurfaceArea(leftBox) * leftCount + rightCosts[i];
+
+		if( cost < bestCost )
+		{
+			bestCost = cost;
+			bestBin = i;
+		}
+	}
+
+	if( bestBin == 0 )
+	{
+		std::nth_element(triangles, triangles + half, triangles + count,
+			BuildTriangleCenterLess(axis));
+		return half;
+	}
+
+	BuildTriangle* middle = std::partition(triangles, triangles + count,
+		[=](const BuildTriangle& triangle) {
+			float offset = GetAxis(triangle.center, axis) - minCenter;
+			return std::min((uint32) (offset * scale), NumSplitBins - 1) < bestBin;
+		});
+
+	return (uint32) (middle - triangles);
+}
+
+//-----------------------------------//
+
+int32 TriangleTree::build( BuildTriangle* triangles, uint32 count, uint32 depth )
+{
+	if( count <= TriangleTreeWidth )
+		return buildLeaf(triangles, count);
+
+	// Split the triangles twice, so the node gets up to four children.
+	uint32 starts[TriangleTreeWidth];
+	uint32 counts[TriangleTreeWidth];
+	uint32 numChildren = 0;
+
+	uint32 half = split(triangles, count, depth);
+
+	uint32 halfStarts[] = { 0, half };
+	uint32 halfCounts[] = { half, count - half };
+
+	for( uint32 i = 0; i < 2; i++ )
+	{
+		uint32 start = halfStarts[i];
+		uint32 size = halfCounts[i];
+
+		if( size <= TriangleTreeWidth )
+		{
+			starts[numChildren] = start;
+			counts[numChildren++] = size;
+			continue;
+		}
+
+		uint32 quarter = split(triangles + start, size, depth);
+
+		starts[numChildren] = start;
+		counts[numChildren++] = quarter;
+
+		starts[numChildren] = start + quarter;
+		counts[numChildren++] = size - quarter;
+	}
+
+	int32 index = (int32) nodes.size();
+	nodes.resize(index + 1);
+
+	BoundingBox boxes[TriangleTreeWidth];
+	int32 children[TriangleTreeWidth];
+
+	for( uint32 i = 0; i < numChildren; i++ )
+	{
+		boxes[i].reset();
+
+		for( uint32 j = 0; j < counts[i]; j++ )
+			boxes[i].add(triangles[starts[i] + j].box);
+
+		children[i] = build(triangles + starts[i], counts[i], depth + 1);
+	}
+
+	// The children are built first, as they might resize the nodes.
+	TriangleTreeNode& node = nodes[index];
+
+	for( uint32 i = 0; i < TriangleTreeWidth; i++ )
+	{
+		bool isEmpty = i >= numChildren;
+		const BoundingBox& childBox = boxes[isEmpty ? 0 : i];
+
+		node.minX[i] = childBox.min.x;
+		node.minY[i] = childBox.min.y;
+		node.minZ[i] = childBox.min.z;
+
+		node.maxX[i] = childBox.max.x;
+		node.maxY[i] = childBox.max.y;
+		node.maxZ[i] = childBox.max.z;
+
+		node.children[i] = isEmpty ? TriangleTreeEmpty : children[i];
+	}
+
+	return index;
+}
+
+//-----------------------------------//
+
+int32 TriangleTree::buildLeaf( const BuildTriangle* triangles, uint32 count )
+{
+	TriangleTreeLeaf leaf;
+
+	for( uint32 i = 0; i < TriangleTreeWidth; i++ )
+	{
+		// Padding triangles have empty edges, so they are never hit.
+		Vector3 vertex, edge1, edge2;
+		vertex.zero();
+		edge1.zero();
+		edge2.zero();
+
+		int32 index = TriangleTreeEmpty;
+
+		if( i < count )
+		{
+			const BuildTriangle& triangle = triangles[i];
+
+			vertex = triangle.vertices[0];
+			edge1 = triangle.vertices[1] - triangle.vertices[0];
+			edge2 = triangle.vertices[2] - triangle.vertices[0];
+
+			index = triangle.index;
+		}
+
+		leaf.vertexX[i] = vertex.x;
+		leaf.vertexY[i] = vertex.y;
+		leaf.vertexZ[i] = vertex.z;
+
+		leaf.edge1X[i] = edge1.x;
+		leaf.edge1Y[i] = edge1.y;
+		leaf.edge1Z[i] = edge1.z;
+
+		leaf.edge2X[i] = edge2.x;
+		leaf.edge2Y[i] = edge2.y;
+		leaf.edge2Z[i] = edge2.z;
+
+		leaf.triangles[i] = index;
+	}
+
+	leaves.pushBack(leaf);
+
+	return ~((int32) leaves.size() - 1);
+}
+
+//-----------------------------------//
+
+struct RaycastState
+{
+	Vector3 origin;
+	Vector3 direction;
+	Vector3 inverse;
+
+	float nearest;
+	bool found;
+
+	TriangleTreeHit* hit;
+};
+
+#ifdef FLD_MATH_SSE
+
+// Tests the ray against the boxes of the children and returns a mask
+// with a bit set for each box that is hit before the nearest triangle.
+static uint32 IntersectBoxes( const TriangleTreeNode& node, const RaycastState& state,
+	float* distances )
+{
+	__m128 originX = _mm_set1_ps(state.origin.x);
+	__m128 originY = _mm_set1_ps(state.origin.y);
+	__m128 originZ = _mm_set1_ps(state.origin.z);
+
+	__m128 inverseX = _mm_set1_ps(state.inverse.x);
+	__m128 inverseY = _mm_set1_ps(state.inverse.y);
+	__m128 inverseZ = _mm_set1_ps(state.inverse.z);
+
+	__m128 nearX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minX), originX), inverseX);
+	__m128 nearY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minY), originY), inverseY);
+	__m128 nearZ = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minZ), originZ), inverseZ);
+
+	__m128 farX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxX), originX), inverseX);
+	__m128 farY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxY), originY), inverseY);
+	__m128 farZ = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxZ), originZ), inverseZ);
+
+	__m128 enter = _mm_max_ps(
+		_mm_max_ps(_mm_min_ps(nearX, farX), _mm_min_ps(nearY, farY)),
+		_mm_max_ps(_mm_min_ps(nearZ, farZ), _mm_setzero_ps()));
+
+	__m128 exit = _mm_min_ps(
+		_mm_min_ps(_mm_max_ps(nearX, farX), _mm_max_ps(nearY, farY)),
+		_mm_min_ps(_mm_max_ps(nearZ, farZ), _mm_set1_ps(state.nearest)));
+
+	_mm_storeu_ps(distances, enter);
+
+	return (uint32) _mm_movemask_ps(_mm_cmple_ps(enter, exit));
+}
+
+//-----------------------------------//
+
+// Tests the ray against the triangles of the leaf with the algorithm of
+// Moller and Trumbore and keeps the nearest hit.
+static void IntersectTriangles( const TriangleTreeLeaf& leaf, RaycastState& state )
+{
+	__m128 directionX = _mm_set1_ps(state.direction.x);
+	__m128 directionY = _mm_set1_ps(state.direction.y);
+	__m128 directionZ = _mm_set1_ps(state.direction.z);
+
+	__m128 edge1X = _mm_loadu_ps(leaf.edge1X);
+	__m128 edge1Y = _mm_loadu_ps(leaf.edge1Y);
+	__m128 edge1Z = _mm_loadu_ps(leaf.edge1Z);
+
+	__m128 edge2X = _mm_loadu_ps(leaf.edge2X);
+	__m128 edge2Y = _mm_loadu_ps(leaf.edge2Y);
+	__m128 edge2Z = _mm_loadu_ps(leaf.edge2Z);
+
+	// P = D x E2
+	__m128 pX = _mm_sub_ps(_mm_mul_ps(directionY, edge2Z), _mm_mul_ps(directionZ, edge2Y));
+	__m128 pY = _mm_sub_ps(_mm_mul_ps(directionZ, edge2X), _mm_mul_ps(directionX, edge2Z));
+	__m128 pZ = _mm_sub_ps(_mm_mul_ps(directionX, edge2Y), _mm_mul_ps(directionY, edge2X));
+
+	__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge1X, pX), _mm_mul_ps(edge1Y, pY)),
+		_mm_mul_ps(edge1Z, pZ));
+
+	__m128 epsilon = _mm_set1_ps(LimitsFloatEpsilon);
+
+	__m128 mask = _mm_or_ps(_mm_cmpgt_ps(det, epsilon),
+		_mm_cmplt_ps(det, _mm_sub_ps(_mm_setzero_ps(), epsilon)));
+
+	if( _mm_movemask_ps(mask) == 0 ) return;
+
+	__m128 inverseDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+	// T = O - V0
+	__m128 tX = _mm_sub_ps(_mm_set1_ps(state.origin.x), _mm_loadu_ps(leaf.vertexX));
+	__m128 tY = _mm_sub_ps(_mm_set1_ps(state.origin.y), _mm_loadu_ps(leaf.vertexY));
+	__m128 tZ = _mm_sub_ps(_mm_set1_ps(state.origin.z), _mm_loadu_ps(leaf.vertexZ));
+
+	__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tX, pX), _mm_mul_ps(tY, pY)),
+		_mm_mul_ps(tZ, pZ)), inverseDet);
+
+	// Q = T x E1
+	__m128 qX = _mm_sub_ps(_mm_mul_ps(tY, edge1Z), _mm_mul_ps(tZ, edge1Y));
+	__m128 qY = _mm_sub_ps(_mm_mul_ps(tZ, edge1X), _mm_mul_ps(tX, edge1Z));
+	__m128 qZ = _mm_sub_ps(_mm_mul_ps(tX, edge1Y), _mm_mul_ps(tY, edge1X));
+
+	__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(directionX, qX),
+		_mm_mul_ps(directionY, qY)), _mm_mul_ps(directionZ, qZ)), inverseDet);
+
+	__m128 distance = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edge2X, qX),
+		_mm_mul_ps(edge2Y, qY)), _mm_mul_ps(edge2Z, qZ)), inverseDet);
+
+	__m128 zero = _mm_setzero_ps();
+
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(distance, zero));
+	mask = _mm_and_ps(mask, _mm_cmplt_ps(distance, _mm_set1_ps(state.nearest)));
+
+	uint32 hits = (uint32) _mm_movemask_ps(mask);
+	if( hits == 0 ) return;
+
+	float us[TriangleTreeWidth], vs[TriangleTreeWidth], distances[TriangleTreeWidth];
+
+	_mm_storeu_ps(us, u);
+	_mm_storeu_ps(vs, v);
+	_mm_storeu_ps(distances, distance);
+
+	for( uint32 i = 0; i < TriangleTreeWidth; i++ )
+	{
+		if( !(hits & (1u << i)) || distances[i] >= state.nearest )
+			continue;
+
+		state.nearest = distances[i];
+		state.found = true;
+
+		state.hit->triangle = (uint32) leaf.triangles[i];
+		state.hit->distance = distances[i];
+		state.hit->u = us[i];
+		state.hit->v = vs[i];
+	}
+}
+
+#else
+
+static uint32 IntersectBoxes( const TriangleTreeNode& node, const RaycastState& state,
+	float* distances )
+{
+	const Vector3& origin = state.origin;
+	const Vector3& inverse = state.inverse;
+
+	uint32 mask = 0;
+
+	for( uint32 i = 0; i < TriangleTreeWidth; i++ )
+	{
+		float nearX = (node.minX[i] - origin.x) * inverse.x;
+		float nearY = (node.minY[i] - origin.y) * inverse.y;
+		float nearZ = (node.minZ[i] - origin.z) * inverse.z;
+
+		float farX = (node.maxX[i] - origin.x) * inverse.x;
+		float farY = (node.maxY[i] - origin.y) * inverse.y;
+		float farZ = (node.maxZ[i] - origin.z) * inverse.z;
+
+		float enter = std::max(std::max(std::min(nearX, farX), std::min(nearY, farY)),
+			std::max(std::min(nearZ, farZ), 0.0f));
+
+		float exit = std::min(std::min(std::max(nearX, farX), std::max(nearY, farY)),
+			std::min(std::max(nearZ, farZ), state.nearest));
+
+		distances[i] = enter;
+
+		if( enter <= exit )
+			mask |= 1u << i;
+	}
+
+	return mask;
+}
+
+//-----------------------------------//
+
+static void IntersectTriangles( const TriangleTreeLeaf& leaf, RaycastState& state )
+{
+	const Vector3& direction = state.direction;
+
+	for( uint32 i = 0; i < TriangleTreeWidth; i++ )
+	{
+		Vector3 edge1(leaf.edge1X[i], leaf.edge1Y[i], leaf.edge1Z[i]);
+		Vector3 edge2(leaf.edge2X[i], leaf.edge2Y[i], leaf.edge2Z[i]);
+
+		Vector3 p = direction.cross(edge2);
+		float det = edge1.dot(p);
+
+		if( det > -LimitsFloatEpsilon && det < LimitsFloatEpsilon )
+			continue;
+
+		float inverseDet = 1.0f / det;
+
+		Vector3 vertex(leaf.vertexX[i], leaf.vertexY[i], leaf.vertexZ[i]);
+		Vector3 t = state.origin - vertex;
+
+		float u = t.dot(p) * inverseDet;
+		if( u < 0 || u > 1 ) continue;
+
+		Vector3 q = t.cross(edge1);
+
+		float v = direction.dot(q) * inverseDet;
+		if( v < 0 || u + v > 1 ) continue;
+
+		float distance = edge2.dot(q) * inverseDet;
+		if( distance < 0 || distance >= state.nearest ) continue;
+
+		state.nearest = distance;
+		state.found = true;
+
+		state.hit->triangle = (uint32) leaf.triangles[i];
+		state.hit->distance = distance;
+		state.hit->u = u;
+		state.hit->v = v;
+	}
+}
+
+#endif
+
+//-----------------------------------//
+
+static float GetInverse( float value )
+{
+	// Avoid infinities, so the slabs of flat boxes stay well defined.
+	if( value > -LimitsFloatEpsilon && value < LimitsFloatEpsilon )
+		value = (value < 0) ? -LimitsFloatEpsilon : LimitsFloatEpsilon;
+
+	return 1.0f / value;
+}
+
+bool TriangleTree::raycast( const Ray& ray, TriangleTreeHit& hit, float maxDistance ) const
+{
+	if( root == TriangleTreeEmpty ) return false;
+
+	RaycastState state;
+	state.origin = ray.origin;
+	state.direction = ray.direction;
+	state.inverse = Vector3( GetInverse(ray.direction.x), GetInverse(ray.direction.y),
+		GetInverse(ray.direction.z) );
+	state.nearest = maxDistance;
+	state.found = false;
+	state.hit = &hit;
+
+	int32 stack[MaxStackSize];
+	uint32 stackSize = 0;
+
+	stack[stackSize++] = root;
+
+	while( stackSize > 0 )
+	{
+		int32 child = stack[--stackSize];
+
+		if( child < 0 )
+		{
+			IntersectTriangles(leaves[~child], state);
+			continue;
+		}
+
+		const TriangleTreeNode& node = nodes[child];
+
+		float distances[TriangleTreeWidth];
+		uint32 mask = IntersectBoxes(node, state, distances);
+
+		// Push the farthest children first, so the nearest are visited
+		// first and the hits found there cull the others.
+		int32 order[TriangleTreeWidth];
+		uint32 numHits = 0;
+
+		for( uint32 i = 0; i < TriangleTreeWidth; i++ )
+		{
+			if( !(mask & (1u << i)) || node.children[i] == TriangleTreeEmpty )
+				continue;
+
+			uint32 j = numHits++;
+
+			for( ; j > 0 && distances[order[j - 1]] < distances[i]; j-- )
+				order[j] = order[j - 1];
+
+			order[j] = (int32) i;
+		}
+
+		assert( stackSize + numHits <= MaxStackSize );
+
+		for( uint32 i = 0; i < numHits; i++ )
+			stack[stackSize++] = node.children[order[i]];
+	}
+
+	return state.found;
+}
+
+//-----------------------------------//
+
+NAMESPACE_CORE_END
@@ -435,6 +435,132 @@ Allocator* AllocatorCreateBump( Allocator* alloc, int32 size )
 
 //-----------------------------------//
 
+// Slots keep the allocation metadata right before the object, so the
+// objects are deallocated like the ones of the heap. Free slots keep a
+// pointer to the next free slot, and chunks to the next chunk.
+
+static const int32 ChunkAlignment = 16;
+
+template<typename T> static T ChunkAlign(T size)
+{
+	return (size + ChunkAlignment - 1) & ~(T) (ChunkAlignment - 1);
+}
+
+// Offset of the objects in the slots, so they stay aligned.
+static const int32 ChunkObjectOffset = ChunkAlign<int32>(sizeof(AllocationMetadata));
+
+//-----------------------------------//
+
+static void ChunkGrow(ChunkAllocator* chunk)
+{
+	int32 headerSize = sizeof(uint8*);
+	int32 size = headerSize + chunk->slotSize * chunk->slotsPerChunk + ChunkAlignment;
+
+	uint8* memory = (uint8*) AllocatorAllocate(chunk->parent, size, ChunkAlignment);
+	if( !memory ) return;
+
+	*(uint8**) memory = chunk->chunks;
+	chunk->chunks = memory;
+	chunk->numChunks++;
+
+	// Link the slots backwards so they are used in memory order.
+	uintptr_t start = (uintptr_t) (memory + headerSize);
+	uint8* slots = (uint8*) ChunkAlign(start);
+
+	for( int32 i = chunk->slotsPerChunk - 1; i >= 0; i-- )
+	{
+		uint8* slot = slots + i * chunk->slotSize;
+		*(uint8**) slot = chunk->freeSlots;
+		chunk->freeSlots = slot;
+	}
+}
+
+//-----------------------------------//
+
+static void* ChunkAllocate(Allocator* alloc, int32 size, int32 align)
+{
+	if(AllocatorSimulateLowMemory) return nullptr;
+
+	ChunkAllocator* chunk = (ChunkAllocator*) alloc;
+
+	if( size + ChunkObjectOffset > chunk->slotSize || align > ChunkAlignment )
+		return AllocatorAllocate(chunk->parent, size, align);
+
+	if( !chunk->freeSlots )
+		ChunkGrow(chunk);
+
+	uint8* slot = chunk->freeSlots;
+	if( !slot ) return nullptr;
+
+	chunk->freeSlots = *(uint8**) slot;
+	chunk->numAllocations++;
+
+	uint8* object = slot + ChunkObjectOffset;
+
+	AllocationMetadata* metadata = (AllocationMetadata*) (object - sizeof(AllocationMetadata));
+	metadata->size = size;
+	metadata->group = alloc->group;
+	metadata->allocator = alloc;
+	metadata->pattern = MEMORY_PATTERN;
+
+	return object;
+}
+
+//-----------------------------------//
+
+static void ChunkDeallocate(Allocator* alloc, const void* p)
+{
+	ChunkAllocator* chunk = (ChunkAllocator*) alloc;
+
+	uint8* slot = (uint8*) p - ChunkObjectOffset;
+	*(uint8**) slot = chunk->freeSlots;
+
+	chunk->freeSlots = slot;
+	chunk->numAllocations--;
+}
+
+//-----------------------------------//
+
+static void ChunkReset(Allocator* alloc)
+{
+	ChunkAllocator* chunk = (ChunkAllocator*) alloc;
+
+	while( chunk->chunks )
+	{
+		uint8* memory = chunk->chunks;
+		chunk->chunks = *(uint8**) memory;
+
+		AllocatorDeallocate(memory);
+	}
+
+	chunk->freeSlots = nullptr;
+	chunk->numChunks = 0;
+	chunk->numAllocations = 0;
+}
+
+//-----------------------------------//
+
+Allocator* AllocatorCreateChunk( Allocator* alloc, int32 size, int32 slotsPerChunk )
+{
+	ChunkAllocator* chunk = Allocate(alloc, ChunkAllocator);
+
+	chunk->parent = alloc;
+	chunk->slotSize = ChunkAlign(size + ChunkObjectOffset);
+	chunk->slotsPerChunk = slotsPerChunk;
+	chunk->numChunks = 0;
+	chunk->numAllocations = 0;
+	chunk->chunks = nullptr;
+	chunk->freeSlots = nullptr;
+	chunk->allocate = ChunkAllocate;
+	chunk->deallocate = ChunkDeallocate;
+	chunk->reset = ChunkReset;
+	chunk->group = alloc->group;
+
+	return chunk;
+}
+
+//-----------------------------------//
+
 int32 ReferenceGetCount(ReferenceCounted* ref)
 {
 	return ref->references.read();
@@ -0,0 +1,87 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Core/API.h"
+#include "Core/Sort.h"
+#include <cstring>
+#include <algorithm>
+
+NAMESPACE_CORE_BEGIN
+
+//-----------------------------------//
+
+static const size_t RadixBits = 8;
+static const size_t RadixBuckets = 1 << RadixBits;
+static const size_t RadixPasses = 64 / RadixBits;
+
+void RadixSort(uint64* keys, uint32* values, size_t count,
+	uint64* tempKeys, uint32* tempValues)
+{
+	if( count < 2 ) return;
+
+	// Build the histograms of all the passes at once.
+	size_t histograms[RadixPasses][RadixBuckets];
+	memset(histograms, 0, sizeof(histograms));
+
+	for( size_t i = 0; i < count; ++i )
+	{
+		uint64 key = keys[i];
+
+		for( size_t pass = 0; pass < RadixPasses; ++pass )
+		{
+			size_t digit = (key >> (pass * RadixBits)) & (RadixBuckets - 1);
+			histograms[pass][digit]++;
+		}
+	}
+
+	uint64* srcKeys = keys;
+	uint32* srcValues = values;
+	uint64* dstKeys = tempKeys;
+	uint32* dstValues = tempValues;
+
+	for( size_t pass = 0; pass < RadixPasses; ++pass )
+	{
+		size_t* histogram = histograms[pass];
+		size_t shift = pass * RadixBits;
+
+		// Skip the pass if all the keys have the same digit.
+		size_t firstDigit = (srcKeys[0] >> shift) & (RadixBuckets - 1);
+		if( histogram[firstDigit] == count ) continue;
+
+		// Convert the counts to the starting offsets of each bucket.
+		size_t offset = 0;
+		for( size_t i = 0; i < RadixBuckets; ++i )
+		{
+			size_t bucketCount = histogram[i];
+			histogram[i] = offset;
+			offset += bucketCount;
+		}
+
+		for( size_t i = 0; i < count; ++i )
+		{
+			uint64 key = srcKeys[i];
+			size_t digit = (key >> shift) & (RadixBuckets - 1);
+			size_t index = histogram[digit]++;
+
+			dstKeys[index] = key;
+			dstValues[index] = srcValues[i];
+		}
+
+		std::swap(srcKeys, dstKeys);
+		std::swap(srcValues, dstValues);
+	}
+
+	// Copy back if the sorted data ended up in the temporary arrays.
+	if( srcKeys == keys ) return;
+
+	memcpy(keys, srcKeys, count * sizeof(uint64));
+	memcpy(values, srcValues, count * sizeof(uint32));
+}
+
+//-----------------------------------//
+
+NAMESPACE_CORE_END
@@ -0,0 +1,149 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Core/API.h"
+#include "Core/Memory.h"
+#include "Core/Array.h"
+#include "Core/Math/BoundingTree.h"
+#include <UnitTest++.h>
+#include <algorithm>
+
+using namespace fld;
+
+static float NextRandomFloat(uint32& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return (state & 0xFFFFFF) / float(0x1000000);
+}
+
+static BoundingBox NextRandomBox(uint32& state)
+{
+	Vector3 center;
+	center.x = (NextRandomFloat(state) - 0.5f) * 1000.0f;
+	center.y = (NextRandomFloat(state) - 0.5f) * 1000.0f;
+	center.z = (NextRandomFloat(state) - 0.5f) * 1000.0f;
+
+	Vector3 extent( 0.5f + NextRandomFloat(state) * 5.0f );
+
+	return BoundingBox(center - extent, center + extent);
+}
+
+static bool BoxesOverlap(const BoundingBox& a, const BoundingBox& b)
+{
+	return a.min.x <= b.max.x && a.min.y <= b.max.y && a.min.z <= b.max.z
+		&& a.max.x >= b.min.x && a.max.y >= b.min.y && a.max.z >= b.min.z;
+}
+
+SUITE(Core)
+{
+	TEST(BoundingTree)
+	{
+		const uint32 count = 50000;
+
+		BoundingTree tree;
+		uint32 state = 0x9E3779B9;
+
+		Array<BoundingBox> boxes;
+		boxes.resize(count);
+
+		Array<int32> proxies;
+		proxies.resize(count);
+
+		for( uint32 i = 0; i < count; i++ )
+		{
+			boxes[i] = NextRandomBox(state);
+			proxies[i] = tree.createProxy(boxes[i], &boxes[i]);
+		}
+
+		CHECK_EQUAL(count, tree.getNumProxies());
+		CHECK(tree.validate());
+
+		// A balanced tree of 50000 leaves has a height of about 16.
+		CHECK(tree.getHeight() < 32);
+
+		// Small movements stay inside the fat boxes.
+		uint32 numReinserted = 0;
+
+		for( uint32 i = 0; i < count; i += 2 )
+		{
+			Vector3 offset( tree.getMargin() * 0.5f, 0, 0 );
+
+			BoundingBox& box = boxes[i];
+			box = (i % 10 == 0) ? NextRandomBox(state)
+				: BoundingBox(box.min + offset, box.max + offset);
+
+			numReinserted += tree.moveProxy(proxies[i], box);
+		}
+
+		CHECK_EQUAL(count / 10, numReinserted);
+		CHECK(tree.validate());
+
+		for( uint32 i = 0; i < count; i += 3 )
+		{
+			tree.destroyProxy(proxies[i]);
+			proxies[i] = BoundingTreeNull;
+		}
+
+		CHECK(tree.validate());
+
+		// Compare the queries with testing every box.
+		uint32 numMissing = 0;
+
+		for( uint32 i = 0; i < 1000; i++ )
+		{
+			Vector3 center = NextRandomBox(state).getCenter();
+			BoundingBox query(center - Vector3(20.0f), center + Vector3(20.0f));
+
+			Array<int32> found;
+			tree.query(query, found);
+
+			for( uint32 j = 0; j < count; j++ )
+			{
+				if( proxies[j] == BoundingTreeNull ) continue;
+				if( !BoxesOverlap(boxes[j], query) ) continue;
+
+				if( std::find(found.begin(), found.end(), proxies[j]) == found.end() )
+					numMissing++;
+			}
+		}
+
+		CHECK_EQUAL(0u, numMissing);
+
+		// The ray query returns the proxies whose fat boxes the ray hits.
+		Ray ray( Vector3(0, 0, -1000), Vector3(0, 0, 1) );
+
+		Array<int32> hits;
+		tree.query(ray, hits);
+
+		uint32 numHits = 0;
+
+		for( uint32 i = 0; i < count; i++ )
+		{
+			if( proxies[i] == BoundingTreeNull ) continue;
+
+			float distance;
+			if( !tree.getFatBox(proxies[i]).intersects(ray, distance) ) continue;
+
+			numHits++;
+			CHECK(std::find(hits.begin(), hits.end(), proxies[i]) != hits.end());
+		}
+
+		CHECK(numHits > 0);
+		CHECK_EQUAL(numHits, (uint32) hits.size());
+
+		for( uint32 i = 0; i < count; i++ )
+		{
+			if( proxies[i] != BoundingTreeNull )
+				tree.destroyProxy(proxies[i]);
+		}
+
+		CHECK_EQUAL(0u, tree.getNumProxies());
+		CHECK(tree.validate());
+	}
+}
@@ -260,4 +260,25 @@ SUITE(CoreTests_Containers)
         ptrs.clear();
         CHECK_EQUAL(100, obj::dtorCount);
     }
+
+    TEST_FIXTURE(ContainerFixture, HashMapRemove)
+    {
+        HashMap<int> map(*_a);
+
+        for(int i = 0; i < 10; ++i)
+            map.set(i, i * 2);
+
+        map.remove(3);
+        map.remove(9);
+
+        CHECK_EQUAL(8, map.size());
+        CHECK(!map.has(3));
+        CHECK(!map.has(9));
+
+        for(int i = 0; i < 10; ++i)
+        {
+            if(i == 3 || i == 9) continue;
+            CHECK_EQUAL(i * 2, map.get(i, -1));
+        }
+    }
 }
\ No newline at end of file
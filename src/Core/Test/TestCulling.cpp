@@ -0,0 +1,98 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Core/API.h"
+#include "Core/Memory.h"
+#include "Core/Array.h"
+#include "Core/Math/FrustumCulling.h"
+#include <UnitTest++.h>
+
+using namespace fld;
+
+static float NextRandomFloat(uint32& state)
+{
+	// xorshift32, so the test does not depend on the platform rand().
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return (state & 0xFFFFFF) / float(0x1000000);
+}
+
+SUITE(Core)
+{
+	TEST(FrustumCullBoxes)
+	{
+		const uint32 count = 100000;
+
+		Frustum frustum;
+		frustum.farPlane = 500.0f;
+		frustum.aspectRatio = 16.0f / 9.0f;
+		frustum.updateProjection();
+		frustum.updatePlanes( Matrix4x3::Identity );
+
+		// Scatter the boxes around the camera, so some are in front of it,
+		// some behind it and some cross the planes.
+		Array<BoundingBox> boxes;
+		boxes.resize(count);
+
+		BoundingBoxArray boxArray;
+		uint32 state = 0x9E3779B9;
+
+		for( uint32 i = 0; i < count; i++ )
+		{
+			Vector3 center;
+			center.x = (NextRandomFloat(state) - 0.5f) * 1000.0f;
+			center.y = (NextRandomFloat(state) - 0.5f) * 1000.0f;
+			center.z = (NextRandomFloat(state) - 0.5f) * 1000.0f;
+
+			Vector3 extent( 0.5f + NextRandomFloat(state) * 10.0f );
+
+			boxes[i] = BoundingBox(center - extent, center + extent);
+			boxArray.add(boxes[i]);
+		}
+
+		CHECK_EQUAL(count, boxArray.getSize());
+
+		Array<bool> expected;
+		expected.resize(count);
+
+		for( uint32 i = 0; i < count; i++ )
+			expected[i] = frustum.intersects(boxes[i]);
+
+		Array<uint32> visible;
+		FrustumCullBoxes(frustum, boxArray, visible);
+
+		CHECK_EQUAL((count + 31) / 32, (uint32) visible.size());
+
+		uint32 numVisible = 0;
+		uint32 numMismatches = 0;
+
+		for( uint32 i = 0; i < count; i++ )
+		{
+			bool isVisible = FrustumCullIsVisible(visible, i);
+
+			numVisible += isVisible;
+			numMismatches += isVisible != expected[i];
+		}
+
+		// Boxes that touch a plane can round to the other side of it.
+		CHECK(numVisible > 0 && numVisible < count);
+		CHECK(numMismatches <= count / 10000);
+
+		// Reset boxes have no bounds and are never culled.
+		BoundingBox reset;
+		reset.reset();
+
+		boxArray.clear();
+		boxArray.add( BoundingBox(Vector3(0, 0, 1000), Vector3(1, 1, 1001)) );
+		boxArray.add(reset);
+
+		FrustumCullBoxes(frustum, boxArray, visible);
+		CHECK_EQUAL(1u, (uint32) visible.size());
+		CHECK_EQUAL(2u, visible[0]);
+	}
+}
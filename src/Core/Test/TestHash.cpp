@@ -0,0 +1,44 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Core/API.h"
+#include "Core/Math/Hash.h"
+#include <UnitTest++.h>
+
+using namespace fld;
+
+SUITE(Core)
+{
+	TEST(HashXX64)
+	{
+		CHECK(XXHash64("", 0, 0) == 0xEF46DB3751D8E999ULL);
+		CHECK(XXHash64("abc", 3, 0) == 0x44BC2CF5AD770999ULL);
+
+		const char* text = "Nobody inspects the spammish repetition";
+		size_t size = strlen(text);
+		CHECK(XXHash64(text, size, 0) == 0xFBCEA83C8A378BF1ULL);
+
+		// Hashing in chunks should match hashing all the data at once.
+		uint8 data[1024];
+		for( size_t i = 0; i < sizeof(data); ++i )
+			data[i] = (uint8) (i * 7 + 3);
+
+		for( size_t chunk = 1; chunk < 80; chunk += 13 )
+		{
+			HashStateXX64 state;
+			XXHash64Init(&state, 42);
+
+			for( size_t i = 0; i < sizeof(data); i += chunk )
+			{
+				size_t n = (sizeof(data) - i < chunk) ? sizeof(data) - i : chunk;
+				XXHash64Update(&state, data + i, n);
+			}
+
+			CHECK(XXHash64Digest(&state) == XXHash64(data, sizeof(data), 42));
+		}
+	}
+}
\ No newline at end of file
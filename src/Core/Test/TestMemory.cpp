@@ -0,0 +1,65 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Core/API.h"
+#include "Core/Memory.h"
+#include <UnitTest++.h>
+
+using namespace fld;
+
+SUITE(Core)
+{
+	TEST(ChunkAllocator)
+	{
+		Allocator* heap = AllocatorGetHeap();
+		Allocator* alloc = AllocatorCreateChunk(heap, 40, 8);
+		ChunkAllocator* chunk = (ChunkAllocator*) alloc;
+
+		void* objects[20];
+
+		for( size_t i = 0; i < 20; i++ )
+		{
+			objects[i] = AllocatorAllocate(alloc, 40, 8);
+			CHECK( objects[i] != nullptr );
+			CHECK_EQUAL( 0u, (uint32) ((uintptr_t) objects[i] & 15) );
+			CHECK( AllocatorGetObject(objects[i]) == alloc );
+		}
+
+		CHECK_EQUAL( 3, chunk->numChunks );
+		CHECK_EQUAL( 20, chunk->numAllocations );
+
+		// The objects of a chunk are next to each other.
+		for( size_t i = 1; i < 8; i++ )
+		{
+			int32 offset = (int32) ((uint8*) objects[i] - (uint8*) objects[i - 1]);
+			CHECK_EQUAL( chunk->slotSize, offset );
+		}
+
+		// Freed slots are used again.
+		AllocatorDeallocate(objects[5]);
+		CHECK_EQUAL( 19, chunk->numAllocations );
+
+		objects[5] = AllocatorAllocate(alloc, 40, 8);
+		CHECK_EQUAL( 20, chunk->numAllocations );
+		CHECK_EQUAL( 3, chunk->numChunks );
+
+		// Bigger objects are allocated by the parent.
+		void* big = AllocatorAllocate(alloc, 400, 8);
+		CHECK( AllocatorGetObject(big) == heap );
+		AllocatorDeallocate(big);
+
+		for( size_t i = 0; i < 20; i++ )
+			AllocatorDeallocate(objects[i]);
+
+		CHECK_EQUAL( 0, chunk->numAllocations );
+
+		AllocatorReset(alloc);
+		CHECK_EQUAL( 0, chunk->numChunks );
+
+		AllocatorDestroy(alloc);
+	}
+}
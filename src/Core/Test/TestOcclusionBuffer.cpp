@@ -0,0 +1,105 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Core/API.h"
+#include "Core/Memory.h"
+#include "Core/Array.h"
+#include "Core/Math/OcclusionBuffer.h"
+#include <UnitTest++.h>
+
+using namespace fld;
+
+static void AddQuad( OcclusionBuffer& buffer, const Vector3 (&corners)[4] )
+{
+	uint16 indices[] = { 0, 1, 2, 0, 2, 3 };
+
+	buffer.addOccluder(Matrix4x3::Identity, (const uint8*) corners, sizeof(Vector3),
+		4, (const uint8*) indices, 16, 6);
+}
+
+SUITE(Core)
+{
+	TEST(OcclusionBuffer)
+	{
+		// The view looks down the negative Z axis.
+		Matrix4x4 projection = Matrix4x4::createPerspective(60, 2, 1, 100);
+
+		OcclusionBuffer buffer;
+		buffer.resize(60, 30);
+
+		CHECK_EQUAL(64u, buffer.getWidth());
+		CHECK_EQUAL(32u, buffer.getHeight());
+
+		// A wall in front of the view.
+		Vector3 wall[4] =
+		{
+			Vector3(-5, -5, -10), Vector3(5, -5, -10),
+			Vector3(5, 5, -10), Vector3(-5, 5, -10)
+		};
+
+		buffer.clear(projection);
+		AddQuad(buffer, wall);
+		buffer.rasterize();
+
+		CHECK_EQUAL(2u, buffer.getTriangles().size());
+		CHECK(buffer.getDepth(32, 16) < 1.0f);
+		CHECK_EQUAL(1.0f, buffer.getDepth(0, 0));
+
+		// Boxes behind the wall are hidden, unless they reach past it.
+		CHECK(!buffer.isVisible(BoundingBox(Vector3(-1, -1, -30), Vector3(1, 1, -20))));
+		CHECK(buffer.isVisible(BoundingBox(Vector3(10, -1, -30), Vector3(20, 1, -20))));
+		CHECK(buffer.isVisible(BoundingBox(Vector3(-1, -1, -8), Vector3(1, 1, -6))));
+
+		// Boxes that cross the near plane are always visible.
+		CHECK(buffer.isVisible(BoundingBox(Vector3(-1, -1, -5), Vector3(1, 1, 5))));
+
+		// Rasterizing the rows in bands gives the same depths.
+		OcclusionBuffer bands;
+		bands.resize(60, 30);
+		bands.clear(projection);
+		AddQuad(bands, wall);
+		bands.rasterize(16, 32);
+		bands.rasterize(0, 16);
+
+		for( uint32 y = 0; y < buffer.getHeight(); y++ )
+		{
+			for( uint32 x = 0; x < buffer.getWidth(); x++ )
+				CHECK_EQUAL(buffer.getDepth(x, y), bands.getDepth(x, y));
+		}
+	}
+
+	TEST(OcclusionBufferNearPlane)
+	{
+		Matrix4x4 projection = Matrix4x4::createPerspective(60, 2, 1, 100);
+
+		OcclusionBuffer buffer;
+		buffer.resize(64, 32);
+
+		// A floor under the view that starts behind it, so its triangles
+		// are clipped to the near plane.
+		Vector3 floor[4] =
+		{
+			Vector3(-50, -2, 5), Vector3(50, -2, 5),
+			Vector3(50, -2, -20), Vector3(-50, -2, -20)
+		};
+
+		buffer.clear(projection);
+		AddQuad(buffer, floor);
+		buffer.rasterize();
+
+		CHECK(!buffer.getTriangles().empty());
+
+		CHECK(!buffer.isVisible(BoundingBox(Vector3(-1, -10, -15), Vector3(1, -8, -12))));
+		CHECK(buffer.isVisible(BoundingBox(Vector3(-1, -1, -15), Vector3(1, 0, -12))));
+
+		// The occluders are removed when the buffer is cleared.
+		buffer.clear(projection);
+		buffer.rasterize();
+
+		CHECK(buffer.isVisible(BoundingBox(Vector3(-1, -10, -15), Vector3(1, -8, -12))));
+	}
+}
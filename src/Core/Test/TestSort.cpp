@@ -0,0 +1,75 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Core/API.h"
+#include "Core/Memory.h"
+#include "Core/Array.h"
+#include "Core/Sort.h"
+#include <UnitTest++.h>
+#include <algorithm>
+
+using namespace fld;
+
+static uint64 NextRandom(uint64& state)
+{
+	// xorshift64, so the test does not depend on the platform rand().
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+SUITE(Core)
+{
+	TEST(RadixSort)
+	{
+		const size_t count = 100000;
+
+		Array<uint64> keys;
+		Array<uint32> values;
+		Array<uint64> tempKeys;
+		Array<uint32> tempValues;
+
+		keys.resize(count);
+		values.resize(count);
+		tempKeys.resize(count);
+		tempValues.resize(count);
+
+		// Use few distinct keys in the low bits so the stability is tested.
+		uint64 state = 0x9E3779B97F4A7C15ULL;
+		for( size_t i = 0; i < count; ++i )
+		{
+			keys[i] = NextRandom(state) & 0xFFFF0000000003FFULL;
+			values[i] = (uint32) i;
+		}
+
+		Array<uint64> expected = keys;
+		std::sort(expected.begin(), expected.end());
+
+		RadixSort(keys.data(), values.data(), count,
+			tempKeys.data(), tempValues.data());
+
+		bool sorted = true;
+		bool stable = true;
+
+		for( size_t i = 0; i < count; ++i )
+		{
+			sorted &= keys[i] == expected[i];
+
+			if( i > 0 && keys[i] == keys[i-1] )
+				stable &= values[i] > values[i-1];
+		}
+
+		CHECK(sorted);
+		CHECK(stable);
+
+		// Sorting already sorted keys should keep them in place.
+		RadixSort(keys.data(), values.data(), count,
+			tempKeys.data(), tempValues.data());
+		CHECK(keys[0] == expected[0] && keys[count-1] == expected[count-1]);
+	}
+}
@@ -0,0 +1,221 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Core/API.h"
+#include "Core/Memory.h"
+#include "Core/Array.h"
+#include "Core/Math/BoundingTree.h"
+#include "Core/Math/LooseOctree.h"
+#include "Core/Math/HashedGrid.h"
+#include <UnitTest++.h>
+#include <algorithm>
+
+using namespace fld;
+
+static float NextRandomFloat(uint32& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return (state & 0xFFFFFF) / float(0x1000000);
+}
+
+// Props scattered over a flat world, with a few big boxes.
+static BoundingBox NextRandomProp(uint32& state)
+{
+	Vector3 center;
+	center.x = (NextRandomFloat(state) - 0.5f) * 2000.0f;
+	center.y = (NextRandomFloat(state) - 0.5f) * 50.0f;
+	center.z = (NextRandomFloat(state) - 0.5f) * 2000.0f;
+
+	Vector3 extent( 0.5f + NextRandomFloat(state) * 4.0f );
+
+	if( NextRandomFloat(state) < 0.01f )
+		extent = Vector3(100.0f);
+
+	return BoundingBox(center - extent, center + extent);
+}
+
+static bool BoxesOverlap(const BoundingBox& a, const BoundingBox& b)
+{
+	return a.min.x <= b.max.x && a.min.y <= b.max.y && a.min.z <= b.max.z
+		&& a.max.x >= b.min.x && a.max.y >= b.min.y && a.max.z >= b.min.z;
+}
+
+// Returns the number of overlapping boxes the queries of the index miss.
+static uint32 RunSpatialIndex(SpatialIndex* index, bool bulk)
+{
+	const uint32 count = 20000;
+	uint32 state = 0x2545F491;
+
+	Array<BoundingBox> boxes;
+	boxes.resize(count);
+
+	Array<void*> userdata;
+	userdata.resize(count);
+
+	Array<int32> proxies;
+	proxies.resize(count);
+
+	for( uint32 i = 0; i < count; i++ )
+	{
+		boxes[i] = NextRandomProp(state);
+		userdata[i] = &boxes[i];
+	}
+
+	if( bulk )
+	{
+		index->createProxies(boxes.data(), userdata.data(), count, proxies.data());
+	}
+	else
+	{
+		for( uint32 i = 0; i < count; i++ )
+			proxies[i] = index->createProxy(boxes[i], userdata[i]);
+	}
+
+	// Move a few props a lot and the others a bit.
+	for( uint32 i = 0; i < count; i += 2 )
+	{
+		Vector3 offset( NextRandomFloat(state) - 0.5f, 0, NextRandomFloat(state) - 0.5f );
+
+		BoundingBox& box = boxes[i];
+		box = (i % 20 == 0) ? NextRandomProp(state)
+			: BoundingBox(box.min + offset, box.max + offset);
+
+		index->moveProxy(proxies[i], box);
+	}
+
+	// Neighbourhood queries around random points.
+	Array<BoundingBox> queries;
+
+	for( uint32 i = 0; i < 500; i++ )
+	{
+		Vector3 center = NextRandomProp(state).getCenter();
+		queries.pushBack( BoundingBox(center - Vector3(30.0f), center + Vector3(30.0f)) );
+	}
+
+	uint32 numMissing = 0;
+
+	for( size_t i = 0; i < queries.size(); i++ )
+	{
+		Array<int32> found;
+		index->query(queries[i], found);
+
+		for( size_t j = 0; j < found.size(); j++ )
+			found[j] = (int32) ((BoundingBox*) index->getUserData(found[j]) - boxes.data());
+
+		std::sort(found.begin(), found.end());
+
+		for( uint32 j = 0; j < count; j++ )
+		{
+			if( !BoxesOverlap(boxes[j], queries[i]) ) continue;
+
+			if( !std::binary_search(found.begin(), found.end(), (int32) j) )
+				numMissing++;
+		}
+	}
+
+	return numMissing;
+}
+
+SUITE(Core)
+{
+	TEST(SpatialIndex)
+	{
+		BoundingTree tree;
+		CHECK_EQUAL(0u, RunSpatialIndex(&tree, false));
+		CHECK(tree.validate());
+
+		BoundingTree bulkTree;
+		CHECK_EQUAL(0u, RunSpatialIndex(&bulkTree, true));
+		CHECK(bulkTree.validate());
+
+		LooseOctree octree( BoundingBox(Vector3(-1024.0f), Vector3(1024.0f)) );
+		CHECK_EQUAL(0u, RunSpatialIndex(&octree, false));
+
+		HashedGrid grid(16.0f);
+		CHECK_EQUAL(0u, RunSpatialIndex(&grid, false));
+
+		// Removing all the proxies leaves the indices empty.
+		octree.clear();
+		grid.clear();
+
+		CHECK_EQUAL(0u, octree.getNumProxies());
+		CHECK_EQUAL(0u, grid.getNumProxies());
+	}
+
+	TEST(SpatialIndexRayPacket)
+	{
+		const uint32 count = 20000;
+		uint32 state = 0x2545F491;
+
+		Array<BoundingBox> boxes;
+		boxes.resize(count);
+
+		BoundingTree tree;
+		LooseOctree octree( BoundingBox(Vector3(-1024.0f), Vector3(1024.0f)) );
+
+		for( uint32 i = 0; i < count; i++ )
+		{
+			boxes[i] = NextRandomProp(state);
+			tree.createProxy(boxes[i], &boxes[i]);
+			octree.createProxy(boxes[i], &boxes[i]);
+		}
+
+		// Rays fired from a point, like the line of sight checks of an agent.
+		Array<Ray> rays;
+		Vector3 origin( 0, 10.0f, 0 );
+
+		for( uint32 i = 0; i < 50; i++ )
+		{
+			Vector3 target = NextRandomProp(state).getCenter();
+			rays.pushBack( Ray(origin, (target - origin).normalize()) );
+		}
+
+		SpatialIndex* indices[] = { &tree, &octree };
+
+		for( size_t i = 0; i < 2; i++ )
+		{
+			const SpatialIndex* index = indices[i];
+			uint32 numMissing = 0;
+
+			for( uint32 first = 0; first < rays.size(); first += RayPacketSize )
+			{
+				RayPacket packet;
+				packet.set(rays.data() + first, rays.size() - first);
+
+				Array<int32> proxies;
+				Array<uint32> masks;
+				index->query(packet, proxies, masks);
+
+				CHECK_EQUAL(proxies.size(), masks.size());
+
+				// Every box hit by a ray is returned with the ray in its mask.
+				for( uint32 j = 0; j < packet.getSize(); j++ )
+				{
+					for( uint32 k = 0; k < count; k++ )
+					{
+						float distance;
+						if( !boxes[k].intersects(packet.getRay(j), distance) ) continue;
+
+						bool found = false;
+
+						for( size_t l = 0; l < proxies.size() && !found; l++ )
+						{
+							found = (masks[l] & (1u << j))
+								&& index->getUserData(proxies[l]) == &boxes[k];
+						}
+
+						if( !found ) numMissing++;
+					}
+				}
+			}
+
+			CHECK_EQUAL(0u, numMissing);
+		}
+	}
+}
@@ -9,6 +9,7 @@
 #include "Core/Concurrency.h"
 #include "Core/Task.h"
 #include "Core/Memory.h"
+#include "Core/Utilities.h"
 #include <UnitTest++.h>
 
 using namespace fld;
@@ -28,26 +29,33 @@ void RunTask(Task* task)
 	taskVal = 20;
 }
 
-bool added = false; 
+TaskState eventStates[4];
+size_t numEvents = 0;
+
 void TaskEventWatch(TaskEvent taskEvent)
 {
-	switch(taskVal)
-	{
-		case 10:
-			if(!added)
-			{
-				CHECK(taskEvent.state == TaskState::Added);
-				added = true;
-			}
-			else
-			{
-				CHECK(taskEvent.state == TaskState::Started);
-			}
-			break;
-		case 20:
-			CHECK(taskEvent.state == TaskState::Finished);
-			break;
-	}
+	if(numEvents < 4)
+		eventStates[numEvents] = taskEvent.state;
+
+	numEvents++;
+}
+
+struct TaskOrder
+{
+	uint32* counter;
+	uint32 order;
+};
+
+void RunOrderedTask(Task* task)
+{
+	TaskOrder* order = (TaskOrder*) task->userdata;
+	order->order = ++(*order->counter);
+}
+
+void RunCountedTask(Task* task)
+{
+	Atomic<uint32>* count = (Atomic<uint32>*) task->userdata;
+	count->increment();
 }
 
 }
@@ -131,5 +139,150 @@ SUITE(Core)
 		pool.waitAll();
 		CHECK( taskVal == 20 );
 
+		// Events are only raised when the pool is updated.
+		CHECK_EQUAL( 0u, numEvents );
+
+		pool.update();
+		CHECK_EQUAL( 3u, numEvents );
+		CHECK( eventStates[0] == TaskState::Added );
+		CHECK( eventStates[1] == TaskState::Started );
+		CHECK( eventStates[2] == TaskState::Finished );
+
+		pool.update();
+		CHECK_EQUAL( 3u, numEvents );
+	}
+
+	TEST(TaskpoolPriorities)
+	{
+		// Without threads the tasks only run when they are drained below.
+		TaskPool pool(0);
+		uint32 counter = 0;
+
+		// Flood the pool with background work.
+		const size_t NumBackground = 256;
+		Task background[NumBackground];
+		TaskOrder backgroundOrder[NumBackground];
+
+		for(size_t i = 0; i < NumBackground; ++i)
+		{
+			backgroundOrder[i].counter = &counter;
+			backgroundOrder[i].order = 0;
+			background[i].callback.Bind(RunOrderedTask);
+			background[i].userdata = &backgroundOrder[i];
+			pool.add(&background[i]);
+		}
+
+		TaskOrder highOrder = { &counter, 0 };
+		Task high;
+		high.priority = 10;
+		high.callback.Bind(RunOrderedTask);
+		high.userdata = &highOrder;
+		pool.add(&high);
+
+		TaskOrder cancelledOrder = { &counter, 0 };
+		Task cancelled;
+		cancelled.callback.Bind(RunOrderedTask);
+		cancelled.userdata = &cancelledOrder;
+		pool.add(&cancelled);
+
+		TaskOrder deadlineOrder = { &counter, 0 };
+		Task deadline;
+		deadline.priority = -1;
+		deadline.deadline = 0.0001f;
+		deadline.callback.Bind(RunOrderedTask);
+		deadline.userdata = &deadlineOrder;
+		pool.add(&deadline);
+
+		Task unqueued;
+		unqueued.callback.Bind(RunOrderedTask);
+
+		CHECK( pool.cancel(&cancelled) );
+		CHECK( !pool.cancel(&unqueued) );
+		CHECK( pool.setPriority(&background[NumBackground - 1], 5) );
+		CHECK( !pool.setPriority(&unqueued, 5) );
+
+		// The sleep is longer than the deadline, so it has always expired.
+		SystemSleep(1);
+
+		while(pool.runPendingTask()) {}
+
+		CHECK_EQUAL( NumBackground + 2, counter );
+
+		// Expired deadlines go first, then the highest priorities.
+		CHECK_EQUAL( 1u, deadlineOrder.order );
+		CHECK_EQUAL( 2u, highOrder.order );
+		CHECK_EQUAL( 3u, backgroundOrder[NumBackground - 1].order );
+		CHECK_EQUAL( 0u, cancelledOrder.order );
+
+		// The remaining background tasks keep their queueing order.
+		for(size_t i = 1; i < NumBackground - 1; ++i)
+			CHECK_EQUAL( backgroundOrder[i - 1].order + 1, backgroundOrder[i].order );
+	}
+
+	TEST(TaskGroupWait)
+	{
+		// Without threads the waiting thread has to run the tasks.
+		TaskPool pool(0);
+
+		Atomic<uint32> otherCount(0);
+		Task other;
+		other.callback.Bind(RunCountedTask);
+		other.userdata = &otherCount;
+		pool.add(&other);
+
+		TaskGroup group;
+		group.setTaskPool(&pool);
+
+		const size_t NumTasks = 8;
+		Task tasks[NumTasks];
+		Atomic<uint32> count(0);
+
+		for(size_t i = 0; i < NumTasks; ++i)
+		{
+			tasks[i].callback.Bind(RunCountedTask);
+			tasks[i].userdata = &count;
+			group.add(&tasks[i]);
+		}
+
+		group.wait();
+		CHECK_EQUAL( NumTasks, count.read() );
+
+		// Tasks outside the group are left in the pool.
+		CHECK_EQUAL( 0u, otherCount.read() );
+		CHECK( pool.tasks.has(&other) );
+		CHECK( pool.runPendingTask() );
+		CHECK_EQUAL( 1u, otherCount.read() );
+
+		// Groups without a pool run the tasks when added.
+		TaskGroup inlineGroup;
+		inlineGroup.add(&tasks[0]);
+		CHECK_EQUAL( NumTasks + 1, count.read() );
+	}
+
+	TEST(TaskGroupThreads)
+	{
+		TaskPool pool(2);
+
+		TaskGroup group;
+		group.setTaskPool(&pool);
+
+		const size_t NumTasks = 64;
+		Task tasks[NumTasks];
+		Atomic<uint32> count(0);
+
+		for(size_t frame = 0; frame < 4; ++frame)
+		{
+			for(size_t i = 0; i < NumTasks; ++i)
+			{
+				tasks[i].callback.Bind(RunCountedTask);
+				tasks[i].userdata = &count;
+				group.add(&tasks[i]);
+			}
+
+			group.wait();
+			CHECK_EQUAL( NumTasks * (frame + 1), count.read() );
+		}
+
+		pool.waitAll();
 	}
 }
@@ -0,0 +1,139 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Core/API.h"
+#include "Core/Memory.h"
+#include "Core/Array.h"
+#include "Core/Math/TriangleTree.h"
+#include <UnitTest++.h>
+
+using namespace fld;
+
+static float NextRandomFloat(uint32& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return (state & 0xFFFFFF) / float(0x1000000);
+}
+
+static Vector3 NextRandomVector(uint32& state, float scale)
+{
+	Vector3 v;
+	v.x = (NextRandomFloat(state) - 0.5f) * scale;
+	v.y = (NextRandomFloat(state) - 0.5f) * scale;
+	v.z = (NextRandomFloat(state) - 0.5f) * scale;
+	return v;
+}
+
+SUITE(Core)
+{
+	TEST(TriangleTree)
+	{
+		const uint32 numTriangles = 5000;
+
+		uint32 state = 0x9E3779B9;
+
+		// Small random triangles, with shared indices.
+		Array<Vector3> positions;
+		Array<uint32> indices;
+
+		for( uint32 i = 0; i < numTriangles; i++ )
+		{
+			Vector3 center = NextRandomVector(state, 100.0f);
+
+			uint32 first = positions.size();
+
+			for( uint32 j = 0; j < 3; j++ )
+				positions.pushBack( center + NextRandomVector(state, 4.0f) );
+
+			indices.pushBack(first + 2);
+			indices.pushBack(first + 0);
+			indices.pushBack(first + 1);
+		}
+
+		TriangleTree tree;
+		tree.build((uint8*) positions.data(), sizeof(Vector3), positions.size(),
+			indices.data(), indices.size());
+
+		CHECK_EQUAL(numTriangles, tree.getNumTriangles());
+		CHECK(tree.getLeaves().size() >= numTriangles / TriangleTreeWidth);
+
+		// The tree finds the same nearest hits as testing every triangle.
+		uint32 numHits = 0;
+
+		for( uint32 i = 0; i < 500; i++ )
+		{
+			Vector3 origin = NextRandomVector(state, 150.0f);
+			Vector3 target = NextRandomVector(state, 50.0f);
+
+			Ray ray(origin, (target - origin).normalize());
+
+			float nearest = LimitsFloatMaximum;
+			int32 nearestTriangle = -1;
+
+			for( uint32 j = 0; j < numTriangles; j++ )
+			{
+				Vector3 tri[3];
+				tri[0] = positions[indices[j * 3 + 0]];
+				tri[1] = positions[indices[j * 3 + 1]];
+				tri[2] = positions[indices[j * 3 + 2]];
+
+				float t, u, v;
+
+				if( ray.intersects(tri, t, u, v) && t >= 0 && t < nearest )
+				{
+					nearest = t;
+					nearestTriangle = (int32) j;
+				}
+			}
+
+			TriangleTreeHit hit;
+			bool isHit = tree.raycast(ray, hit);
+
+			CHECK_EQUAL(nearestTriangle >= 0, isHit);
+			if( !isHit || nearestTriangle < 0 ) continue;
+
+			CHECK_CLOSE(nearest, hit.distance, 0.01f);
+			numHits++;
+		}
+
+		CHECK(numHits > 0);
+
+		// Hits further than the maximum distance are ignored.
+		Ray ray(Vector3(0, 0, -1000), Vector3(0, 0, 1));
+
+		TriangleTreeHit hit;
+		CHECK(!tree.raycast(ray, hit, 10.0f));
+
+		tree.clear();
+		CHECK(!tree.raycast(ray, hit));
+	}
+
+	TEST(TriangleTreeUnindexed)
+	{
+		Vector3 positions[] =
+		{
+			Vector3(-1, -1, 5), Vector3(1, -1, 5), Vector3(0, 1, 5),
+			Vector3(-1, -1, 2), Vector3(1, -1, 2), Vector3(0, 1, 2)
+		};
+
+		TriangleTree tree;
+		tree.build((uint8*) positions, sizeof(Vector3), 6, nullptr, 0);
+
+		CHECK_EQUAL(2u, tree.getNumTriangles());
+
+		TriangleTreeHit hit;
+		CHECK(tree.raycast(Ray(Vector3(0, 0, 0), Vector3(0, 0, 1)), hit));
+
+		CHECK_EQUAL(1u, hit.triangle);
+		CHECK_CLOSE(2.0f, hit.distance, 0.001f);
+
+		// Triangles behind the ray are not hit.
+		CHECK(!tree.raycast(Ray(Vector3(0, 0, 10), Vector3(0, 0, 1)), hit));
+	}
+}
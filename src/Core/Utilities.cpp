@@ -14,6 +14,7 @@
 #include <sstream>
 #include <algorithm>
 #include <cstdio>
+#include <cerrno>
 
 #ifdef PLATFORM_WINDOWS
 	#define WIN32_LEAN_AND_MEAN
@@ -33,6 +34,9 @@
 	#include <unistd.h>
 #endif
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #if defined(PLATFORM_NACL)
 // Declare these manually because GCC/Clang in C++11 mode
 // define __STRICT_ANSI__ and that makes them hidden.
@@ -456,4 +460,37 @@ bool FileExists(const Path& path)
 
 //-----------------------------------//
 
+bool FileGetInfo(const Path& path, uint64& size, uint64& modifiedTime)
+{
+#ifdef COMPILER_MSVC
+	struct _stat64 info;
+	if( _stat64(path.c_str(), &info) != 0 )
+		return false;
+#else
+	struct stat info;
+	if( stat(path.c_str(), &info) != 0 )
+		return false;
+#endif
+
+	size = (uint64) info.st_size;
+	modifiedTime = (uint64) info.st_mtime;
+
+	return true;
+}
+
+//-----------------------------------//
+
+bool FileCreateDirectory(const Path& path)
+{
+#ifdef COMPILER_MSVC
+	int result = _mkdir(path.c_str());
+#else
+	int result = mkdir(path.c_str(), 0755);
+#endif
+
+	return result == 0 || errno == EEXIST;
+}
+
+//-----------------------------------//
+
 NAMESPACE_CORE_END
\ No newline at end of file
@@ -32,6 +32,7 @@ AudioDevice::AudioDevice(ALCdevice* device)
 
 	ResourceManager* res = GetResourceManager();
 	res->onResourceLoaded.Connect(this, &AudioDevice::onResourceLoaded);
+	res->onResourceStreamed.Connect(this, &AudioDevice::onResourceLoaded);
 }
 
 //-----------------------------------//
@@ -176,11 +177,21 @@ void AudioDevice::onResourceLoaded(const ResourceEvent& event)
 	Sound* sound = (Sound*) resource;
 	assert( sound->isLoaded() );
 
+	// Sounds decoded in chunks are uploaded after the last chunk. Until
+	// then the sources queue the decoded data as it gets ready.
+	if( !sound->isDecoded() )
+		return;
+
 	auto soundBuffer = soundBuffers.get((uint64)sound, nullptr);
 	
 	if(!soundBuffer)
 		return;
 
+	// The events of the chunks decoded before this update all see the
+	// sound fully decoded, so upload it only once.
+	if( soundBuffer->getUploaded() )
+		return;
+
 	AudioBufferSound(soundBuffer.get(), sound);
 }
 
@@ -14,6 +14,7 @@
 #include "Engine/Audio/Context.h"
 #include "Engine/Audio/Device.h"
 #include "Engine/Audio/AL.h"
+#include "Resources/ResourceManager.h"
 
 #define LogAudio(s) (LogWarn(s ": %s", AudioGetError()))
 
@@ -31,6 +32,8 @@ REFLECT_ENUM_END()
 
 AudioSource::AudioSource(AudioContext* context)
 	: context(context)
+	, queueChunks(false)
+	, chunkOffset(0)
 	, id(0)
 {
 	for( size_t i = 0; i < AudioSourceNumBuffers; ++i )
@@ -125,7 +128,7 @@ static bool AudioStreamQueueBuffer(ALuint source, ALuint buffer,
 
 	int size = stream.decode(data, FLD_ARRAY_SIZE(data));
 	
-	if( size < BUFFER_SIZE )
+	if( size < (int) BUFFER_SIZE )
 		hasMoreData = false;
 
 	details.data = data;
@@ -150,11 +153,50 @@ static bool AudioStreamQueueBuffer(ALuint source, ALuint buffer,
 
 //-----------------------------------//
 
+bool AudioSource::queueChunk(ALuint buffer)
+{
+	const Array<byte>& data = sound->getBuffer();
+	uint32 decoded = sound->getDecodedSize();
+
+	// Start again from the beginning of the sound when looping.
+	if( chunkOffset == data.size() && loop )
+		chunkOffset = 0;
+
+	uint32 size = decoded - chunkOffset;
+
+	if( size > BUFFER_SIZE )
+		size = BUFFER_SIZE;
+
+	// Nothing to queue until more of the sound is decoded.
+	if( size == 0 )
+		return false;
+
+	AudioBufferDetails details;
+	AudioGetBufferDataDetails(details, sound);
+	details.data = (uint8*) data.data() + chunkOffset;
+	details.size = size;
+
+	AudioBufferData(buffer, details);
+	chunkOffset += size;
+
+	alSourceQueueBuffers(id, 1, &buffer);
+
+	if(AudioCheckError())
+		LogAudio("Could not queue buffer in audio source");
+
+	return true;
+}
+
+//-----------------------------------//
+
 void AudioSource::setSound(const SoundHandle& handle)
 {
 	soundHandle = handle;
 	sound = handle.Resolve();
 
+	queueChunks = false;
+	idleBuffers.clear();
+
 	// Empty the source if the sound is not valid.
 	if( !sound )
 	{
@@ -164,11 +206,26 @@ void AudioSource::setSound(const SoundHandle& handle)
 
 	AudioDevice* device = GetAudioDevice();
 
-	if( !sound->getStreamed() )
+	if( !sound->getStreamed() && sound->isLoaded() && !sound->isDecoded() )
+	{
+		// Play the decoded part of the sound while the rest is decoded.
+		queueChunks = true;
+		chunkOffset = 0;
+
+		for( size_t i = 0; i < AudioSourceNumBuffers; ++i )
+		{
+			buffers[i] = device->createBuffer();
+			ALuint bufferId = buffers[i]->getId();
+
+			if( !queueChunk(bufferId) )
+				idleBuffers.pushBack(bufferId);
+		}
+	}
+	else if( !sound->getStreamed() )
 	{
 		buffers[0] = device->prepareBuffer(sound);
 		
-		if( sound->isLoaded() )
+		if( sound->isLoaded() && !buffers[0]->getUploaded() )
 			AudioBufferSound(buffers[0].get(), sound);
 	}
 	else
@@ -196,6 +253,14 @@ bool AudioSource::update()
 {
 	if( !sound )
 		return false;
+
+	// The source reads the sound data, so keep it from being unloaded.
+	if( queueChunks )
+		GetResourceManager()->touchResource(sound);
+
+	// Queue the buffers that were waiting for more decoded data.
+	while( queueChunks && !idleBuffers.empty() && queueChunk(idleBuffers.back()) )
+		idleBuffers.popBack();
 	
 	int processed;
 	alGetSourcei(id, AL_BUFFERS_PROCESSED, &processed);
@@ -217,6 +282,14 @@ bool AudioSource::update()
 		
 		if(AudioCheckError())
 			LogAudio("Could not unqueue buffer from audio source");
+
+		if( queueChunks )
+		{
+			if( !queueChunk(buffer) )
+				idleBuffers.pushBack(buffer);
+
+			continue;
+		}
 		
 		if( !sound->getStreamed() )
 			continue;
@@ -233,14 +306,14 @@ bool AudioSource::update()
 
 //-----------------------------------//
 
-void AudioSource::play( int count )
+void AudioSource::play( int )
 {
 	if( !sound ) return;
 
 	// If the sound has not been loaded yet, then delay the playback
 	// by setting up a callback that will start playback when it loads.
 
-	if( !sound->getStreamed() && !buffers[0]->getUploaded() )
+	if( !sound->getStreamed() && !queueChunks && !buffers[0]->getUploaded() )
 	{
 		buffers[0]->onBufferUploaded.Connect(this, &AudioSource::onBufferUploaded);
 		state = AudioSourceState::PendingPlay;
@@ -251,8 +324,10 @@ void AudioSource::play( int count )
 		return;
 	}
 
-	// Queue the needed sound buffers before playing the source.
-	queue();
+	// Queue the needed sound buffers before playing the source. Sounds
+	// still being decoded are already queued by setSound and update.
+	if( !queueChunks )
+		queue();
 
 	alSourcePlay(id);
 	state = AudioSourceState::Playing;
@@ -288,6 +363,8 @@ void AudioSource::stop()
 
 	if( sound && sound->stream )
 		sound->stream->reset();
+
+	chunkOffset = 0;
 }
 
 //-----------------------------------//
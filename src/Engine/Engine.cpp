@@ -115,6 +115,7 @@ void Engine::init()
 
 	// Creates the rendering device.
 	renderDevice = AllocateThis(RenderDevice);
+	renderDevice->setTaskPool( taskPool );
 
 #ifdef ENABLE_AUDIO_OPENAL
 	// Creates the audio device.
@@ -142,6 +143,7 @@ void Engine::setupLogger()
 
 void Engine::update()
 {
+	taskPool->update();
 	resourceManager->update();
 
 #ifdef ENABLE_SCRIPTING_LUA
@@ -153,6 +155,9 @@ void Engine::update()
 
 void Engine::stepFrame()
 {
+	if( renderDevice )
+		renderDevice->endFrame();
+
 	AllocatorReset( GetFrameAllocator() );
 }
 
@@ -43,6 +43,11 @@ project "Engine"
 		["*"] = { ".", path.join(incdir,"Engine") },
 	}
 
+	excludes
+	{
+		"Test/**",
+	}
+
 	configuration {}
 
 	includedirs
@@ -19,6 +19,28 @@ FrameStatistics::FrameStatistics()
 	, avgFrameTime(0)
 	, sumFrameTime(0)
 	, lastFrameTime(0)
+	, numStateChanges(0)
+	, numStateChangesElided(0)
+	, lastStateChanges(0)
+	, lastStateChangesElided(0)
+	, numDrawCalls(0)
+	, numInstancedDrawCalls(0)
+	, numInstances(0)
+	, lastDrawCalls(0)
+	, lastInstancedDrawCalls(0)
+	, lastInstances(0)
+	, textureUploadBudget(0)
+	, numTextureUploadBytes(0)
+	, lastTextureUploadBytes(0)
+	, numStreamingTextures(0)
+	, numOccluders(0)
+	, numOccluderTriangles(0)
+	, numOccludedEntities(0)
+	, lastOccluders(0)
+	, lastOccluderTriangles(0)
+	, lastOccludedEntities(0)
+	, occlusionTime(0)
+	, lastOcclusionTime(0)
 { }
 
 //-----------------------------------//
@@ -32,6 +54,33 @@ void FrameStatistics::frameStep()
 
 	sumFrameTime += lastFrameTime;
 	avgFrameTime = sumFrameTime / numFrames;
+
+	lastStateChanges = numStateChanges;
+	lastStateChangesElided = numStateChangesElided;
+
+	numStateChanges = 0;
+	numStateChangesElided = 0;
+
+	lastDrawCalls = numDrawCalls;
+	lastInstancedDrawCalls = numInstancedDrawCalls;
+	lastInstances = numInstances;
+
+	numDrawCalls = 0;
+	numInstancedDrawCalls = 0;
+	numInstances = 0;
+
+	lastTextureUploadBytes = numTextureUploadBytes;
+	numTextureUploadBytes = 0;
+
+	lastOccluders = numOccluders;
+	lastOccluderTriangles = numOccluderTriangles;
+	lastOccludedEntities = numOccludedEntities;
+	lastOcclusionTime = occlusionTime;
+
+	numOccluders = 0;
+	numOccluderTriangles = 0;
+	numOccludedEntities = 0;
+	occlusionTime = 0;
 }
 
 //-----------------------------------//
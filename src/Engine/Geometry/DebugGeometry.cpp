@@ -292,8 +292,6 @@ void DebugUpdateFrustum( const RenderablePtr& rend, const Frustum& box )
 
 	Array<Vector3> colors( pos.size(), Color::White );
 	gb->set( VertexAttribute::Color, colors );
-
-	gb->forceRebuild();
 }
 
 //-----------------------------------//
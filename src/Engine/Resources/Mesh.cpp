@@ -12,6 +12,7 @@
 #include "Core/Log.h"
 #include "Core/Utilities.h"
 #include "Core/Math/Vector.h"
+#include "Core/Math/TriangleTree.h"
 #include "Graphics/GeometryBuffer.h"
 
 NAMESPACE_ENGINE_BEGIN
@@ -26,8 +27,10 @@ REFLECT_CLASS_END()
 Mesh::Mesh()
 	: animated(false)
 	, bindPose(nullptr)
-	, built(false)
 	, geometryBuffer(nullptr)
+	, triangleTree(nullptr)
+	, triangleTreeBuilt(0)
+	, built(false)
 {
 }
 
@@ -37,6 +40,8 @@ Mesh::~Mesh()
 {
 	LogDebug("Destroying mesh: %s", path.c_str());
 	//Deallocate(geometryBuffer);
+
+	Deallocate(triangleTree);
 }
 
 //-----------------------------------//
@@ -102,6 +107,93 @@ void Mesh::buildBounds()
 
 //-----------------------------------//
 
+const TriangleTree* Mesh::getTriangleTree()
+{
+	// The tree is written before the flag is set, so it is complete
+	// once the flag is seen by the other threads.
+	if( triangleTreeBuilt.read() )
+		return triangleTree;
+
+	triangleTreeMutex.lock();
+
+	if( !triangleTreeBuilt.read() )
+	{
+		triangleTree = buildTriangleTree();
+		triangleTreeBuilt.write(1);
+	}
+
+	triangleTreeMutex.unlock();
+
+	return triangleTree;
+}
+
+//-----------------------------------//
+
+TriangleTree* Mesh::buildTriangleTree()
+{
+	if( !geometryBuffer || isAnimated() ) return nullptr;
+
+	uint32 numVertices = geometryBuffer->getNumVertices();
+	if( numVertices < 3 ) return nullptr;
+
+	int8 positionStride = geometryBuffer->getAttributeStride(VertexAttribute::Position);
+	if( positionStride < 0 ) return nullptr;
+
+	uint8* positions = (uint8*) geometryBuffer->getAttribute(VertexAttribute::Position, 0);
+	if( !positions ) return nullptr;
+
+	// Positions without a stride are tightly packed.
+	uint32 stride = positionStride ? (uint32) positionStride : sizeof(Vector3);
+
+	// The triangles are numbered in the order of the groups.
+	Array<uint32> indices;
+
+	for( size_t i = 0; i < groups.size(); i++ )
+	{
+		const Array<uint16>& groupIndices = groups[i].indices;
+		size_t numIndices = groupIndices.size() - groupIndices.size() % 3;
+
+		for( size_t j = 0; j < numIndices; j++ )
+			indices.pushBack(groupIndices[j]);
+	}
+
+	TriangleTree* tree = AllocateThis(TriangleTree);
+	tree->build(positions, stride, numVertices, indices.data(), indices.size());
+
+	LogDebug("Built triangle tree of mesh '%s' with %u triangles",
+		path.c_str(), tree->getNumTriangles());
+
+	return tree;
+}
+
+//-----------------------------------//
+
+bool Mesh::getTriangle( uint32 triangle, int32& group, uint32 (&indices)[3] ) const
+{
+	for( size_t i = 0; i < groups.size(); i++ )
+	{
+		const Array<uint16>& groupIndices = groups[i].indices;
+		uint32 numTriangles = groupIndices.size() / 3;
+
+		if( triangle >= numTriangles )
+		{
+			triangle -= numTriangles;
+			continue;
+		}
+
+		group = (int32) i;
+
+		for( size_t j = 0; j < 3; j++ )
+			indices[j] = groupIndices[triangle * 3 + j];
+
+		return true;
+	}
+
+	return false;
+}
+
+//-----------------------------------//
+
 void Mesh::setupInitialVertices()
 {
 	if( !isAnimated() ) return;
@@ -86,7 +86,7 @@ struct OggStream : public SoundStream
 
 //-----------------------------------//
 
-int OggStream::decode(uint8* buffer, size_t bufSize)
+static size_t OggDecode(OggVorbis_File* ogg, uint8* buffer, size_t bufSize)
 {
 	// Decode the sound into a buffer now.
 	int endianness = SystemIsLittleEndian() ? 0 : 1;
@@ -97,12 +97,15 @@ int OggStream::decode(uint8* buffer, size_t bufSize)
 	// Read up to a buffer's worth of decoded sound data.
 	while(size < bufSize) 
 	{
-		size_t read = ov_read(ogg, (char*) buffer + size, bufSize- size, 
+		long read = ov_read(ogg, (char*) buffer + size, bufSize- size, 
 			endianness,
 			2, // 1 for 8-bit samples, or 2 for 16-bit samples
 			1, // 0 for unsigned, 1 for signed
 			&bitStream);
 
+		// Skip the holes in the data, they are recoverable.
+		if( read == OV_HOLE ) continue;
+
 		if( read <= 0 ) break;
 
 		size += read;
@@ -113,6 +116,13 @@ int OggStream::decode(uint8* buffer, size_t bufSize)
 
 //-----------------------------------//
 
+int OggStream::decode(uint8* buffer, size_t bufSize)
+{
+	return OggDecode(ogg, buffer, bufSize);
+}
+
+//-----------------------------------//
+
 OggStream::~OggStream()
 {
 	ov_clear(ogg);
@@ -195,6 +205,9 @@ bool OGG_Loader::initOgg( OggVorbis_File*& oggFile, ResourceLoadOptions& options
 
 //-----------------------------------//
 
+// Size of the decoded audio chunks, about a second of stereo audio.
+static const size_t OggChunkSize = 192 * 1024;
+
 bool OGG_Loader::decode(ResourceLoadOptions& options)
 {
 	Sound* sound = static_cast<Sound*>( options.resource );
@@ -202,24 +215,101 @@ bool OGG_Loader::decode(ResourceLoadOptions& options)
 	if( sound->getStreamed() )
 		return true;
 
-	OggVorbis_File oggFile;
-	OggVorbis_File* p_oggFile = &oggFile;
+	OggVorbis_File* oggFile = AllocateThis(OggVorbis_File);
 	
 	// Initialize the sound. 
-	if( !initOgg(p_oggFile, options) )
+	if( !initOgg(oggFile, options) )
+	{
+		Deallocate(oggFile);
 		return false;
+	}
 
-	// Decode the sound into a buffer now.
 	Array<byte>& buffer = sound->dataBuffer;
-	decodeOgg( &oggFile, buffer );
 
-	ov_clear(&oggFile);
+	// If the decoded size is known, the buffer is allocated only once
+	// and the sound is decoded in chunks after the first one is ready.
+	ogg_int64_t samples = ov_pcm_total(oggFile, -1);
+
+	if( samples <= 0 )
+	{
+		decodeOgg( oggFile, buffer );
+
+		ov_clear(oggFile);
+		Deallocate(oggFile);
+
+		return true;
+	}
+
+	buffer.resize( (size_t) samples * sound->getChannels() * 2 );
+	sound->decodedSize.write(0);
+	sound->decoding.write(1);
+
+	options.decodeState = oggFile;
+	options.decodeInChunks = true;
+
+	decodeOggChunk( oggFile, options );
 
 	return true;
 }
 
 //-----------------------------------//
 
+bool OGG_Loader::decodeChunk(ResourceLoadOptions& options)
+{
+	OggVorbis_File* oggFile = (OggVorbis_File*) options.decodeState;
+	if( !oggFile ) return false;
+
+	decodeOggChunk( oggFile, options );
+	return true;
+}
+
+//-----------------------------------//
+
+void OGG_Loader::decodeOggChunk( OggVorbis_File* oggFile, ResourceLoadOptions& options )
+{
+	Sound* sound = static_cast<Sound*>( options.resource );
+	Array<byte>& buffer = sound->dataBuffer;
+
+	size_t offset = sound->decodedSize.read();
+	size_t size = buffer.size() - offset;
+	
+	if( size > OggChunkSize )
+		size = OggChunkSize;
+
+	size_t read = OggDecode(oggFile, buffer.data() + offset, size);
+	offset += read;
+
+	if( read == size && offset < buffer.size() )
+	{
+		// Publish the chunk only after it was written.
+		sound->decodedSize.write(offset);
+		return;
+	}
+
+	if( offset < buffer.size() )
+	{
+		// The stream ended early or could not be read, so silence the rest
+		// of the sound instead of leaving it undefined.
+		LogWarn("Error decoding sound '%s', %d bytes are missing",
+			sound->getPath().c_str(), (int) (buffer.size() - offset));
+
+		memset(buffer.data() + offset, 0, buffer.size() - offset);
+	}
+
+	sound->decodedSize.write(buffer.size());
+
+	// The sound is fully decoded.
+	ov_clear(oggFile);
+	Deallocate(oggFile);
+
+	options.decodeState = nullptr;
+	options.decodeInChunks = false;
+
+	sound->decoding.write(0);
+}
+
+//-----------------------------------//
+
 void OGG_Loader::decodeOgg( OggVorbis_File* oggFile, Array<byte>& buffer )
 {
 	// Decode the sound into a buffer now.
@@ -25,10 +25,49 @@ Sound::Sound()
 	, channels(0)
 	, size(0)
 	, streamed(false)
+	, decodedSize(0)
+	, decoding(0)
 {
 
 }
 
 //-----------------------------------//
 
+bool Sound::isDecoded() const
+{
+	return decoding.read() == 0;
+}
+
+//-----------------------------------//
+
+uint32 Sound::getDecodedSize() const
+{
+	return isDecoded() ? dataBuffer.size() : decodedSize.read();
+}
+
+//-----------------------------------//
+
+uint64 Sound::getMemoryUsage() const
+{
+	return dataBuffer.size();
+}
+
+//-----------------------------------//
+
+bool Sound::unload()
+{
+	// Streamed sounds do not keep their data in memory.
+	if( streamed ) return false;
+
+	// The loader is still writing to the data buffer.
+	if( !isDecoded() ) return false;
+
+	dataBuffer.clear();
+	dataBuffer.trim();
+
+	return true;
+}
+
+//-----------------------------------//
+
 NAMESPACE_ENGINE_END
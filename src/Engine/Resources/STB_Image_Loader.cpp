@@ -34,17 +34,73 @@ STB_Image_Loader::STB_Image_Loader()
 
 //-----------------------------------//
 
-bool STB_Image_Loader::decode(ResourceLoadOptions& options)
+static int StbRead(void* user, char* data, int size)
+{
+	Stream* stream = (Stream*) user;
+	int64 read = stream->read(data, size);
+	return (read > 0) ? (int) read : 0;
+}
+
+static void StbSkip(void* user, unsigned size)
+{
+	Stream* stream = (Stream*) user;
+	stream->setPosition(size, StreamSeekMode::Relative);
+}
+
+static int StbEof(void* user)
+{
+	Stream* stream = (Stream*) user;
+	return stream->getPosition() >= (int64) stream->size();
+}
+
+// Reads the image straight from the stream, so the compressed
+// data does not need to be fully loaded in memory first.
+static const stbi_io_callbacks gs_StbCallbacks = { StbRead, StbSkip, StbEof };
+
+//-----------------------------------//
+
+static PixelFormat StbGetPixelFormat(int comp)
 {
-	Array<uint8> data;
-	options.stream->read(data);
+	switch( comp )
+	{
+	case 3: return PixelFormat::R8G8B8;
+	case 4: return PixelFormat::R8G8B8A8;
+	}
+
+	return PixelFormat::Unknown;
+}
 
-	if( data.empty() ) return false;
+//-----------------------------------//
+
+Resource* STB_Image_Loader::prepare(ResourceLoadOptions& options)
+{
+	Image* image = AllocateThis(Image);
+	if( !options.stream ) return image;
 
+	// Read the image header so the image size is known before decoding.
 	int width, height, comp;
 	
-	byte* pixelData = stbi_load_from_memory(
-		&data[0], data.size(), &width, &height,
+	if( stbi_info_from_callbacks(&gs_StbCallbacks, options.stream,
+		&width, &height, &comp) )
+	{
+		image->setWidth( width );
+		image->setHeight( height );
+		image->setPixelFormat( StbGetPixelFormat(comp) );
+	}
+
+	options.stream->setPosition(0, StreamSeekMode::Absolute);
+
+	return image;
+}
+
+//-----------------------------------//
+
+bool STB_Image_Loader::decode(ResourceLoadOptions& options)
+{
+	int width, height, comp;
+	
+	byte* pixelData = stbi_load_from_callbacks(
+		&gs_StbCallbacks, options.stream, &width, &height,
 		&comp, 0 /* 0=auto-detect, 3=RGB, 4=RGBA */ );
 
 	if( !pixelData )
@@ -55,35 +111,28 @@ bool STB_Image_Loader::decode(ResourceLoadOptions& options)
 	}
 
 	// Build our image with the pixel data returned by stb_image.
-	PixelFormat pf = PixelFormat::Unknown;
-	
-	switch( comp )
-	{
-	case 0:
-	case 1: break;
-	case 3: pf = PixelFormat::R8G8B8; break;
-	case 4: pf = PixelFormat::R8G8B8A8; break;
-	}
+	PixelFormat pf = StbGetPixelFormat(comp);
 
 	if( pf == PixelFormat::Unknown )
 	{
+		free(pixelData);
 		LogError( "Implement support for more pixel formats" );
 		return false;
 	}
 	
-	Array<byte> buffer;
+	Image* image = static_cast<Image*>( options.resource );
+	image->setWidth( width );
+	image->setHeight( height );
+	image->setPixelFormat( pf );
+
+	// Copy the pixels straight to the image buffer.
+	Array<byte>& buffer = image->getBuffer();
 	uint32 size = width*height*comp; 
 	buffer.resize(size);
 	
 	memcpy(&buffer[0], pixelData, size);
 	free(pixelData);
 
-	Image* image = static_cast<Image*>( options.resource );
-	image->setWidth( width );
-	image->setHeight( height );
-	image->setPixelFormat( pf );
-	image->setBuffer( buffer );
-
 	return true;
 }
 
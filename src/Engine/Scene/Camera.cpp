@@ -12,7 +12,11 @@
 #include "Engine/Scene/Tags.h"
 #include "Graphics/RenderDevice.h"
 #include "Graphics/RenderView.h"
+#include "Graphics/GeometryBuffer.h"
+#include "Graphics/FrameStatistics.h"
 #include "Engine/Geometry/DebugGeometry.h"
+#include "Core/Task.h"
+#include "Core/Timer.h"
 
 NAMESPACE_ENGINE_BEGIN
 
@@ -21,6 +25,7 @@ NAMESPACE_ENGINE_BEGIN
 REFLECT_CHILD_CLASS(Camera, Component)
 	FIELD_CLASS(4, Frustum, frustum)
 	FIELD_PRIMITIVE(5, bool, frustumCulling)
+	FIELD_PRIMITIVE(6, bool, occlusionCulling)
 REFLECT_CLASS_END()
 
 //-----------------------------------//
@@ -28,6 +33,7 @@ REFLECT_CLASS_END()
 Camera::Camera()
 	: activeView(nullptr)
 	, frustumCulling(false)
+	, occlusionCulling(false)
 	, transform(nullptr)
 	, lookAtVector(Vector3::UnitZ)
 {
@@ -37,6 +43,14 @@ Camera::Camera()
 
 Camera::~Camera()
 {
+	cullTasks.wait();
+
+	for( size_t i = 0; i < cullJobs.size(); i++ )
+		Deallocate(cullJobs[i]);
+
+	for( size_t i = 0; i < occlusionJobs.size(); i++ )
+		Deallocate(occlusionJobs[i]);
+
 	if( !transform ) return;
 	transform->onTransformed.Disconnect( this, &Camera::onTransformed );
 }
@@ -131,7 +145,7 @@ void Camera::render( const Scene* scene )
 	RenderBlock renderBlock;
 
 	// Perform frustum culling.
-	cull( renderBlock, &scene->entities );
+	cull( renderBlock, scene );
 
 	// Submits the geometry to the renderer.
 	render( renderBlock );
@@ -159,7 +173,432 @@ void Camera::render( RenderBlock& block, bool clearView )
 
 //-----------------------------------//
 
+// Minimum number of entities appended by each thread.
+static const size_t MinEntitiesPerCullSlice = 512;
+
+// Priority of the culling tasks over the other queued tasks.
+static const int16 CullTaskPriority = 100;
+
+// Width of the occlusion buffer, its height follows the aspect ratio.
+static const uint32 OcclusionBufferWidth = 256;
+
+// Minimum number of occluder triangles to rasterize in several threads.
+static const size_t MinTrianglesPerOcclusionBand = 256;
+
+struct CameraCullJob
+{
+	Task task;
+	RenderQueue queue;
+	size_t start;
+	size_t end;
+	uint32 numOccluded;
+	float occlusionTime;
+};
+
+struct CameraOcclusionJob
+{
+	Task task;
+	uint32 startRow;
+	uint32 endRow;
+};
+
 void Camera::cull( RenderBlock& block, const Entity* entity )
+{
+	cullEntities.clear();
+	cullBoxes.clear();
+
+	collectEntities( entity );
+	appendCollected( block );
+}
+
+//-----------------------------------//
+
+void Camera::cull( RenderBlock& block, const Scene* scene )
+{
+	if( !frustumCulling )
+	{
+		cull( block, &scene->entities );
+		return;
+	}
+
+	cullEntities.clear();
+	cullBoxes.clear();
+
+	sceneEntities.clear();
+	scene->queryEntities( frustum, sceneEntities );
+
+	for( size_t i = 0; i < sceneEntities.size(); i++ )
+	{
+		const Entity* entity = sceneEntities[i];
+		if( !entity->isVisible() ) continue;
+
+		const Transform* transform = entity->getTransform().get();
+
+		cullEntities.pushBack( entity );
+		cullBoxes.add( transform->getWorldBoundingVolume() );
+	}
+
+	appendCollected( block );
+}
+
+//-----------------------------------//
+
+void Camera::appendCollected( RenderBlock& block )
+{
+	// Test the bounds of all the entities against the frustum at once.
+	if( frustumCulling )
+		FrustumCullBoxes( frustum, cullBoxes, cullVisible );
+
+	size_t count = cullEntities.size();
+
+	TaskPool* taskPool = GetRenderDevice()->getTaskPool();
+
+	Timer occlusionTimer;
+	float occlusionTime = 0;
+	uint32 numOccluders = 0;
+
+	// The occluders are rasterized before any entity is tested.
+	if( occlusionCulling )
+	{
+		cullOccluded.resize(count);
+		std::fill(cullOccluded.begin(), cullOccluded.end(), 0);
+
+		numOccluders = rasterizeOccluders( taskPool );
+		occlusionTime = occlusionTimer.getElapsed();
+	}
+
+	// Split the entities in slices, one per thread, as long as each slice
+	// has enough entities to be worth appending in another thread.
+	size_t maxSlices = taskPool ? taskPool->threads.size() + 1 : 1;
+	size_t numSlices = count / MinEntitiesPerCullSlice;
+	numSlices = std::max<size_t>(1, std::min(numSlices, maxSlices));
+
+	while( cullJobs.size() < numSlices - 1 )
+	{
+		CameraCullJob* job = AllocateThis(CameraCullJob);
+		job->task.callback.Bind(this, &Camera::runCullJob);
+		job->task.userdata = job;
+		job->task.priority = CullTaskPriority;
+		cullJobs.pushBack(job);
+	}
+
+	size_t sliceSize = (count + numSlices - 1) / numSlices;
+
+	cullTasks.setTaskPool(taskPool);
+
+	// The first slice is appended by this thread, straight to the block.
+	for( size_t i = 1; i < numSlices; i++ )
+	{
+		CameraCullJob* job = cullJobs[i - 1];
+		job->start = i * sliceSize;
+		job->end = std::min(job->start + sliceSize, count);
+
+		cullTasks.add(&job->task);
+	}
+
+	uint32 numOccluded = appendSlice( block.renderables, 0,
+		std::min(sliceSize, count), occlusionTime );
+
+	cullTasks.wait();
+
+	// Merge the slice queues in order, so the block does not depend on
+	// the number of threads.
+	for( size_t i = 1; i < numSlices; i++ )
+	{
+		const CameraCullJob* job = cullJobs[i - 1];
+		const RenderQueue& queue = job->queue;
+
+		block.renderables.insert( block.renderables.end(), queue.begin(), queue.end() );
+
+		numOccluded += job->numOccluded;
+		occlusionTime += job->occlusionTime;
+	}
+
+	FrameStatistics* stats = GetRenderDevice()->getFrameStatistics();
+
+	if( occlusionCulling && stats )
+	{
+		stats->numOccluders += numOccluders;
+		stats->numOccluderTriangles += (uint32) occlusionBuffer.getTriangles().size();
+		stats->numOccludedEntities += numOccluded;
+		stats->occlusionTime += occlusionTime;
+	}
+
+#ifdef BUILD_DEBUG
+	// The component hooks are not thread-safe so they run after the merge.
+	for( size_t i = 0; i < count; i++ )
+	{
+		if( isCollectedVisible(i) )
+			drawEntityDebug( cullEntities[i] );
+	}
+#endif
+}
+
+//-----------------------------------//
+
+void Camera::runCullJob( Task* task )
+{
+	CameraCullJob* job = (CameraCullJob*) task->userdata;
+
+	job->queue.clear();
+	job->occlusionTime = 0;
+	job->numOccluded = appendSlice( job->queue, job->start, job->end,
+		job->occlusionTime );
+}
+
+//-----------------------------------//
+
+uint32 Camera::rasterizeOccluders( TaskPool* taskPool )
+{
+	float aspectRatio = (frustum.aspectRatio > 0) ? frustum.aspectRatio : 1.0f;
+
+	uint32 height = uint32(OcclusionBufferWidth / aspectRatio);
+	height = std::max(height, OcclusionTileHeight);
+	height = (height + OcclusionTileHeight - 1) / OcclusionTileHeight * OcclusionTileHeight;
+
+	if( occlusionBuffer.getWidth() != OcclusionBufferWidth
+		|| occlusionBuffer.getHeight() != height )
+		occlusionBuffer.resize(OcclusionBufferWidth, height);
+
+	occlusionBuffer.clear( Matrix4x4(viewMatrix) * frustum.matProjection );
+
+	uint32 numOccluders = 0;
+
+	for( size_t i = 0; i < cullEntities.size(); i++ )
+	{
+		const Entity* entity = cullEntities[i];
+
+		if( !entity->getTag(Tags::Occluder) || !isCollectedVisible(i) )
+			continue;
+
+		addOccluder( entity );
+		numOccluders++;
+	}
+
+	// Split the rows in bands of whole tiles, one per thread, as long as
+	// there are enough triangles to be worth rasterizing in other threads.
+	size_t numTriangles = occlusionBuffer.getTriangles().size();
+
+	uint32 numTileRows = height / OcclusionTileHeight;
+	uint32 numBands = 1;
+
+	if( taskPool && numTriangles >= MinTrianglesPerOcclusionBand )
+		numBands = std::min((uint32) taskPool->threads.size() + 1, numTileRows);
+
+	uint32 tileRowsPerBand = (numTileRows + numBands - 1) / numBands;
+	numBands = (numTileRows + tileRowsPerBand - 1) / tileRowsPerBand;
+
+	uint32 bandSize = tileRowsPerBand * OcclusionTileHeight;
+
+	while( occlusionJobs.size() < numBands - 1 )
+	{
+		CameraOcclusionJob* job = AllocateThis(CameraOcclusionJob);
+		job->task.callback.Bind(this, &Camera::runOcclusionJob);
+		job->task.userdata = job;
+		job->task.priority = CullTaskPriority;
+		occlusionJobs.pushBack(job);
+	}
+
+	cullTasks.setTaskPool(taskPool);
+
+	// The first band is rasterized by this thread.
+	for( uint32 i = 1; i < numBands; i++ )
+	{
+		CameraOcclusionJob* job = occlusionJobs[i - 1];
+		job->startRow = i * bandSize;
+		job->endRow = std::min(job->startRow + bandSize, height);
+
+		cullTasks.add(&job->task);
+	}
+
+	occlusionBuffer.rasterize( 0, std::min(bandSize, height) );
+
+	cullTasks.wait();
+
+	return numOccluders;
+}
+
+//-----------------------------------//
+
+void Camera::runOcclusionJob( Task* task )
+{
+	CameraOcclusionJob* job = (CameraOcclusionJob*) task->userdata;
+
+	occlusionBuffer.rasterize( job->startRow, job->endRow );
+}
+
+//-----------------------------------//
+
+static uint32 GetOccluderIndex( const uint8* indices, uint32 indexSize, uint32 i )
+{
+	if( !indices ) return i;
+	if( indexSize == 16 ) return ((const uint16*) indices)[i];
+	return ((const uint32*) indices)[i];
+}
+
+void Camera::addOccluder( const Entity* entity )
+{
+	const Transform* transform = entity->getTransform().get();
+	const Matrix4x3& matrix = transform->getAbsoluteTransform();
+
+	const Array<GeometryPtr>& geoms = entity->getGeometry();
+
+	for( size_t i = 0; i < geoms.size(); i++ )
+	{
+		RenderablesVector renderables = geoms[i]->getRenderables();
+
+		for( size_t j = 0; j < renderables.size(); j++ )
+		{
+			const RenderBatch* batch = renderables[j].get();
+			PrimitiveType type = batch->getPrimitiveType();
+
+			if( type != PrimitiveType::Triangles && type != PrimitiveType::Quads )
+				continue;
+
+			const GeometryBuffer* gb = batch->getGeometryBuffer().get();
+			if( !gb ) continue;
+
+			int8 positionStride = gb->getAttributeStride(VertexAttribute::Position);
+			if( positionStride < 0 ) continue;
+
+			uint8* positions = (uint8*) gb->getAttribute(VertexAttribute::Position, 0);
+			if( !positions ) continue;
+
+			// Positions without a stride are tightly packed.
+			uint32 stride = positionStride ? (uint32) positionStride : sizeof(Vector3);
+
+			uint32 numVertices = gb->getNumVertices();
+
+			const uint8* indices = nullptr;
+			uint32 indexSize = gb->indexSize;
+			uint32 numIndices = 0;
+
+			if( gb->isIndexed() )
+			{
+				uint32 indexBytes = indexSize / 8;
+
+				indices = gb->indexData.data() + batch->range.start * indexBytes;
+				numIndices = batch->range.end - batch->range.start;
+
+				if( numIndices == 0 )
+				{
+					indices = gb->indexData.data();
+					numIndices = gb->indexData.size() / indexBytes;
+				}
+			}
+
+			if( type == PrimitiveType::Quads )
+			{
+				// Split each quad in two triangles.
+				uint32 numQuadVertices = indices ? numIndices : numVertices;
+				occluderIndices.clear();
+
+				for( uint32 k = 0; k + 3 < numQuadVertices; k += 4 )
+				{
+					uint32 quad[4];
+
+					for( uint32 l = 0; l < 4; l++ )
+						quad[l] = GetOccluderIndex(indices, indexSize, k + l);
+
+					occluderIndices.pushBack(quad[0]);
+					occluderIndices.pushBack(quad[1]);
+					occluderIndices.pushBack(quad[2]);
+					occluderIndices.pushBack(quad[0]);
+					occluderIndices.pushBack(quad[2]);
+					occluderIndices.pushBack(quad[3]);
+				}
+
+				if( occluderIndices.empty() ) continue;
+
+				indices = (const uint8*) occluderIndices.data();
+				indexSize = 32;
+				numIndices = occluderIndices.size();
+			}
+
+			occlusionBuffer.addOccluder( matrix, positions, stride, numVertices,
+				indices, indexSize, numIndices );
+		}
+	}
+}
+
+//-----------------------------------//
+
+uint32 Camera::appendSlice( RenderQueue& queue, size_t start, size_t end,
+	float& occlusionTime )
+{
+	uint32 numOccluded = 0;
+
+	if( occlusionCulling )
+	{
+		Timer timer;
+		numOccluded = occludeEntities( start, end );
+		occlusionTime += timer.getElapsed();
+	}
+
+	appendEntities( queue, start, end );
+
+	return numOccluded;
+}
+
+//-----------------------------------//
+
+uint32 Camera::occludeEntities( size_t start, size_t end )
+{
+	uint32 numOccluded = 0;
+
+	for( size_t i = start; i < end; i++ )
+	{
+		const Entity* entity = cullEntities[i];
+
+		if( !isCollectedVisible(i) ) continue;
+
+		// The occluders are never hidden, even by other occluders.
+		if( entity->getTag(Tags::NonCulled) || entity->getTag(Tags::Occluder) )
+			continue;
+
+		const Transform* transform = entity->getTransform().get();
+
+		if( occlusionBuffer.isVisible(transform->getWorldBoundingVolume()) )
+			continue;
+
+		cullOccluded[i] = 1;
+		numOccluded++;
+	}
+
+	return numOccluded;
+}
+
+//-----------------------------------//
+
+bool Camera::isCollectedVisible( size_t index ) const
+{
+	if( occlusionCulling && cullOccluded[index] )
+		return false;
+
+	if( !frustumCulling ) return true;
+
+	const Entity* entity = cullEntities[index];
+
+	if( entity->getTag(Tags::NonCulled) )
+		return true;
+
+	return FrustumCullIsVisible(cullVisible, (uint32) index);
+}
+
+//-----------------------------------//
+
+void Camera::appendEntities( RenderQueue& queue, size_t start, size_t end )
+{
+	for( size_t i = start; i < end; i++ )
+	{
+		if( isCollectedVisible(i) )
+			appendEntity( queue, cullEntities[i] );
+	}
+}
+
+//-----------------------------------//
+
+void Camera::collectEntities( const Entity* entity )
 {
 	if( !entity ) return;
 
@@ -172,11 +611,11 @@ void Camera::cull( RenderBlock& block, const Entity* entity )
 
 		const Array<EntityPtr>& entities = group->getEntities();
 
-		// Cull the children entities recursively.
+		// Collect the children entities recursively.
 		for( size_t i = 0; i < entities.size(); i++ )
 		{
 			const Entity* child = entities[i].get();
-			cull( block, child );
+			collectEntities( child );
 		}
 
 		return;
@@ -191,21 +630,45 @@ void Camera::cull( RenderBlock& block, const Entity* entity )
 		return;
 
 	const Transform* transform = entity->getTransform().get();
-	const BoundingBox& box = transform->getWorldBoundingVolume();
 
-	bool isCulled = !entity->getTag(Tags::NonCulled);
-	
-	if( frustumCulling && isCulled && !frustum.intersects(box) )
-		return;
+	cullEntities.pushBack( entity );
+	cullBoxes.add( transform->getWorldBoundingVolume() );
+}
+
+//-----------------------------------//
+
+void Camera::appendEntity( RenderQueue& queue, const Entity* entity )
+{
+	const Transform* transform = entity->getTransform().get();
 
 	#pragma TODO("Fix multiple geometry instancing")
 
 	const Array<GeometryPtr>& geoms = entity->getGeometry();
+	size_t firstState = queue.size();
 
 	for( size_t i = 0; i < geoms.size(); i++ )
 	{
 		const GeometryPtr& geometry = geoms[i];
-		geometry->appendRenderables( block.renderables, transform );
+		geometry->appendRenderables( queue, transform );
+	}
+
+	// Build the sort keys with the distance to the camera.
+	Vector3 cameraPosition;
+	
+	if( Camera::transform )
+		cameraPosition = Camera::transform->getPosition();
+
+	float farPlane = (frustum.farPlane > 0) ? frustum.farPlane : 1.0f;
+
+	for( size_t i = firstState; i < queue.size(); i++ )
+	{
+		RenderState& state = queue[i];
+
+		const Matrix4x3& model = state.modelMatrix;
+		Vector3 position(model.tx, model.ty, model.tz);
+		
+		float depth = (position - cameraPosition).length() / farPlane;
+		state.sortKey = RenderStateMakeSortKey(state, depth);
 	}
 
 #if 0
@@ -220,8 +683,12 @@ void Camera::cull( RenderBlock& block, const Entity* entity )
 		block.lights.pushBack( ls );
 	}
 #endif
+}
 
-#ifdef BUILD_DEBUG
+//-----------------------------------//
+
+void Camera::drawEntityDebug( const Entity* entity )
+{
 	const ComponentMap& components = entity->getComponents();
 	for( auto it = components.begin(); it != components.end(); it++ )
 	{
@@ -234,7 +701,6 @@ void Camera::cull( RenderBlock& block, const Entity* entity )
 		DebugDrawFlags flags = (DebugDrawFlags) 0;
 		component->onDebugDraw(drawer, flags);
 	}
-#endif
 }
 
 //-----------------------------------//
@@ -0,0 +1,424 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Engine/API.h"
+#include "Engine/Scene/ComponentStorage.h"
+#include "Engine/Scene/Entity.h"
+#include "Engine/Scene/Transform.h"
+#include "Engine/Scene/Geometry.h"
+#include <algorithm>
+
+NAMESPACE_ENGINE_BEGIN
+
+//-----------------------------------//
+
+// Number of components in each chunk of the pools.
+static const int32 ComponentsPerChunk = 64;
+
+//-----------------------------------//
+
+ComponentPool::ComponentPool( Class* klass )
+	: klass(klass)
+	, needsSort(false)
+{
+	allocator = AllocatorCreateChunk( AllocatorGetThis(), klass->size,
+		ComponentsPerChunk );
+}
+
+//-----------------------------------//
+
+ComponentPool::~ComponentPool()
+{
+	// The chunks can only be freed if all the components were, else the
+	// allocator is kept for the components that outlive the pool.
+	ChunkAllocator* chunk = (ChunkAllocator*) allocator;
+
+	if( chunk->numAllocations > 0 )
+	{
+		LogDebug("Components of '%s' outlive their pool", klass->name);
+		return;
+	}
+
+	AllocatorReset(allocator);
+	AllocatorDestroy(allocator);
+}
+
+//-----------------------------------//
+
+void ComponentPool::add( Component* component, EntityHandle entity )
+{
+	indices.set((uint64) component, (int32) components.size());
+
+	components.pushBack(component);
+	entities.pushBack(entity);
+
+	needsSort = true;
+}
+
+//-----------------------------------//
+
+void ComponentPool::remove( Component* component )
+{
+	int32 index = indices.get((uint64) component, -1);
+	if( index < 0 ) return;
+
+	indices.remove((uint64) component);
+
+	int32 last = (int32) components.size() - 1;
+
+	if( index != last )
+	{
+		components[index] = components[last];
+		entities[index] = entities[last];
+
+		indices.set((uint64) components[index], index);
+		needsSort = true;
+	}
+
+	components.popBack();
+	entities.popBack();
+}
+
+//-----------------------------------//
+
+void ComponentPool::sort()
+{
+	size_t count = components.size();
+
+	Array<int32> order;
+	order.resize(count);
+
+	for( size_t i = 0; i < count; i++ )
+		order[i] = (int32) i;
+
+	const Array<Component*>& list = components;
+
+	std::sort(order.begin(), order.end(), [&list](int32 a, int32 b) {
+		return list[a] < list[b];
+	});
+
+	Array<Component*> sortedComponents;
+	sortedComponents.resize(count);
+
+	Array<EntityHandle> sortedEntities;
+	sortedEntities.resize(count);
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		sortedComponents[i] = components[order[i]];
+		sortedEntities[i] = entities[order[i]];
+
+		indices.set((uint64) sortedComponents[i], (int32) i);
+	}
+
+	components = std::move(sortedComponents);
+	entities = std::move(sortedEntities);
+
+	needsSort = false;
+}
+
+//-----------------------------------//
+
+const Array<Component*>& ComponentPool::getComponents()
+{
+	if( needsSort ) sort();
+	return components;
+}
+
+//-----------------------------------//
+
+const Array<EntityHandle>& ComponentPool::getEntities()
+{
+	if( needsSort ) sort();
+	return entities;
+}
+
+//-----------------------------------//
+
+int32 ComponentArchetype::getColumn( const Class* klass ) const
+{
+	for( size_t i = 0; i < classes.size(); i++ )
+	{
+		if( classes[i] == klass )
+			return (int32) i;
+	}
+
+	return -1;
+}
+
+//-----------------------------------//
+
+ComponentStorage::ComponentStorage()
+	: needsUpdateOrder(false)
+{
+}
+
+//-----------------------------------//
+
+ComponentStorage::~ComponentStorage()
+{
+	for( size_t i = 0; i < archetypes.size(); i++ )
+		Deallocate(archetypes[i]);
+
+	for( size_t i = 0; i < pools.size(); i++ )
+		Deallocate(pools[i]);
+}
+
+//-----------------------------------//
+
+ComponentPool* ComponentStorage::findPool( Class* klass )
+{
+	int32 index = poolMap.get((uint64) klass, -1);
+
+	if( index >= 0 )
+		return pools[index];
+
+	ComponentPool* pool = AllocateThis(ComponentPool, klass);
+
+	poolMap.set((uint64) klass, (int32) pools.size());
+	pools.pushBack(pool);
+
+	needsUpdateOrder = true;
+
+	return pool;
+}
+
+//-----------------------------------//
+
+Allocator* ComponentStorage::getAllocator( Class* klass )
+{
+	return findPool(klass)->getAllocator();
+}
+
+//-----------------------------------//
+
+Component* ComponentStorage::createComponent( Class* klass )
+{
+	if( ClassIsAbstract(klass) ) return nullptr;
+	return (Component*) ClassCreateInstance(klass, getAllocator(klass));
+}
+
+//-----------------------------------//
+
+const Array<Component*>& ComponentStorage::getComponents( Class* klass )
+{
+	return findPool(klass)->getComponents();
+}
+
+//-----------------------------------//
+
+int32 ComponentStorage::findArchetype( const Array<Class*>& classes )
+{
+	for( size_t i = 0; i < archetypes.size(); i++ )
+	{
+		const Array<Class*>& other = archetypes[i]->classes;
+
+		if( other.size() == classes.size()
+			&& std::equal(classes.begin(), classes.end(), other.begin()) )
+			return (int32) i;
+	}
+
+	ComponentArchetype* archetype = AllocateThis(ComponentArchetype);
+	archetype->classes = classes;
+
+	archetypes.pushBack(archetype);
+
+	return (int32) archetypes.size() - 1;
+}
+
+//-----------------------------------//
+
+void ComponentStorage::getArchetypes( Class* const* classes, size_t count,
+	Array<const ComponentArchetype*>& list ) const
+{
+	for( size_t i = 0; i < archetypes.size(); i++ )
+	{
+		const ComponentArchetype* archetype = archetypes[i];
+		if( archetype->entities.empty() ) continue;
+
+		bool hasAll = true;
+
+		for( size_t j = 0; j < count && hasAll; j++ )
+			hasAll = archetype->getColumn(classes[j]) >= 0;
+
+		if( hasAll )
+			list.pushBack(archetype);
+	}
+}
+
+//-----------------------------------//
+
+EntityHandle ComponentStorage::add( Entity* entity )
+{
+	EntityHandle handle = getHandle(entity);
+
+	if( handle != EntityHandleNull )
+		return handle;
+
+	if( !freeHandles.empty() )
+	{
+		handle = freeHandles.back();
+		freeHandles.popBack();
+	}
+	else
+	{
+		handle = (EntityHandle) entities.size();
+
+		entities.pushBack(nullptr);
+		entityArchetypes.pushBack(-1);
+		entityRows.pushBack(-1);
+	}
+
+	entities[handle] = entity;
+	handleMap.set((uint64) entity, handle);
+
+	link(handle);
+
+	return handle;
+}
+
+//-----------------------------------//
+
+void ComponentStorage::remove( Entity* entity )
+{
+	EntityHandle handle = getHandle(entity);
+	if( handle == EntityHandleNull ) return;
+
+	unlink(handle);
+
+	entities[handle] = nullptr;
+	handleMap.remove((uint64) entity);
+
+	freeHandles.pushBack(handle);
+}
+
+//-----------------------------------//
+
+void ComponentStorage::refresh( Entity* entity )
+{
+	EntityHandle handle = getHandle(entity);
+	if( handle == EntityHandleNull ) return;
+
+	unlink(handle);
+	link(handle);
+}
+
+//-----------------------------------//
+
+EntityHandle ComponentStorage::getHandle( const Entity* entity ) const
+{
+	return handleMap.get((uint64) entity, EntityHandleNull);
+}
+
+//-----------------------------------//
+
+void ComponentStorage::link( EntityHandle handle )
+{
+	Entity* entity = entities[handle];
+	const ComponentMap& map = entity->getComponents();
+
+	Array<Class*> classes;
+
+	for( auto it = map.begin(); it != map.end(); it++ )
+		classes.pushBack( it->value->getType() );
+
+	std::sort(classes.begin(), classes.end());
+
+	int32 index = findArchetype(classes);
+	ComponentArchetype* archetype = archetypes[index];
+
+	entityArchetypes[handle] = index;
+	entityRows[handle] = (int32) archetype->entities.size();
+
+	archetype->entities.pushBack(handle);
+
+	for( size_t i = 0; i < classes.size(); i++ )
+	{
+		Component* component = entity->getComponent(classes[i]).get();
+
+		archetype->components.pushBack(component);
+		findPool(classes[i])->add(component, handle);
+	}
+}
+
+//-----------------------------------//
+
+void ComponentStorage::unlink( EntityHandle handle )
+{
+	int32 index = entityArchetypes[handle];
+	if( index < 0 ) return;
+
+	ComponentArchetype* archetype = archetypes[index];
+
+	size_t stride = archetype->classes.size();
+	size_t row = entityRows[handle];
+	size_t lastRow = archetype->entities.size() - 1;
+
+	for( size_t i = 0; i < stride; i++ )
+		findPool(archetype->classes[i])->remove( archetype->getComponent(row, i) );
+
+	// Move the last row to the row of the entity.
+	if( row != lastRow )
+	{
+		EntityHandle last = archetype->entities[lastRow];
+
+		archetype->entities[row] = last;
+		entityRows[last] = (int32) row;
+
+		for( size_t i = 0; i < stride; i++ )
+		{
+			archetype->components[row * stride + i] =
+				archetype->components[lastRow * stride + i];
+		}
+	}
+
+	archetype->entities.popBack();
+	archetype->components.resize(lastRow * stride);
+
+	entityArchetypes[handle] = -1;
+	entityRows[handle] = -1;
+}
+
+//-----------------------------------//
+
+static int32 GetUpdatePass( const Class* klass )
+{
+	if( ClassInherits(klass, ReflectionGetType(Geometry)) )
+		return 0;
+
+	if( ClassInherits(klass, ReflectionGetType(Transform)) )
+		return 1;
+
+	return 2;
+}
+
+void ComponentStorage::update( float delta )
+{
+	if( needsUpdateOrder )
+	{
+		updateOrder = pools;
+
+		std::stable_sort(updateOrder.begin(), updateOrder.end(),
+			[](ComponentPool* a, ComponentPool* b) {
+				return GetUpdatePass(a->getClass()) < GetUpdatePass(b->getClass());
+			});
+
+		needsUpdateOrder = false;
+	}
+
+	for( size_t i = 0; i < updateOrder.size(); i++ )
+	{
+		const Array<Component*>& components = updateOrder[i]->getComponents();
+
+		for( size_t j = 0; j < components.size(); j++ )
+			components[j]->update( delta );
+	}
+}
+
+//-----------------------------------//
+
+NAMESPACE_ENGINE_END
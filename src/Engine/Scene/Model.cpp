@@ -183,7 +183,11 @@ void Model::build()
 	for( size_t i = 0; i < rends.size(); ++i )
 	{
 		Renderable* rend = rends[i].get();
-		rend->onPreRender.Bind(this, &Model::onRender);
+
+		// Static meshes need no per-object setup, which lets the
+		// render device batch them into instanced draws.
+		if( mesh->isAnimated() )
+			rend->onPreRender.Bind(this, &Model::onRender);
 		
 		addRenderable( rend );
 	}
@@ -461,7 +465,11 @@ void Model::doSkinning(const GeometryBufferPtr& gb)
 	}
 #endif
 
-	gb->forceRebuild();
+	// Only the positions need to be uploaded again.
+	if( elemPosition->stride == 0 )
+		gb->markDirty(elemPosition->offset, elemPosition->size);
+	else
+		gb->forceRebuild();
 }
 
 //-----------------------------------//
@@ -59,6 +59,20 @@ void Projector::update(float)
 	frustum.updateCorners(transform->getAbsoluteTransform());
 
 	updateDebugRenderable();
+
+	if( !geometry ) return;
+
+	// The renderables are appended by the culling threads, so the
+	// callback is bound here instead.
+	const RenderablesVector& renderables = geometry->getRenderables();
+
+	for( size_t i = 0; i < renderables.size(); i++ )
+	{
+		RenderBatch* renderable = renderables[i].get();
+		if( !renderable ) continue;
+
+		renderable->onPreRender.Bind(this, &Projector::onPreRender);
+	}
 }
 
 //-----------------------------------//
@@ -77,8 +91,6 @@ void Projector::appendRenderables( RenderQueue& queue, const Transform* transfor
 		RenderBatch* renderable = renderables[i].get();
 		if( !renderable ) continue;
 
-		renderable->onPreRender.Bind(this, &Projector::onPreRender);
-
 		RenderState state;
 		state.renderable = renderable;
 		state.material = material.Resolve();
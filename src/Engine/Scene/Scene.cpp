@@ -10,6 +10,9 @@
 #include "Engine/Scene/Transform.h"
 #include "Engine/Scene/Tags.h"
 #include "Engine/Scene/Geometry.h"
+#include "Core/Math/BoundingTree.h"
+#include "Core/Math/TriangleTree.h"
+#include "Core/Math/RayPacket.h"
 #include "Engine/Scene/SceneLoader.h"
 #include "Graphics/RenderDevice.h"
 
@@ -20,6 +23,8 @@
 #include "Engine/Scene/Model.h"
 #include "Engine/Resources/Animation.h"
 #include "Engine/Resources/Skeleton.h"
+#include "Engine/Engine.h"
+#include "Core/Task.h"
 #include <algorithm>
 
 #if SERIALIZE_SCENE
@@ -70,9 +75,28 @@ REFLECT_CLASS_END()
 //-----------------------------------//
 
 Scene::Scene()
+	: updateByComponent(false)
 {
 	SceneLoaderGetType();
 	entities.addReference();
+
+	for( size_t i = 0; i < SceneLayer::Count; i++ )
+		spatialIndices[i] = AllocateThis(BoundingTree);
+
+	// The geometries and the transforms only change their own entity, so
+	// they are updated in parallel. Geometries mark the bounds of their
+	// transforms as dirty, which the transforms then read.
+	ComponentSystem* geometries = AllocateThis(ComponentSystem, ReflectionGetType(Geometry));
+	geometries->addWrite( ReflectionGetType(Transform) );
+	geometries->setFlags( SystemFlags::Parallel );
+	systems.add(geometries);
+
+	ComponentSystem* transformUpdates = AllocateThis(ComponentSystem, ReflectionGetType(Transform));
+	transformUpdates->addRead( ReflectionGetType(Geometry) );
+	transformUpdates->setFlags( SystemFlags::Parallel );
+	systems.add(transformUpdates);
+
+	addEntity(&entities);
 }
 
 //-----------------------------------//
@@ -80,6 +104,258 @@ Scene::Scene()
 Scene::~Scene()
 {
 	LogDebug("Destroying Scene");
+
+	// The entities can outlive the scene, so take them out of the indices.
+	removeEntity(&entities);
+
+	for( size_t i = 0; i < SceneLayer::Count; i++ )
+		Deallocate(spatialIndices[i]);
+}
+
+//-----------------------------------//
+
+const SpatialIndex* Scene::getSpatialIndex( SceneLayer::Enum layer ) const
+{
+	return spatialIndices[layer];
+}
+
+//-----------------------------------//
+
+void Scene::setSpatialIndex( SceneLayer::Enum layer, SpatialIndex* index )
+{
+	if( !index || index == spatialIndices[layer] ) return;
+
+	removeEntity(&entities);
+
+	Deallocate(spatialIndices[layer]);
+	spatialIndices[layer] = index;
+
+	addEntity(&entities);
+}
+
+//-----------------------------------//
+
+void Scene::fixUp()
+{
+	// Serialization sets the entities without adding them to the group.
+	addEntity(&entities);
+}
+
+//-----------------------------------//
+
+static bool IsGroup(const Entity* entity)
+{
+	return ClassInherits(entity->getType(), ReflectionGetType(Group));
+}
+
+//-----------------------------------//
+
+void Scene::addEntity( Entity* entity )
+{
+	Array<Entity*> staticEntities;
+	addEntity(entity, staticEntities);
+
+	if( staticEntities.empty() ) return;
+
+	Array<BoundingBox> boxes;
+	boxes.resize(staticEntities.size());
+
+	for( size_t i = 0; i < staticEntities.size(); i++ )
+		boxes[i] = staticEntities[i]->getTransform()->getWorldBoundingVolume();
+
+	Array<int32> proxies;
+	proxies.resize(staticEntities.size());
+
+	SpatialIndex* index = spatialIndices[SceneLayer::Static];
+	index->createProxies(boxes.data(), (void* const*) staticEntities.data(),
+		staticEntities.size(), proxies.data());
+
+	for( size_t i = 0; i < staticEntities.size(); i++ )
+		staticEntities[i]->getTransform()->setSpatialProxy(index, proxies[i]);
+}
+
+//-----------------------------------//
+
+void Scene::addEntity( Entity* entity, Array<Entity*>& staticEntities )
+{
+	if( !entity ) return;
+
+	Transform* transform = entity->getTransform().get();
+
+	if( transform && !transform->getSystem() )
+		transforms.add(transform);
+
+	components.add(entity);
+
+	if( IsGroup(entity) )
+	{
+		Group* group = (Group*) entity;
+
+		group->onEntityAdded.Connect(this, &Scene::onEntityAdded);
+		group->onEntityRemoved.Connect(this, &Scene::onEntityRemoved);
+		group->onEntityComponentAdded.Connect(this, &Scene::onEntityComponentAdded);
+		group->onEntityComponentRemoved.Connect(this, &Scene::onEntityComponentRemoved);
+
+		const Array<EntityPtr>& children = group->getEntities();
+
+		for( size_t i = 0; i < children.size(); i++ )
+			addEntity( children[i].get(), staticEntities );
+
+		return;
+	}
+
+	if( entity->getTag(Tags::NonCulled) )
+	{
+		if( std::find(nonCulledEntities.begin(), nonCulledEntities.end(), entity)
+			== nonCulledEntities.end() )
+			nonCulledEntities.pushBack(entity);
+
+		return;
+	}
+
+	if( !transform || transform->getSpatialProxy() != SpatialProxyNull )
+		return;
+
+	if( entity->getTag(Tags::Static) )
+	{
+		staticEntities.pushBack(entity);
+		return;
+	}
+
+	SpatialIndex* index = spatialIndices[SceneLayer::Dynamic];
+
+	const BoundingBox& box = transform->getWorldBoundingVolume();
+	transform->setSpatialProxy( index, index->createProxy(box, entity) );
+}
+
+//-----------------------------------//
+
+void Scene::removeEntity( Entity* entity )
+{
+	if( !entity ) return;
+
+	Transform* transform = entity->getTransform().get();
+
+	if( transform && transform->getSystem() == &transforms )
+		transforms.remove(transform);
+
+	components.remove(entity);
+
+	if( IsGroup(entity) )
+	{
+		Group* group = (Group*) entity;
+
+		group->onEntityAdded.Disconnect(this, &Scene::onEntityAdded);
+		group->onEntityRemoved.Disconnect(this, &Scene::onEntityRemoved);
+		group->onEntityComponentAdded.Disconnect(this, &Scene::onEntityComponentAdded);
+		group->onEntityComponentRemoved.Disconnect(this, &Scene::onEntityComponentRemoved);
+
+		const Array<EntityPtr>& children = group->getEntities();
+
+		for( size_t i = 0; i < children.size(); i++ )
+			removeEntity( children[i].get() );
+
+		return;
+	}
+
+	auto it = std::find(nonCulledEntities.begin(), nonCulledEntities.end(), entity);
+
+	if( it != nonCulledEntities.end() )
+		nonCulledEntities.remove(it);
+
+	if( transform && transform->getSpatialProxy() != SpatialProxyNull )
+		transform->setSpatialProxy(nullptr, SpatialProxyNull);
+}
+
+//-----------------------------------//
+
+void Scene::onEntityAdded( const EntityPtr& entity )
+{
+	addEntity( entity.get() );
+}
+
+//-----------------------------------//
+
+void Scene::onEntityRemoved( const EntityPtr& entity )
+{
+	removeEntity( entity.get() );
+}
+
+//-----------------------------------//
+
+void Scene::onEntityComponentAdded( const ComponentPtr& component )
+{
+	components.refresh( component->getEntity() );
+
+	// Entities added before their transform get it in the tree now.
+	if( ClassInherits(component->getType(), ReflectionGetType(Transform)) )
+		addEntity( component->getEntity() );
+}
+
+//-----------------------------------//
+
+void Scene::onEntityComponentRemoved( const ComponentPtr& component )
+{
+	components.refresh( component->getEntity() );
+}
+
+//-----------------------------------//
+
+void Scene::queryEntities( const Frustum& frustum, Array<Entity*>& list ) const
+{
+	Array<int32> proxies;
+
+	for( size_t i = 0; i < SceneLayer::Count; i++ )
+	{
+		const SpatialIndex* index = spatialIndices[i];
+
+		proxies.clear();
+		index->query(frustum, proxies);
+
+		for( size_t j = 0; j < proxies.size(); j++ )
+			list.pushBack( (Entity*) index->getUserData(proxies[j]) );
+	}
+
+	for( size_t i = 0; i < nonCulledEntities.size(); i++ )
+		list.pushBack( nonCulledEntities[i] );
+}
+
+//-----------------------------------//
+
+static float GetDistanceSquared( const BoundingBox& box, const Vector3& point )
+{
+	Vector3 closest;
+	closest.x = std::max(box.min.x, std::min(point.x, box.max.x));
+	closest.y = std::max(box.min.y, std::min(point.y, box.max.y));
+	closest.z = std::max(box.min.z, std::min(point.z, box.max.z));
+
+	return (closest - point).lengthSquared();
+}
+
+void Scene::queryNeighbours( const Vector3& point, float radius, Array<Entity*>& list ) const
+{
+	BoundingBox box(point - Vector3(radius), point + Vector3(radius));
+	Array<int32> proxies;
+
+	for( size_t i = 0; i < SceneLayer::Count; i++ )
+	{
+		const SpatialIndex* index = spatialIndices[i];
+
+		proxies.clear();
+		index->query(box, proxies);
+
+		for( size_t j = 0; j < proxies.size(); j++ )
+		{
+			Entity* entity = (Entity*) index->getUserData(proxies[j]);
+			const Transform* transform = entity->getTransform().get();
+
+			// The indices return the boxes near the query box.
+			const BoundingBox& bounds = transform->getWorldBoundingVolume();
+
+			if( GetDistanceSquared(bounds, point) <= radius * radius )
+				list.pushBack(entity);
+		}
+	}
 }
 
 //-----------------------------------//
@@ -100,56 +376,78 @@ static bool sortRayQueryResult(const RayQueryResult& lhs, const RayQueryResult&
 	return lhs.distance < rhs.distance;
 }
 
-static bool doRayGroupQuery( const Group* group, const Culler& culler, RayQueryList& list, bool all )
+static bool IsEntityPickable( const Entity* entity )
 {
-	const Array<EntityPtr>& entities = group->getEntities();
+	// Ignore invisible entities.
+	return entity->isVisible() && !entity->getTag(Tags::NonPickable);
+}
 
-	// Do some ray casting to find a collision.
-	for( size_t i = 0; i < entities.size(); i++ )
-	{
-		Entity* entity = entities[i].get();
-		if( !entity ) continue;
+static void DoEntityQuery( Entity* entity, const Culler& culler, RayQueryList& list )
+{
+	if( !IsEntityPickable(entity) )
+		return;
 
-		Class* klass = entity->getType();
+	const Transform* transform = entity->getTransform().get();
+	if( !transform ) return;
 
-		if( ClassInherits(klass, ReflectionGetType(Group)) )
-		{
-			const Group* group = (const Group*) entity;
+	const BoundingBox& box = transform->getWorldBoundingVolume();
 
-			if( doRayGroupQuery(group, culler, list, all) && !all )
-				return true;
-		}
-		else
-		{
-			// Ignore invisible entities.
-			if( !entity->isVisible() || entity->getTag(Tags::NonPickable) )
-				continue;
+	float distance = -1;
 
-			const Transform* transform = entity->getTransform().get();
-			if( !transform ) continue;
+	bool intersectsBox = culler.ray && box.intersects(*culler.ray, distance);
+	bool intersectsFrustum = culler.frustum && culler.frustum->intersects(box);
+	
+	if(intersectsBox || intersectsFrustum)
+	{
+		RayQueryResult res;
+		res.entity = entity;
+		res.distance = distance;
+
+		list.pushBack( res );
+	}
+}
 
-			const BoundingBox& box = transform->getWorldBoundingVolume();
+static bool DoBoundsQuery( SpatialIndex* const* indices, const Array<Entity*>& nonCulled,
+	const Culler& culler, RayQueryList& list, bool all )
+{
+	// Only the entities near the ray or volume need to be tested.
+	Array<int32> proxies;
 
-			float distance = -1;
+	for( size_t i = 0; i < SceneLayer::Count; i++ )
+	{
+		const SpatialIndex* index = indices[i];
 
-			bool intersectsBox = culler.ray && box.intersects(*culler.ray, distance);
-			bool intersectsFrustum = culler.frustum && culler.frustum->intersects(box);
-			
-			if(intersectsBox || intersectsFrustum)
-			{
-				RayQueryResult res;
-				res.entity = entity;
-				res.distance = distance;
+		proxies.clear();
 
-				list.pushBack( res );
+		if( culler.ray )
+			index->query(*culler.ray, proxies);
+		else
+			index->query(*culler.frustum, proxies);
 
-				if( !all ) break;
-			}
+		for( size_t j = 0; j < proxies.size(); j++ )
+		{
+			Entity* entity = (Entity*) index->getUserData(proxies[j]);
+			DoEntityQuery(entity, culler, list);
 		}
 	}
 
-	// Sort the results by distance.
-	std::sort( list.begin(), list.end(), &sortRayQueryResult );
+	for( size_t i = 0; i < nonCulled.size(); i++ )
+		DoEntityQuery(nonCulled[i], culler, list);
+
+	if( !all && list.size() > 1 )
+	{
+		// Only the nearest result is kept, so there is no need to sort.
+		RayQueryResult nearest = *std::min_element( list.begin(), list.end(),
+			&sortRayQueryResult );
+
+		list.resize(1);
+		list[0] = nearest;
+	}
+	else
+	{
+		// Sort the results by distance.
+		std::sort( list.begin(), list.end(), &sortRayQueryResult );
+	}
 
 	return !list.empty();
 }
@@ -174,7 +472,7 @@ bool Scene::doRayBoxQuery( const Ray& ray, RayQueryList& list, bool all )
 	Culler culler;
 	culler.ray = &ray;
 
-	return doRayGroupQuery(&entities, culler, list, all);
+	return DoBoundsQuery(spatialIndices, nonCulledEntities, culler, list, all);
 }
 
 //-----------------------------------//
@@ -184,7 +482,7 @@ bool Scene::doRayVolumeQuery( const Frustum& volume, RayQueryList& list, bool al
 	Culler culler;
 	culler.frustum = &volume;
 
-	return doRayGroupQuery(&entities, culler, list, all);
+	return DoBoundsQuery(spatialIndices, nonCulledEntities, culler, list, all);
 }
 
 //-----------------------------------//
@@ -331,6 +629,64 @@ static bool DoSkinning(const Geometry* geo, Array<Vector3>& skinnedPositions)
 
 //-----------------------------------//
 
+static const TriangleTree* GetTriangleTree(const Geometry* geo, Mesh*& mesh)
+{
+	bool isModel = ClassInherits(geo->getType(), ReflectionGetType(Model));
+	if( !isModel ) return nullptr;
+
+	mesh = ((Model*) geo)->getMesh().Resolve();
+	if( !mesh || !mesh->isBuilt() ) return nullptr;
+
+	return mesh->getTriangleTree();
+}
+
+//-----------------------------------//
+
+static bool DoRayQueryTree( const Ray& ray, const Geometry* geo, Mesh* mesh,
+	const TriangleTree* tree, RayTriangleQueryResult& res, RenderBatch*& rend )
+{
+	TriangleTreeHit hit;
+	if( !tree->raycast(ray, hit) ) return false;
+
+	int32 group;
+	uint32 indices[3];
+
+	if( !mesh->getTriangle(hit.triangle, group, indices) )
+		return false;
+
+	const GeometryBuffer* gb = mesh->getGeometryBuffer().get();
+	bool hasTexCoords = gb->getAttribute(VertexAttribute::TexCoord0, 0) != nullptr;
+
+	Vector3 tri[3];
+	Vector3 tex[3];
+
+	for( size_t i = 0; i < 3; i++ )
+	{
+		tri[i] = *(Vector3*) gb->getAttribute(VertexAttribute::Position, indices[i]);
+
+		if( hasTexCoords )
+			tex[i] = *(Vector2*) gb->getAttribute(VertexAttribute::TexCoord0, indices[i]);
+	}
+
+	BuildQueryResult(res, ray, tri, tex, hit.u, hit.v, hit.distance);
+
+	// The model has a renderable for each group with indices.
+	const Array<RenderBatchPtr>& rends = geo->getRenderables();
+	size_t index = 0;
+
+	for( int32 i = 0; i < group; i++ )
+	{
+		if( !mesh->groups[i].indices.empty() )
+			index++;
+	}
+
+	rend = (index < rends.size()) ? rends[index].get() : nullptr;
+
+	return true;
+}
+
+//-----------------------------------//
+
 static Ray TransformRay(const Ray& ray, const EntityPtr& entity)
 {
 	const Transform* transform = entity->getTransform().get();
@@ -350,6 +706,19 @@ static Ray TransformRay(const Ray& ray, const EntityPtr& entity)
 
 //-----------------------------------//
 
+static void SetQueryResult( RayTriangleQueryResult& res, const Ray& ray,
+	const Matrix4x3& absolute, const EntityPtr& entity, const Geometry* geo,
+	RenderBatch* rend )
+{
+	res.intersectionWorld = absolute * res.intersectionLocal;
+	res.entity = entity.get();
+	res.geometry = (Geometry*) geo;
+	res.renderable = rend;
+	res.distance = (ray.origin - res.intersectionWorld).lengthSquared();
+}
+
+//-----------------------------------//
+
 bool Scene::doRayTriangleQuery( const Ray& ray, RayTriangleQueryResult& res, const EntityPtr& entity )
 {
 	Ray entityRay = TransformRay(ray, entity);
@@ -374,6 +743,22 @@ bool Scene::doRayTriangleQuery( const Ray& ray, RayTriangleQueryResult& res, con
 		if( !bound.intersects(ray, distance) )
 			continue;
 
+		// Static models test the triangle tree of their mesh, which is
+		// built once and shared by all the models of the mesh.
+		Mesh* mesh = nullptr;
+		const TriangleTree* tree = GetTriangleTree(geo, mesh);
+
+		if( tree )
+		{
+			RenderBatch* rend = nullptr;
+
+			if( !DoRayQueryTree(entityRay, geo, mesh, tree, res, rend) )
+				continue;
+
+			SetQueryResult(res, ray, absolute, entity, geo, rend);
+			return true;
+		}
+
 		const Array<RenderBatchPtr>& rends = geo->getRenderables();
 
 		Array<Vector3> skinnedPositions;
@@ -410,12 +795,7 @@ bool Scene::doRayTriangleQuery( const Ray& ray, RayTriangleQueryResult& res, con
 
 			if(hit)
 			{
-				res.intersectionWorld = absolute * res.intersectionLocal;
-				res.entity = entity.get();
-				res.geometry = (Geometry*) geo;
-				res.renderable = (Renderable*) rend;
-				res.distance = (ray.origin - res.intersectionWorld).lengthSquared();
-
+				SetQueryResult(res, ray, absolute, entity, geo, (RenderBatch*) rend);
 				return true;
 			}
 		}
@@ -426,9 +806,284 @@ bool Scene::doRayTriangleQuery( const Ray& ray, RayTriangleQueryResult& res, con
 
 //-----------------------------------//
 
+// Minimum number of rays traced by each slice of a batch.
+static const size_t MinRaysPerSlice = 64;
+
+// Priority of the ray tasks in the task pool.
+static const int32 RayTaskPriority = 100;
+
+struct SceneRayBatch
+{
+	Scene* scene;
+	SpatialIndex* const* indices;
+	const Array<Entity*>* nonCulled;
+
+	const Ray* rays;
+	size_t count;
+
+	// Indices of the rays, with the rays that go the same way together.
+	Array<uint32> order;
+
+	RayQueryResult* boxResults;
+	RayTriangleQueryResult* triangleResults;
+};
+
+struct SceneRayJob
+{
+	Task task;
+	SceneRayBatch* batch;
+	size_t start;
+	size_t end;
+};
+
+//-----------------------------------//
+
+static void SortRaysByDirection( const Ray* rays, size_t count, Array<uint32>& order )
+{
+	// Group the rays by the signs of their directions, so the rays of a
+	// packet visit mostly the same nodes of the indices.
+	uint32 offsets[9] = { 0 };
+	order.resize(count);
+
+	Array<uint8> octants;
+	octants.resize(count);
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		const Vector3& direction = rays[i].direction;
+
+		uint8 octant = (direction.x < 0 ? 1 : 0) | (direction.y < 0 ? 2 : 0)
+			| (direction.z < 0 ? 4 : 0);
+
+		octants[i] = octant;
+		offsets[octant + 1]++;
+	}
+
+	for( size_t i = 1; i < 9; i++ )
+		offsets[i] += offsets[i - 1];
+
+	for( size_t i = 0; i < count; i++ )
+		order[offsets[octants[i]]++] = (uint32) i;
+}
+
+//-----------------------------------//
+
+static void AddPacketHits( Entity* entity, const RayPacket& packet, uint32 mask,
+	RayQueryList* hits )
+{
+	if( !IsEntityPickable(entity) )
+		return;
+
+	const Transform* transform = entity->getTransform().get();
+	if( !transform ) return;
+
+	const BoundingBox& box = transform->getWorldBoundingVolume();
+
+	// Test all the rays at once before finding the distances of the hits.
+	mask = packet.intersects(box, mask);
+
+	for( uint32 i = 0; mask != 0; i++, mask >>= 1 )
+	{
+		if( !(mask & 1) ) continue;
+
+		float distance = -1;
+
+		if( !box.intersects(packet.getRay(i), distance) )
+			continue;
+
+		RayQueryResult res;
+		res.entity = entity;
+		res.distance = distance;
+
+		hits[i].pushBack(res);
+	}
+}
+
+//-----------------------------------//
+
+static void TraceRays( SceneRayBatch& batch, size_t start, size_t end )
+{
+	RayPacket packet;
+
+	Array<int32> proxies;
+	Array<uint32> masks;
+
+	// Entities with bounds hit by each ray of the packet.
+	RayQueryList hits[RayPacketSize];
+
+	for( size_t first = start; first < end; first += RayPacketSize )
+	{
+		uint32 size = (uint32) std::min<size_t>(RayPacketSize, end - first);
+		const uint32* indices = batch.order.data() + first;
+
+		packet.set(batch.rays, indices, size);
+
+		for( uint32 i = 0; i < size; i++ )
+			hits[i].clear();
+
+		for( size_t i = 0; i < SceneLayer::Count; i++ )
+		{
+			const SpatialIndex* index = batch.indices[i];
+
+			proxies.clear();
+			masks.clear();
+
+			index->query(packet, proxies, masks);
+
+			for( size_t j = 0; j < proxies.size(); j++ )
+			{
+				Entity* entity = (Entity*) index->getUserData(proxies[j]);
+				AddPacketHits(entity, packet, masks[j], hits);
+			}
+		}
+
+		const Array<Entity*>& nonCulled = *batch.nonCulled;
+
+		for( size_t i = 0; i < nonCulled.size(); i++ )
+			AddPacketHits(nonCulled[i], packet, packet.getMask(), hits);
+
+		for( uint32 i = 0; i < size; i++ )
+		{
+			RayQueryList& list = hits[i];
+			uint32 ray = indices[i];
+
+			if( batch.boxResults )
+			{
+				RayQueryResult& res = batch.boxResults[ray];
+				res.entity = nullptr;
+				res.distance = -1;
+
+				if( !list.empty() )
+					res = *std::min_element(list.begin(), list.end(), &sortRayQueryResult);
+
+				continue;
+			}
+
+			RayTriangleQueryResult& res = batch.triangleResults[ray];
+			res.entity = nullptr;
+			res.geometry = nullptr;
+			res.renderable = nullptr;
+
+			// Test the triangles of the entities in the order of their bounds.
+			std::sort( list.begin(), list.end(), &sortRayQueryResult );
+
+			for( size_t j = 0; j < list.size(); j++ )
+			{
+				if( batch.scene->doRayTriangleQuery(batch.rays[ray], res, list[j].entity) )
+					break;
+
+				res.entity = nullptr;
+			}
+		}
+	}
+}
+
+//-----------------------------------//
+
+static void RunRayJob( Task* task )
+{
+	SceneRayJob* job = (SceneRayJob*) task->userdata;
+
+	TraceRays( *job->batch, job->start, job->end );
+}
+
+//-----------------------------------//
+
+static void TraceBatch( SceneRayBatch& batch )
+{
+	size_t count = batch.count;
+	if( count == 0 ) return;
+
+	SortRaysByDirection(batch.rays, count, batch.order);
+
+	// Split the rays in slices of whole packets, one per thread, as long
+	// as each slice has enough rays to be worth tracing in another thread.
+	TaskPool* taskPool = GetEngine() ? GetEngine()->getTaskPool() : nullptr;
+
+	size_t maxSlices = taskPool ? taskPool->threads.size() + 1 : 1;
+	size_t numSlices = count / MinRaysPerSlice;
+	numSlices = std::max<size_t>(1, std::min(numSlices, maxSlices));
+
+	size_t sliceSize = (count + numSlices - 1) / numSlices;
+	sliceSize = (sliceSize + RayPacketSize - 1) / RayPacketSize * RayPacketSize;
+
+	Array<SceneRayJob*> jobs;
+
+	for( size_t i = 1; i < numSlices; i++ )
+	{
+		size_t start = i * sliceSize;
+		if( start >= count ) break;
+
+		SceneRayJob* job = AllocateHeap(SceneRayJob);
+		job->task.callback.Bind(RunRayJob);
+		job->task.userdata = job;
+		job->task.priority = RayTaskPriority;
+		job->batch = &batch;
+		job->start = start;
+		job->end = std::min(start + sliceSize, count);
+
+		jobs.pushBack(job);
+	}
+
+	TaskGroup tasks;
+	tasks.setTaskPool(taskPool);
+
+	for( size_t i = 0; i < jobs.size(); i++ )
+		tasks.add(&jobs[i]->task);
+
+	// The first slice is traced by this thread.
+	TraceRays( batch, 0, std::min(sliceSize, count) );
+
+	// Wait for the other slices, tracing the ones not started yet.
+	tasks.wait();
+
+	for( size_t i = 0; i < jobs.size(); i++ )
+		Deallocate(jobs[i]);
+}
+
+//-----------------------------------//
+
+void Scene::doRayBoxQueries( const Ray* rays, size_t count, RayQueryResult* results )
+{
+	SceneRayBatch batch;
+	batch.scene = this;
+	batch.indices = spatialIndices;
+	batch.nonCulled = &nonCulledEntities;
+	batch.rays = rays;
+	batch.count = count;
+	batch.boxResults = results;
+	batch.triangleResults = nullptr;
+
+	TraceBatch(batch);
+}
+
+//-----------------------------------//
+
+void Scene::doRayTriangleQueries( const Ray* rays, size_t count, RayTriangleQueryResult* results )
+{
+	SceneRayBatch batch;
+	batch.scene = this;
+	batch.indices = spatialIndices;
+	batch.nonCulled = &nonCulledEntities;
+	batch.rays = rays;
+	batch.count = count;
+	batch.boxResults = nullptr;
+	batch.triangleResults = results;
+
+	TraceBatch(batch);
+}
+
+//-----------------------------------//
+
 void Scene::update( float delta )
 {
-	entities.update( delta );
+	if( updateByComponent )
+		systems.update( components, delta );
+	else
+		entities.update( delta );
+
+	// Update the world matrices and bounds of all the changed transforms.
+	transforms.update();
 }
 
 //-----------------------------------//
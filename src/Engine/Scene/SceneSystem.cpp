@@ -0,0 +1,95 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Engine/API.h"
+#include "Engine/Scene/SceneSystem.h"
+#include "Engine/Scene/Transform.h"
+#include "Engine/Scene/Geometry.h"
+#include <algorithm>
+
+NAMESPACE_ENGINE_BEGIN
+
+//-----------------------------------//
+
+SceneSystem::SceneSystem( Class* klass )
+	: klass(klass)
+	, flags(0)
+	, stage(SystemStage::Update)
+{
+}
+
+//-----------------------------------//
+
+SceneSystem::~SceneSystem()
+{
+}
+
+//-----------------------------------//
+
+void SceneSystem::addRead( Class* klass )
+{
+	if( std::find(reads.begin(), reads.end(), klass) == reads.end() )
+		reads.pushBack(klass);
+}
+
+//-----------------------------------//
+
+void SceneSystem::addWrite( Class* klass )
+{
+	if( std::find(writes.begin(), writes.end(), klass) == writes.end() )
+		writes.pushBack(klass);
+}
+
+//-----------------------------------//
+
+static bool ClassesOverlap( const Array<Class*>& a, const Array<Class*>& b )
+{
+	for( size_t i = 0; i < a.size(); i++ )
+	{
+		for( size_t j = 0; j < b.size(); j++ )
+		{
+			// The components of a class are also of its parent classes.
+			if( ClassInherits(a[i], b[j]) || ClassInherits(b[j], a[i]) )
+				return true;
+		}
+	}
+
+	return false;
+}
+
+bool SceneSystem::conflicts( const SceneSystem* other ) const
+{
+	return ClassesOverlap(writes, other->writes)
+		|| ClassesOverlap(writes, other->reads)
+		|| ClassesOverlap(reads, other->writes);
+}
+
+//-----------------------------------//
+
+ComponentSystem::ComponentSystem( Class* klass )
+	: SceneSystem(klass)
+{
+	addWrite(klass);
+	flags = SystemFlags::MainThread;
+
+	if( ClassInherits(klass, ReflectionGetType(Geometry)) )
+		stage = SystemStage::Geometry;
+	else if( ClassInherits(klass, ReflectionGetType(Transform)) )
+		stage = SystemStage::Transform;
+}
+
+//-----------------------------------//
+
+void ComponentSystem::update( Component* const* components, size_t count, float delta )
+{
+	for( size_t i = 0; i < count; i++ )
+		components[i]->update( delta );
+}
+
+//-----------------------------------//
+
+NAMESPACE_ENGINE_END
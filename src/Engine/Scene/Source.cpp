@@ -47,13 +47,13 @@ REFLECT_CLASS_END()
 Source::Source()
 	: state(SourceState::Stop)
 	, mode(SourceMode::Static)
+	, loop(false)
 	, volume(1.0f)
 	, pitch(1.0f)
 	, minDistance(20.0f)
 	, maxDistance(40.0f)
 	, rolloffMode(AudioRolloffMode::Logarithmic)
 	, rolloff(1.0f)
-	, loop(false)
 	, sound(HandleInvalid)
 	, audioSource(nullptr)
 { }
@@ -177,7 +177,7 @@ void Source::setSound( const SoundHandle& soundHandle )
 
 //-----------------------------------//
 
-void Source::update( float delta )
+void Source::update( float )
 {
 	if( !audioSource ) return;
 
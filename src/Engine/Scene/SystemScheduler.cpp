@@ -0,0 +1,322 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Engine/API.h"
+#include "Engine/Scene/SystemScheduler.h"
+#include "Engine/Scene/ComponentStorage.h"
+#include "Engine/Scene/Transform.h"
+#include "Engine/Engine.h"
+#include "Core/Task.h"
+#include <algorithm>
+
+NAMESPACE_ENGINE_BEGIN
+
+//-----------------------------------//
+
+// Minimum number of components updated by each range.
+static const size_t MinComponentsPerRange = 256;
+
+// Priority of the system tasks in the task pool.
+static const int32 SystemTaskPriority = 100;
+
+struct SystemJob
+{
+	Task task;
+	int32 system;
+	size_t start;
+	size_t end;
+};
+
+//-----------------------------------//
+
+SystemScheduler::SystemScheduler()
+	: numPools(0)
+	, needsGraph(false)
+	, deterministic(false)
+	, taskPool(nullptr)
+	, activePool(nullptr)
+	, delta(0)
+	, numReady(0)
+	, numFinished(0)
+	, numJobs(0)
+	, numWaited(0)
+{
+}
+
+//-----------------------------------//
+
+SystemScheduler::~SystemScheduler()
+{
+	for( size_t i = 0; i < systemTasks.size(); i++ )
+		Deallocate(systemTasks[i]);
+
+	for( size_t i = 0; i < jobs.size(); i++ )
+		Deallocate(jobs[i]);
+
+	for( size_t i = 0; i < systems.size(); i++ )
+		Deallocate(systems[i]);
+}
+
+//-----------------------------------//
+
+void SystemScheduler::add( SceneSystem* system )
+{
+	if( !system ) return;
+
+	systems.pushBack(system);
+	needsGraph = true;
+}
+
+//-----------------------------------//
+
+void SystemScheduler::remove( SceneSystem* system )
+{
+	auto it = std::find(systems.begin(), systems.end(), system);
+	if( it == systems.end() ) return;
+
+	systems.remove(it);
+	needsGraph = true;
+
+	Deallocate(system);
+}
+
+//-----------------------------------//
+
+SceneSystem* SystemScheduler::findSystem( const Class* klass ) const
+{
+	for( size_t i = 0; i < systems.size(); i++ )
+	{
+		if( systems[i]->getClass() == klass )
+			return systems[i];
+	}
+
+	return nullptr;
+}
+
+//-----------------------------------//
+
+void SystemScheduler::buildGraph()
+{
+	sorted = systems;
+
+	std::stable_sort(sorted.begin(), sorted.end(),
+		[](const SceneSystem* a, const SceneSystem* b) {
+			return a->getStage() < b->getStage();
+		});
+
+	size_t count = sorted.size();
+
+	// Each system waits for the systems before it that conflict.
+	Array<int32> edges;
+
+	dependencyCounts.clear();
+	dependencyCounts.resize(count);
+
+	dependentOffsets.clear();
+	dependentOffsets.resize(count + 1);
+
+	for( size_t i = 0; i <= count; i++ )
+		dependentOffsets[i] = 0;
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		dependencyCounts[i] = 0;
+
+		for( size_t j = 0; j < i; j++ )
+		{
+			if( !sorted[j]->conflicts(sorted[i]) ) continue;
+
+			edges.pushBack((int32) j);
+			edges.pushBack((int32) i);
+
+			dependencyCounts[i]++;
+			dependentOffsets[j + 1]++;
+		}
+	}
+
+	for( size_t i = 0; i < count; i++ )
+		dependentOffsets[i + 1] += dependentOffsets[i];
+
+	dependents.resize(edges.size() / 2);
+
+	Array<int32> offsets = dependentOffsets;
+
+	for( size_t i = 0; i < edges.size(); i += 2 )
+		dependents[offsets[edges[i]]++] = edges[i + 1];
+
+	needsGraph = false;
+}
+
+//-----------------------------------//
+
+void SystemScheduler::update( ComponentStorage& storage, float delta )
+{
+	// Classes of components without a system get a default one, which
+	// might also change the transforms of its entities.
+	const Array<ComponentPool*>& pools = storage.getPools();
+
+	for( ; numPools < pools.size(); numPools++ )
+	{
+		Class* klass = pools[numPools]->getClass();
+		if( findSystem(klass) ) continue;
+
+		ComponentSystem* system = AllocateThis(ComponentSystem, klass);
+		system->addWrite( ReflectionGetType(Transform) );
+
+		add(system);
+	}
+
+	if( needsGraph )
+		buildGraph();
+
+	size_t count = sorted.size();
+
+	activePool = taskPool;
+
+	if( !activePool && GetEngine() )
+		activePool = GetEngine()->getTaskPool();
+
+	if( deterministic )
+		activePool = nullptr;
+
+	this->delta = delta;
+
+	// The pools are sorted here, before any system runs.
+	componentLists.resize(count);
+	pendingDependencies = dependencyCounts;
+
+	while( systemTasks.size() < count )
+		systemTasks.pushBack( AllocateThis(TaskGroup) );
+
+	ready.clear();
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		Class* klass = sorted[i]->getClass();
+		componentLists[i] = klass ? &storage.getComponents(klass) : nullptr;
+
+		if( pendingDependencies[i] == 0 )
+			ready.pushBack((int32) i);
+	}
+
+	numReady = 0;
+	numFinished = 0;
+	numJobs = 0;
+
+	running.clear();
+	numWaited = 0;
+
+	while( numFinished < count )
+	{
+		// Start the systems in the order they got ready.
+		if( numReady < ready.size() )
+		{
+			launch( ready[numReady++] );
+			continue;
+		}
+
+		// Wait for the oldest system still running, running the ranges
+		// of it not started yet in this thread.
+		assert( numWaited < running.size() );
+		int32 index = running[numWaited++];
+
+		systemTasks[index]->wait();
+		finish( index );
+	}
+}
+
+//-----------------------------------//
+
+void SystemScheduler::launch( int32 index )
+{
+	SceneSystem* system = sorted[index];
+	system->begin(delta);
+
+	const Array<Component*>* list = componentLists[index];
+
+	Component* const* components = list ? list->data() : nullptr;
+	size_t count = list ? list->size() : 0;
+
+	bool isMainThread = (system->getFlags() & SystemFlags::MainThread) != 0;
+
+	if( !activePool || isMainThread )
+	{
+		system->update(components, count, delta);
+		finish(index);
+		return;
+	}
+
+	// Split the components of parallel systems in ranges, one per thread,
+	// as long as each range has enough components to be worth it.
+	size_t numRanges = 1;
+
+	if( system->getFlags() & SystemFlags::Parallel )
+	{
+		size_t maxRanges = activePool->threads.size() + 1;
+		numRanges = count / MinComponentsPerRange;
+		numRanges = std::max<size_t>(1, std::min(numRanges, maxRanges));
+	}
+
+	size_t rangeSize = (count + numRanges - 1) / numRanges;
+
+	TaskGroup* group = systemTasks[index];
+	group->setTaskPool(activePool);
+
+	for( size_t i = 0; i < numRanges; i++ )
+	{
+		if( numJobs == jobs.size() )
+		{
+			SystemJob* job = AllocateThis(SystemJob);
+			job->task.callback.Bind(this, &SystemScheduler::runJob);
+			job->task.userdata = job;
+			job->task.priority = SystemTaskPriority;
+			jobs.pushBack(job);
+		}
+
+		SystemJob* job = jobs[numJobs++];
+		job->system = index;
+		job->start = std::min(i * rangeSize, count);
+		job->end = std::min(job->start + rangeSize, count);
+
+		group->add(&job->task);
+	}
+
+	running.pushBack(index);
+}
+
+//-----------------------------------//
+
+void SystemScheduler::runJob( Task* task )
+{
+	SystemJob* job = (SystemJob*) task->userdata;
+
+	SceneSystem* system = sorted[job->system];
+	const Array<Component*>* list = componentLists[job->system];
+
+	Component* const* components = list ? list->data() + job->start : nullptr;
+	system->update(components, job->end - job->start, delta);
+}
+
+//-----------------------------------//
+
+void SystemScheduler::finish( int32 index )
+{
+	sorted[index]->end(delta);
+	numFinished++;
+
+	for( int32 i = dependentOffsets[index]; i < dependentOffsets[index + 1]; i++ )
+	{
+		int32 dependent = dependents[i];
+
+		if( --pendingDependencies[dependent] == 0 )
+			ready.pushBack(dependent);
+	}
+}
+
+//-----------------------------------//
+
+NAMESPACE_ENGINE_END
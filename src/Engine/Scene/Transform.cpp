@@ -7,6 +7,7 @@
 
 #include "Engine/API.h"
 #include "Engine/Scene/Transform.h"
+#include "Engine/Scene/TransformSystem.h"
 #include "Engine/Scene/Geometry.h"
 #include "Engine/Scene/Entity.h"
 #include "Engine/Geometry/DebugGeometry.h"
@@ -36,6 +37,10 @@ Transform::Transform()
 	, needsBoundsUpdate(true)
 	, externalTransform(false)
 	, scale(1.0f, 1.0f, 1.0f)
+	, spatialIndex(nullptr)
+	, spatialProxy(SpatialProxyNull)
+	, system(nullptr)
+	, systemIndex(-1)
 {
 }
 
@@ -43,7 +48,10 @@ Transform::Transform()
 
 Transform::~Transform()
 {
+	setSpatialProxy(nullptr, SpatialProxyNull);
 
+	if( system )
+		system->remove(this);
 }
 
 //-----------------------------------//
@@ -52,6 +60,7 @@ void Transform::setPosition( const Vector3& position )
 {
 	setChanged();
 	this->position = position;
+	updateSystem();
 }
 
 //-----------------------------------//
@@ -60,6 +69,7 @@ void Transform::setRotation( const Quaternion& rotation )
 {
 	setChanged();
 	this->rotation = rotation;
+	updateSystem();
 }
 
 //-----------------------------------//
@@ -68,6 +78,7 @@ void Transform::setScale( const Vector3& scale )
 {
 	setChanged();
 	this->scale = scale;
+	updateSystem();
 }
 
 //-----------------------------------//
@@ -79,6 +90,8 @@ void Transform::reset()
 	position.zero();
 	rotation.identity();
 	scale = 1;
+
+	updateSystem();
 }
 
 //-----------------------------------//
@@ -128,8 +141,19 @@ void Transform::setChanged(bool state)
 
 //-----------------------------------//
 
+void Transform::updateSystem()
+{
+	if( system )
+		system->setLocalTransform(systemIndex, position, rotation, scale);
+}
+
+//-----------------------------------//
+
 const Matrix4x3& Transform::getAbsoluteTransform() const
 {
+	if( system )
+		return system->getWorldMatrix(systemIndex);
+
 	return transform;
 }
 
@@ -141,6 +165,14 @@ void Transform::setAbsoluteTransform( const Matrix4x3& newTransform )
 
 	transform = newTransform;
 	externalTransform = true;
+
+	if( system )
+	{
+		system->setWorldMatrix(systemIndex, newTransform);
+		return;
+	}
+
+	updateWorldBoundingVolume();
 }
 
 //-----------------------------------//
@@ -186,17 +218,29 @@ void Transform::updateBoundingVolume()
 		bounds.setZero();
 
 	needsBoundsUpdate = false;
+
+	if( system )
+		system->setLocalBounds(systemIndex, bounds);
 }
 
 //-----------------------------------//
 
 void Transform::update( float delta )
 {
+	bool boundsChanged = requiresBoundingVolumeUpdate();
+
+	if( boundsChanged )
+		updateBoundingVolume();
+
+	// The system updates its transforms all at once.
+	if( system ) return;
+
 	if( !externalTransform )
 		transform = getLocalTransform();
 
-	if( requiresBoundingVolumeUpdate() )
-		updateBoundingVolume();
+	// Entities that did not move keep their world bounds and proxies.
+	if( wasChanged || boundsChanged )
+		updateWorldBoundingVolume();
 
 	if( wasChanged )
 	{
@@ -209,10 +253,65 @@ void Transform::update( float delta )
 
 //-----------------------------------//
 
-BoundingBox Transform::getWorldBoundingVolume() const
+void Transform::updateWorldBoundingVolume()
 {
 	const Matrix4x3& transform = getAbsoluteTransform();
-	return bounds.transform(transform);
+	worldBounds = bounds.transform(transform);
+
+	// The indices only change if the bounds move far enough.
+	if( spatialIndex )
+		spatialIndex->moveProxy(spatialProxy, worldBounds);
+}
+
+//-----------------------------------//
+
+const BoundingBox& Transform::getWorldBoundingVolume() const
+{
+	if( system )
+		return system->getWorldBounds(systemIndex);
+
+	return worldBounds;
+}
+
+//-----------------------------------//
+
+void Transform::onWorldChanged()
+{
+	// The indices only change if the bounds move far enough.
+	if( spatialIndex )
+		spatialIndex->moveProxy(spatialProxy, getWorldBoundingVolume());
+
+	if( wasChanged )
+	{
+		onTransformed();
+		setChanged(false);
+	}
+}
+
+//-----------------------------------//
+
+bool Transform::setParent( Transform* parent )
+{
+	if( !system ) return false;
+
+	if( !parent )
+		return system->setParent(systemIndex, -1);
+
+	if( parent->system != system )
+		return false;
+
+	return system->setParent(systemIndex, parent->systemIndex);
+}
+
+//-----------------------------------//
+
+void Transform::setSpatialProxy( SpatialIndex* index, int32 proxy )
+{
+	if( spatialIndex )
+		spatialIndex->destroyProxy(spatialProxy);
+
+	spatialIndex = index;
+	spatialProxy = proxy;
 }
 
 //-----------------------------------//
@@ -0,0 +1,450 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Engine/API.h"
+#include "Engine/Scene/TransformSystem.h"
+#include "Engine/Scene/Transform.h"
+#include "Engine/Engine.h"
+#include "Core/Task.h"
+#include <algorithm>
+
+NAMESPACE_ENGINE_BEGIN
+
+//-----------------------------------//
+
+static const int32 TransformNull = -1;
+
+// Minimum number of transforms updated by each slice.
+static const size_t MinTransformsPerSlice = 1024;
+
+// Priority of the update tasks in the task pool.
+static const int32 TransformTaskPriority = 100;
+
+struct TransformSystemJob
+{
+	Task task;
+	size_t start;
+	size_t end;
+};
+
+// Reorders the values so the value at each index comes from the order.
+template<typename T>
+static void Permute( Array<T>& values, const Array<int32>& order )
+{
+	Array<T> sorted;
+	sorted.resize(values.size());
+
+	for( size_t i = 0; i < order.size(); i++ )
+		sorted[i] = values[order[i]];
+
+	values = std::move(sorted);
+}
+
+//-----------------------------------//
+
+TransformSystem::TransformSystem()
+	: needsSort(false)
+{
+}
+
+//-----------------------------------//
+
+TransformSystem::~TransformSystem()
+{
+	jobTasks.wait();
+
+	for( size_t i = 0; i < jobs.size(); i++ )
+		Deallocate(jobs[i]);
+
+	while( !transforms.empty() )
+		remove( transforms.back() );
+}
+
+//-----------------------------------//
+
+void TransformSystem::add( Transform* transform )
+{
+	assert( transform->system == nullptr );
+
+	uint8 flag = TransformFlags::Dirty;
+
+	if( transform->externalTransform )
+		flag |= TransformFlags::External;
+
+	positions.pushBack(transform->position);
+	rotations.pushBack(transform->rotation);
+	scales.pushBack(transform->scale);
+	localBounds.pushBack(transform->bounds);
+
+	worldMatrices.pushBack(transform->transform);
+	worldBounds.pushBack(transform->worldBounds);
+
+	// New transforms are roots at the end, so the order is still valid.
+	parents.pushBack(TransformNull);
+	numChildren.pushBack(0);
+	subtreeSizes.pushBack(1);
+
+	flags.pushBack(flag);
+	transforms.pushBack(transform);
+
+	transform->system = this;
+	transform->systemIndex = (int32) transforms.size() - 1;
+}
+
+//-----------------------------------//
+
+void TransformSystem::remove( Transform* transform )
+{
+	assert( transform->system == this );
+
+	int32 index = transform->systemIndex;
+
+	// Keep the last world state in the transform.
+	transform->transform = worldMatrices[index];
+	transform->worldBounds = worldBounds[index];
+	transform->system = nullptr;
+	transform->systemIndex = TransformNull;
+
+	if( numChildren[index] > 0 )
+	{
+		for( size_t i = 0; i < parents.size(); i++ )
+		{
+			if( parents[i] != index ) continue;
+
+			parents[i] = TransformNull;
+			flags[i] |= TransformFlags::Dirty;
+		}
+
+		needsSort = true;
+	}
+
+	// The subtree sizes of the ancestors change, so sort them again.
+	if( parents[index] != TransformNull )
+	{
+		numChildren[parents[index]]--;
+		needsSort = true;
+	}
+
+	int32 last = (int32) transforms.size() - 1;
+
+	if( index != last )
+	{
+		moveLast(index);
+		needsSort = true;
+	}
+
+	positions.popBack();
+	rotations.popBack();
+	scales.popBack();
+	localBounds.popBack();
+	worldMatrices.popBack();
+	worldBounds.popBack();
+	parents.popBack();
+	numChildren.popBack();
+	subtreeSizes.popBack();
+	flags.popBack();
+	transforms.popBack();
+}
+
+//-----------------------------------//
+
+void TransformSystem::moveLast( int32 index )
+{
+	int32 last = (int32) transforms.size() - 1;
+
+	positions[index] = positions[last];
+	rotations[index] = rotations[last];
+	scales[index] = scales[last];
+	localBounds[index] = localBounds[last];
+	worldMatrices[index] = worldMatrices[last];
+	worldBounds[index] = worldBounds[last];
+	parents[index] = parents[last];
+	numChildren[index] = numChildren[last];
+	flags[index] = flags[last];
+	transforms[index] = transforms[last];
+
+	transforms[index]->systemIndex = index;
+
+	if( numChildren[last] == 0 ) return;
+
+	for( size_t i = 0; i < parents.size(); i++ )
+	{
+		if( parents[i] == last )
+			parents[i] = index;
+	}
+}
+
+//-----------------------------------//
+
+bool TransformSystem::setParent( int32 index, int32 parent )
+{
+	if( parents[index] == parent )
+		return true;
+
+	for( int32 i = parent; i != TransformNull; i = parents[i] )
+	{
+		if( i == index ) return false;
+	}
+
+	if( parents[index] != TransformNull )
+		numChildren[parents[index]]--;
+
+	if( parent != TransformNull )
+		numChildren[parent]++;
+
+	parents[index] = parent;
+	flags[index] |= TransformFlags::Dirty;
+
+	needsSort = true;
+
+	return true;
+}
+
+//-----------------------------------//
+
+void TransformSystem::setLocalTransform( int32 index, const Vector3& position,
+	const Quaternion& rotation, const Vector3& scale )
+{
+	positions[index] = position;
+	rotations[index] = rotation;
+	scales[index] = scale;
+
+	flags[index] |= TransformFlags::Dirty;
+}
+
+//-----------------------------------//
+
+void TransformSystem::setLocalBounds( int32 index, const BoundingBox& bounds )
+{
+	localBounds[index] = bounds;
+	flags[index] |= TransformFlags::Dirty;
+}
+
+//-----------------------------------//
+
+void TransformSystem::setWorldMatrix( int32 index, const Matrix4x3& matrix )
+{
+	worldMatrices[index] = matrix;
+	worldBounds[index] = localBounds[index].transform(matrix);
+
+	// The children are updated from it in the next update.
+	flags[index] |= TransformFlags::External | TransformFlags::Changed;
+}
+
+//-----------------------------------//
+
+void TransformSystem::sort()
+{
+	size_t count = transforms.size();
+
+	// Link the children of each transform.
+	Array<int32> firstChild(count, TransformNull);
+	Array<int32> nextSibling(count, TransformNull);
+
+	for( size_t i = count; i-- > 0; )
+	{
+		int32 parent = parents[i];
+		if( parent == TransformNull ) continue;
+
+		nextSibling[i] = firstChild[parent];
+		firstChild[parent] = (int32) i;
+	}
+
+	// Walk each tree depth first, so each subtree follows its root.
+	Array<int32> order;
+	order.reserve(count);
+
+	Array<int32> stack;
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		if( parents[i] != TransformNull ) continue;
+
+		stack.pushBack((int32) i);
+
+		while( !stack.empty() )
+		{
+			int32 index = stack.back();
+			stack.popBack();
+
+			order.pushBack(index);
+
+			for( int32 child = firstChild[index]; child != TransformNull;
+				child = nextSibling[child] )
+				stack.pushBack(child);
+		}
+	}
+
+	assert( order.size() == count );
+
+	Array<int32> newIndices;
+	newIndices.resize(count);
+
+	for( size_t i = 0; i < count; i++ )
+		newIndices[order[i]] = (int32) i;
+
+	Permute(positions, order);
+	Permute(rotations, order);
+	Permute(scales, order);
+	Permute(localBounds, order);
+	Permute(worldMatrices, order);
+	Permute(worldBounds, order);
+	Permute(parents, order);
+	Permute(numChildren, order);
+	Permute(flags, order);
+	Permute(transforms, order);
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		if( parents[i] != TransformNull )
+			parents[i] = newIndices[parents[i]];
+
+		transforms[i]->systemIndex = (int32) i;
+		subtreeSizes[i] = 1;
+	}
+
+	// The children follow their parents, so sum the sizes backwards.
+	for( size_t i = count; i-- > 0; )
+	{
+		if( parents[i] != TransformNull )
+			subtreeSizes[parents[i]] += subtreeSizes[i];
+	}
+
+	needsSort = false;
+}
+
+//-----------------------------------//
+
+void TransformSystem::updateRange( size_t start, size_t end )
+{
+	for( size_t i = start; i < end; i++ )
+	{
+		int32 parent = parents[i];
+		uint8 flag = flags[i];
+
+		// The parents come first, so they were already updated.
+		bool parentChanged = parent != TransformNull
+			&& (flags[parent] & TransformFlags::Changed);
+
+		if( !(flag & TransformFlags::Dirty) && !parentChanged )
+			continue;
+
+		Matrix4x3& world = worldMatrices[i];
+
+		if( !(flag & TransformFlags::External) )
+		{
+			world = Matrix4x3::createScale(scales[i])
+				* Matrix4x3::createFromQuaternion(rotations[i])
+				* Matrix4x3::createTranslation(positions[i]);
+
+			if( parent != TransformNull )
+				world = world * worldMatrices[parent];
+		}
+
+		worldBounds[i] = localBounds[i].transform(world);
+
+		flags[i] = (uint8) ((flag & ~TransformFlags::Dirty) | TransformFlags::Changed);
+	}
+}
+
+//-----------------------------------//
+
+void TransformSystem::runJob( Task* task )
+{
+	TransformSystemJob* job = (TransformSystemJob*) task->userdata;
+
+	updateRange( job->start, job->end );
+}
+
+//-----------------------------------//
+
+void TransformSystem::update()
+{
+	if( needsSort )
+		sort();
+
+	size_t count = transforms.size();
+
+	// Split the transforms in slices of whole subtrees, one per thread,
+	// as long as each slice has enough transforms to be worth it.
+	Engine* engine = GetEngine();
+	TaskPool* taskPool = engine ? engine->getTaskPool() : nullptr;
+
+	size_t maxSlices = taskPool ? taskPool->threads.size() + 1 : 1;
+	size_t numSlices = count / MinTransformsPerSlice;
+	numSlices = std::max<size_t>(1, std::min(numSlices, maxSlices));
+
+	size_t sliceSize = (count + numSlices - 1) / numSlices;
+	size_t firstEnd = count;
+
+	if( numSlices > 1 )
+	{
+		size_t numJobs = 0;
+		size_t start = 0;
+
+		for( size_t i = 0; i < count; i += subtreeSizes[i] )
+		{
+			size_t end = i + subtreeSizes[i];
+			if( end - start < sliceSize && end < count ) continue;
+
+			if( start == 0 )
+			{
+				firstEnd = end;
+			}
+			else
+			{
+				if( numJobs == jobs.size() )
+				{
+					TransformSystemJob* job = AllocateThis(TransformSystemJob);
+					job->task.callback.Bind(this, &TransformSystem::runJob);
+					job->task.userdata = job;
+					job->task.priority = TransformTaskPriority;
+					jobs.pushBack(job);
+				}
+
+				TransformSystemJob* job = jobs[numJobs++];
+				job->start = start;
+				job->end = end;
+			}
+
+			start = end;
+		}
+
+		jobTasks.setTaskPool(taskPool);
+
+		for( size_t i = 0; i < numJobs; i++ )
+			jobTasks.add(&jobs[i]->task);
+	}
+
+	// The first slice is updated by this thread.
+	updateRange( 0, firstEnd );
+
+	// Wait for the other slices, running the ones not started yet.
+	jobTasks.wait();
+
+	// Notify the changes in a batch, after all the slices are done.
+	changed.clear();
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		if( !(flags[i] & TransformFlags::Changed) ) continue;
+
+		flags[i] = (uint8) (flags[i] & ~TransformFlags::Changed);
+		changed.pushBack(transforms[i]);
+	}
+
+	if( changed.empty() ) return;
+
+	for( size_t i = 0; i < changed.size(); i++ )
+		changed[i]->onWorldChanged();
+
+	onTransformsChanged(changed);
+}
+
+//-----------------------------------//
+
+NAMESPACE_ENGINE_END
@@ -0,0 +1,235 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Engine/API.h"
+#include "Engine/Scene/SystemScheduler.h"
+#include "Engine/Scene/ComponentStorage.h"
+#include "Engine/Scene/Transform.h"
+#include "Engine/Scene/Geometry.h"
+#include "Core/Task.h"
+#include <UnitTest++.h>
+
+using namespace fld;
+
+namespace {
+
+class TestComponent : public Component
+{
+public:
+
+	TestComponent() : numUpdates(0) {}
+	virtual void update( float ) OVERRIDE {}
+
+	int32 numUpdates;
+};
+
+// Adds the components straight to the pools, without entities.
+class TestComponentStorage : public ComponentStorage
+{
+public:
+
+	~TestComponentStorage()
+	{
+		for( size_t i = 0; i < components.size(); i++ )
+			Deallocate(components[i]);
+	}
+
+	void addComponents( Class* klass, size_t count )
+	{
+		for( size_t i = 0; i < count; i++ )
+		{
+			TestComponent* component = AllocateHeap(TestComponent);
+			components.pushBack(component);
+
+			findPool(klass)->add(component, EntityHandleNull);
+		}
+	}
+
+	bool allUpdated( int32 numUpdates ) const
+	{
+		for( size_t i = 0; i < components.size(); i++ )
+		{
+			if( components[i]->numUpdates != numUpdates ) return false;
+		}
+
+		return true;
+	}
+
+	Array<TestComponent*> components;
+};
+
+// Logs its id when it begins and its negated id when it ends.
+class TestSystem : public SceneSystem
+{
+public:
+
+	TestSystem( Class* klass, int32 id, Array<int32>& events )
+		: SceneSystem(klass)
+		, id(id)
+		, events(events)
+	{
+	}
+
+	virtual void begin( float ) OVERRIDE
+	{
+		events.pushBack(id);
+	}
+
+	virtual void update( Component* const* components, size_t count, float ) OVERRIDE
+	{
+		for( size_t i = 0; i < count; i++ )
+			((TestComponent*) components[i])->numUpdates++;
+
+		numRanges.increment();
+		numComponents.add((int32) count);
+	}
+
+	virtual void end( float ) OVERRIDE
+	{
+		events.pushBack(-id);
+	}
+
+	int32 id;
+	Array<int32>& events;
+	Atomic<int32> numRanges;
+	Atomic<int32> numComponents;
+};
+
+int32 FindEvent( const Array<int32>& events, int32 event )
+{
+	for( size_t i = 0; i < events.size(); i++ )
+	{
+		if( events[i] == event ) return (int32) i;
+	}
+
+	return -1;
+}
+
+// Transforms are written in their stage and read by the geometries in
+// the update stage, and a third system conflicts with neither.
+void AddSystems( SystemScheduler& scheduler, Array<int32>& events )
+{
+	TestSystem* geometries = AllocateHeap(TestSystem, ReflectionGetType(Geometry), 1, events);
+	geometries->addRead( ReflectionGetType(Transform) );
+	scheduler.add(geometries);
+
+	TestSystem* transforms = AllocateHeap(TestSystem, ReflectionGetType(Transform), 2, events);
+	transforms->addWrite( ReflectionGetType(Transform) );
+	transforms->setStage( SystemStage::Transform );
+	transforms->setFlags( SystemFlags::Parallel );
+	scheduler.add(transforms);
+
+	TestSystem* other = AllocateHeap(TestSystem, nullptr, 3, events);
+	scheduler.add(other);
+}
+
+}
+
+SUITE(Engine)
+{
+	TEST(SystemSchedulerDependencies)
+	{
+		TaskPool pool(2);
+
+		TestComponentStorage storage;
+		storage.addComponents( ReflectionGetType(Transform), 1000 );
+		storage.addComponents( ReflectionGetType(Geometry), 1000 );
+
+		Array<int32> events;
+
+		SystemScheduler scheduler;
+		scheduler.setTaskPool(&pool);
+		AddSystems(scheduler, events);
+
+		CHECK( scheduler.getSystems()[0]->conflicts(scheduler.getSystems()[1]) );
+		CHECK( !scheduler.getSystems()[0]->conflicts(scheduler.getSystems()[2]) );
+
+		scheduler.update(storage, 0.1f);
+
+		// The geometries were added first but wait for the transforms.
+		CHECK_EQUAL( 6u, events.size() );
+		CHECK( FindEvent(events, -2) >= 0 );
+		CHECK( FindEvent(events, -2) < FindEvent(events, 1) );
+		CHECK( FindEvent(events, -3) >= 0 );
+		CHECK( storage.allUpdated(1) );
+
+		// The storage has no classes without a system.
+		CHECK_EQUAL( 3u, scheduler.getSystems().size() );
+	}
+
+	TEST(SystemSchedulerDeterministic)
+	{
+		TaskPool pool(2);
+
+		TestComponentStorage storage;
+		storage.addComponents( ReflectionGetType(Transform), 1000 );
+		storage.addComponents( ReflectionGetType(Geometry), 1000 );
+
+		Array<int32> events;
+
+		SystemScheduler scheduler;
+		scheduler.setTaskPool(&pool);
+		scheduler.setDeterministic(true);
+		AddSystems(scheduler, events);
+
+		scheduler.update(storage, 0.1f);
+
+		// The systems run one after the other in the order of the graph.
+		int32 expected[] = { 2, -2, 3, -3, 1, -1 };
+		CHECK_EQUAL( 6u, events.size() );
+		CHECK_ARRAY_EQUAL( expected, events.data(), 6 );
+
+		// The parallel system is not split in ranges.
+		TestSystem* transforms = (TestSystem*) scheduler.findSystem( ReflectionGetType(Transform) );
+		CHECK_EQUAL( 1, transforms->numRanges.read() );
+		CHECK_EQUAL( 1000, transforms->numComponents.read() );
+
+		events.clear();
+		scheduler.update(storage, 0.1f);
+
+		CHECK_EQUAL( 6u, events.size() );
+		CHECK_ARRAY_EQUAL( expected, events.data(), 6 );
+		CHECK( storage.allUpdated(2) );
+	}
+
+	TEST(SystemSchedulerParallelRanges)
+	{
+		TaskPool pool(2);
+
+		TestComponentStorage storage;
+		storage.addComponents( ReflectionGetType(Transform), 1000 );
+		storage.addComponents( ReflectionGetType(Geometry), 1000 );
+
+		Array<int32> events;
+
+		SystemScheduler scheduler;
+		scheduler.setTaskPool(&pool);
+		AddSystems(scheduler, events);
+
+		scheduler.update(storage, 0.1f);
+
+		// Both threads and the scheduler thread get a range each.
+		TestSystem* transforms = (TestSystem*) scheduler.findSystem( ReflectionGetType(Transform) );
+		CHECK_EQUAL( 3, transforms->numRanges.read() );
+		CHECK_EQUAL( 1000, transforms->numComponents.read() );
+
+		// Systems that are not parallel get a single range.
+		TestSystem* geometries = (TestSystem*) scheduler.findSystem( ReflectionGetType(Geometry) );
+		CHECK_EQUAL( 1, geometries->numRanges.read() );
+		CHECK_EQUAL( 1000, geometries->numComponents.read() );
+
+		CHECK( storage.allUpdated(1) );
+
+		// Too few components for more than one range.
+		TestComponentStorage small;
+		small.addComponents( ReflectionGetType(Transform), 100 );
+
+		scheduler.update(small, 0.1f);
+		CHECK_EQUAL( 4, transforms->numRanges.read() );
+		CHECK( small.allUpdated(1) );
+	}
+}
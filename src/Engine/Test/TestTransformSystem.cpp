@@ -0,0 +1,162 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Engine/API.h"
+#include "Engine/Scene/Transform.h"
+#include "Engine/Scene/TransformSystem.h"
+#include <UnitTest++.h>
+
+using namespace fld;
+
+namespace {
+
+// Checks the hierarchy arrays that the update relies on.
+class TestTransformSystem : public TransformSystem
+{
+public:
+
+	bool isConsistent()
+	{
+		size_t count = transforms.size();
+
+		for( size_t i = 0; i < count; i++ )
+		{
+			if( transforms[i]->getSystem() != this ) return false;
+
+			int32 children = 0;
+			int32 size = 1;
+
+			for( size_t j = 0; j < count; j++ )
+			{
+				if( parents[j] == (int32) i ) children++;
+
+				// The subtree of each transform follows it.
+				for( int32 p = parents[j]; p != -1; p = parents[p] )
+				{
+					if( p == (int32) i ) size++;
+				}
+			}
+
+			if( numChildren[i] != children ) return false;
+			if( !needsSort && subtreeSizes[i] != size ) return false;
+			if( !needsSort && parents[i] >= (int32) i ) return false;
+		}
+
+		return true;
+	}
+};
+
+Vector3 GetWorldPosition(Transform* transform)
+{
+	const Matrix4x3& world = transform->getAbsoluteTransform();
+	return Vector3(world.tx, world.ty, world.tz);
+}
+
+}
+
+SUITE(Engine)
+{
+	TEST(TransformSystemHierarchy)
+	{
+		TestTransformSystem system;
+
+		TransformPtr a = TransformCreate(AllocatorGetHeap());
+		TransformPtr b = TransformCreate(AllocatorGetHeap());
+		TransformPtr c = TransformCreate(AllocatorGetHeap());
+
+		system.add(a.get());
+		system.add(b.get());
+		system.add(c.get());
+
+		CHECK( b->setParent(a.get()) );
+		CHECK( c->setParent(b.get()) );
+		CHECK( !a->setParent(c.get()) );
+
+		a->setPosition( Vector3(1.0f, 0.0f, 0.0f) );
+		b->setPosition( Vector3(0.0f, 1.0f, 0.0f) );
+		c->setPosition( Vector3(0.0f, 0.0f, 1.0f) );
+
+		system.update();
+		CHECK( system.isConsistent() );
+		CHECK( GetWorldPosition(c.get()) == Vector3(1.0f, 1.0f, 1.0f) );
+
+		// The children move with their parents.
+		a->setPosition( Vector3(2.0f, 0.0f, 0.0f) );
+		system.update();
+		CHECK( GetWorldPosition(c.get()) == Vector3(2.0f, 1.0f, 1.0f) );
+
+		// Reparenting moves the transform to the new parent.
+		CHECK( c->setParent(a.get()) );
+		system.update();
+		CHECK( system.isConsistent() );
+		CHECK( GetWorldPosition(c.get()) == Vector3(2.0f, 0.0f, 1.0f) );
+
+		CHECK( c->setParent(nullptr) );
+		system.update();
+		CHECK( system.isConsistent() );
+		CHECK( GetWorldPosition(c.get()) == Vector3(0.0f, 0.0f, 1.0f) );
+	}
+
+	TEST(TransformSystemRemove)
+	{
+		TestTransformSystem system;
+
+		TransformPtr root = TransformCreate(AllocatorGetHeap());
+		TransformPtr child = TransformCreate(AllocatorGetHeap());
+		TransformPtr leaf = TransformCreate(AllocatorGetHeap());
+
+		system.add(root.get());
+		system.add(child.get());
+		system.add(leaf.get());
+
+		child->setParent(root.get());
+		leaf->setParent(child.get());
+		root->setPosition( Vector3(1.0f, 0.0f, 0.0f) );
+		leaf->setPosition( Vector3(0.0f, 0.0f, 1.0f) );
+
+		system.update();
+		CHECK( system.isConsistent() );
+		CHECK( GetWorldPosition(leaf.get()) == Vector3(1.0f, 0.0f, 1.0f) );
+
+		// The leaf is the last row and has a parent, so removing it has
+		// to shrink the subtrees of its ancestors.
+		leaf = nullptr;
+		CHECK_EQUAL( 2u, system.getNumTransforms() );
+		CHECK( system.isConsistent() );
+
+		system.update();
+		CHECK( system.isConsistent() );
+
+		// Removing a parent turns its children into roots.
+		TransformPtr grandchild = TransformCreate(AllocatorGetHeap());
+		system.add(grandchild.get());
+		CHECK( grandchild->setParent(child.get()) );
+		grandchild->setPosition( Vector3(0.0f, 1.0f, 0.0f) );
+
+		system.update();
+		CHECK( GetWorldPosition(grandchild.get()) == Vector3(1.0f, 1.0f, 0.0f) );
+
+		child = nullptr;
+		CHECK( system.isConsistent() );
+
+		system.update();
+		CHECK( system.isConsistent() );
+		CHECK( grandchild->getSystem() == &system );
+		CHECK( GetWorldPosition(grandchild.get()) == Vector3(0.0f, 1.0f, 0.0f) );
+
+		// Adding after removing keeps the rows valid.
+		TransformPtr added = TransformCreate(AllocatorGetHeap());
+		system.add(added.get());
+		CHECK( added->setParent(grandchild.get()) );
+		added->setPosition( Vector3(0.0f, 0.0f, 1.0f) );
+
+		system.update();
+		CHECK( system.isConsistent() );
+		CHECK_EQUAL( 3u, system.getNumTransforms() );
+		CHECK( GetWorldPosition(added.get()) == Vector3(0.0f, 1.0f, 1.0f) );
+	}
+}
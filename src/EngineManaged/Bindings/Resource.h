@@ -27,7 +27,8 @@ namespace Flood
         Error = 0,
         Unloaded = 1,
         Loading = 2,
-        Loaded = 3
+        Loaded = 3,
+        Evicted = 4
     };
 
     /// <summary>
@@ -74,6 +74,7 @@ void Game::init()
 
 	RenderDevice * dev = engine->getRenderDevice();
 	dev->setRenderTarget( window );
+	dev->setFrameStatistics( &frameStats );
 
 	RenderContext * context = window->getContext();
 	assert( context != nullptr );
@@ -232,8 +232,11 @@ void BindGenericVertexBufferDeclarations(VertexBuffer* vb)
 		bool normalized = decl.type == VertexDataType::Byte 
 			&& decl.attribute == VertexAttribute::Color;
 
+		// Streamed and pooled data starts at its offset in the shared storage.
+		uintptr_t offset = decl.offset + vb->offset;
+
 		glVertexAttribPointer(index, decl.components, type, normalized,
-			decl.stride, (void*) decl.offset );
+			decl.stride, (void*) offset );
 
 		CheckLastErrorGL("Error binding pointers to buffer");
 	}
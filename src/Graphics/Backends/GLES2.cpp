@@ -13,6 +13,7 @@
 #include "Graphics/RenderBackend.h"
 #include "Graphics/RenderCapabilities.h"
 #include "Graphics/VertexBuffer.h"
+#include "Graphics/BufferManager.h"
 #include "Graphics/RenderBuffer.h"
 #include "Graphics/Texture.h"
 #include "Graphics/RenderBatch.h"
@@ -21,7 +22,9 @@
 #include "GL.h"
 #include "GLSL_Shader.h"
 #include "GLSL_ShaderProgram.h"
+#include "GLSL_ProgramCache.h"
 #include "GL_RenderBuffer.h"
+#include "GL_StreamBuffer.h"
 
 NAMESPACE_GRAPHICS_BEGIN
 
@@ -31,11 +34,25 @@ class RenderBackendGLES2 : public RenderBackend
 {
 public:
 
+	RenderBackendGLES2()
+		: supportsUniformBuffers(false)
+		, supportsInstancing(false)
+		, instanceBuffer(0)
+		, instanceBufferSize(0)
+		, streamVertices(GL_ARRAY_BUFFER)
+		, streamIndices(GL_ELEMENT_ARRAY_BUFFER)
+		, boundIndexBuffer(nullptr)
+		, boundArrayBuffer(0)
+		, boundElementBuffer(0)
+	{}
+
 	bool init() OVERRIDE;
 	void cleanup() OVERRIDE;
 	void checkCapabilities(RenderCapabilities*) OVERRIDE;
+	void endFrame() OVERRIDE;
 	
 	void renderBatch(RenderBatch*) OVERRIDE;
+	void renderBatchInstanced(RenderBatch*, const Matrix4x4*, uint32) OVERRIDE;
 	void setupRenderState( const RenderState&, bool bindUniforms ) OVERRIDE;
 	void unsetupRenderState( const RenderState& ) OVERRIDE;
 	void setupRenderView(RenderView*) OVERRIDE;
@@ -67,6 +84,9 @@ public:
 	Texture* createTexture() OVERRIDE;
 	void releaseTexture(Texture*) OVERRIDE;
 	void uploadTexture(Texture*) OVERRIDE;
+	void uploadTextureMip(Texture*, uint8 level, uint32 width, uint32 height,
+		const uint8* data) OVERRIDE;
+	void releaseTextureMips(Texture*, uint8 level) OVERRIDE;
 	void configureTexture(Texture*) OVERRIDE;
 	void bindTexture(Texture*) OVERRIDE;
 	void unbindTexture(Texture*) OVERRIDE;
@@ -81,8 +101,52 @@ public:
 	ShaderProgram* createShader() OVERRIDE;
 	void releaseShader(ShaderProgram*) OVERRIDE;
 	void compileShader(ShaderProgram*) OVERRIDE;
+
+	// Programs use std140 uniform blocks when this is supported.
+	bool supportsUniformBuffers;
+
+	// Stream buffer with the instance data of the instanced draws.
+	bool supportsInstancing;
+	GLuint instanceBuffer;
+	GLsizeiptr instanceBufferSize;
+
+	// Ring buffers that the dynamic geometry is streamed to.
+	GL_StreamBuffer streamVertices;
+	GL_StreamBuffer streamIndices;
+
+	// Uploads the data to the stream buffer.
+	bool writeStream(GL_StreamBuffer& stream, Buffer* buffer, const Array<uint8>& data,
+		uint32 align);
+
+	// Uploads the data to the buffer storage, only the changed range if
+	// the storage does not need to be reallocated.
+	void writeStorage(GLenum target, Buffer* buffer, const Array<uint8>& data,
+		uint32 dirtyOffset, uint32 dirtySize, bool isDirtyRange);
+
+	// Gets the byte offset of the indices of the batch.
+	const GLvoid* getIndexOffset(RenderBatch* batch, int& numIndices);
+
+	// Gets the GL buffer that holds the data of the buffer.
+	GLuint getStorageId(const Buffer* buffer, const GL_StreamBuffer& stream) const;
+
+	// Binds the GL buffer unless it is already bound to the target.
+	void bindBufferGL(GLenum target, GLuint id);
+
+	// Cache of the binaries of the linked programs.
+	GLSL_ProgramCache programCache;
+
+	// Index buffer bound to the context.
+	IndexBuffer* boundIndexBuffer;
+
+	// GL buffers bound to the array and element array targets.
+	GLuint boundArrayBuffer;
+	GLuint boundElementBuffer;
 };
 
+// Sizes of the vertex and index stream buffers.
+static const uint32 StreamVertexBufferSize = 4 << 20;
+static const uint32 StreamIndexBufferSize = 1 << 20;
+
 //-----------------------------------//
 
 RenderBackend* RenderCreateBackendGLES2()
@@ -111,6 +175,19 @@ bool RenderBackendGLES2::init()
 	glEnable( GL_DEPTH_TEST );
 	glEnable( GL_CULL_FACE );
 
+	// Dynamic geometry is streamed through unsynchronized mappings, so
+	// fences are needed to know when the GPU is done with the data.
+	if( GLEW_ARB_map_buffer_range && GLEW_ARB_sync )
+	{
+		streamVertices.create(StreamVertexBufferSize);
+		streamIndices.create(StreamIndexBufferSize);
+	}
+
+	programCache.init();
+
+	if( programCache.enabled )
+		LogInfo( "Caching program binaries in '%s'", programCache.getDirectory().c_str() );
+
     return true;
 }
 
@@ -118,6 +195,22 @@ bool RenderBackendGLES2::init()
 
 void RenderBackendGLES2::cleanup()
 {
+	if( instanceBuffer )
+		glDeleteBuffers( 1, &instanceBuffer );
+
+	instanceBuffer = 0;
+	instanceBufferSize = 0;
+
+	streamVertices.destroy();
+	streamIndices.destroy();
+}
+
+//-----------------------------------//
+
+void RenderBackendGLES2::endFrame()
+{
+	streamVertices.endFrame();
+	streamIndices.endFrame();
 }
 
 //-----------------------------------//
@@ -180,26 +273,108 @@ void RenderBackendGLES2::renderBatch(RenderBatch* batch)
 
 	GLenum indexType = (gb->indexSize == 16) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
 
-	int numIndices = batch->range.end - batch->range.start;
-	if (numIndices > 0)
+	int numIndices;
+	const GLvoid* offset = getIndexOffset(batch, numIndices);
+
+	glDrawElements( primitiveType, numIndices, indexType, offset );
+	CheckLastErrorGL("Error drawing index buffer");
+
+	if( rasterMode != PrimitiveRasterMode::Solid )
+	{
+		// Restore the polygon rendering mode.
+		GLenum mode = ConvertPrimitiveRasterGL(PrimitiveRasterMode::Solid);
+		glPolygonMode( GL_FRONT_AND_BACK, mode );
+	}
+}
+
+//-----------------------------------//
+
+const GLvoid* RenderBackendGLES2::getIndexOffset(RenderBatch* batch, int& numIndices)
+{
+	const GeometryBuffer* gb = batch->getGeometryBuffer().get();
+	uint32 indexBytes = gb->indexSize / 8;
+
+	// Streamed and pooled indices start at their offset in the shared
+	// storage, else the offset is zero.
+	uintptr_t offset = 0;
+
+	if( boundIndexBuffer )
+		offset = boundIndexBuffer->offset;
+
+	numIndices = batch->range.end - batch->range.start;
+
+	if( numIndices > 0 )
+		offset += batch->range.start * indexBytes;
+	else
+		numIndices = gb->indexData.size() / indexBytes;
+
+	return (const GLvoid*) offset;
+}
+
+//-----------------------------------//
+
+void RenderBackendGLES2::renderBatchInstanced(RenderBatch* batch,
+	const Matrix4x4* matrices, uint32 count)
+{
+	if( !supportsInstancing || count == 0 ) return;
+
+	if( !instanceBuffer )
 	{
-		glDrawElements( primitiveType, numIndices, indexType,
-			(const GLvoid*) (batch->range.start * (gb->indexSize / 8)) );
-		CheckLastErrorGL("Error drawing index buffer");
+		glGenBuffers( 1, &instanceBuffer );
+		CheckLastErrorGL("Error generating the instance buffer");
+	}
+
+	GLuint meshBuffer = boundArrayBuffer;
+	bindBufferGL( GL_ARRAY_BUFFER, instanceBuffer );
+
+	// Orphan the storage so the driver does not have to wait for the
+	// draws that are still using the instance data of the last frame.
+	GLsizeiptr size = count * sizeof(Matrix4x4);
+	
+	if( size > instanceBufferSize )
+		instanceBufferSize = size;
+
+	glBufferData( GL_ARRAY_BUFFER, instanceBufferSize, nullptr, GL_STREAM_DRAW );
+	glBufferSubData( GL_ARRAY_BUFFER, 0, size, matrices );
+	CheckLastErrorGL("Could not upload the instance data");
+
+	GLuint location = (GLuint) VertexAttribute::InstanceMatrix;
+
+	for( GLuint i = 0; i < 4; i++ )
+	{
+		glEnableVertexAttribArray( location + i );
+		glVertexAttribPointer( location + i, 4, GL_FLOAT, GL_FALSE,
+			sizeof(Matrix4x4), (const GLvoid*) (i * 4 * sizeof(float)) );
+		glVertexAttribDivisorARB( location + i, 1 );
+	}
+
+	// The mesh attributes keep pointing to the mesh buffer.
+	bindBufferGL( GL_ARRAY_BUFFER, meshBuffer );
+
+	GLenum primitiveType = ConvertPrimitiveGL( batch->getPrimitiveType() );
+	const GeometryBuffer* gb = batch->getGeometryBuffer().get();
+
+	if( !gb->isIndexed() )
+	{
+		GLsizei numVertices = gb->getNumVertices();
+		glDrawArraysInstancedARB( primitiveType, batch->range.start, numVertices, count );
 	}
 	else
 	{
-		numIndices = gb->indexData.size() / (gb->indexSize / 8);
+		GLenum indexType = (gb->indexSize == 16) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
 
-		glDrawElements( primitiveType, numIndices, indexType, 0 );
-		CheckLastErrorGL("Error drawing index buffer");
+		int numIndices;
+		const GLvoid* offset = getIndexOffset(batch, numIndices);
+
+		glDrawElementsInstancedARB( primitiveType, numIndices, indexType, offset, count );
 	}
 
-	if( rasterMode != PrimitiveRasterMode::Solid )
+	CheckLastErrorGL("Error drawing instanced batch");
+
+	for( GLuint i = 0; i < 4; i++ )
 	{
-		// Restore the polygon rendering mode.
-		GLenum mode = ConvertPrimitiveRasterGL(PrimitiveRasterMode::Solid);
-		glPolygonMode( GL_FRONT_AND_BACK, mode );
+		glVertexAttribDivisorARB( location + i, 0 );
+		glDisableVertexAttribArray( location + i );
 	}
 }
 
@@ -298,6 +473,11 @@ void RenderBackendGLES2::checkCapabilities(RenderCapabilities* caps)
 	caps->supportsShaders = !! GLEW_ARB_shading_language_100;
 	caps->supportsVertexBuffers = !! GLEW_ARB_vertex_buffer_object;
 	caps->supportsAnisotropic = !! GLEW_EXT_texture_filter_anisotropic;
+	caps->supportsUniformBuffers = !! GLEW_ARB_uniform_buffer_object;
+	caps->supportsInstancing = GLEW_ARB_draw_instanced && GLEW_ARB_instanced_arrays;
+
+	supportsUniformBuffers = caps->supportsUniformBuffers;
+	supportsInstancing = caps->supportsInstancing;
 	
 	glGetIntegerv( GL_MAX_TEXTURE_SIZE, (GLint*) &caps->maxTextureSize );
 	glGetIntegerv( GL_MAX_TEXTURE_IMAGE_UNITS, (GLint*) &caps->maxTextureUnits );
@@ -350,6 +530,10 @@ VertexBuffer* RenderBackendGLES2::createVertexBuffer()
 
 void RenderBackendGLES2::releaseVertexBuffer(VertexBuffer* vb)
 {
+	// Deleting a buffer unbinds it.
+	if( boundArrayBuffer == vb->id )
+		boundArrayBuffer = 0;
+
 	glDeleteBuffers( 1, (GLuint*) &vb->id );
 	CheckLastErrorGL("Error deleting buffer");
 }
@@ -358,7 +542,8 @@ void RenderBackendGLES2::releaseVertexBuffer(VertexBuffer* vb)
 
 void RenderBackendGLES2::bindVertexBuffer(VertexBuffer* vb)
 {
-	glBindBuffer( GL_ARRAY_BUFFER, vb->id );
+	// Buffers that share the same storage do not need to be rebound.
+	bindBufferGL( GL_ARRAY_BUFFER, getStorageId(vb, streamVertices) );
 	CheckLastErrorGL("Error binding vertex buffer");
 }
 
@@ -366,7 +551,7 @@ void RenderBackendGLES2::bindVertexBuffer(VertexBuffer* vb)
 
 void RenderBackendGLES2::unbindVertexBuffer(VertexBuffer* vb)
 {
-	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	bindBufferGL( GL_ARRAY_BUFFER, 0 );
 	CheckLastErrorGL("Error unbinding vertex buffer");
 }
 
@@ -379,18 +564,126 @@ void RenderBackendGLES2::buildVertexBuffer(VertexBuffer* vb)
 
 	const Array<uint8>& data = gb->data;
 	if( data.empty() ) return;
-	
+
+	// Dynamic geometry is written to the stream buffer every time it
+	// changes, instead of reallocating the storage of the buffer.
+	if( gb->usage == BufferUsage::Dynamic
+		&& writeStream(streamVertices, vb, data, sizeof(float)) )
+	{
+		vb->built = true;
+		unbindVertexBuffer(vb);
+		return;
+	}
+
+	if( vb->isStreamed )
+	{
+		vb->isStreamed = false;
+		vb->offset = 0;
+	}
+
 	bindVertexBuffer(vb);
 
+	uint32 dirtyOffset, dirtySize;
+	bool isDirtyRange = gb->getDirtyRange(vb->size, dirtyOffset, dirtySize);
+
+	writeStorage(GL_ARRAY_BUFFER, vb, data, dirtyOffset, dirtySize, isDirtyRange);
+	vb->built = true;
+
+	unbindVertexBuffer(vb);
+}
+
+//-----------------------------------//
+
+bool RenderBackendGLES2::writeStream(GL_StreamBuffer& stream, Buffer* buffer,
+	const Array<uint8>& data, uint32 align)
+{
+	if( !stream.id ) return false;
+
+	bindBufferGL( stream.target, stream.id );
+
+	uint32 offset;
+
+	if( !stream.write(data.data(), data.size(), align, offset) )
+		return false;
+
+	buffer->isStreamed = true;
+	buffer->offset = offset;
+
+	return true;
+}
+
+//-----------------------------------//
+
+void RenderBackendGLES2::writeStorage(GLenum target, Buffer* buffer, const Array<uint8>& data,
+	uint32 dirtyOffset, uint32 dirtySize, bool isDirtyRange)
+{
+	const GeometryBuffer* gb = buffer->getGeometryBuffer();
+	BufferArena* arena = buffer->arena;
+
+	if( arena )
+	{
+		// The arena storage is allocated by the first buffer built in it.
+		Buffer* storage = arena->storage;
+
+		if( storage->size == 0 )
+		{
+			glBufferData( target, arena->capacity, nullptr, GL_STATIC_DRAW );
+			CheckLastErrorGL("Could not allocate storage for buffer arena");
+
+			storage->size = arena->capacity;
+		}
+
+		if( !isDirtyRange )
+		{
+			dirtyOffset = 0;
+			dirtySize = data.size();
+		}
+
+		glBufferSubData( target, buffer->offset + dirtyOffset, dirtySize,
+			data.data() + dirtyOffset );
+		CheckLastErrorGL("Could not update buffer arena data");
+		return;
+	}
+
+	if( isDirtyRange )
+	{
+		// Only upload the bytes that changed.
+		glBufferSubData( target, dirtyOffset, dirtySize, data.data() + dirtyOffset );
+		CheckLastErrorGL("Could not update buffer data");
+		return;
+	}
+
 	GLenum usage = ConvertBufferGL(gb->usage, gb->access);
 
-	// Upload all the vertex elements.
-	glBufferData( GL_ARRAY_BUFFER, data.size(), data.data(), usage );
+	glBufferData( target, data.size(), data.data(), usage );
 	CheckLastErrorGL("Could not allocate storage for buffer");
 
-	vb->built = true;
+	buffer->size = data.size();
+}
 
-	unbindVertexBuffer(vb);
+//-----------------------------------//
+
+GLuint RenderBackendGLES2::getStorageId(const Buffer* buffer,
+	const GL_StreamBuffer& stream) const
+{
+	if( buffer->isStreamed )
+		return stream.id;
+
+	if( buffer->arena )
+		return buffer->arena->storage->id;
+
+	return buffer->id;
+}
+
+//-----------------------------------//
+
+void RenderBackendGLES2::bindBufferGL(GLenum target, GLuint id)
+{
+	GLuint& bound = (target == GL_ARRAY_BUFFER) ? boundArrayBuffer : boundElementBuffer;
+	if( bound == id ) return;
+
+	glBindBuffer( target, id );
+	bound = id;
 }
 
 //-----------------------------------//
@@ -417,6 +710,12 @@ IndexBuffer* RenderBackendGLES2::createIndexBuffer()
 
 void RenderBackendGLES2::releaseIndexBuffer(IndexBuffer* ib)
 {
+	if( boundElementBuffer == ib->id )
+		boundElementBuffer = 0;
+
+	if( boundIndexBuffer == ib )
+		boundIndexBuffer = nullptr;
+
 	glDeleteBuffers( 1, (GLuint*) &ib->id );
 	CheckLastErrorGL("Error deleting index buffer");
 }
@@ -425,7 +724,8 @@ void RenderBackendGLES2::releaseIndexBuffer(IndexBuffer* ib)
 
 void RenderBackendGLES2::bindIndexBuffer(IndexBuffer* ib)
 {
-	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, ib->id );
+	bindBufferGL( GL_ELEMENT_ARRAY_BUFFER, getStorageId(ib, streamIndices) );
+	boundIndexBuffer = ib;
 	CheckLastErrorGL( "Error binding index buffer" );
 }
 
@@ -433,7 +733,8 @@ void RenderBackendGLES2::bindIndexBuffer(IndexBuffer* ib)
 
 void RenderBackendGLES2::unbindIndexBuffer(IndexBuffer* ib)
 {
-	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+	bindBufferGL( GL_ELEMENT_ARRAY_BUFFER, 0 );
+	boundIndexBuffer = nullptr;
 	CheckLastErrorGL( "Error unbinding index buffer" );
 }
 
@@ -446,18 +747,30 @@ void RenderBackendGLES2::buildIndexBuffer(IndexBuffer* ib)
 
 	assert( gb->isIndexed() );
 
-	GLsizeiptr indexSize = gb->indexData.size();
-	if( indexSize == 0 ) return;
+	const Array<uint8>& data = gb->indexData;
+	if( data.empty() ) return;
 
-	bindIndexBuffer(ib);
+	if( gb->usage == BufferUsage::Dynamic
+		&& writeStream(streamIndices, ib, data, sizeof(uint32)) )
+	{
+		// Writing bound the stream buffer.
+		boundIndexBuffer = ib;
+		ib->isBuilt = true;
+		return;
+	}
+
+	if( ib->isStreamed )
+	{
+		ib->isStreamed = false;
+		ib->offset = 0;
+	}
 
-	const GLvoid* data = &gb->indexData.front();
+	bindIndexBuffer(ib);
 
-	// Reserve space for all the buffer elements.
-	GLenum usage = ConvertBufferGL(gb->getBufferUsage(), gb->getBufferAccess());
-	glBufferData( GL_ELEMENT_ARRAY_BUFFER, indexSize, data, usage );
-	CheckLastErrorGL("Could not buffer data in index buffer");
+	uint32 dirtyOffset, dirtySize;
+	bool isDirtyRange = gb->getIndexDirtyRange(ib->size, dirtyOffset, dirtySize);
 
+	writeStorage(GL_ELEMENT_ARRAY_BUFFER, ib, data, dirtyOffset, dirtySize, isDirtyRange);
 	ib->isBuilt = true;
 }
 
@@ -567,6 +880,13 @@ void RenderBackendGLES2::uploadTexture(Texture* tex)
 
 	CheckLastErrorGL("Could not upload pixel data to texture object");
 
+	// Sample from the first level again if the texture was streamed.
+	if( tex->residentMip != 0 )
+		glTexParameteri( target, GL_TEXTURE_BASE_LEVEL, 0 );
+
+	tex->numMips = 1;
+	tex->residentMip = 0;
+
 	unbindTexture(tex);
 
 	tex->setUploaded();
@@ -574,6 +894,62 @@ void RenderBackendGLES2::uploadTexture(Texture* tex)
 
 //-----------------------------------//
 
+void RenderBackendGLES2::uploadTextureMip(Texture* tex, uint8 level, uint32 width,
+	uint32 height, const uint8* data)
+{
+	bindTexture(tex);
+
+	GLint target = ConvertTextureTargetGL(tex->target);
+	GLint internalFormat = ConvertTextureInternalFormatGL(tex->format);
+	GLint sourceFormat = ConvertTextureSourceFormatGL(tex->format);
+
+	// The rows of the small levels are not aligned to 4 bytes.
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+
+	glTexImage2D( target, level, internalFormat, width, height, 0,
+		sourceFormat, GL_UNSIGNED_BYTE, data );
+
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+
+	CheckLastErrorGL("Could not upload pixel data to texture mip level");
+
+	// Only sample the levels that are uploaded so far.
+	glTexParameteri( target, GL_TEXTURE_BASE_LEVEL, level );
+	glTexParameteri( target, GL_TEXTURE_MAX_LEVEL, tex->numMips - 1 );
+
+	glTexParameteri( target, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri( target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST );
+
+	unbindTexture(tex);
+}
+
+//-----------------------------------//
+
+void RenderBackendGLES2::releaseTextureMips(Texture* tex, uint8 level)
+{
+	bindTexture(tex);
+
+	GLint target = ConvertTextureTargetGL(tex->target);
+	GLint internalFormat = ConvertTextureInternalFormatGL(tex->format);
+	GLint sourceFormat = ConvertTextureSourceFormatGL(tex->format);
+
+	// Sample from the level before the storage of the others goes away.
+	glTexParameteri( target, GL_TEXTURE_BASE_LEVEL, level );
+
+	// Empty levels give their storage back to the driver.
+	for( uint8 i = tex->residentMip; i < level; i++ )
+	{
+		glTexImage2D( target, i, internalFormat, 0, 0, 0,
+			sourceFormat, GL_UNSIGNED_BYTE, nullptr );
+	}
+
+	CheckLastErrorGL("Could not release texture mip levels");
+
+	unbindTexture(tex);
+}
+
+//-----------------------------------//
+
 void RenderBackendGLES2::configureTexture(Texture* tex)
 {
 	bindTexture(tex);
@@ -635,7 +1011,9 @@ Image* RenderBackendGLES2::readTexture(Texture* tex)
 
 ShaderProgram* RenderBackendGLES2::createProgram()
 {
-	ShaderProgram* program = AllocateGraphics(GLSL_ShaderProgram);
+	GLSL_ShaderProgram* program = AllocateGraphics(GLSL_ShaderProgram);
+	program->useUniformBlocks = supportsUniformBuffers;
+	program->cache = programCache.enabled ? &programCache : nullptr;
 	return program;
 }
 
@@ -643,7 +1021,9 @@ ShaderProgram* RenderBackendGLES2::createProgram()
 
 ShaderProgram* RenderBackendGLES2::createShader()
 {
-	ShaderProgram* shader = AllocateGraphics(GLSL_ShaderProgram);
+	GLSL_ShaderProgram* shader = AllocateGraphics(GLSL_ShaderProgram);
+	shader->useUniformBlocks = supportsUniformBuffers;
+	shader->cache = programCache.enabled ? &programCache : nullptr;
 	return shader;
 }
 
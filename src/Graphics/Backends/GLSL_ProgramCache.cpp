@@ -0,0 +1,207 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Graphics/API.h"
+
+#ifdef ENABLE_RENDERER_OPENGL_GLSL
+
+#include "GLSL_ProgramCache.h"
+#include "GLSL_ShaderProgram.h"
+#include "Core/Stream.h"
+#include "Core/Math/Hash.h"
+#include "Core/Utilities.h"
+#include "Core/Log.h"
+
+NAMESPACE_GRAPHICS_BEGIN
+
+//-----------------------------------//
+
+// Identifies the files of the cache.
+static const uint32 ProgramCacheMagic = 0x42505846; // "FXPB"
+
+// Needs to change when the programs are built differently, for example
+// when the default attributes change, so the old binaries are rebuilt.
+static const uint32 ProgramCacheVersion = 1;
+
+struct GLSL_ProgramBinaryHeader
+{
+	uint32 magic;
+	uint32 version;
+	uint64 driverHash;
+	uint64 sourceHash;
+	uint32 format;
+	uint32 size;
+};
+
+//-----------------------------------//
+
+GLSL_ProgramCache::GLSL_ProgramCache()
+	: enabled(false)
+	, driverHash(0)
+	, numLoaded(0)
+	, numSaved(0)
+	, directory("ShaderCache/")
+{
+}
+
+//-----------------------------------//
+
+void GLSL_ProgramCache::init()
+{
+	enabled = false;
+
+	if( !GLEW_ARB_get_program_binary )
+		return;
+
+	GLint numFormats = 0;
+	glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats );
+
+	// Some drivers expose the extension without any binary format.
+	if( numFormats == 0 )
+		return;
+
+	const char* strings[] =
+	{
+		(const char*) glGetString(GL_VENDOR),
+		(const char*) glGetString(GL_RENDERER),
+		(const char*) glGetString(GL_VERSION)
+	};
+
+	driverHash = ProgramCacheVersion;
+
+	for( size_t i = 0; i < FLD_ARRAY_SIZE(strings); i++ )
+	{
+		const char* str = strings[i];
+		if( !str ) continue;
+
+		driverHash = MurmurHash64(str, strlen(str), driverHash);
+	}
+
+	if( !FileCreateDirectory(directory) )
+	{
+		LogWarn( "Could not create program cache directory '%s'", directory.c_str() );
+		return;
+	}
+
+	enabled = true;
+}
+
+//-----------------------------------//
+
+uint64 GLSL_ProgramCache::getSourceHash(GLSL_ShaderProgram* program) const
+{
+	const String& vertex = program->getVertexShader()->getText();
+	const String& fragment = program->getFragmentShader()->getText();
+
+	uint64 hash = MurmurHash64(vertex.c_str(), vertex.size(), ProgramCacheVersion);
+	return MurmurHash64(fragment.c_str(), fragment.size(), hash);
+}
+
+//-----------------------------------//
+
+String GLSL_ProgramCache::getPath(uint64 sourceHash) const
+{
+	return directory + StringFormat("%08x%08x.bin",
+		(uint32) (sourceHash >> 32), (uint32) sourceHash);
+}
+
+//-----------------------------------//
+
+bool GLSL_ProgramCache::load(GLSL_ShaderProgram* program)
+{
+	if( !enabled ) return false;
+
+	uint64 sourceHash = getSourceHash(program);
+
+	FileStream stream(getPath(sourceHash), StreamOpenMode::Read);
+	if( !stream.isValid ) return false;
+
+	GLSL_ProgramBinaryHeader header;
+
+	if( stream.read(&header, sizeof(header)) != sizeof(header) )
+		return false;
+
+	// Binaries of other drivers are rebuilt and overwritten.
+	if( header.magic != ProgramCacheMagic || header.version != ProgramCacheVersion
+		|| header.driverHash != driverHash || header.sourceHash != sourceHash )
+		return false;
+
+	Array<uint8> binary;
+	binary.resize(header.size);
+
+	if( stream.read(binary.data(), header.size) != (int64) header.size )
+		return false;
+
+	glProgramBinary( program->id, header.format, binary.data(), header.size );
+
+	// The driver can reject a binary it built, for example after the
+	// state it depends on changed.
+	GLint status = GL_FALSE;
+	glGetProgramiv( program->id, GL_LINK_STATUS, &status );
+
+	if( status != GL_TRUE )
+		return false;
+
+	numLoaded++;
+	return true;
+}
+
+//-----------------------------------//
+
+void GLSL_ProgramCache::save(GLSL_ShaderProgram* program)
+{
+	if( !enabled ) return;
+
+	GLint size = 0;
+	glGetProgramiv( program->id, GL_PROGRAM_BINARY_LENGTH, &size );
+	if( size <= 0 ) return;
+
+	Array<uint8> binary;
+	binary.resize(size);
+
+	GLsizei length = 0;
+	GLenum format = 0;
+	glGetProgramBinary( program->id, size, &length, &format, binary.data() );
+
+	if( CheckLastErrorGL("Could not get program binary") || length <= 0 )
+	{
+		LogWarn( "Could not get program binary to cache" );
+		return;
+	}
+
+	GLSL_ProgramBinaryHeader header;
+	header.magic = ProgramCacheMagic;
+	header.version = ProgramCacheVersion;
+	header.driverHash = driverHash;
+	header.sourceHash = getSourceHash(program);
+	header.format = format;
+	header.size = length;
+
+	String path = getPath(header.sourceHash);
+	FileStream stream(path, StreamOpenMode::Write);
+
+	if( !stream.isValid )
+	{
+		LogWarn( "Could not open program binary '%s' for writing", path.c_str() );
+		return;
+	}
+
+	if( stream.write(&header, sizeof(header)) != sizeof(header)
+		|| stream.write(binary.data(), length) != (int64) length )
+	{
+		LogWarn( "Could not write program binary '%s'", path.c_str() );
+		return;
+	}
+
+	numSaved++;
+}
+
+//-----------------------------------//
+
+NAMESPACE_GRAPHICS_END
+
+#endif
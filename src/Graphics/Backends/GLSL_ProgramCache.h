@@ -0,0 +1,69 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Graphics/API.h"
+#include "GL.h"
+
+NAMESPACE_GRAPHICS_BEGIN
+
+//-----------------------------------//
+
+class GLSL_ShaderProgram;
+
+/**
+ * Caches the binaries of the linked programs on disk, so the next runs
+ * can load them instead of compiling and linking the shaders again. The
+ * binaries are keyed by a hash of the shader sources, and store a hash
+ * of the driver that built them, since other drivers or driver versions
+ * can not load them.
+ */
+
+class GLSL_ProgramCache
+{
+public:
+
+	GLSL_ProgramCache();
+
+	// Enables the cache if the driver can retrieve the program binaries.
+	void init();
+
+	// Loads the cached binary of the program. Returns false if it is not
+	// cached or the driver does not accept it anymore.
+	bool load(GLSL_ShaderProgram*);
+
+	// Saves the binary of the linked program.
+	void save(GLSL_ShaderProgram*);
+
+	// Gets/sets the directory of the binaries. It has to exist.
+	ACCESSOR(Directory, const String&, directory)
+
+	// Is the cache enabled?
+	bool enabled;
+
+	// Hash of the vendor, renderer and version of the driver.
+	uint64 driverHash;
+
+	// Number of programs loaded from and saved to the cache.
+	uint32 numLoaded;
+	uint32 numSaved;
+
+protected:
+
+	// Gets the hash of the sources of the program.
+	uint64 getSourceHash(GLSL_ShaderProgram*) const;
+
+	// Gets the path of the binary of the sources.
+	String getPath(uint64 sourceHash) const;
+
+	String directory;
+};
+
+//-----------------------------------//
+
+NAMESPACE_GRAPHICS_END
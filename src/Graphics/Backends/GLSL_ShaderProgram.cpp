@@ -11,6 +11,7 @@
 
 #include "GLSL_Shader.h"
 #include "GLSL_ShaderProgram.h"
+#include "GLSL_ProgramCache.h"
 #include "GL.h"
 #include "Graphics/UniformBuffer.h"
 #include "Core/Utilities.h"
@@ -22,6 +23,9 @@ NAMESPACE_GRAPHICS_BEGIN
 
 GLSL_ShaderProgram::GLSL_ShaderProgram()
 	: hadLinkError(false)
+	, useUniformBlocks(false)
+	, lastUniforms(nullptr)
+	, cache(nullptr)
 {
 	create();
 	createShaders();
@@ -32,6 +36,7 @@ GLSL_ShaderProgram::GLSL_ShaderProgram()
 GLSL_ShaderProgram::~GLSL_ShaderProgram()
 {
 	detachShaders();
+	releaseUniformBlocks();
 
 	//Deallocate(vertex);
 	//Deallocate(fragment);
@@ -160,11 +165,21 @@ bool GLSL_ShaderProgram::link()
 	// If there are no shader programs, no point in trying to link.
 	if( shaders.empty() ) return false;
 
+	// Programs linked by an earlier run are loaded from their binaries.
+	if( cache && cache->load(this) )
+	{
+		onLinked();
+		return true;
+	}
+
 	// If we could not compile the shaders, no point in trying to link.
 	if( !compileShaders() ) return false;
 
 	bindDefaultAttributes();
 
+	if( cache )
+		glProgramParameteri( id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+
 	glLinkProgram( id );
 
 	// Check that the linking was good
@@ -188,10 +203,134 @@ bool GLSL_ShaderProgram::link()
 		return false;
 	}
 
+	if( cache )
+		cache->save(this);
+
+	onLinked();
+	return true;
+}
+
+//-----------------------------------//
+
+void GLSL_ShaderProgram::onLinked()
+{
 	linked = true;
 	hadLinkError = false;
 
-	return true;
+	resolveUniforms();
+
+	// Programs that declare the instance matrix can be drawn instanced.
+	supportsInstancing = glGetAttribLocation( id, "vp_InstanceMatrix" ) != -1;
+}
+
+//-----------------------------------//
+
+void GLSL_ShaderProgram::resolveUniforms()
+{
+	releaseUniformBlocks();
+	uniformLocations.clear();
+	lastUniforms = nullptr;
+
+	GLint numUniforms = 0;
+	glGetProgramiv( id, GL_ACTIVE_UNIFORMS, &numUniforms );
+
+	GLint maxLength = 0;
+	glGetProgramiv( id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength );
+
+	String name;
+	name.resize(maxLength + 1);
+
+	for( GLint i = 0; i < numUniforms; i++ )
+	{
+		GLsizei length = 0;
+		GLint size;
+		GLenum type;
+
+		glGetActiveUniform( id, i, name.size(), &length, &size, &type, &name[0] );
+		if( length == 0 ) continue;
+
+		// Arrays are reported with the name of their first element.
+		if( length > 3 && strncmp(&name[length-3], "[0]", 3) == 0 )
+			length -= 3;
+
+		name[length] = '\0';
+
+		UniformSlot slot = UniformSlotGet(name.c_str());
+		if( slot == UniformSlotInvalid ) continue;
+
+		if( slot >= uniformLocations.size() )
+		{
+			size_t numLocations = uniformLocations.size();
+			uniformLocations.resize(slot + 1);
+
+			for( size_t j = numLocations; j < uniformLocations.size(); j++ )
+			{
+				GLSL_UniformLocation& unused = uniformLocations[j];
+				unused.location = -1;
+				unused.block = -1;
+			}
+		}
+
+		GLSL_UniformLocation& loc = uniformLocations[slot];
+		loc.location = glGetUniformLocation( id, name.c_str() );
+		loc.block = -1;
+		loc.offset = 0;
+		loc.arrayStride = 0;
+		loc.matrixStride = 0;
+		loc.cachedSize = 0;
+
+		if( !useUniformBlocks ) continue;
+
+		GLuint index = i;
+		glGetActiveUniformsiv( id, 1, &index, GL_UNIFORM_BLOCK_INDEX, &loc.block );
+
+		if( loc.block < 0 ) continue;
+
+		glGetActiveUniformsiv( id, 1, &index, GL_UNIFORM_OFFSET, &loc.offset );
+		glGetActiveUniformsiv( id, 1, &index, GL_UNIFORM_ARRAY_STRIDE, &loc.arrayStride );
+		glGetActiveUniformsiv( id, 1, &index, GL_UNIFORM_MATRIX_STRIDE, &loc.matrixStride );
+	}
+
+	if( !useUniformBlocks ) return;
+
+	GLint numBlocks = 0;
+	glGetProgramiv( id, GL_ACTIVE_UNIFORM_BLOCKS, &numBlocks );
+
+	uniformBlocks.resize(numBlocks);
+
+	for( GLint i = 0; i < numBlocks; i++ )
+	{
+		GLSL_UniformBlock& block = uniformBlocks[i];
+		glGetActiveUniformBlockiv( id, i, GL_UNIFORM_BLOCK_DATA_SIZE, &block.size );
+
+		// Each block of the program gets the binding point of its index.
+		glUniformBlockBinding( id, i, i );
+
+		glGenBuffers( 1, &block.buffer );
+		glBindBuffer( GL_UNIFORM_BUFFER, block.buffer );
+		glBufferData( GL_UNIFORM_BUFFER, block.size, nullptr, GL_DYNAMIC_DRAW );
+
+		block.data = (uint8*) AllocatorAllocate(GetRenderAllocator(), block.size, 16);
+		memset(block.data, 0, block.size);
+		block.dirty = true;
+	}
+
+	glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+	CheckLastErrorGL("Could not create the uniform blocks");
+}
+
+//-----------------------------------//
+
+void GLSL_ShaderProgram::releaseUniformBlocks()
+{
+	for( size_t i = 0; i < uniformBlocks.size(); i++ )
+	{
+		GLSL_UniformBlock& block = uniformBlocks[i];
+		glDeleteBuffers( 1, &block.buffer );
+		AllocatorDeallocate(block.data);
+	}
+
+	uniformBlocks.clear();
 }
 
 //-----------------------------------//
@@ -266,6 +405,7 @@ void GLSL_ShaderProgram::bindDefaultAttributes()
 	setAttribute( "vp_Color", VertexAttribute::Color );
 	setAttribute( "vp_BoneIndex", VertexAttribute::BoneIndex );
 	setAttribute( "vp_TexCoord0", VertexAttribute::TexCoord0 );
+	setAttribute( "vp_InstanceMatrix", VertexAttribute::InstanceMatrix );
 }
 
 //-----------------------------------//
@@ -280,46 +420,167 @@ void GLSL_ShaderProgram::setAttribute( const String& name, VertexAttribute attr
 
 //-----------------------------------//
 
+// Gets the number of columns and the size of each column of the type.
+static void UniformDataTypeGetLayout(UniformDataType type, uint32& columns, uint32& columnSize)
+{
+	switch(type)
+	{
+	case UniformDataType::Scalar_F:
+	case UniformDataType::Scalar_I:
+		columns = 1; columnSize = 4; break;
+	case UniformDataType::Vector2_F:
+		columns = 1; columnSize = 8; break;
+	case UniformDataType::Vector3_F:
+		columns = 1; columnSize = 12; break;
+	case UniformDataType::Matrix2_F:
+		columns = 2; columnSize = 8; break;
+	case UniformDataType::Matrix3_F:
+		columns = 3; columnSize = 12; break;
+	case UniformDataType::Matrix4_F:
+		columns = 4; columnSize = 16; break;
+	case UniformDataType::Matrix2x3_F:
+		columns = 2; columnSize = 12; break;
+	case UniformDataType::Matrix3x2_F:
+		columns = 3; columnSize = 8; break;
+	case UniformDataType::Matrix2x4_F:
+		columns = 2; columnSize = 16; break;
+	case UniformDataType::Matrix4x2_F:
+		columns = 4; columnSize = 8; break;
+	case UniformDataType::Matrix3x4_F:
+		columns = 3; columnSize = 16; break;
+	case UniformDataType::Matrix4x3_F:
+		columns = 4; columnSize = 12; break;
+	default:
+		columns = 0; columnSize = 0; break;
+	}
+}
+
+//-----------------------------------//
+
+void GLSL_ShaderProgram::uploadUniform( GLSL_UniformLocation& loc,
+	const UniformBufferElement* element )
+{
+	uint32 size = element->size;
+
+	if( size <= sizeof(loc.cached) )
+	{
+		// Skip values that the program already has.
+		if( loc.cachedSize == size && memcmp(loc.cached, &element->data, size) == 0 )
+			return;
+
+		memcpy(loc.cached, &element->data, size);
+		loc.cachedSize = size;
+	}
+
+	GLint location = loc.location;
+	GLint count = element->count;
+
+	switch(element->type)
+	{
+	case UniformDataType::Scalar_F:
+		glUniform1fv(location, count, (GLfloat*) &element->data);
+		break;
+	case UniformDataType::Scalar_I:
+		glUniform1iv(location, count, (GLint*) &element->data);
+		break;
+	case UniformDataType::Vector2_F:
+		glUniform2fv(location, count, (GLfloat*) &element->data);
+		break;
+	case UniformDataType::Vector3_F:
+		glUniform3fv(location, count, (GLfloat*) &element->data);
+		break;
+	case UniformDataType::Matrix3_F:
+		glUniformMatrix3fv(location, count, false, (GLfloat*) &element->data);
+		break;
+	case UniformDataType::Matrix4_F:
+		glUniformMatrix4fv(location, count, false, (GLfloat*) &element->data);
+		break;
+	case UniformDataType::Matrix4x3_F:
+		glUniformMatrix4x3fv(location, count, false, (GLfloat*) &element->data);
+		break;
+	default:
+		LogWarn("Uniform type is not supported");
+		loc.cachedSize = 0;
+		break;
+	}
+}
+
+//-----------------------------------//
+
+void GLSL_ShaderProgram::writeUniformBlock( const GLSL_UniformLocation& loc,
+	const UniformBufferElement* element )
+{
+	GLSL_UniformBlock& block = uniformBlocks[loc.block];
+
+	uint32 columns, columnSize;
+	UniformDataTypeGetLayout(element->type, columns, columnSize);
+
+	const uint8* source = (const uint8*) &element->data;
+	uint32 elementSize = columns * columnSize;
+
+	// std140 pads array elements and matrix columns, so copy them one by one.
+	for( uint16 i = 0; i < element->count; i++ )
+	{
+		uint32 offset = loc.offset + i * loc.arrayStride;
+
+		for( uint32 c = 0; c < columns; c++ )
+		{
+			uint32 columnOffset = offset + c * loc.matrixStride;
+			if( columnOffset + columnSize > (uint32) block.size ) return;
+
+			memcpy(block.data + columnOffset, source + i * elementSize + c * columnSize, columnSize);
+		}
+	}
+
+	block.dirty = true;
+}
+
+//-----------------------------------//
+
 void GLSL_ShaderProgram::setUniforms( UniformBuffer* ub )
 {
-	for( auto it = ub->elements.begin(); it != ub->elements.end(); it++ )
+	if( !ub ) return;
+
+	// The dirty bits of the buffer are only meaningful if the buffer was
+	// last uploaded to this program, else all the uniforms are uploaded.
+	bool uploadAll = (lastUniforms != ub) || (ub->lastProgram != this);
+
+	size_t numSlots = ub->elements.size();
+	if( numSlots > uniformLocations.size() ) numSlots = uniformLocations.size();
+
+	for( size_t slot = 0; slot < numSlots; slot++ )
 	{
-		UniformBufferElement* element = it->value;
-		if( !element || !element->name ) continue;
+		if( !uploadAll && !ub->isDirty(slot) ) continue;
 
-		GLint location = glGetUniformLocation( id, element->name );
-		if( location == -1 ) continue;
+		const UniformBufferElement* element = ub->elements[slot];
+		if( !element ) continue;
 
-		GLint count = element->count;
+		GLSL_UniformLocation& loc = uniformLocations[slot];
 
-		switch(element->type)
+		if( loc.block >= 0 )
+			writeUniformBlock(loc, element);
+		else if( loc.location != -1 )
+			uploadUniform(loc, element);
+	}
+
+	for( size_t i = 0; i < uniformBlocks.size(); i++ )
+	{
+		GLSL_UniformBlock& block = uniformBlocks[i];
+
+		if( block.dirty )
 		{
-		case UniformDataType::Scalar_F:
-			glUniform1fv(location, count, (GLfloat*) &element->data);
-			break;
-		case UniformDataType::Scalar_I:
-			glUniform1iv(location, count, (GLint*) &element->data);
-			break;
-		case UniformDataType::Vector2_F:
-			glUniform2fv(location, count, (GLfloat*) &element->data);
-			break;
-		case UniformDataType::Vector3_F:
-			glUniform3fv(location, count, (GLfloat*) &element->data);
-			break;
-		case UniformDataType::Matrix3_F:
-			glUniformMatrix3fv(location, count, false, (GLfloat*) &element->data);
-			break;
-		case UniformDataType::Matrix4_F:
-			glUniformMatrix4fv(location, count, false, (GLfloat*) &element->data);
-			break;
-		case UniformDataType::Matrix4x3_F:
-			glUniformMatrix4x3fv(location, count, false, (GLfloat*) &element->data);
-			break;
-		default:
-			LogWarn("Uniform type is not supported");
-			continue;
+			glBindBuffer( GL_UNIFORM_BUFFER, block.buffer );
+			glBufferSubData( GL_UNIFORM_BUFFER, 0, block.size, block.data );
+			block.dirty = false;
 		}
+
+		// Other programs use the same binding points.
+		glBindBufferBase( GL_UNIFORM_BUFFER, i, block.buffer );
 	}
+
+	ub->clearDirty();
+	ub->lastProgram = this;
+	lastUniforms = ub;
 }
 
 //-----------------------------------//
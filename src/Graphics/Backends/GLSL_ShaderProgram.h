@@ -9,6 +9,7 @@
 
 #include "Graphics/ShaderProgram.h"
 #include "Graphics/VertexBuffer.h"
+#include "Graphics/UniformBuffer.h"
 #include "GL.h"
 
 FWD_DECL_INTRUSIVE(GLSL_Shader)
@@ -17,6 +18,8 @@ NAMESPACE_GRAPHICS_BEGIN
 
 //-----------------------------------//
 
+class GLSL_ProgramCache;
+
 /**
  * GLSL implementation of shader programs.
  */
@@ -24,6 +27,29 @@ NAMESPACE_GRAPHICS_BEGIN
 typedef Array< GLSL_ShaderPtr > ShadersVector;
 typedef HashMap< bool > ShadersAttachMap; // keyed by GLSL_ShaderPtr
 
+// Location of an uniform slot in the program.
+struct GLSL_UniformLocation
+{
+	GLint location;
+	GLint block; // Index of the uniform block or -1.
+	GLint offset;
+	GLint arrayStride;
+	GLint matrixStride;
+
+	// Last uploaded value, so small uniforms are only uploaded on change.
+	uint32 cachedSize;
+	uint8 cached[sizeof(Matrix4x4)];
+};
+
+// Uniform block with std140 layout backed by a buffer object.
+struct GLSL_UniformBlock
+{
+	GLuint buffer;
+	uint8* data;
+	GLint size;
+	bool dirty;
+};
+
 class API_GRAPHICS GLSL_ShaderProgram : public ShaderProgram
 {
 public:
@@ -78,12 +104,40 @@ protected:
 	// Gets the linking log of the program.
 	void getLogText();
 
+	// Sets up the program after it was linked.
+	void onLinked();
+
+	// Resolves the locations of the active uniforms into the slot table.
+	void resolveUniforms();
+
+	// Releases the uniform blocks buffers.
+	void releaseUniformBlocks();
+
+	// Uploads the uniform in the default block.
+	void uploadUniform( GLSL_UniformLocation&, const UniformBufferElement* );
+
+	// Writes the uniform in its uniform block.
+	void writeUniformBlock( const GLSL_UniformLocation&, const UniformBufferElement* );
+
 public:
 
 	GLuint id;
 	bool hadLinkError;
 	ShadersVector shaders;
 	ShadersAttachMap attached;
+
+	// Uses uniform blocks for the uniforms declared in them.
+	bool useUniformBlocks;
+
+	// Locations of the uniforms, indexed by uniform slot.
+	Array<GLSL_UniformLocation> uniformLocations;
+	Array<GLSL_UniformBlock> uniformBlocks;
+
+	// Buffer whose uniforms were last uploaded to the program.
+	UniformBuffer* lastUniforms;
+
+	// Cache of the program binaries, if the driver supports them.
+	GLSL_ProgramCache* cache;
 };
 
 TYPEDEF_INTRUSIVE_POINTER_FROM_TYPE( GLSL_ShaderProgram );
@@ -0,0 +1,144 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Graphics/API.h"
+
+#ifdef ENABLE_RENDERER_OPENGL
+
+#include "GL_StreamBuffer.h"
+#include "Core/Log.h"
+
+NAMESPACE_GRAPHICS_BEGIN
+
+//-----------------------------------//
+
+GL_StreamBuffer::GL_StreamBuffer(GLenum target)
+	: id(0)
+	, target(target)
+{
+}
+
+//-----------------------------------//
+
+GL_StreamBuffer::~GL_StreamBuffer()
+{
+	assert( id == 0 && "Stream buffer was not destroyed" );
+}
+
+//-----------------------------------//
+
+bool GL_StreamBuffer::create(uint32 capacity)
+{
+	glGenBuffers( 1, &id );
+	glBindBuffer( target, id );
+	glBufferData( target, capacity, nullptr, GL_STREAM_DRAW );
+	glBindBuffer( target, 0 );
+
+	if( CheckLastErrorGL("Could not allocate storage for stream buffer") )
+	{
+		destroy();
+		return false;
+	}
+
+	reset(capacity);
+	return true;
+}
+
+//-----------------------------------//
+
+void GL_StreamBuffer::destroy()
+{
+	for( uint32 i = 0; i < numFrames; i++ )
+		glDeleteSync( fences[(firstFrame + i) % StreamBufferMaxFrames] );
+
+	if( id )
+		glDeleteBuffers( 1, &id );
+
+	id = 0;
+	reset(0);
+}
+
+//-----------------------------------//
+
+bool GL_StreamBuffer::write(const void* data, uint32 size, uint32 align, uint32& offset)
+{
+	if( !id ) return false;
+
+	releaseFinishedFrames(false);
+
+	while( !allocate(size, align, offset) )
+	{
+		// The data does not fit even with all the frames released.
+		if( numFrames == 0 ) return false;
+
+		// Wait for the GPU to be done with the oldest frame.
+		releaseFinishedFrames(true);
+	}
+
+	// The range is not used by any draw in flight, so there is no need
+	// for the driver to synchronize the mapping.
+	GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT
+		| GL_MAP_INVALIDATE_RANGE_BIT;
+
+	void* dest = glMapBufferRange( target, offset, size, access );
+	
+	if( !dest )
+	{
+		CheckLastErrorGL("Could not map stream buffer");
+		return false;
+	}
+
+	memcpy(dest, data, size);
+	glUnmapBuffer( target );
+
+	return true;
+}
+
+//-----------------------------------//
+
+void GL_StreamBuffer::endFrame()
+{
+	if( !id ) return;
+
+	// Make room for the fence of this frame.
+	if( numFrames == StreamBufferMaxFrames )
+		releaseFinishedFrames(true);
+
+	uint32 index = (firstFrame + numFrames) % StreamBufferMaxFrames;
+	fences[index] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+
+	StreamBuffer::endFrame();
+}
+
+//-----------------------------------//
+
+void GL_StreamBuffer::releaseFinishedFrames(bool wait)
+{
+	while( numFrames > 0 )
+	{
+		GLsync fence = fences[firstFrame];
+
+		GLbitfield flags = wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0;
+		GLuint64 timeout = wait ? GL_TIMEOUT_IGNORED : 0;
+		GLenum status = glClientWaitSync( fence, flags, timeout );
+
+		if( status == GL_TIMEOUT_EXPIRED )
+			break;
+
+		glDeleteSync( fence );
+		releaseFrame();
+
+		// Only wait for a single frame to make room.
+		wait = false;
+	}
+}
+
+//-----------------------------------//
+
+NAMESPACE_GRAPHICS_END
+
+#endif
@@ -0,0 +1,58 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#pragma once
+
+#include "Graphics/StreamBuffer.h"
+#include "GL.h"
+
+NAMESPACE_GRAPHICS_BEGIN
+
+//-----------------------------------//
+
+/**
+ * Ring buffer object used to stream dynamic geometry. The data is written
+ * through unsynchronized mappings of the buffer range, and each frame
+ * inserts a fence that tells when the GPU is done with its range.
+ */
+
+class GL_StreamBuffer : public StreamBuffer
+{
+public:
+
+	GL_StreamBuffer(GLenum target);
+	~GL_StreamBuffer();
+
+	// Creates the buffer storage with the given capacity.
+	bool create(uint32 capacity);
+
+	// Destroys the buffer storage and the pending fences.
+	void destroy();
+
+	// Writes the data to the buffer, which needs to be bound to its
+	// target. Returns false if it does not fit.
+	bool write(const void* data, uint32 size, uint32 align, uint32& offset);
+
+	// Ends the current frame and inserts a fence after its commands.
+	void endFrame();
+
+	// Releases the frames whose commands the GPU is done with.
+	void releaseFinishedFrames(bool wait);
+
+	// Buffer object and target.
+	GLuint id;
+	GLenum target;
+
+protected:
+
+	// Fences of the frames in flight, in the order of the frames.
+	GLsync fences[StreamBufferMaxFrames];
+};
+
+//-----------------------------------//
+
+NAMESPACE_GRAPHICS_END
@@ -17,14 +17,26 @@ Buffer::Buffer()
 	, usage(BufferUsage::Static)
 	, access(BufferAccess::Read)
 	, gb(nullptr)
+	, size(0)
+	, arena(nullptr)
+	, isStreamed(false)
+	, offset(0)
+	, streamFrame(0)
 {
 }
 
 //-----------------------------------//
 
 Buffer::Buffer(BufferUsage usage, BufferAccess access) 
-	: usage(usage)
+	: id(0)
+	, usage(usage)
 	, access(access)
+	, gb(nullptr)
+	, size(0)
+	, arena(nullptr)
+	, isStreamed(false)
+	, offset(0)
+	, streamFrame(0)
 {
 }
 
@@ -9,6 +9,7 @@
 #include "Graphics/BufferManager.h"
 #include "Graphics/RenderBackend.h"
 #include "Graphics/GeometryBuffer.h"
+#include "Core/Log.h"
 
 NAMESPACE_GRAPHICS_BEGIN
 
@@ -22,6 +23,131 @@ BufferEntry::BufferEntry()
 
 //-----------------------------------//
 
+BufferArena::BufferArena(Buffer* storage, uint32 capacity)
+	: storage(storage)
+	, capacity(capacity)
+	, usedBytes(0)
+	, peakBytes(0)
+	, numAllocations(0)
+{
+	BufferArenaRange range = { 0, capacity };
+	freeRanges.pushBack(range);
+}
+
+//-----------------------------------//
+
+bool BufferArena::allocate(uint32 size, uint32 align, uint32& offset)
+{
+	if( size == 0 ) return false;
+
+	for( size_t i = 0; i < freeRanges.size(); i++ )
+	{
+		BufferArenaRange& range = freeRanges[i];
+
+		uint32 start = range.offset;
+
+		if( align > 1 )
+			start = (start + align - 1) / align * align;
+
+		uint32 padding = start - range.offset;
+		if( padding + size > range.size ) continue;
+
+		uint32 end = start + size;
+		uint32 rangeEnd = range.offset + range.size;
+
+		if( padding > 0 && end < rangeEnd )
+		{
+			// The padding stays free before the allocation.
+			range.size = padding;
+
+			BufferArenaRange tail = { end, rangeEnd - end };
+			freeRanges.insert(freeRanges.begin() + i + 1, &tail, &tail + 1);
+		}
+		else if( padding > 0 )
+		{
+			range.size = padding;
+		}
+		else if( end < rangeEnd )
+		{
+			range.offset = end;
+			range.size = rangeEnd - end;
+		}
+		else
+		{
+			freeRanges.remove(&range);
+		}
+
+		usedBytes += size;
+		peakBytes = std::max(peakBytes, usedBytes);
+		numAllocations++;
+
+		offset = start;
+		return true;
+	}
+
+	return false;
+}
+
+//-----------------------------------//
+
+void BufferArena::free(uint32 offset, uint32 size)
+{
+	assert( usedBytes >= size );
+	assert( numAllocations > 0 );
+
+	usedBytes -= size;
+	numAllocations--;
+
+	size_t i = 0;
+
+	while( i < freeRanges.size() && freeRanges[i].offset < offset )
+		i++;
+
+	// Merge with the previous free range.
+	if( i > 0 )
+	{
+		BufferArenaRange& prev = freeRanges[i - 1];
+
+		if( prev.offset + prev.size == offset )
+		{
+			prev.size += size;
+
+			// The freed range can also close the gap to the next one.
+			if( i < freeRanges.size() && prev.offset + prev.size == freeRanges[i].offset )
+			{
+				prev.size += freeRanges[i].size;
+				freeRanges.remove(&freeRanges[i]);
+			}
+
+			return;
+		}
+	}
+
+	// Merge with the next free range.
+	if( i < freeRanges.size() && offset + size == freeRanges[i].offset )
+	{
+		freeRanges[i].offset = offset;
+		freeRanges[i].size += size;
+		return;
+	}
+
+	BufferArenaRange range = { offset, size };
+	freeRanges.insert(freeRanges.begin() + i, &range, &range + 1);
+}
+
+//-----------------------------------//
+
+// Size of the storage of each vertex and index arena.
+static const uint32 VertexArenaSize = 4 * 1024 * 1024;
+static const uint32 IndexArenaSize = 1024 * 1024;
+
+// Bigger buffers get their own storage, so they do not fragment the arenas.
+static const uint32 MaxArenaAllocationDivisor = 4;
+
+// Alignment of the allocations in the arenas.
+static const uint32 VertexArenaAlign = 16;
+static const uint32 IndexArenaAlign = 4;
+
 BufferManager::BufferManager()
 	: backend(nullptr)
 {
@@ -31,6 +157,21 @@ BufferManager::BufferManager()
 
 BufferManager::~BufferManager()
 {
+	for( auto it = buffers.begin(); it != buffers.end(); ++it )
+	{
+		BufferEntry* entry = it->value;
+
+		const GeometryBuffer* gb = entry->vb->getGeometryBuffer();
+		gb->onDestroyed.Disconnect(this, &BufferManager::onGeometryBufferDestroyed);
+
+		Deallocate(entry);
+	}
+
+	for( size_t i = 0; i < vertexArenas.size(); i++ )
+		Deallocate(vertexArenas[i]);
+
+	for( size_t i = 0; i < indexArenas.size(); i++ )
+		Deallocate(indexArenas[i]);
 }
 
 //-----------------------------------//
@@ -39,28 +180,30 @@ BufferEntry* BufferManager::getBuffer(const GeometryBuffer* gb)
 {
 	if( !gb ) return nullptr;
 
-	auto entry = buffers.get((uint64)gb, BufferEntry());
+	BufferEntry* entry = buffers.get((uint64)gb, nullptr);
+	if( entry ) return entry;
 
-	if(!buffers.has((uint64)gb))
-	{
-		entry.vb = backend->createVertexBuffer();
-		entry.vb->setBufferAccess( gb->getBufferAccess() );
-		entry.vb->setBufferUsage( gb->getBufferUsage() );
-		entry.vb->setGeometryBuffer( gb );
+	// The entries are allocated on the heap so the pointers to them stay
+	// valid when the map grows.
+	entry = AllocateGraphics(BufferEntry);
 
-		if( gb->isIndexed() )
-		{
-			entry.ib = backend->createIndexBuffer();
-			entry.ib->setBufferAccess( gb->getBufferAccess() );
-			entry.ib->setBufferUsage( gb->getBufferUsage() );
-			entry.ib->setGeometryBuffer( gb );
-		}
+	entry->vb = backend->createVertexBuffer();
+	entry->vb->setBufferAccess( gb->getBufferAccess() );
+	entry->vb->setBufferUsage( gb->getBufferUsage() );
+	entry->vb->setGeometryBuffer( gb );
 
-		buffers.set((uint64)gb, entry);
-		entry = buffers.get((uint64)gb, entry);
+	if( gb->isIndexed() )
+	{
+		entry->ib = backend->createIndexBuffer();
+		entry->ib->setBufferAccess( gb->getBufferAccess() );
+		entry->ib->setBufferUsage( gb->getBufferUsage() );
+		entry->ib->setGeometryBuffer( gb );
 	}
 
-	return &entry;
+	buffers.set((uint64)gb, entry);
+	gb->onDestroyed.Connect(this, &BufferManager::onGeometryBufferDestroyed);
+
+	return entry;
 }
 
 //-----------------------------------//
@@ -85,4 +228,186 @@ IndexBufferPtr BufferManager::getIndexBuffer(const GeometryBuffer* gb)
 
 //-----------------------------------//
 
+static bool IsPooled(const GeometryBuffer* gb, uint32 size, uint32 arenaSize)
+{
+	// Only geometry that rarely changes is worth packing in the arenas.
+	return gb->usage == BufferUsage::Static && size > 0
+		&& size <= arenaSize / MaxArenaAllocationDivisor;
+}
+
+//-----------------------------------//
+
+bool BufferManager::prepareVertexStorage(VertexBuffer* vb)
+{
+	const GeometryBuffer* gb = vb->getGeometryBuffer();
+	if( !gb ) return false;
+
+	uint32 size = gb->data.size();
+	bool isPooled = IsPooled(gb, size, VertexArenaSize);
+
+	if( vb->arena )
+	{
+		if( isPooled && vb->size == size ) return false;
+
+		freeStorage(vb);
+		if( !isPooled ) return true;
+	}
+	else if( !isPooled )
+	{
+		return false;
+	}
+
+	uint32 offset;
+	BufferArena* arena = allocateStorage(vertexArenas, false, size, VertexArenaAlign, offset);
+	if( !arena ) return false;
+
+	vb->arena = arena;
+	vb->offset = offset;
+	vb->size = size;
+
+	return true;
+}
+
+//-----------------------------------//
+
+bool BufferManager::prepareIndexStorage(IndexBuffer* ib)
+{
+	const GeometryBuffer* gb = ib->getGeometryBuffer();
+	if( !gb ) return false;
+
+	uint32 size = gb->indexData.size();
+	bool isPooled = IsPooled(gb, size, IndexArenaSize);
+
+	if( ib->arena )
+	{
+		if( isPooled && ib->size == size ) return false;
+
+		freeStorage(ib);
+		if( !isPooled ) return true;
+	}
+	else if( !isPooled )
+	{
+		return false;
+	}
+
+	uint32 offset;
+	BufferArena* arena = allocateStorage(indexArenas, true, size, IndexArenaAlign, offset);
+	if( !arena ) return false;
+
+	ib->arena = arena;
+	ib->offset = offset;
+	ib->size = size;
+
+	return true;
+}
+
+//-----------------------------------//
+
+BufferArena* BufferManager::allocateStorage(Array<BufferArena*>& arenas, bool isIndex,
+	uint32 size, uint32 align, uint32& offset)
+{
+	for( size_t i = 0; i < arenas.size(); i++ )
+	{
+		BufferArena* arena = arenas[i];
+		if( arena->allocate(size, align, offset) ) return arena;
+	}
+
+	// The storage of the arena is allocated by the backend when the first
+	// buffer is built in it.
+	Buffer* storage = nullptr;
+	uint32 capacity = 0;
+
+	if( isIndex )
+	{
+		IndexBufferPtr ib = backend->createIndexBuffer();
+		indexStorages.pushBack(ib);
+		storage = ib.get();
+		capacity = IndexArenaSize;
+	}
+	else
+	{
+		VertexBufferPtr vb = backend->createVertexBuffer();
+		vertexStorages.pushBack(vb);
+		storage = vb.get();
+		capacity = VertexArenaSize;
+	}
+
+	BufferArena* arena = AllocateGraphics(BufferArena, storage, capacity);
+	arenas.pushBack(arena);
+
+	if( !arena->allocate(size, align, offset) )
+		return nullptr;
+
+	return arena;
+}
+
+//-----------------------------------//
+
+void BufferManager::freeStorage(Buffer* buffer)
+{
+	if( !buffer->arena ) return;
+
+	buffer->arena->free(buffer->offset, buffer->size);
+
+	buffer->arena = nullptr;
+	buffer->offset = 0;
+	buffer->size = 0;
+}
+
+//-----------------------------------//
+
+void BufferManager::releaseBuffers(const GeometryBuffer* gb)
+{
+	BufferEntry* entry = buffers.get((uint64)gb, nullptr);
+	if( !entry ) return;
+
+	gb->onDestroyed.Disconnect(this, &BufferManager::onGeometryBufferDestroyed);
+
+	if( entry->vb.get() )
+	{
+		freeStorage(entry->vb.get());
+		entry->vb->setGeometryBuffer(nullptr);
+		backend->releaseVertexBuffer(entry->vb.get());
+	}
+
+	if( entry->ib.get() )
+	{
+		freeStorage(entry->ib.get());
+		entry->ib->setGeometryBuffer(nullptr);
+		backend->releaseIndexBuffer(entry->ib.get());
+	}
+
+	buffers.remove((uint64)gb);
+	Deallocate(entry);
+}
+
+//-----------------------------------//
+
+void BufferManager::onGeometryBufferDestroyed(const GeometryBuffer* gb)
+{
+	releaseBuffers(gb);
+}
+
+//-----------------------------------//
+
+static void LogArenas(const char* name, const Array<BufferArena*>& arenas)
+{
+	for( size_t i = 0; i < arenas.size(); i++ )
+	{
+		const BufferArena* arena = arenas[i];
+
+		LogInfo( "%s arena %u: %u/%u bytes used (peak %u) in %u allocations, %u free ranges",
+			name, (uint32) i, arena->usedBytes, arena->capacity, arena->peakBytes,
+			arena->numAllocations, (uint32) arena->freeRanges.size() );
+	}
+}
+
+void BufferManager::logArenaStats() const
+{
+	LogArenas("Vertex", vertexArenas);
+	LogArenas("Index", indexArenas);
+}
+
+//-----------------------------------//
+
 NAMESPACE_GRAPHICS_END
\ No newline at end of file
@@ -156,6 +156,10 @@ GeometryBuffer::GeometryBuffer()
 	, access(BufferAccess::Read)
 	, indexSize(16)
 	, needsRebuild(false)
+	, dirtyStart(0)
+	, dirtyEnd(0)
+	, indexDirtyStart(0)
+	, indexDirtyEnd(0)
 	, hash(0)
 {
 }
@@ -163,6 +167,15 @@ GeometryBuffer::GeometryBuffer()
 //-----------------------------------//
 
 GeometryBuffer::GeometryBuffer(BufferUsage usage, BufferAccess access)
+	: usage(usage)
+	, access(access)
+	, indexSize(16)
+	, needsRebuild(false)
+	, dirtyStart(0)
+	, dirtyEnd(0)
+	, indexDirtyStart(0)
+	, indexDirtyEnd(0)
+	, hash(0)
 {
 }
 
@@ -170,6 +183,7 @@ GeometryBuffer::GeometryBuffer(BufferUsage usage, BufferAccess access)
 
 GeometryBuffer::~GeometryBuffer()
 {
+	onDestroyed(this);
 }
 
 //-----------------------------------//
@@ -194,6 +208,7 @@ void GeometryBuffer::set(VertexAttribute attribute, uint8* buf, uint32 size)
 	}
 
 	std::copy(buf, buf+size, data.begin() + elem->offset);
+	markDirty(elem->offset, size);
 }
 
 //-----------------------------------//
@@ -210,7 +225,7 @@ void GeometryBuffer::add(uint8* buf, uint32 size)
 {
 	data.resize(data.size() + size);
 	std::copy(buf, buf+size, data.end() - size);
-	forceRebuild();
+	markDirty(data.size() - size, size);
 }
 
 //-----------------------------------//
@@ -228,7 +243,7 @@ void GeometryBuffer::addIndex(uint8* buf, uint32 size)
 {
 	indexData.resize(indexData.size() + size);
 	std::copy(buf, buf+size, indexData.end() - size);
-	forceRebuild();
+	markIndexDirty(indexData.size() - size, size);
 }
 
 //-----------------------------------//
@@ -318,9 +333,86 @@ int8 GeometryBuffer::getAttributeStride(VertexAttribute attribute) const
 
 void GeometryBuffer::forceRebuild()
 {
+	markDirty(0, data.size());
+	markIndexDirty(0, indexData.size());
+}
+
+//-----------------------------------//
+
+void GeometryBuffer::markDirty(uint32 offset, uint32 size)
+{
+	if( dirtyEnd <= dirtyStart )
+	{
+		dirtyStart = offset;
+		dirtyEnd = offset + size;
+	}
+	else
+	{
+		dirtyStart = std::min(dirtyStart, offset);
+		dirtyEnd = std::max(dirtyEnd, offset + size);
+	}
+
+	needsRebuild = true;
+}
+
+//-----------------------------------//
+
+void GeometryBuffer::markIndexDirty(uint32 offset, uint32 size)
+{
+	if( indexDirtyEnd <= indexDirtyStart )
+	{
+		indexDirtyStart = offset;
+		indexDirtyEnd = offset + size;
+	}
+	else
+	{
+		indexDirtyStart = std::min(indexDirtyStart, offset);
+		indexDirtyEnd = std::max(indexDirtyEnd, offset + size);
+	}
+
 	needsRebuild = true;
 }
 
 //-----------------------------------//
 
+void GeometryBuffer::clearDirty()
+{
+	dirtyStart = dirtyEnd = 0;
+	indexDirtyStart = indexDirtyEnd = 0;
+	needsRebuild = false;
+}
+
+//-----------------------------------//
+
+// Changed ranges can only be uploaded on their own if the storage
+// already has the size of the data, else it has to be reallocated.
+
+static bool GetDirtyRange(uint32 start, uint32 end, uint32 dataSize,
+	uint32 storageSize, uint32& offset, uint32& size)
+{
+	if( storageSize == 0 || storageSize != dataSize )
+		return false;
+
+	if( end <= start || end > dataSize )
+		return false;
+
+	offset = start;
+	size = end - start;
+
+	return true;
+}
+
+bool GeometryBuffer::getDirtyRange(uint32 storageSize, uint32& offset, uint32& size) const
+{
+	return GetDirtyRange(dirtyStart, dirtyEnd, data.size(), storageSize, offset, size);
+}
+
+bool GeometryBuffer::getIndexDirtyRange(uint32 storageSize, uint32& offset, uint32& size) const
+{
+	return GetDirtyRange(indexDirtyStart, indexDirtyEnd, indexData.size(),
+		storageSize, offset, size);
+}
+
+//-----------------------------------//
+
 NAMESPACE_GRAPHICS_END
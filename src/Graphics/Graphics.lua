@@ -32,6 +32,11 @@ project "Graphics"
 		["*"] = { ".", path.join(incdir,"Graphics") },
 	}
 
+	excludes
+	{
+		"Test/**",
+	}
+
 	includedirs
 	{
 		incdir,
@@ -7,8 +7,6 @@
 
 #include "Graphics/API.h"
 
-#ifdef ENABLE_RENDERER_OPENGL
-
 #include "Graphics/IndexBuffer.h"
 #include "Graphics/GeometryBuffer.h"
 
@@ -23,5 +21,3 @@ IndexBuffer::IndexBuffer()
 //-----------------------------------//
 
 NAMESPACE_GRAPHICS_END
-
-#endif
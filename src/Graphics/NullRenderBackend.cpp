@@ -0,0 +1,587 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Graphics/API.h"
+
+#include "Graphics/NullRenderBackend.h"
+#include "Graphics/RenderCapabilities.h"
+#include "Graphics/RenderBatch.h"
+#include "Graphics/RenderQueue.h"
+#include "Graphics/RenderView.h"
+#include "Graphics/VertexBuffer.h"
+#include "Graphics/IndexBuffer.h"
+#include "Graphics/GeometryBuffer.h"
+#include "Graphics/Texture.h"
+#include "Graphics/ShaderProgram.h"
+#include "Graphics/UniformBuffer.h"
+
+NAMESPACE_GRAPHICS_BEGIN
+
+//-----------------------------------//
+
+static const char* gs_RenderCommandNames[] =
+{
+	"SetupRenderView",
+	"ClearRenderView",
+	"SetupRenderState",
+	"UnsetupRenderState",
+	"BindVertexBuffer",
+	"UnbindVertexBuffer",
+	"BuildVertexBuffer",
+	"SetupVertexBuffer",
+	"BindIndexBuffer",
+	"UnbindIndexBuffer",
+	"BuildIndexBuffer",
+	"UploadTexture",
+	"UploadTextureMip",
+	"ReleaseTextureMips",
+	"ConfigureTexture",
+	"BindTexture",
+	"UnbindTexture",
+	"SetupTextureUnit",
+	"UndoTextureUnit",
+	"LinkProgram",
+	"BindProgram",
+	"UnbindProgram",
+	"SetUniform",
+	"Draw",
+	"DrawInstanced",
+	"EndFrame",
+};
+
+const char* RenderCommandTypeGetName(RenderCommandType type)
+{
+	if( type >= RenderCommandType::Count ) return nullptr;
+	return gs_RenderCommandNames[(size_t) type];
+}
+
+//-----------------------------------//
+
+class NullShader : public Shader
+{
+public:
+
+	bool create() OVERRIDE { return true; }
+
+	bool compile() OVERRIDE
+	{
+		compiled = true;
+		compileErrors = false;
+		return true;
+	}
+};
+
+//-----------------------------------//
+
+/**
+ * Program of the null backend, which reports the bound programs and
+ * the uploaded uniforms to the backend. Uniforms are tracked with the
+ * same dirty rules as the real programs, so the recorded uploads match.
+ */
+
+class NullShaderProgram : public ShaderProgram
+{
+public:
+
+	NullShaderProgram(NullRenderBackend* backend)
+		: backend(backend)
+		, lastUniforms(nullptr)
+	{
+		create();
+		createShaders();
+	}
+
+	bool create() OVERRIDE { return true; }
+
+	void createShaders() OVERRIDE
+	{
+		vertexShader = AllocateThis(NullShader);
+		vertexShader->setShaderType( ShaderType::Vertex );
+		vertex = vertexShader.get();
+
+		fragmentShader = AllocateThis(NullShader);
+		fragmentShader->setShaderType( ShaderType::Fragment );
+		fragment = fragmentShader.get();
+	}
+
+	bool link() OVERRIDE
+	{
+		if( linked ) return true;
+
+		vertex->compile();
+		fragment->compile();
+
+		linked = true;
+		supportsInstancing = true;
+		lastUniforms = nullptr;
+
+		backend->recordCommand(RenderCommandType::LinkProgram, this, 0);
+		return true;
+	}
+
+	void bind() OVERRIDE
+	{
+		backend->recordCommand(RenderCommandType::BindProgram, this, 0);
+	}
+
+	void unbind() OVERRIDE
+	{
+		backend->recordCommand(RenderCommandType::UnbindProgram, this, 0);
+	}
+
+	void forceRecompile() OVERRIDE
+	{
+		vertex->forceRecompile();
+		fragment->forceRecompile();
+		linked = false;
+	}
+
+	void setAttribute( const String&, VertexAttribute ) OVERRIDE
+	{
+	}
+
+	void setUniforms( UniformBuffer* ub ) OVERRIDE
+	{
+		if( !ub ) return;
+
+		bool uploadAll = (lastUniforms != ub) || (ub->lastProgram != this);
+
+		for( size_t slot = 0; slot < ub->elements.size(); slot++ )
+		{
+			if( !ub->elements[slot] ) continue;
+			if( !uploadAll && !ub->isDirty(slot) ) continue;
+
+			backend->recordCommand(RenderCommandType::SetUniform, ub, slot);
+		}
+
+		ub->clearDirty();
+		ub->lastProgram = this;
+		lastUniforms = ub;
+	}
+
+protected:
+
+	NullRenderBackend* backend;
+	ShaderPtr vertexShader;
+	ShaderPtr fragmentShader;
+	UniformBuffer* lastUniforms;
+};
+
+//-----------------------------------//
+
+NullRenderBackend::NullRenderBackend()
+	: frameUploadBytes(0)
+	, lastFrameUploadBytes(0)
+	, nextId(0)
+{
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::recordCommand(RenderCommandType, const void*, uint32)
+{
+}
+
+//-----------------------------------//
+
+bool NullRenderBackend::init()
+{
+	return true;
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::cleanup()
+{
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::checkCapabilities(RenderCapabilities* caps)
+{
+	caps->name = "Null";
+	caps->vendor = "Flood";
+	caps->driverName = "Null";
+	caps->driverVersion = "1.0";
+	caps->shadingLanguageVersion = "1.0";
+
+	caps->maxTextureSize = 8192;
+	caps->maxTextureUnits = 16;
+	caps->maxAttribs = 16;
+
+	caps->supportsVertexBuffers = true;
+	caps->supportsShaders = true;
+	caps->supportsAnisotropic = false;
+	caps->supportsFixedPipeline = false;
+	caps->supportsUniformBuffers = false;
+	caps->supportsInstancing = true;
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::endFrame()
+{
+	recordCommand(RenderCommandType::EndFrame, nullptr, 0);
+
+	lastFrameUploadBytes = frameUploadBytes;
+	frameUploadBytes = 0;
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::renderBatch(RenderBatch* batch)
+{
+	const GeometryBuffer* gb = batch->getGeometryBuffer().get();
+
+	uint32 numElements = 0;
+
+	if( !gb->isIndexed() )
+		numElements = gb->getNumVertices();
+	else if( batch->range.end > batch->range.start )
+		numElements = batch->range.end - batch->range.start;
+	else
+		numElements = gb->indexData.size() / (gb->indexSize / 8);
+
+	recordCommand(RenderCommandType::Draw, batch, numElements);
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::renderBatchInstanced(RenderBatch* batch,
+	const Matrix4x4*, uint32 count)
+{
+	recordCommand(RenderCommandType::DrawInstanced, batch, count);
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::setupRenderState( const RenderState& state, bool )
+{
+	recordCommand(RenderCommandType::SetupRenderState, state.material, 0);
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::unsetupRenderState( const RenderState& state )
+{
+	recordCommand(RenderCommandType::UnsetupRenderState, state.material, 0);
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::setupRenderView(RenderView* view)
+{
+	recordCommand(RenderCommandType::SetupRenderView, view, 0);
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::clearRenderView(RenderView* view)
+{
+	recordCommand(RenderCommandType::ClearRenderView, view, 0);
+}
+
+//-----------------------------------//
+
+Color NullRenderBackend::getPixel(uint16, uint16)
+{
+	return Color::Black;
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::setClearColor(Color)
+{
+}
+
+//-----------------------------------//
+
+VertexBuffer* NullRenderBackend::createVertexBuffer()
+{
+	VertexBuffer* vb = AllocateGraphics(VertexBuffer);
+	vb->id = ++nextId;
+	return vb;
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::releaseVertexBuffer(VertexBuffer*)
+{
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::bindVertexBuffer(VertexBuffer* vb)
+{
+	recordCommand(RenderCommandType::BindVertexBuffer, vb, 0);
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::unbindVertexBuffer(VertexBuffer* vb)
+{
+	recordCommand(RenderCommandType::UnbindVertexBuffer, vb, 0);
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::buildVertexBuffer(VertexBuffer* vb)
+{
+	const GeometryBuffer* gb = vb->getGeometryBuffer();
+	if( !gb || gb->data.empty() ) return;
+
+	uint32 dirtyOffset, dirtySize;
+	bool isDirtyRange = gb->getDirtyRange(vb->size, dirtyOffset, dirtySize);
+
+	uint32 size = getUploadSize(vb, gb->data, isDirtyRange, dirtySize);
+	recordCommand(RenderCommandType::BuildVertexBuffer, vb, size);
+
+	vb->built = true;
+}
+
+//-----------------------------------//
+
+uint32 NullRenderBackend::getUploadSize(Buffer* buffer, const Array<uint8>& data,
+	bool isDirtyRange, uint32 dirtySize)
+{
+	const GeometryBuffer* gb = buffer->getGeometryBuffer();
+
+	// Mirror the streaming backends: dynamic data is written as a whole
+	// to a stream buffer, else only the changed range is uploaded when
+	// the storage does not need to be reallocated.
+	uint32 size = data.size();
+
+	if( gb->usage == BufferUsage::Dynamic )
+		buffer->isStreamed = true;
+	else if( isDirtyRange )
+		size = dirtySize;
+
+	buffer->size = data.size();
+	frameUploadBytes += size;
+
+	return size;
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::setupVertexBuffer(VertexBuffer* vb)
+{
+	recordCommand(RenderCommandType::SetupVertexBuffer, vb, 0);
+}
+
+//-----------------------------------//
+
+IndexBuffer* NullRenderBackend::createIndexBuffer()
+{
+	IndexBuffer* ib = AllocateGraphics(IndexBuffer);
+	ib->id = ++nextId;
+	return ib;
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::releaseIndexBuffer(IndexBuffer*)
+{
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::bindIndexBuffer(IndexBuffer* ib)
+{
+	recordCommand(RenderCommandType::BindIndexBuffer, ib, 0);
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::unbindIndexBuffer(IndexBuffer* ib)
+{
+	recordCommand(RenderCommandType::UnbindIndexBuffer, ib, 0);
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::buildIndexBuffer(IndexBuffer* ib)
+{
+	const GeometryBuffer* gb = ib->getGeometryBuffer();
+	if( !gb || gb->indexData.empty() ) return;
+
+	uint32 dirtyOffset, dirtySize;
+	bool isDirtyRange = gb->getIndexDirtyRange(ib->size, dirtyOffset, dirtySize);
+
+	uint32 size = getUploadSize(ib, gb->indexData, isDirtyRange, dirtySize);
+	recordCommand(RenderCommandType::BuildIndexBuffer, ib, size);
+
+	ib->isBuilt = true;
+}
+
+//-----------------------------------//
+
+RenderBuffer* NullRenderBackend::createRenderBuffer(const Settings&)
+{
+	LogWarn("Render buffers are not supported by the null backend");
+	return nullptr;
+}
+
+//-----------------------------------//
+
+Texture* NullRenderBackend::createTexture()
+{
+	Texture* tex = AllocateGraphics(Texture);
+	tex->target = TextureTarget::Target2D;
+	tex->id = ++nextId;
+	return tex;
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::releaseTexture(Texture*)
+{
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::uploadTexture(Texture* tex)
+{
+	recordCommand(RenderCommandType::UploadTexture, tex, tex->getExpectedSize());
+	tex->setUploaded();
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::uploadTextureMip(Texture* tex, uint8 level, uint32,
+	uint32, const uint8*)
+{
+	recordCommand(RenderCommandType::UploadTextureMip, tex, level);
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::releaseTextureMips(Texture* tex, uint8 level)
+{
+	recordCommand(RenderCommandType::ReleaseTextureMips, tex, level);
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::configureTexture(Texture* tex)
+{
+	recordCommand(RenderCommandType::ConfigureTexture, tex, 0);
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::bindTexture(Texture* tex)
+{
+	recordCommand(RenderCommandType::BindTexture, tex, 0);
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::unbindTexture(Texture* tex)
+{
+	recordCommand(RenderCommandType::UnbindTexture, tex, 0);
+}
+
+//-----------------------------------//
+
+Image* NullRenderBackend::readTexture(Texture* tex)
+{
+	Array<byte> data;
+	data.resize( tex->getExpectedSize() );
+	memset(data.data(), 0, data.size());
+
+	Image* image = AllocateThis(Image);
+	image->setWidth( tex->width );
+	image->setHeight( tex->height );
+	image->setPixelFormat( tex->format );
+	image->setBuffer( data );
+
+	return image;
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::setupTextureUnit(Texture* texture, const TextureUnit& unit)
+{
+	recordCommand(RenderCommandType::SetupTextureUnit, texture, unit.unit);
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::undoTextureUnit(Texture* texture, const TextureUnit& unit)
+{
+	recordCommand(RenderCommandType::UndoTextureUnit, texture, unit.unit);
+}
+
+//-----------------------------------//
+
+ShaderProgram* NullRenderBackend::createProgram()
+{
+	return AllocateGraphics(NullShaderProgram, this);
+}
+
+//-----------------------------------//
+
+ShaderProgram* NullRenderBackend::createShader()
+{
+	return AllocateGraphics(NullShaderProgram, this);
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::releaseShader(ShaderProgram*)
+{
+}
+
+//-----------------------------------//
+
+void NullRenderBackend::compileShader(ShaderProgram*)
+{
+}
+
+//-----------------------------------//
+
+NullRenderContext::NullRenderContext(RenderBackend* backend)
+	: RenderContext(backend)
+{
+}
+
+//-----------------------------------//
+
+void NullRenderContext::makeCurrent(RenderTarget*)
+{
+}
+
+//-----------------------------------//
+
+NullRenderTarget::NullRenderTarget(const Settings& settings)
+	: settings(settings)
+{
+}
+
+//-----------------------------------//
+
+void NullRenderTarget::makeCurrent()
+{
+}
+
+//-----------------------------------//
+
+void NullRenderTarget::update()
+{
+}
+
+//-----------------------------------//
+
+const Settings& NullRenderTarget::getSettings() const
+{
+	return settings;
+}
+
+//-----------------------------------//
+
+NAMESPACE_GRAPHICS_END
\ No newline at end of file
@@ -0,0 +1,70 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Graphics/API.h"
+#include "Graphics/RecordingRenderBackend.h"
+
+NAMESPACE_GRAPHICS_BEGIN
+
+//-----------------------------------//
+
+RecordingRenderBackend::RecordingRenderBackend()
+	: keepCommands(true)
+{
+	clearCommands();
+}
+
+//-----------------------------------//
+
+void RecordingRenderBackend::recordCommand(RenderCommandType type, const void* object, uint32 arg)
+{
+	commandCounts[(size_t) type]++;
+
+	if( !keepCommands ) return;
+
+	RenderCommand command;
+	command.type = type;
+	command.arg = arg;
+	command.object = object;
+
+	commands.pushBack(command);
+}
+
+//-----------------------------------//
+
+uint32 RecordingRenderBackend::getCommandCount(RenderCommandType type) const
+{
+	if( type >= RenderCommandType::Count ) return 0;
+	return commandCounts[(size_t) type];
+}
+
+//-----------------------------------//
+
+void RecordingRenderBackend::clearCommands()
+{
+	commands.clear();
+
+	for( size_t i = 0; i < (size_t) RenderCommandType::Count; i++ )
+		commandCounts[i] = 0;
+}
+
+//-----------------------------------//
+
+void RecordingRenderBackend::logCommands() const
+{
+	for( size_t i = 0; i < commands.size(); i++ )
+	{
+		const RenderCommand& command = commands[i];
+
+		LogDebug("%s %p %u", RenderCommandTypeGetName(command.type),
+			command.object, command.arg);
+	}
+}
+
+//-----------------------------------//
+
+NAMESPACE_GRAPHICS_END
\ No newline at end of file
@@ -0,0 +1,86 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Graphics/API.h"
+#include "Graphics/RenderCommandBuffer.h"
+
+NAMESPACE_GRAPHICS_BEGIN
+
+//-----------------------------------//
+
+// Size of the frame memory of each command buffer.
+static const int32 CommandBufferFrameSize = 1 << 20;
+
+RenderCommandBuffer::RenderCommandBuffer()
+{
+	frameAllocator = AllocatorCreateBump(GetRenderAllocator(), CommandBufferFrameSize);
+	AllocatorSetGroup(frameAllocator, "Commands");
+}
+
+//-----------------------------------//
+
+RenderCommandBuffer::~RenderCommandBuffer()
+{
+	AllocatorDestroy(frameAllocator);
+}
+
+//-----------------------------------//
+
+void RenderCommandBuffer::draw(const RenderState& state)
+{
+	RenderDrawCommand command;
+	command.state = &state;
+	command.instances = nullptr;
+	command.instanceMatrices = nullptr;
+	command.numInstances = 0;
+
+	commands.pushBack(command);
+}
+
+//-----------------------------------//
+
+bool RenderCommandBuffer::drawInstanced(const RenderState* const* states, uint32 numInstances)
+{
+	int32 statesSize = numInstances * sizeof(RenderState*);
+	int32 matricesSize = numInstances * sizeof(Matrix4x4);
+
+	const RenderState** instances = (const RenderState**) AllocatorAllocate(
+		frameAllocator, statesSize, alignof(RenderState*));
+
+	Matrix4x4* matrices = (Matrix4x4*) AllocatorAllocate(
+		frameAllocator, matricesSize, alignof(Matrix4x4));
+
+	if( !instances || !matrices )
+		return false;
+
+	for( uint32 i = 0; i < numInstances; i++ )
+	{
+		instances[i] = states[i];
+		matrices[i] = Matrix4x4(states[i]->modelMatrix);
+	}
+
+	RenderDrawCommand command;
+	command.state = states[0];
+	command.instances = instances;
+	command.instanceMatrices = matrices;
+	command.numInstances = numInstances;
+
+	commands.pushBack(command);
+	return true;
+}
+
+//-----------------------------------//
+
+void RenderCommandBuffer::reset()
+{
+	commands.clear();
+	AllocatorReset(frameAllocator);
+}
+
+//-----------------------------------//
+
+NAMESPACE_GRAPHICS_END
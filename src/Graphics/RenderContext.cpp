@@ -42,6 +42,19 @@ RenderContext::RenderContext()
 
 //-----------------------------------//
 
+RenderContext::RenderContext(RenderBackend* backend)
+	: currentTarget(nullptr)
+	, bufferManager(nullptr)
+	, textureManager(nullptr)
+	, programManager(nullptr)
+	, caps(nullptr)
+	, initDone(false)
+	, backend(backend)
+{
+}
+
+//-----------------------------------//
+
 RenderContext::~RenderContext()
 {
 	LogInfo("Destroying rendering context");
@@ -106,6 +119,8 @@ void RenderContext::showCapabilities(RenderCapabilities* card)
 	LogInfo( "OpenGL shading language: %s", card->shadingLanguageVersion.c_str() );
 	
 	LogInfo("Supports vertex buffers: ", card->supportsVertexBuffers ? "yes" : "no" );
+	LogInfo("Supports uniform buffers: %s", card->supportsUniformBuffers ? "yes" : "no" );
+	LogInfo("Supports instancing: %s", card->supportsInstancing ? "yes" : "no" );
 	LogInfo( "Max texture size: %dx%d", card->maxTextureSize, card->maxTextureSize );
 	LogInfo( "Max texture units: %d", card->maxTextureUnits );
 	LogInfo( "Max vertex attributes: %d", card->maxAttribs );
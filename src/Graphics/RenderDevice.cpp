@@ -10,10 +10,13 @@
 #ifdef ENABLE_RENDERER_OPENGL
 
 #include "Graphics/RenderDevice.h"
+#include "Graphics/FrameStatistics.h"
 #include "Graphics/RenderContext.h"
 #include "Graphics/RenderBackend.h"
 #include "Graphics/RenderBatch.h"
 #include "Graphics/RenderView.h"
+#include "Graphics/RenderCapabilities.h"
+#include "Graphics/RenderCommandBuffer.h"
 #include "Graphics/ShaderProgram.h"
 #include "Graphics/GeometryBuffer.h"
 
@@ -21,8 +24,11 @@
 #include "Graphics/ShaderProgramManager.h"
 #include "Graphics/TextureManager.h"
 
+#include "Resources/ResourceManager.h"
+
 #include "Core/Utilities.h"
-#include <algorithm>
+#include "Core/Sort.h"
+#include "Core/Task.h"
 
 NAMESPACE_GRAPHICS_BEGIN
 
@@ -36,16 +42,29 @@ REFLECT_ENUM_END()
 
 //-----------------------------------//
 
+// Maximum number of instances drawn by a single instanced draw.
+static const size_t MaxInstancesPerDraw = 1024;
+
+// Minimum number of states recorded by each thread.
+static const size_t MinStatesPerRecordSlice = 256;
+
+// Priority of the recording tasks over the other queued tasks.
+static const int16 RecordTaskPriority = 100;
+
 static RenderDevice* gs_RenderDevice = nullptr;
 RenderDevice* GetRenderDevice() { return gs_RenderDevice; }
 
 RenderDevice::RenderDevice()
-	: activeContext(nullptr)
+	: numCommandBuffers(0)
+	, taskPool(nullptr)
+	, pipeline(RenderPipeline::ShaderForward)
 	, activeTarget(nullptr)
-	, activeView(nullptr)
+	, activeContext(nullptr)
 	, renderBackend(nullptr)
+	, activeView(nullptr)
+	, frameStats(nullptr)
+	, frameNumber(0)
 	//, shadowDepthBuffer(nullptr)
-	, pipeline(RenderPipeline::ShaderForward)
 {
 	gs_RenderDevice = this;
 }
@@ -54,6 +73,11 @@ RenderDevice::RenderDevice()
 
 RenderDevice::~RenderDevice()
 {
+	for( size_t i = 0; i < commandBuffers.size(); i++ )
+	{
+		Deallocate(commandBuffers[i]);
+		Deallocate(recordJobs[i]);
+	}
 }
 
 //-----------------------------------//
@@ -64,30 +88,173 @@ void RenderDevice::updateRenderTargets()
 
 //-----------------------------------//
 
-static bool RenderStateSorter(const RenderState& lhs, const RenderState& rhs)
+void RenderDevice::sortRenderQueue( RenderQueue& queue )
 {
-	int rA = (int) lhs.renderable->getRenderLayer();
-	int rB = (int) rhs.renderable->getRenderLayer();
-	int pA = lhs.priority;
-	int pB = rhs.priority;
+	size_t count = queue.size();
+
+	sortOrder.resize(count);
+	sortTempOrder.resize(count);
+	sortKeys.resize(count);
+	sortTempKeys.resize(count);
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		RenderState& state = queue[i];
+
+		// States not built by a camera cull have no depth information.
+		if( state.sortKey == 0 )
+			state.sortKey = RenderStateMakeSortKey(state, 0);
+
+		sortKeys[i] = state.sortKey;
+		sortOrder[i] = (uint32) i;
+	}
 
-	return (rA == rB) ? (pA < pB) : (rA < rB);
+	RadixSort(sortKeys.data(), sortOrder.data(), count,
+		sortTempKeys.data(), sortTempOrder.data());
 }
 
 //-----------------------------------//
 
 void RenderDevice::render( RenderBlock& queue ) 
 {
-	#pragma TODO("Sort the render group by depth distance")
+	// Sort the renderables by their state keys.
+	sortRenderQueue( queue.renderables );
+
+	// Record the sorted queue into command buffers.
+	recordRenderQueue( queue.renderables );
+
+	// Replay the command buffers in the order of the queue slices.
+	for( size_t i = 0; i < numCommandBuffers; i++ )
+		submitCommands( *commandBuffers[i], queue.lights );
+
+	flushState();
+}
+
+//-----------------------------------//
+
+struct RenderRecordJob
+{
+	Task task;
+	RenderCommandBuffer* buffer;
+	const RenderQueue* queue;
+	size_t start;
+	size_t end;
+};
+
+void RenderDevice::recordRenderQueue( const RenderQueue& queue )
+{
+	size_t count = sortOrder.size();
+
+	// Split the queue in slices, one per thread, as long as each slice
+	// has enough states to be worth recording in another thread.
+	size_t maxSlices = taskPool ? taskPool->threads.size() + 1 : 1;
+	size_t numSlices = count / MinStatesPerRecordSlice;
+	numSlices = std::max<size_t>(1, std::min(numSlices, maxSlices));
+
+	while( commandBuffers.size() < numSlices )
+	{
+		commandBuffers.pushBack( AllocateGraphics(RenderCommandBuffer) );
+
+		RenderRecordJob* job = AllocateGraphics(RenderRecordJob);
+		job->task.callback.Bind(this, &RenderDevice::runRecordJob);
+		job->task.userdata = job;
+		job->task.priority = RecordTaskPriority;
+		recordJobs.pushBack(job);
+	}
 
-	// Sort the renderables by render group.
-	std::sort( queue.renderables.begin(), queue.renderables.end(), &RenderStateSorter );
+	numCommandBuffers = numSlices;
 
-	// Render all the renderables in the queue.
-	for( size_t i = 0; i < queue.renderables.size(); i++ )
+	size_t sliceSize = (count + numSlices - 1) / numSlices;
+
+	recordTasks.setTaskPool(taskPool);
+
+	// The first slice is recorded by this thread.
+	for( size_t i = 1; i < numSlices; i++ )
 	{
-		const RenderState& state = queue.renderables[i];
-		render(state, queue.lights);
+		RenderRecordJob* job = recordJobs[i];
+		job->buffer = commandBuffers[i];
+		job->queue = &queue;
+		job->start = i * sliceSize;
+		job->end = std::min(job->start + sliceSize, count);
+
+		recordTasks.add(&job->task);
+	}
+
+	recordCommands( *commandBuffers[0], queue, 0, std::min(sliceSize, count) );
+
+	// Record the slices no thread has started while waiting for the others.
+	recordTasks.wait();
+}
+
+//-----------------------------------//
+
+void RenderDevice::runRecordJob(Task* task)
+{
+	RenderRecordJob* job = (RenderRecordJob*) task->userdata;
+	recordCommands( *job->buffer, *job->queue, job->start, job->end );
+}
+
+//-----------------------------------//
+
+void RenderDevice::recordCommands( RenderCommandBuffer& buffer, const RenderQueue& queue,
+	size_t start, size_t end )
+{
+	buffer.reset();
+
+	// Merge the consecutive states that can be drawn with a single
+	// instanced draw.
+	const RenderState* instances[MaxInstancesPerDraw];
+
+	for( size_t i = start; i < end; )
+	{
+		const RenderState& state = queue[sortOrder[i]];
+		uint32 numInstances = countInstances(queue, i, end);
+
+		if( numInstances > 1 )
+		{
+			for( uint32 j = 0; j < numInstances; j++ )
+				instances[j] = &queue[sortOrder[i + j]];
+
+			if( buffer.drawInstanced(instances, numInstances) )
+			{
+				i += numInstances;
+				continue;
+			}
+		}
+
+		buffer.draw(state);
+		i++;
+	}
+}
+
+//-----------------------------------//
+
+void RenderDevice::submitCommands( const RenderCommandBuffer& buffer, const LightQueue& lights )
+{
+	const Array<RenderDrawCommand>& commands = buffer.getCommands();
+
+	for( size_t i = 0; i < commands.size(); i++ )
+	{
+		const RenderDrawCommand& command = commands[i];
+
+		if( command.numInstances == 0 )
+		{
+			renderState(*command.state, lights);
+			continue;
+		}
+
+		if( !isInstancingSupported(*command.state) )
+		{
+			// Programs that do not read the instance matrix are drawn
+			// once per instance instead.
+			for( uint32 j = 0; j < command.numInstances; j++ )
+				renderState(*command.instances[j], lights);
+
+			continue;
+		}
+
+		renderState(*command.state, lights, command.numInstances,
+			command.instanceMatrices);
 	}
 }
 
@@ -95,33 +262,132 @@ void RenderDevice::render( RenderBlock& queue )
 
 void RenderDevice::render( const RenderState& state, const LightQueue& lights )
 {
-	BufferManager* buffers = activeContext->bufferManager;
+	renderState(state, lights);
+	flushState();
+}
+
+//-----------------------------------//
+
+void RenderDevice::flushState()
+{
+	stateCache.flush();
+
+	if( frameStats )
+	{
+		frameStats->numStateChanges += stateCache.numStateChanges;
+		frameStats->numStateChangesElided += stateCache.numStateChangesElided;
+	}
+
+	stateCache.numStateChanges = 0;
+	stateCache.numStateChangesElided = 0;
+}
+
+//-----------------------------------//
+
+static bool CanDrawInstanced( const RenderState& first, const RenderState& state )
+{
+	if( first.material != state.material ) return false;
+
+	const RenderBatch* a = first.renderable;
+	const RenderBatch* b = state.renderable;
+
+	if( a == b ) return true;
+
+	// The hooks can set per-object state, so they need separate draws.
+	if( !b->onPreRender.empty() || !b->onPostRender.empty() )
+		return false;
+
+	return a->getGeometryBuffer() == b->getGeometryBuffer()
+		&& a->getPrimitiveType() == b->getPrimitiveType()
+		&& a->getPrimitiveRasterMode() == b->getPrimitiveRasterMode()
+		&& a->getRenderLayer() == b->getRenderLayer()
+		&& a->range.start == b->range.start
+		&& a->range.end == b->range.end;
+}
+
+//-----------------------------------//
+
+uint32 RenderDevice::countInstances( const RenderQueue& queue, size_t start, size_t end )
+{
+	const RenderCapabilities* caps = activeContext->caps;
+	if( !caps || !caps->supportsInstancing ) return 1;
+
+	const RenderState& first = queue[sortOrder[start]];
+	const RenderBatch* renderable = first.renderable;
+
+	if( renderable->getRenderLayer() == RenderLayer::Overlays )
+		return 1;
+
+	if( !renderable->onPreRender.empty() || !renderable->onPostRender.empty() )
+		return 1;
+
+	size_t last = start + 1;
+
+	while( last < end && last - start < MaxInstancesPerDraw )
+	{
+		const RenderState& state = queue[sortOrder[last]];
+		if( !CanDrawInstanced(first, state) ) break;
+		last++;
+	}
+
+	return (uint32) (last - start);
+}
+
+//-----------------------------------//
+
+// Gets the shader permutation the state is drawn with.
+static ShaderPermutationKey GetPermutationKey( const RenderState& state )
+{
+	ShaderPermutationKey key = 0;
+
+	const GeometryBuffer* gb = state.renderable->getGeometryBuffer().get();
+	if( gb && gb->declarations.find(VertexAttribute::BoneIndex) )
+		key |= ShaderFeature::Skinning;
+
+	const Material* material = state.material;
+	if( material->lighting ) key |= ShaderFeature::Lighting;
+	if( material->fog ) key |= ShaderFeature::Fog;
+
+	return key;
+}
+
+//-----------------------------------//
+
+bool RenderDevice::isInstancingSupported( const RenderState& state )
+{
+	ShaderMaterial* shader = state.material->getShader().Resolve();
+	ShaderProgram* program = activeContext->programManager->getProgram(shader,
+		GetPermutationKey(state));
+
+	return program && program->isInstancingSupported();
+}
+
+//-----------------------------------//
+
+void RenderDevice::renderState( const RenderState& state, const LightQueue& lights,
+	uint32 numInstances, const Matrix4x4* instanceMatrices )
+{
 	ProgramManager* programs = activeContext->programManager;
 	
 	RenderBatch* renderable = state.renderable;
-	bindBuffers(renderable);
 
 	const GeometryBuffer* gb = renderable->getGeometryBuffer().get();
 	if( gb->data.empty() ) return;
 
-	BufferEntry* bufs = buffers->getBuffer(gb);
-
-	// Setup the vertex buffer format.
-	VertexBuffer* vb = bufs->vb.get();
-	renderBackend->setupVertexBuffer(vb);
-	
 	Material* material = state.material;
 	ShaderMaterial* shader = material->getShader().Resolve();
 
-	ShaderProgram* shaderProgram = programs->getProgram(shader);
+	ShaderProgram* shaderProgram = programs->getProgram(shader, GetPermutationKey(state));
 	if( !shaderProgram ) return;
 
 	if( !shaderProgram->isLinked() && !shaderProgram->link() )
 		return;
 
-	shaderProgram->bind();
+	if( !bindBuffers(renderable) )
+		return;
 
-	renderBackend->setupRenderState(state, true);
+	stateCache.bindProgram(shaderProgram);
+	stateCache.setRasterState(state);
 	bindTextureUnits(state, true);
 
 	if( !renderable->onPreRender.empty() )
@@ -146,24 +412,74 @@ void RenderDevice::render( const RenderState& state, const LightQueue& lights )
 			return;
 	}
 
+	static const UniformSlot s_Instanced = UniformSlotGet("vp_Instanced");
+
 	UniformBuffer* ub = renderable->getUniformBuffer().get();
+	ub->setUniform( s_Instanced, (int32) (numInstances > 0) );
 	shaderProgram->setUniforms(ub);
 
-	renderBackend->renderBatch(renderable);
+	if( numInstances > 0 )
+		renderBackend->renderBatchInstanced(renderable, instanceMatrices, numInstances);
+	else
+		renderBackend->renderBatch(renderable);
+
+	if( frameStats )
+	{
+		frameStats->numDrawCalls++;
+
+		if( numInstances > 0 )
+		{
+			frameStats->numInstancedDrawCalls++;
+			frameStats->numInstances += numInstances;
+		}
+	}
 	
 	if( !renderable->onPostRender.empty() )
 	{
 		// Call the user post render hook.
 		renderable->onPostRender(activeView, state);
 	}
-	
-	renderBackend->unsetupRenderState(state);
-	unbindTextureUnits(state.material);
-	
-	shaderProgram->unbind();
+}
+
+//-----------------------------------//
+
+struct TextureUniformSlots
+{
+	TextureUniformSlots()
+	{
+		char name[] = "vp_Texture00";
+
+		for( uint8 i = 0; i < RenderStateCacheTextureUnits; i++ )
+		{
+			// Units below ten have a single digit.
+			if( i < 10 )
+			{
+				name[10] = '0' + i;
+				name[11] = '\0';
+			}
+			else
+			{
+				name[10] = '0' + i / 10;
+				name[11] = '0' + i % 10;
+			}
+
+			slots[i] = UniformSlotGet(name);
+		}
+	}
+
+	UniformSlot slots[RenderStateCacheTextureUnits];
+};
+
+static UniformSlot GetTextureUniformSlot(uint8 index)
+{
+	static const TextureUniformSlots s_TextureSlots;
 
-	renderBackend->unbindVertexBuffer(vb);
-	unbindBuffers(renderable);
+	if( index < RenderStateCacheTextureUnits )
+		return s_TextureSlots.slots[index];
+
+	char name[16];
+	sprintf(name, "vp_Texture%d", index);
+	return UniformSlotGet(name);
 }
 
 //-----------------------------------//
@@ -173,55 +489,73 @@ void RenderDevice::bindTextureUnits(const RenderState& state, bool bindUniforms)
 	TextureUnitMap& units = state.material->textureUnits;
 	UniformBuffer* ub = state.renderable->getUniformBuffer().get();
 
+	float screenSize = -1;
+
 	for( auto it = units.begin(); it != units.end(); it++ )
 	{
 		auto& unit = it->value;
 		auto& handle = unit.image;
 
+		// Keep the image from being unloaded while it is drawn.
+		GetResourceManager()->touchResource(handle.Resolve());
+
 		Texture* texture = activeContext->textureManager->getTexture(handle).get();
 		if( !texture ) continue;
 
-		if( !texture->isUploaded() )
+		if( !texture->isUploaded() && !textureStreamer.stream(texture, taskPool) )
 		{
 			renderBackend->uploadTexture(texture);
 			renderBackend->configureTexture(texture);
+
+			// Uploading binds the texture behind the cache.
+			stateCache.invalidateTextures();
+		}
+
+		if( textureStreamer.isStreaming(texture) )
+		{
+			if( screenSize < 0 )
+				screenSize = getScreenSize(state);
+
+			textureStreamer.request(texture, screenSize);
 		}
 
-		renderBackend->bindTexture(texture);
-		renderBackend->setupTextureUnit(texture, unit);
+		stateCache.bindTexture(texture, unit);
 		
 		if( !bindUniforms ) continue;
 
-		char s_TextureUniform[] = "vp_Texture0";
-		size_t s_TextureUniformSize = FLD_ARRAY_SIZE(s_TextureUniform) - 2;
-
-		// Build the uniform string without allocating memory.
 		uint8 index = unit.unit;
-		char indexChar = (index + '0');
-		
-		s_TextureUniform[s_TextureUniformSize] = indexChar;
-		ub->setUniform( s_TextureUniform, (int32) index );
+		ub->setUniform( GetTextureUniformSlot(index), (int32) index );
 	}
 }
 
 //-----------------------------------//
 
-void RenderDevice::unbindTextureUnits(Material* material)
+float RenderDevice::getScreenSize(const RenderState& state) const
 {
-	TextureUnitMap& units = material->textureUnits;
-	TextureManager* textureManager = activeContext->textureManager;
+	float viewHeight = (float) activeView->getSize().y;
 
-	for( auto it = units.begin(); it != units.end(); it++ )
-	{
-		auto& unit = it->value;
-		auto& handle = unit.image;
+	if( state.renderable->getRenderLayer() == RenderLayer::Overlays )
+		return viewHeight;
 
-		Texture* texture = textureManager->getTexture(handle).get();
-		if( !texture ) continue;
+	// Batches have no bounds, so the size of the object is estimated
+	// from the scale of its model matrix.
+	const Matrix4x3& model = state.modelMatrix;
 
-		renderBackend->setupTextureUnit(texture, unit);
-		renderBackend->unbindTexture(texture);
-	}
+	float scale = std::max( Vector3(model.m11, model.m12, model.m13).length(),
+		std::max( Vector3(model.m21, model.m22, model.m23).length(),
+		Vector3(model.m31, model.m32, model.m33).length() ) );
+
+	const Matrix4x4& projection = activeView->projectionMatrix;
+	float size = scale * projection.m22 * viewHeight * 0.5f;
+
+	// Orthographic projections do not shrink with the distance.
+	if( projection.tw != 0 )
+		return size;
+
+	Vector3 position = activeView->viewMatrix * Vector3(model.tx, model.ty, model.tz);
+	float distance = std::max(std::abs(position.z), 0.01f);
+
+	return size / distance;
 }
 
 //-----------------------------------//
@@ -232,10 +566,14 @@ bool RenderDevice::setupRenderStateMatrix( const RenderState& state )
 	const Matrix4x3& matView = activeView->viewMatrix;
 	const Matrix4x4& matProjection = activeView->projectionMatrix;
 
+	static const UniformSlot s_ModelMatrix = UniformSlotGet("vp_ModelMatrix");
+	static const UniformSlot s_ViewMatrix = UniformSlotGet("vp_ViewMatrix");
+	static const UniformSlot s_ProjectionMatrix = UniformSlotGet("vp_ProjectionMatrix");
+
 	UniformBuffer* ub = state.renderable->getUniformBuffer().get();
-	ub->setUniform( "vp_ModelMatrix", matModel );
-	ub->setUniform( "vp_ViewMatrix", matView );
-	ub->setUniform( "vp_ProjectionMatrix", matProjection );
+	ub->setUniform( s_ModelMatrix, matModel );
+	ub->setUniform( s_ViewMatrix, matView );
+	ub->setUniform( s_ProjectionMatrix, matProjection );
 
 	return true;
 }
@@ -252,50 +590,64 @@ bool RenderDevice::bindBuffers(RenderBatch* renderable)
 	
 	if( !vb ) return false;
 
-	if( !vb->isBuilt() || gb->needsRebuild )
+	// Static geometry is packed in shared arenas, so new storage needs
+	// all of the data to be uploaded.
+	if( buffers->prepareVertexStorage(vb) )
+		gb->markDirty(0, gb->data.size());
+
+	if( ib && buffers->prepareIndexStorage(ib) )
+		gb->markIndexDirty(0, gb->indexData.size());
+
+	if( !vb->isBuilt() || gb->needsRebuild || isStreamExpired(vb) )
 	{
 		// If the vertex buffer is not built yet, then we build it.
 		renderBackend->buildVertexBuffer(vb);
+		vb->streamFrame = frameNumber;
+		stateCache.invalidateBuffers();
 	}
 
-	renderBackend->bindVertexBuffer(vb);
+	stateCache.bindVertexBuffer(vb);
 
-	// If there is no index buffer associated with the geometry, we are done.
-	if( !ib ) goto done;
+	// Unbind the previous index buffer if the geometry has none.
+	stateCache.bindIndexBuffer(ib);
 
-	renderBackend->bindIndexBuffer(ib);
-	
-	if( !ib->isBuilt || gb->needsRebuild )
+	if( ib && (!ib->isBuilt || gb->needsRebuild || isStreamExpired(ib)) )
 	{
 		// If the index buffer is not built, we also need to build it.
 		renderBackend->buildIndexBuffer(ib);
+		ib->streamFrame = frameNumber;
 	}
 
-done:
-
-	gb->needsRebuild = false;
+	gb->clearDirty();
 	return true;
 }
 
 //-----------------------------------//
 
-bool RenderDevice::unbindBuffers(RenderBatch* renderable)
+bool RenderDevice::isStreamExpired(const Buffer* buffer) const
 {
-	BufferManager* buffers = activeContext->bufferManager;
-	const GeometryBuffer* gb = renderable->getGeometryBuffer().get();
-	
-	VertexBuffer* vb = buffers->getVertexBuffer(gb).get();
-	if( !vb ) return false;
-	
-	renderBackend->unbindVertexBuffer(vb);
+	// Streamed data is only kept for the frame it was written in.
+	return buffer->isStreamed && buffer->streamFrame != frameNumber;
+}
 
-	IndexBuffer* ib = buffers->getIndexBuffer(gb).get();
-	if( ib ) renderBackend->unbindIndexBuffer(ib);
+//-----------------------------------//
 
-	return true;
+void RenderDevice::endFrame()
+{
+	if( renderBackend )
+	{
+		textureStreamer.update(renderBackend, frameStats);
+
+		// Uploading binds the textures behind the cache.
+		stateCache.invalidateTextures();
+		renderBackend->endFrame();
+	}
+
+	frameNumber++;
 }
 
 //-----------------------------------//
+
 #if 0
 void RenderDevice::updateLightDepth( LightState& state )
 {
@@ -455,6 +807,7 @@ void RenderDevice::setRenderTarget(RenderTarget* target)
 	activeContext = activeTarget->getContext();
 
 	renderBackend = activeContext->backend;
+	stateCache.setBackend(renderBackend);
 }
 
 //-----------------------------------//
@@ -8,12 +8,17 @@
 #include "Graphics/API.h"
 #include "Graphics/RenderQueue.h"
 #include "Graphics/RenderBatch.h"
+#include "Core/Math/Helpers.h"
 
 NAMESPACE_GRAPHICS_BEGIN
 
 //-----------------------------------//
 
 RenderState::RenderState()
+	: renderable(nullptr)
+	, material(nullptr)
+	, priority(0)
+	, sortKey(0)
 {
 }
 
@@ -23,6 +28,7 @@ RenderState::RenderState(RenderBatch* batch)
 	: renderable( batch )
 	, material( batch->getMaterial().Resolve() )
 	, priority( batch->getRenderPriority() )
+	, sortKey(0)
 {
 }
 
@@ -33,11 +39,78 @@ RenderState::RenderState(const RenderState& rhs)
 	, modelMatrix( rhs.modelMatrix )
 	, material( rhs.material )
 	, priority( rhs.priority )
+	, sortKey( rhs.sortKey )
 {
 }
 
 //-----------------------------------//
 
+static const uint64 SortDepthBits = 19;
+static const uint64 SortDepthMask = (1ULL << SortDepthBits) - 1;
+
+static uint64 RenderStateGetMaterialId(const Material* material)
+{
+	// Fold the pointer bits so materials spread over the key bits.
+	uint64 ptr = (uint64) (uintptr_t) material;
+	return ((ptr >> 4) ^ (ptr >> 16)) & 0xFFF;
+}
+
+static uint64 RenderStateGetTextureId(const Material* material)
+{
+	const TextureUnitMap& units = material->textureUnits;
+	if( units.empty() ) return 0;
+
+	return units.begin()->value.image.getId() & 0x3FF;
+}
+
+uint64 RenderStateMakeSortKey(const RenderState& state, float depth)
+{
+	RenderLayer layer = state.renderable->getRenderLayer();
+	
+	int32 priority = state.priority + 128;
+	MathClamp<int32>(priority, 0, 255);
+
+	uint64 key = ((uint64) layer & 0xF) << 60;
+	key |= (uint64) priority << 52;
+
+	Material* material = state.material;
+	if( !material ) return key;
+
+	uint64 program = material->getShader().getId() & 0x3FF;
+	uint64 materialId = RenderStateGetMaterialId(material);
+	uint64 texture = RenderStateGetTextureId(material);
+
+	// Overlays are sorted by priority only.
+	if( layer == RenderLayer::Overlays )
+		depth = 0;
+
+	MathClamp(depth, 0.0f, 1.0f);
+	uint64 depthBits = (uint64) (depth * SortDepthMask);
+
+	bool isTranslucent = layer >= RenderLayer::Transparency
+		|| material->isBlendingEnabled();
+
+	if( isTranslucent )
+	{
+		key |= 1ULL << 51;
+		key |= (SortDepthMask - depthBits) << 32;
+		key |= program << 22;
+		key |= materialId << 10;
+		key |= texture;
+	}
+	else
+	{
+		key |= program << 41;
+		key |= materialId << 29;
+		key |= texture << 19;
+		key |= depthBits;
+	}
+
+	return key;
+}
+
+//-----------------------------------//
+
 void RenderBlock::addState(RenderState renderState)
 {
     renderables.pushBack(renderState);
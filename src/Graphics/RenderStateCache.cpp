@@ -0,0 +1,211 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Graphics/API.h"
+#include "Graphics/RenderStateCache.h"
+#include "Graphics/RenderBackend.h"
+#include "Graphics/VertexBuffer.h"
+#include "Graphics/IndexBuffer.h"
+#include "Graphics/ShaderProgram.h"
+#include "Graphics/Texture.h"
+
+NAMESPACE_GRAPHICS_BEGIN
+
+//-----------------------------------//
+
+RenderStateCache::RenderStateCache()
+	: numStateChanges(0)
+	, numStateChangesElided(0)
+	, backend(nullptr)
+	, vertexBuffer(nullptr)
+	, indexBuffer(nullptr)
+	, program(nullptr)
+	, hasRasterState(false)
+{
+	invalidateTextures();
+}
+
+//-----------------------------------//
+
+void RenderStateCache::setBackend(RenderBackend* newBackend)
+{
+	if( backend == newBackend ) return;
+
+	flush();
+	backend = newBackend;
+}
+
+//-----------------------------------//
+
+void RenderStateCache::bindVertexBuffer(VertexBuffer* vb)
+{
+	if( vertexBuffer == vb )
+	{
+		numStateChangesElided++;
+		return;
+	}
+
+	backend->bindVertexBuffer(vb);
+	backend->setupVertexBuffer(vb);
+
+	vertexBuffer = vb;
+	numStateChanges++;
+}
+
+//-----------------------------------//
+
+void RenderStateCache::bindIndexBuffer(IndexBuffer* ib)
+{
+	if( indexBuffer == ib )
+	{
+		numStateChangesElided++;
+		return;
+	}
+
+	if( ib )
+		backend->bindIndexBuffer(ib);
+	else
+		backend->unbindIndexBuffer(indexBuffer);
+
+	indexBuffer = ib;
+	numStateChanges++;
+}
+
+//-----------------------------------//
+
+void RenderStateCache::bindProgram(ShaderProgram* newProgram)
+{
+	if( program == newProgram )
+	{
+		numStateChangesElided++;
+		return;
+	}
+
+	newProgram->bind();
+
+	program = newProgram;
+	numStateChanges++;
+}
+
+//-----------------------------------//
+
+static bool IsSameSampler(const TextureUnit& a, const TextureUnit& b)
+{
+	if( a.overrideModes != b.overrideModes )
+		return false;
+
+	// The texture modes are only set up when they are overriden.
+	if( !a.overrideModes )
+		return true;
+
+	return a.getFilterMode() == b.getFilterMode()
+		&& a.getMipMode() == b.getMipMode()
+		&& a.getWrapMode() == b.getWrapMode();
+}
+
+void RenderStateCache::bindTexture(Texture* texture, const TextureUnit& unit)
+{
+	uint8 index = unit.unit;
+
+	if( index < RenderStateCacheTextureUnits && textures[index] == texture
+		&& IsSameSampler(textureUnits[index], unit) )
+	{
+		numStateChangesElided++;
+		return;
+	}
+
+	backend->setupTextureUnit(texture, unit);
+	backend->bindTexture(texture);
+	numStateChanges++;
+
+	if( index >= RenderStateCacheTextureUnits )
+		return;
+
+	textures[index] = texture;
+
+	// Keep only the sampler modes, the image does not need to be held.
+	textureUnits[index] = unit;
+	textureUnits[index].image = ImageHandle();
+}
+
+//-----------------------------------//
+
+void RenderStateCache::setRasterState(const RenderState& state)
+{
+	if( hasRasterState && rasterState.material == state.material )
+	{
+		numStateChangesElided++;
+		return;
+	}
+
+	if( hasRasterState )
+		backend->unsetupRenderState(rasterState);
+
+	backend->setupRenderState(state, true);
+
+	rasterState = state;
+	hasRasterState = true;
+	numStateChanges++;
+}
+
+//-----------------------------------//
+
+void RenderStateCache::invalidateBuffers()
+{
+	vertexBuffer = nullptr;
+	indexBuffer = nullptr;
+}
+
+//-----------------------------------//
+
+void RenderStateCache::invalidateTextures()
+{
+	for( size_t i = 0; i < RenderStateCacheTextureUnits; ++i )
+		textures[i] = nullptr;
+}
+
+//-----------------------------------//
+
+void RenderStateCache::flush()
+{
+	if( !backend ) return;
+
+	if( hasRasterState )
+	{
+		backend->unsetupRenderState(rasterState);
+		hasRasterState = false;
+	}
+
+	for( size_t i = 0; i < RenderStateCacheTextureUnits; ++i )
+	{
+		Texture* texture = textures[i];
+		if( !texture ) continue;
+
+		backend->setupTextureUnit(texture, textureUnits[i]);
+		backend->unbindTexture(texture);
+	}
+
+	invalidateTextures();
+
+	if( program )
+	{
+		program->unbind();
+		program = nullptr;
+	}
+
+	if( vertexBuffer )
+		backend->unbindVertexBuffer(vertexBuffer);
+
+	if( indexBuffer )
+		backend->unbindIndexBuffer(indexBuffer);
+
+	invalidateBuffers();
+}
+
+//-----------------------------------//
+
+NAMESPACE_GRAPHICS_END
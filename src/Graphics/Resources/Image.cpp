@@ -98,6 +98,23 @@ uint32 Image::getSize()
 
 //-----------------------------------//
 
+uint64 Image::getMemoryUsage() const
+{
+	return buffer.size();
+}
+
+//-----------------------------------//
+
+bool Image::unload()
+{
+	buffer.clear();
+	buffer.trim();
+
+	return true;
+}
+
+//-----------------------------------//
+
 void Image::create(uint32 _width, uint32 _height, PixelFormat _format)
 {
 	this->width  = _width;
@@ -22,6 +22,8 @@ REFLECT_CHILD_CLASS(Material, Resource)
 	FIELD_PRIMITIVE(8, bool, lineSmooth)
 	FIELD_PRIMITIVE(9, float, lineWidth)
 	FIELD_PRIMITIVE(10, float, _isBlendingEnabled)
+	FIELD_PRIMITIVE(11, bool, lighting)
+	FIELD_PRIMITIVE(12, bool, fog)
 REFLECT_CLASS_END()
 
 //-----------------------------------//
@@ -66,6 +68,8 @@ Material::Material( const Material& rhs )
 	, depthOffset(rhs.depthOffset)
 	, lineSmooth(rhs.lineSmooth)
 	, lineWidth(rhs.lineWidth)
+	, lighting(rhs.lighting)
+	, fog(rhs.fog)
 	, source(rhs.source)
 	, destination(rhs.destination)
 	, _isBlendingEnabled(rhs._isBlendingEnabled)
@@ -94,6 +98,8 @@ void Material::init()
 	lineSmooth = false;
 	cullBackfaces = true;
 	lineWidth = DefaultLineWidth;
+	lighting = false;
+	fog = false;
 	_isBlendingEnabled = false;
 	source = BlendSource::One;
 	destination = BlendDestination::Zero;
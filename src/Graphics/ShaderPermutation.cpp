@@ -0,0 +1,185 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Graphics/API.h"
+#include "Graphics/ShaderPermutation.h"
+
+NAMESPACE_GRAPHICS_BEGIN
+
+//-----------------------------------//
+
+static const char* ShaderFeatureDefines[] =
+{
+	"FLD_SKINNING",
+	"FLD_LIGHTING",
+	"FLD_FOG"
+};
+
+const char* ShaderFeatureGetDefine(ShaderFeature::Enum feature)
+{
+	for( uint32 i = 0; i < ShaderFeatureCount; i++ )
+	{
+		if( feature == (1u << i) )
+			return ShaderFeatureDefines[i];
+	}
+
+	return nullptr;
+}
+
+//-----------------------------------//
+
+ShaderPermutationKey ShaderPermutationGetFeatures(const char* source)
+{
+	ShaderPermutationKey features = 0;
+	if( !source ) return features;
+
+	for( uint32 i = 0; i < ShaderFeatureCount; i++ )
+	{
+		if( strstr(source, ShaderFeatureDefines[i]) )
+			features |= 1u << i;
+	}
+
+	return features;
+}
+
+//-----------------------------------//
+
+void ShaderPermutationGetKeys(ShaderPermutationKey features, Array<ShaderPermutationKey>& keys)
+{
+	// Walk the subsets of the features, from the empty one up.
+	ShaderPermutationKey key = 0;
+
+	do
+	{
+		keys.pushBack(key);
+		key = (key - features) & features;
+	}
+	while( key != 0 );
+}
+
+//-----------------------------------//
+
+// Finds the start of the line after the version directive, or returns
+// zero if the source has no version directive.
+static size_t FindVersionEnd(const String& source)
+{
+	size_t pos = source.find("#version");
+	if( pos == String::npos ) return 0;
+
+	size_t end = source.find('\n', pos);
+	return (end == String::npos) ? source.size() : end + 1;
+}
+
+String ShaderPermutationExpand(const char* source, ShaderPermutationKey key)
+{
+	String text = source ? source : "";
+	if( key == 0 ) return text;
+
+	String defines;
+
+	for( uint32 i = 0; i < ShaderFeatureCount; i++ )
+	{
+		if( !(key & (1u << i)) ) continue;
+
+		defines += "#define ";
+		defines += ShaderFeatureDefines[i];
+		defines += "\n";
+	}
+
+	size_t pos = FindVersionEnd(text);
+
+	// Sources that end in the version directive need a line break.
+	if( pos > 0 && text[pos - 1] != '\n' )
+		defines.insert(0, "\n");
+
+	text.insert(pos, defines);
+	return text;
+}
+
+//-----------------------------------//
+
+bool ShaderPermutationValidate(const String& source, String& error)
+{
+	int32 depth = 0;
+	uint32 line = 0;
+	bool hasCode = false;
+
+	size_t start = 0;
+
+	while( start < source.size() )
+	{
+		size_t end = source.find('\n', start);
+		if( end == String::npos ) end = source.size();
+
+		line++;
+
+		size_t first = source.find_first_not_of(" \t\r", start);
+		bool isEmpty = (first == String::npos) || (first >= end);
+
+		String directive;
+
+		if( !isEmpty && source[first] == '#' )
+		{
+			size_t name = source.find_first_not_of(" \t", first + 1);
+			size_t nameEnd = source.find_first_of(" \t\r\n", name);
+			if( nameEnd == String::npos ) nameEnd = source.size();
+
+			if( name < end )
+				directive = source.substr(name, nameEnd - name);
+		}
+
+		if( directive == "version" )
+		{
+			if( hasCode )
+			{
+				error = StringFormat("Version directive is not first at line %u", line);
+				return false;
+			}
+		}
+		else if( directive == "if" || directive == "ifdef" || directive == "ifndef" )
+		{
+			depth++;
+		}
+		else if( directive == "else" || directive == "elif" )
+		{
+			if( depth == 0 )
+			{
+				error = StringFormat("#%s without #if at line %u", directive.c_str(), line);
+				return false;
+			}
+		}
+		else if( directive == "endif" )
+		{
+			if( depth == 0 )
+			{
+				error = StringFormat("#endif without #if at line %u", line);
+				return false;
+			}
+
+			depth--;
+		}
+
+		bool isComment = !isEmpty && source.compare(first, 2, "//") == 0;
+
+		if( !isEmpty && !isComment )
+			hasCode = true;
+
+		start = end + 1;
+	}
+
+	if( depth > 0 )
+	{
+		error = StringFormat("%d unterminated #if at the end", depth);
+		return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------//
+
+NAMESPACE_GRAPHICS_END
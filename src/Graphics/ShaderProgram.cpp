@@ -13,9 +13,10 @@ NAMESPACE_GRAPHICS_BEGIN
 //-----------------------------------//
 
 ShaderProgram::ShaderProgram()
-	: linked( false )
-	, vertex( nullptr )
+	: vertex( nullptr )
 	, fragment( nullptr )
+	, linked( false )
+	, supportsInstancing( false )
 { }
 
 //-----------------------------------//
@@ -47,4 +48,11 @@ bool ShaderProgram::isLinked() const
 
 //-----------------------------------//
 
+bool ShaderProgram::isInstancingSupported() const
+{
+	return supportsInstancing;
+}
+
+//-----------------------------------//
+
 NAMESPACE_GRAPHICS_END
\ No newline at end of file
@@ -14,13 +14,16 @@
 #include "Graphics/Resources/ShaderMaterial.h"
 #include "Resources/ResourceManager.h"
 #include "Core/Utilities.h"
+#include "Core/Timer.h"
 
 NAMESPACE_GRAPHICS_BEGIN
 
 //-----------------------------------//
 
 ProgramManager::ProgramManager(RenderBackend* backend)
-	: backend(backend)
+	: numPrecompiled(0)
+	, precompileTime(0)
+	, backend(backend)
 {
 	GetResourceManager()->onResourceLoaded.Connect( this, &ProgramManager::onLoad );
 	GetResourceManager()->onResourceReloaded.Connect( this, &ProgramManager::onReload );
@@ -42,19 +45,25 @@ ProgramManager::~ProgramManager()
 	}
 #endif
 
+	for( auto it = programs.begin(); it != programs.end(); ++it )
+	{
+		ShaderPermutations* permutations = it->value;
+		Deallocate(permutations);
+	}
+
 	GetResourceManager()->onResourceLoaded.Disconnect( this, &ProgramManager::onLoad );
 	GetResourceManager()->onResourceReloaded.Disconnect( this, &ProgramManager::onReload );
 }
 
 //-----------------------------------//
 
-ShaderProgram* ProgramManager::createProgram( const ShaderMaterial* shader )
+ShaderProgram* ProgramManager::createProgram( const ShaderMaterial* shader, ShaderPermutationKey key )
 {
 	// If the program was not yet found, then we need to create it.
 	ShaderProgram* program = backend->createProgram();
 	
-	program->getVertexShader()->setText( shader->getVertexSource() );
-	program->getFragmentShader()->setText( shader->getFragmentSource() );
+	program->getVertexShader()->setText( ShaderPermutationExpand(shader->getVertexSource(), key) );
+	program->getFragmentShader()->setText( ShaderPermutationExpand(shader->getFragmentSource(), key) );
 
 	// Force the recompilation of all shaders in the program.
 	program->forceRecompile();
@@ -64,16 +73,34 @@ ShaderProgram* ProgramManager::createProgram( const ShaderMaterial* shader )
 
 //-----------------------------------//
 
-ShaderProgram* ProgramManager::getProgram( const ShaderMaterial* shader, bool precompile )
+ShaderPermutations* ProgramManager::getPermutations( const ShaderMaterial* shader )
+{
+	ShaderPermutations* permutations = programs.get((uint64)shader, nullptr);
+	if( permutations ) return permutations;
+
+	permutations = AllocateGraphics(ShaderPermutations);
+	permutations->features = ShaderPermutationGetFeatures(shader->getVertexSource())
+		| ShaderPermutationGetFeatures(shader->getFragmentSource());
+
+	programs.set((uint64)shader, permutations);
+	return permutations;
+}
+
+//-----------------------------------//
+
+ShaderProgram* ProgramManager::getProgram( const ShaderMaterial* shader, ShaderPermutationKey key )
 {
 	if( !shader ) return nullptr;
 
-	auto program = programs.get((uint64)shader, nullptr).get();
+	ShaderPermutations* permutations = getPermutations(shader);
+	key &= permutations->features;
+
+	auto program = permutations->programs.get(key, nullptr).get();
 
 	if(!program)
 	{
-		program = createProgram(shader);
-		registerProgram(shader, program);
+		program = createProgram(shader, key);
+		registerProgram(shader, key, program);
 	}
 
 	return program;
@@ -81,20 +108,51 @@ ShaderProgram* ProgramManager::getProgram( const ShaderMaterial* shader, bool pr
 
 //-----------------------------------//
 
-bool ProgramManager::registerProgram( const ShaderMaterial* shader, ShaderProgram* program )
+bool ProgramManager::registerProgram( const ShaderMaterial* shader, ShaderPermutationKey key,
+	ShaderProgram* program )
 {
-	if( programs.has((uint64)shader) )
+	ShaderPermutations* permutations = getPermutations(shader);
+
+	if( permutations->programs.has(key) )
 	{
 		LogWarn( "Shader '%s' already registered", shader->getPath().c_str() );
 		return false;
 	}
 
-	programs.set((uint64)shader, program);
+	permutations->programs.set(key, program);
 	return true;
 }
 
 //-----------------------------------//
 
+void ProgramManager::precompileProgram( const ShaderMaterial* shader )
+{
+	ShaderPermutations* permutations = getPermutations(shader);
+
+	Array<ShaderPermutationKey> keys;
+	ShaderPermutationGetKeys(permutations->features, keys);
+
+	Timer timer;
+
+	for( size_t i = 0; i < keys.size(); i++ )
+	{
+		ShaderProgram* program = getProgram(shader, keys[i]);
+
+		if( !program->isLinked() && !program->link() )
+			continue;
+
+		numPrecompiled++;
+	}
+
+	float time = timer.getElapsed();
+	precompileTime += time;
+
+	LogInfo( "Precompiled %u permutations of shader '%s' in %.2f ms", (uint32) keys.size(),
+		shader->getPath().c_str(), time * 1000.0f );
+}
+
+//-----------------------------------//
+
 void ProgramManager::onLoad( const ResourceEvent& event )
 {
 	Resource* resource = event.handle.Resolve();
@@ -103,7 +161,7 @@ void ProgramManager::onLoad( const ResourceEvent& event )
 		return;
 
 	ShaderMaterial* shader = (ShaderMaterial*) resource;
-	getProgram(shader);
+	precompileProgram(shader);
 
 	LogInfo("Loaded shader '%s'", shader->getPath().c_str() );
 }
@@ -120,21 +178,32 @@ void ProgramManager::onReload( const ResourceEvent& event )
 	ShaderMaterial* oldShader = (ShaderMaterial*) event.oldResource;
 
 	#pragma TODO("Handle reloading of unregistered resources")
-	auto program = programs.get((uint64)oldShader, nullptr); // We need to hold the ref.
-	assert( programs.has((uint64)oldShader) );
+	ShaderPermutations* permutations = programs.get((uint64)oldShader, nullptr);
+	assert( permutations != nullptr );
 
 	programs.remove((uint64)oldShader);
 
 	ShaderMaterial* shader = (ShaderMaterial*) event.resource;
-	programs.set((uint64)shader, program);
+	programs.set((uint64)shader, permutations);
 
 	LogDebug( "Reloading shader '%s'", shader->getPath().c_str() );
 
-	program->getVertexShader()->setText( shader->getVertexSource() );
-	program->getFragmentShader()->setText( shader->getFragmentSource() );
+	// The new source can use other features. Permutations of features it
+	// does not use anymore are not requested again.
+	permutations->features = ShaderPermutationGetFeatures(shader->getVertexSource())
+		| ShaderPermutationGetFeatures(shader->getFragmentSource());
 
-	// Force the recompilation of all shader programs.
-	program->forceRecompile();
+	for( auto it = permutations->programs.begin(); it != permutations->programs.end(); ++it )
+	{
+		ShaderPermutationKey key = (ShaderPermutationKey) it->key;
+		ShaderProgram* program = it->value.get();
+
+		program->getVertexShader()->setText( ShaderPermutationExpand(shader->getVertexSource(), key) );
+		program->getFragmentShader()->setText( ShaderPermutationExpand(shader->getFragmentSource(), key) );
+
+		// Force the recompilation of all shader programs.
+		program->forceRecompile();
+	}
 }
 
 //-----------------------------------//
@@ -0,0 +1,89 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Graphics/API.h"
+#include "Graphics/StreamBuffer.h"
+
+NAMESPACE_GRAPHICS_BEGIN
+
+//-----------------------------------//
+
+StreamBuffer::StreamBuffer()
+{
+	reset(0);
+}
+
+//-----------------------------------//
+
+void StreamBuffer::reset(uint32 capacity)
+{
+	this->capacity = capacity;
+	head = 0;
+	used = 0;
+	frameSize = 0;
+	firstFrame = 0;
+	numFrames = 0;
+}
+
+//-----------------------------------//
+
+bool StreamBuffer::allocate(uint32 size, uint32 align, uint32& offset)
+{
+	if( size == 0 || size > capacity ) return false;
+
+	uint32 start = head;
+
+	if( align > 1 )
+		start = (start + align - 1) / align * align;
+
+	// The space skipped to wrap around is used by this frame too.
+	if( start + size > capacity )
+		start = 0;
+
+	uint32 skipped = (start >= head) ? start - head : capacity - head;
+
+	// The allocations are released in the order they were made, so the
+	// used space is contiguous and ends at the head.
+	if( used + skipped + size > capacity )
+		return false;
+
+	head = start + size;
+	used += skipped + size;
+	frameSize += skipped + size;
+
+	offset = start;
+	return true;
+}
+
+//-----------------------------------//
+
+void StreamBuffer::endFrame()
+{
+	assert( numFrames < StreamBufferMaxFrames );
+
+	uint32 index = (firstFrame + numFrames) % StreamBufferMaxFrames;
+	frameSizes[index] = frameSize;
+	numFrames++;
+
+	frameSize = 0;
+}
+
+//-----------------------------------//
+
+void StreamBuffer::releaseFrame()
+{
+	if( numFrames == 0 ) return;
+
+	used -= frameSizes[firstFrame];
+
+	firstFrame = (firstFrame + 1) % StreamBufferMaxFrames;
+	numFrames--;
+}
+
+//-----------------------------------//
+
+NAMESPACE_GRAPHICS_END
@@ -0,0 +1,115 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Graphics/API.h"
+#include "Graphics/BufferManager.h"
+#include <UnitTest++.h>
+
+using namespace fld;
+
+namespace {
+
+bool CheckRanges(const BufferArena& arena, const BufferArenaRange* ranges, size_t count)
+{
+	if( arena.freeRanges.size() != count )
+		return false;
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		if( arena.freeRanges[i].offset != ranges[i].offset ) return false;
+		if( arena.freeRanges[i].size != ranges[i].size ) return false;
+	}
+
+	return true;
+}
+
+}
+
+SUITE(Graphics)
+{
+	TEST(BufferArenaAllocate)
+	{
+		BufferArena arena(nullptr, 256);
+
+		uint32 a, b, c, d;
+		CHECK( arena.allocate(64, 1, a) );
+		CHECK( arena.allocate(32, 16, b) );
+		CHECK( arena.allocate(40, 16, c) );
+		CHECK_EQUAL( 0u, a );
+		CHECK_EQUAL( 64u, b );
+		CHECK_EQUAL( 96u, c );
+
+		// The alignment padding stays free before the allocation.
+		CHECK( arena.allocate(16, 16, d) );
+		CHECK_EQUAL( 144u, d );
+
+		BufferArenaRange aligned[] = { { 136, 8 }, { 160, 96 } };
+		CHECK( CheckRanges(arena, aligned, 2) );
+		CHECK_EQUAL( 152u, arena.usedBytes );
+		CHECK_EQUAL( 152u, arena.peakBytes );
+		CHECK_EQUAL( 4u, arena.numAllocations );
+
+		uint32 offset;
+		CHECK( !arena.allocate(0, 1, offset) );
+		CHECK( !arena.allocate(128, 1, offset) );
+	}
+
+	TEST(BufferArenaFree)
+	{
+		BufferArena arena(nullptr, 256);
+
+		uint32 a, b, c, d;
+		arena.allocate(64, 1, a);
+		arena.allocate(32, 16, b);
+		arena.allocate(40, 16, c);
+		arena.allocate(16, 16, d);
+
+		// A range between two allocations is kept on its own.
+		arena.free(b, 32);
+		BufferArenaRange freedB[] = { { 64, 32 }, { 136, 8 }, { 160, 96 } };
+		CHECK( CheckRanges(arena, freedB, 3) );
+		CHECK_EQUAL( 120u, arena.usedBytes );
+
+		// Freeing the range between two free ranges merges all of them.
+		arena.free(d, 16);
+		BufferArenaRange freedD[] = { { 64, 32 }, { 136, 120 } };
+		CHECK( CheckRanges(arena, freedD, 2) );
+
+		// A range before a free range is merged with it.
+		arena.free(a, 64);
+		BufferArenaRange freedA[] = { { 0, 96 }, { 136, 120 } };
+		CHECK( CheckRanges(arena, freedA, 2) );
+		CHECK_EQUAL( 40u, arena.usedBytes );
+		CHECK_EQUAL( 1u, arena.numAllocations );
+
+		// The free space is fragmented, so a bigger range does not fit.
+		uint32 offset;
+		CHECK( !arena.allocate(200, 1, offset) );
+
+		// Reallocating a whole free range removes it.
+		CHECK( arena.allocate(96, 16, offset) );
+		CHECK_EQUAL( 0u, offset );
+		BufferArenaRange reallocated[] = { { 136, 120 } };
+		CHECK( CheckRanges(arena, reallocated, 1) );
+		CHECK_EQUAL( 136u, arena.usedBytes );
+		CHECK_EQUAL( 152u, arena.peakBytes );
+
+		arena.free(c, 40);
+		arena.free(offset, 96);
+
+		BufferArenaRange empty[] = { { 0, 256 } };
+		CHECK( CheckRanges(arena, empty, 1) );
+		CHECK_EQUAL( 0u, arena.usedBytes );
+		CHECK_EQUAL( 0u, arena.numAllocations );
+		CHECK_EQUAL( 152u, arena.peakBytes );
+
+		// The whole storage can be allocated again.
+		CHECK( arena.allocate(256, 16, offset) );
+		CHECK( arena.freeRanges.empty() );
+		CHECK( !arena.allocate(1, 1, offset) );
+	}
+}
@@ -0,0 +1,78 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Graphics/API.h"
+#include "Graphics/NullRenderBackend.h"
+#include "Graphics/GeometryBuffer.h"
+#include "Graphics/VertexBuffer.h"
+#include "Graphics/IndexBuffer.h"
+#include <UnitTest++.h>
+
+using namespace fld;
+
+SUITE(Graphics)
+{
+	TEST(NullRenderBackendUploadBytes)
+	{
+		NullRenderBackend backend;
+
+		uint8 data[64] = { 0 };
+
+		GeometryBuffer gb;
+		gb.set(data, 64);
+		gb.setIndex(data, 12);
+
+		VertexBufferPtr vb = backend.createVertexBuffer();
+		vb->setGeometryBuffer(&gb);
+
+		IndexBufferPtr ib = backend.createIndexBuffer();
+		ib->setGeometryBuffer(&gb);
+
+		// The first build uploads all the data.
+		backend.buildVertexBuffer(vb.get());
+		backend.buildIndexBuffer(ib.get());
+		CHECK_EQUAL( 76u, backend.frameUploadBytes );
+
+		backend.endFrame();
+		CHECK_EQUAL( 76u, backend.lastFrameUploadBytes );
+		CHECK_EQUAL( 0u, backend.frameUploadBytes );
+
+		// Only the changed range is uploaded once the storage exists.
+		gb.clearDirty();
+		gb.markDirty(8, 16);
+		backend.buildVertexBuffer(vb.get());
+		CHECK_EQUAL( 16u, backend.frameUploadBytes );
+
+		// Data that grows has to be uploaded again as a whole.
+		gb.add(data, 32);
+		backend.buildVertexBuffer(vb.get());
+		CHECK_EQUAL( 16u + 96u, backend.frameUploadBytes );
+
+		backend.endFrame();
+		CHECK_EQUAL( 112u, backend.lastFrameUploadBytes );
+
+		// Dynamic data is streamed as a whole every time.
+		GeometryBuffer dynamic(BufferUsage::Dynamic, BufferAccess::Write);
+		dynamic.set(data, 32);
+
+		VertexBufferPtr dynamicVB = backend.createVertexBuffer();
+		dynamicVB->setGeometryBuffer(&dynamic);
+
+		backend.buildVertexBuffer(dynamicVB.get());
+		dynamic.clearDirty();
+		dynamic.markDirty(0, 4);
+		backend.buildVertexBuffer(dynamicVB.get());
+
+		CHECK( dynamicVB->isStreamed );
+		CHECK_EQUAL( 64u, backend.frameUploadBytes );
+
+		// Frames without uploads report no bytes.
+		backend.endFrame();
+		backend.endFrame();
+		CHECK_EQUAL( 0u, backend.lastFrameUploadBytes );
+	}
+}
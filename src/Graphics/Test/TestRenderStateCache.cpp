@@ -0,0 +1,183 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Graphics/API.h"
+#include "Graphics/RecordingRenderBackend.h"
+#include "Graphics/RenderStateCache.h"
+#include "Graphics/VertexBuffer.h"
+#include "Graphics/IndexBuffer.h"
+#include "Graphics/ShaderProgram.h"
+#include "Graphics/Texture.h"
+#include <UnitTest++.h>
+
+using namespace fld;
+
+namespace {
+
+struct RecordedCommand
+{
+	RenderCommandType type;
+	const void* object;
+	uint32 arg;
+};
+
+}
+
+SUITE(Graphics)
+{
+	TEST(RecordingRenderBackend)
+	{
+		RecordingRenderBackend backend;
+
+		VertexBufferPtr vb = backend.createVertexBuffer();
+		TexturePtr texture = backend.createTexture();
+
+		backend.bindVertexBuffer(vb.get());
+		backend.bindTexture(texture.get());
+		backend.endFrame();
+
+		CHECK_EQUAL( 3u, backend.getCommands().size() );
+		CHECK_EQUAL( 1u, backend.getCommandCount(RenderCommandType::BindVertexBuffer) );
+		CHECK_EQUAL( 1u, backend.getCommandCount(RenderCommandType::EndFrame) );
+		CHECK_EQUAL( 0u, backend.getCommandCount(RenderCommandType::Draw) );
+
+		// Only the counts are recorded when the stream is not kept.
+		backend.clearCommands();
+		backend.keepCommands = false;
+		backend.bindTexture(texture.get());
+
+		CHECK( backend.getCommands().empty() );
+		CHECK_EQUAL( 1u, backend.getCommandCount(RenderCommandType::BindTexture) );
+	}
+
+	TEST(RenderStateCacheElision)
+	{
+		RecordingRenderBackend backend;
+
+		RenderStateCache cache;
+		cache.setBackend(&backend);
+
+		VertexBufferPtr vb = backend.createVertexBuffer();
+		IndexBufferPtr ib = backend.createIndexBuffer();
+		ShaderProgramPtr program = backend.createProgram();
+		TexturePtr texture = backend.createTexture();
+
+		TextureUnit unit;
+		unit.unit = 1;
+
+		// The null backend only records the material pointers.
+		int32 materials[2];
+		RenderState stateA;
+		stateA.material = (Material*) &materials[0];
+		RenderState stateB;
+		stateB.material = (Material*) &materials[1];
+
+		// Two draws that share all the state but the material.
+		for( size_t i = 0; i < 2; i++ )
+		{
+			cache.bindProgram(program.get());
+			cache.bindVertexBuffer(vb.get());
+			cache.bindIndexBuffer(ib.get());
+			cache.bindTexture(texture.get(), unit);
+			cache.setRasterState(i == 0 ? stateA : stateB);
+		}
+
+		CHECK_EQUAL( 6u, cache.numStateChanges );
+		CHECK_EQUAL( 4u, cache.numStateChangesElided );
+
+		cache.flush();
+
+		RecordedCommand expected[] =
+		{
+			{ RenderCommandType::BindProgram, program.get(), 0 },
+			{ RenderCommandType::BindVertexBuffer, vb.get(), 0 },
+			{ RenderCommandType::SetupVertexBuffer, vb.get(), 0 },
+			{ RenderCommandType::BindIndexBuffer, ib.get(), 0 },
+			{ RenderCommandType::SetupTextureUnit, texture.get(), 1 },
+			{ RenderCommandType::BindTexture, texture.get(), 0 },
+			{ RenderCommandType::SetupRenderState, stateA.material, 0 },
+			{ RenderCommandType::UnsetupRenderState, stateA.material, 0 },
+			{ RenderCommandType::SetupRenderState, stateB.material, 0 },
+
+			// Flushing unbinds everything that is still bound.
+			{ RenderCommandType::UnsetupRenderState, stateB.material, 0 },
+			{ RenderCommandType::SetupTextureUnit, texture.get(), 1 },
+			{ RenderCommandType::UnbindTexture, texture.get(), 0 },
+			{ RenderCommandType::UnbindProgram, program.get(), 0 },
+			{ RenderCommandType::UnbindVertexBuffer, vb.get(), 0 },
+			{ RenderCommandType::UnbindIndexBuffer, ib.get(), 0 },
+		};
+
+		const Array<RenderCommand>& commands = backend.getCommands();
+		size_t numExpected = sizeof(expected) / sizeof(expected[0]);
+
+		CHECK_EQUAL( numExpected, commands.size() );
+		if( commands.size() != numExpected ) return;
+
+		for( size_t i = 0; i < numExpected; i++ )
+		{
+			CHECK( commands[i].type == expected[i].type );
+			CHECK_EQUAL( expected[i].object, commands[i].object );
+			CHECK_EQUAL( expected[i].arg, commands[i].arg );
+		}
+
+		// Nothing is bound after the flush, so all the state is bound again.
+		backend.clearCommands();
+		cache.bindProgram(program.get());
+		cache.bindVertexBuffer(vb.get());
+
+		CHECK_EQUAL( 1u, backend.getCommandCount(RenderCommandType::BindProgram) );
+		CHECK_EQUAL( 1u, backend.getCommandCount(RenderCommandType::BindVertexBuffer) );
+
+		cache.flush();
+	}
+
+	TEST(RenderStateCacheSamplerModes)
+	{
+		RecordingRenderBackend backend;
+
+		RenderStateCache cache;
+		cache.setBackend(&backend);
+
+		TexturePtr texture = backend.createTexture();
+
+		{
+			TextureUnit unit;
+			unit.unit = 2;
+			cache.bindTexture(texture.get(), unit);
+
+			// Units that do not override the modes share the same sampler.
+			TextureUnit other;
+			other.unit = 2;
+			cache.bindTexture(texture.get(), other);
+
+			CHECK_EQUAL( 1u, cache.numStateChanges );
+			CHECK_EQUAL( 1u, cache.numStateChangesElided );
+
+			// The same texture with other sampler modes is set up again.
+			other.setWrapMode(TextureWrapMode::Clamp);
+			cache.bindTexture(texture.get(), other);
+			cache.bindTexture(texture.get(), other);
+
+			CHECK_EQUAL( 2u, cache.numStateChanges );
+			CHECK_EQUAL( 2u, cache.numStateChangesElided );
+
+			other.setFilterMode(TextureFilterMode::Nearest);
+			cache.bindTexture(texture.get(), other);
+
+			CHECK_EQUAL( 3u, cache.numStateChanges );
+			CHECK_EQUAL( 3u, backend.getCommandCount(RenderCommandType::SetupTextureUnit) );
+		}
+
+		// The cache keeps its own copy of the texture units to flush them.
+		backend.clearCommands();
+		cache.flush();
+
+		CHECK_EQUAL( 1u, backend.getCommandCount(RenderCommandType::SetupTextureUnit) );
+		CHECK_EQUAL( 1u, backend.getCommandCount(RenderCommandType::UnbindTexture) );
+	}
+}
@@ -0,0 +1,105 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Graphics/API.h"
+#include "Graphics/ShaderPermutation.h"
+#include <UnitTest++.h>
+
+using namespace fld;
+
+namespace {
+
+const char* VertexSource =
+	"#version 120\n"
+	"#ifdef FLD_LIGHTING\n"
+	"varying vec3 normal;\n"
+	"#endif\n"
+	"void main() {}\n";
+
+const char* FragmentSource =
+	"#version 120\n"
+	"#if defined(FLD_FOG)\n"
+	"uniform float fogDensity;\n"
+	"#endif\n"
+	"void main() {}\n";
+
+}
+
+SUITE(Graphics)
+{
+	TEST(ShaderPermutationFeatures)
+	{
+		ShaderPermutationKey features = ShaderPermutationGetFeatures(VertexSource)
+			| ShaderPermutationGetFeatures(FragmentSource);
+
+		CHECK_EQUAL( (uint32) (ShaderFeature::Lighting | ShaderFeature::Fog), features );
+		CHECK_EQUAL( 0u, ShaderPermutationGetFeatures("void main() {}") );
+		CHECK_EQUAL( 0u, ShaderPermutationGetFeatures(nullptr) );
+
+		// Each subset of the used features is a permutation.
+		Array<ShaderPermutationKey> keys;
+		ShaderPermutationGetKeys(features, keys);
+
+		CHECK_EQUAL( 4u, keys.size() );
+
+		for( size_t i = 0; i < keys.size(); i++ )
+		{
+			CHECK_EQUAL( keys[i], keys[i] & features );
+
+			for( size_t j = 0; j < i; j++ )
+				CHECK( keys[i] != keys[j] );
+		}
+	}
+
+	TEST(ShaderPermutationKeyMasking)
+	{
+		ShaderPermutationKey features = ShaderPermutationGetFeatures(VertexSource);
+
+		// Requests for features the shader does not use share a program.
+		ShaderPermutationKey key = ShaderFeature::Skinning | ShaderFeature::Lighting;
+		key &= features;
+
+		CHECK_EQUAL( (uint32) ShaderFeature::Lighting, key );
+		CHECK_EQUAL( key, (ShaderFeature::Lighting | ShaderFeature::Fog) & features );
+
+		ShaderPermutationKey none = ShaderFeature::Skinning & features;
+		CHECK_EQUAL( 0u, none );
+
+		// Only the defines of the masked key are added.
+		String text = ShaderPermutationExpand(VertexSource, key);
+		CHECK( text.find("#version 120\n#define FLD_LIGHTING\n") == 0 );
+		CHECK( text.find("#define FLD_SKINNING") == String::npos );
+
+		String error;
+		CHECK( ShaderPermutationValidate(text, error) );
+
+		// The empty permutation keeps the source as it is.
+		CHECK( ShaderPermutationExpand(VertexSource, none) == VertexSource );
+	}
+
+	TEST(ShaderPermutationValidation)
+	{
+		String error;
+
+		CHECK( !ShaderPermutationValidate("#ifdef FLD_FOG\nvoid main() {}\n", error) );
+		CHECK( !error.empty() );
+
+		error.clear();
+		CHECK( !ShaderPermutationValidate("#endif\n", error) );
+		CHECK( !error.empty() );
+
+		// The defines go after the version, so it has to come first.
+		error.clear();
+		CHECK( !ShaderPermutationValidate("void main() {}\n#version 120\n", error) );
+		CHECK( !error.empty() );
+
+		// A source that ends in the version directive still expands.
+		String text = ShaderPermutationExpand("#version 120", ShaderFeature::Fog);
+		CHECK( text == "#version 120\n#define FLD_FOG\n" );
+		CHECK( ShaderPermutationValidate(text, error) );
+	}
+}
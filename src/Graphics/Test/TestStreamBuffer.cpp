@@ -0,0 +1,105 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Graphics/API.h"
+#include "Graphics/StreamBuffer.h"
+#include <UnitTest++.h>
+
+using namespace fld;
+
+SUITE(Graphics)
+{
+	TEST(StreamBufferWrapAround)
+	{
+		StreamBuffer buffer;
+		buffer.reset(100);
+
+		uint32 offset;
+		CHECK( buffer.allocate(40, 1, offset) );
+		CHECK_EQUAL( 0u, offset );
+		CHECK( buffer.allocate(40, 1, offset) );
+		CHECK_EQUAL( 40u, offset );
+
+		buffer.endFrame();
+		CHECK_EQUAL( 1u, buffer.getNumFrames() );
+		CHECK_EQUAL( 0u, buffer.getFrameSize() );
+
+		CHECK( buffer.allocate(10, 1, offset) );
+		CHECK_EQUAL( 80u, offset );
+
+		// Wrapping around would overwrite the frame still in flight.
+		CHECK( !buffer.allocate(20, 1, offset) );
+
+		buffer.endFrame();
+		buffer.releaseFrame();
+		CHECK_EQUAL( 1u, buffer.getNumFrames() );
+
+		// The tail skipped to wrap around is used by the frame too.
+		CHECK( buffer.allocate(20, 1, offset) );
+		CHECK_EQUAL( 0u, offset );
+		CHECK_EQUAL( 30u, buffer.getFrameSize() );
+
+		buffer.endFrame();
+		buffer.releaseFrame();
+		buffer.releaseFrame();
+		CHECK_EQUAL( 0u, buffer.getNumFrames() );
+
+		// With no frames in flight all the space can be used again.
+		CHECK( buffer.allocate(80, 1, offset) );
+		CHECK_EQUAL( 20u, offset );
+	}
+
+	TEST(StreamBufferAlignment)
+	{
+		StreamBuffer buffer;
+		buffer.reset(64);
+
+		uint32 offset;
+		CHECK( buffer.allocate(3, 1, offset) );
+		CHECK_EQUAL( 0u, offset );
+
+		CHECK( buffer.allocate(8, 16, offset) );
+		CHECK_EQUAL( 16u, offset );
+		CHECK_EQUAL( 24u, buffer.getFrameSize() );
+
+		// The padding before aligned data is used space too.
+		CHECK( buffer.allocate(32, 16, offset) );
+		CHECK_EQUAL( 32u, offset );
+		CHECK( !buffer.allocate(4, 16, offset) );
+	}
+
+	TEST(StreamBufferFull)
+	{
+		StreamBuffer buffer;
+		buffer.reset(64);
+
+		uint32 offset;
+		CHECK( !buffer.allocate(0, 1, offset) );
+		CHECK( !buffer.allocate(65, 1, offset) );
+
+		for( uint32 i = 0; i < StreamBufferMaxFrames; i++ )
+		{
+			CHECK( buffer.allocate(16, 1, offset) );
+			CHECK_EQUAL( i * 16, offset );
+			buffer.endFrame();
+		}
+
+		CHECK_EQUAL( StreamBufferMaxFrames, buffer.getNumFrames() );
+		CHECK( !buffer.allocate(1, 1, offset) );
+
+		// Releasing the oldest frame frees its space at the start.
+		buffer.releaseFrame();
+		CHECK( buffer.allocate(16, 1, offset) );
+		CHECK_EQUAL( 0u, offset );
+		CHECK( !buffer.allocate(1, 1, offset) );
+
+		for( uint32 i = 0; i <= StreamBufferMaxFrames; i++ )
+			buffer.releaseFrame();
+
+		CHECK_EQUAL( 0u, buffer.getNumFrames() );
+	}
+}
@@ -0,0 +1,138 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Graphics/API.h"
+#include "Graphics/RecordingRenderBackend.h"
+#include "Graphics/UniformBuffer.h"
+#include "Graphics/ShaderProgram.h"
+#include <UnitTest++.h>
+
+using namespace fld;
+
+SUITE(Graphics)
+{
+	TEST(UniformSlotRegistry)
+	{
+		UniformSlot slot = UniformSlotGet("TestUniformSlotA");
+		CHECK( slot != UniformSlotInvalid );
+
+		// Names are registered only once.
+		CHECK_EQUAL( slot, UniformSlotGet("TestUniformSlotA") );
+		CHECK_EQUAL( slot, UniformSlotFind("TestUniformSlotA") );
+		CHECK( strcmp("TestUniformSlotA", UniformSlotGetName(slot)) == 0 );
+
+		uint16 count = UniformSlotGetCount();
+		CHECK_EQUAL( UniformSlotInvalid, UniformSlotFind("TestUniformSlotUnknown") );
+		CHECK_EQUAL( count, UniformSlotGetCount() );
+
+		UniformSlot other = UniformSlotGet("TestUniformSlotB");
+		CHECK( other != slot );
+		CHECK_EQUAL( count + 1, UniformSlotGetCount() );
+		CHECK( UniformSlotGetName(UniformSlotInvalid) == nullptr );
+	}
+
+	TEST(UniformBufferDirtyBits)
+	{
+		UniformSlot slotA = UniformSlotGet("TestUniformDirtyA");
+		UniformSlot slotB = UniformSlotGet("TestUniformDirtyB");
+
+		UniformBuffer ub;
+		CHECK( !ub.isDirty(slotA) );
+
+		ub.setUniform(slotA, 1.0f);
+		ub.setUniform(slotB, 2);
+		CHECK( ub.isDirty(slotA) );
+		CHECK( ub.isDirty(slotB) );
+
+		ub.clearDirty();
+		CHECK( !ub.isDirty(slotA) );
+		CHECK( !ub.isDirty(slotB) );
+
+		// Setting the same value does not mark the uniform as changed.
+		ub.setUniform(slotA, 1.0f);
+		ub.setUniform(slotB, 2);
+		CHECK( !ub.isDirty(slotA) );
+		CHECK( !ub.isDirty(slotB) );
+
+		ub.setUniform(slotA, 3.0f);
+		CHECK( ub.isDirty(slotA) );
+		CHECK( !ub.isDirty(slotB) );
+
+		// Values of another type are a change even with the same bytes.
+		ub.clearDirty();
+		ub.setUniform(slotB, 2.0f);
+		CHECK( ub.isDirty(slotB) );
+
+		// Removing the uniform clears its bit.
+		ub.removeUniform(slotA);
+		CHECK( ub.findElement(slotA) == nullptr );
+		CHECK( !ub.isDirty(slotA) );
+		CHECK( ub.isDirty(slotB) );
+
+		// The named setters go through the same slots.
+		ub.clearDirty();
+		ub.setUniform("TestUniformDirtyA", 3.0f);
+		CHECK( ub.findElement(slotA) != nullptr );
+		CHECK( ub.isDirty(slotA) );
+	}
+
+	TEST(UniformBufferUploads)
+	{
+		RecordingRenderBackend backend;
+
+		ShaderProgramPtr programA = backend.createProgram();
+		ShaderProgramPtr programB = backend.createProgram();
+
+		UniformSlot slotA = UniformSlotGet("TestUniformUploadA");
+		UniformSlot slotB = UniformSlotGet("TestUniformUploadB");
+
+		UniformBuffer ub;
+		ub.setUniform(slotA, 1.0f);
+		ub.setUniform(slotB, 2.0f);
+
+		// The first upload to a program sends all the uniforms.
+		programA->setUniforms(&ub);
+		CHECK_EQUAL( 2u, backend.getCommandCount(RenderCommandType::SetUniform) );
+		CHECK( ub.lastProgram == programA.get() );
+		CHECK( !ub.isDirty(slotA) );
+
+		// Only the changed uniforms are sent again to the same program.
+		backend.clearCommands();
+		ub.setUniform(slotB, 3.0f);
+		programA->setUniforms(&ub);
+
+		CHECK_EQUAL( 1u, backend.getCommandCount(RenderCommandType::SetUniform) );
+		const Array<RenderCommand>& commands = backend.getCommands();
+		CHECK_EQUAL( 1u, commands.size() );
+		if( commands.size() == 1 )
+			CHECK_EQUAL( (uint32) slotB, commands[0].arg );
+
+		backend.clearCommands();
+		programA->setUniforms(&ub);
+		CHECK_EQUAL( 0u, backend.getCommandCount(RenderCommandType::SetUniform) );
+
+		// Another program has not seen the values, so it gets them all.
+		backend.clearCommands();
+		programB->setUniforms(&ub);
+		CHECK_EQUAL( 2u, backend.getCommandCount(RenderCommandType::SetUniform) );
+
+		// And so does the first one, since the buffer went to another one.
+		backend.clearCommands();
+		programA->setUniforms(&ub);
+		CHECK_EQUAL( 2u, backend.getCommandCount(RenderCommandType::SetUniform) );
+
+		// A program switching to another buffer uploads all of it.
+		UniformBuffer other;
+		other.setUniform(slotA, 1.0f);
+		other.clearDirty();
+		other.lastProgram = programA.get();
+
+		backend.clearCommands();
+		programA->setUniforms(&other);
+		CHECK_EQUAL( 1u, backend.getCommandCount(RenderCommandType::SetUniform) );
+	}
+}
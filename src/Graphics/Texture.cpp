@@ -14,10 +14,12 @@ NAMESPACE_GRAPHICS_BEGIN
 
 Texture::Texture()
     : id(0)
+    , target(TextureTarget::Target2D)
+    , anisotropicFilter(1.0f)
+    , numMips(1)
+    , residentMip(0)
     , uploaded(false)
     , uploadedImageTimestamp(0)
-    , anisotropicFilter(1.0f)
-    , target(TextureTarget::Target2D)
 {
 }
 
@@ -0,0 +1,422 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Graphics/API.h"
+#include "Graphics/TextureStreamer.h"
+#include "Graphics/RenderBackend.h"
+#include "Graphics/FrameStatistics.h"
+
+NAMESPACE_GRAPHICS_BEGIN
+
+//-----------------------------------//
+
+// Smaller images are uploaded at once, since they fit in a frame.
+static const uint32 MinStreamedImageSize = 256 * 1024;
+
+// Default number of bytes uploaded in a frame.
+static const uint32 DefaultUploadBudget = 2 * 1024 * 1024;
+
+// Frames the resident levels have to go without needing more detail
+// before the unused levels are dropped, so textures that go in and out
+// of view are not staged and uploaded again all the time.
+static const uint32 ResidencyDelay = 120;
+
+TextureStreamer::TextureStreamer()
+	: taskPool(nullptr)
+	, uploadBudget(DefaultUploadBudget)
+{
+}
+
+//-----------------------------------//
+
+TextureStreamer::~TextureStreamer()
+{
+	// Wait for the mips still being staged by other threads.
+	stagingTasks.wait();
+
+	for( auto it = entries.begin(); it != entries.end(); ++it )
+		freeEntries.pushBack(it->value);
+
+	for( size_t i = 0; i < freeEntries.size(); i++ )
+	{
+		freeMips(freeEntries[i]);
+		Deallocate(freeEntries[i]);
+	}
+}
+
+//-----------------------------------//
+
+bool TextureStreamer::stream(Texture* texture, TaskPool* pool)
+{
+	Image* image = texture->getImage().Resolve();
+	if( !image || image->isCompressed() ) return false;
+
+	PixelFormat format = image->getPixelFormat();
+	if( format == PixelFormat::Depth || format == PixelFormat::Unknown ) return false;
+
+	TextureStreamEntry* entry = entries.get((uint64)texture, nullptr);
+
+	if( !entry )
+	{
+		if( image->getBuffer().size() < MinStreamedImageSize )
+			return false;
+
+		taskPool = pool;
+		texture->setUploaded();
+
+		entry = allocateEntry();
+		entry->texture = texture;
+		entries.set((uint64)texture, entry);
+
+		startStaging(entry, pool, true);
+		return true;
+	}
+
+	taskPool = pool;
+	texture->setUploaded();
+
+	// The image changed, so the mips need to be staged again. If they
+	// are still being staged, they are restaged once that is done.
+	mutex.lock();
+	bool isStaging = entry->isStaging;
+	if( isStaging ) entry->isStale = true;
+	mutex.unlock();
+
+	if( !isStaging )
+		startStaging(entry, pool, true);
+
+	return true;
+}
+
+//-----------------------------------//
+
+TextureStreamEntry* TextureStreamer::allocateEntry()
+{
+	TextureStreamEntry* entry = nullptr;
+
+	if( !freeEntries.empty() )
+	{
+		entry = freeEntries.back();
+		freeEntries.popBack();
+	}
+	else
+	{
+		entry = AllocateGraphics(TextureStreamEntry);
+		entry->task.callback.Bind(this, &TextureStreamer::stage);
+		entry->task.userdata = entry;
+	}
+
+	entry->requestedMip = 0;
+	entry->idleMip = 0;
+	entry->numIdleFrames = 0;
+	entry->isStaging = false;
+	entry->isStaged = false;
+	entry->isStale = false;
+
+	return entry;
+}
+
+//-----------------------------------//
+
+void TextureStreamer::removeEntry(TextureStreamEntry* entry)
+{
+	entries.remove((uint64)entry->texture.get());
+
+	freeMips(entry);
+	entry->texture = nullptr;
+	entry->image = ImageHandle();
+
+	freeEntries.pushBack(entry);
+}
+
+//-----------------------------------//
+
+void TextureStreamer::startStaging(TextureStreamEntry* entry, TaskPool* pool,
+	bool resetLevels)
+{
+	Texture* texture = entry->texture.get();
+
+	// Keep the image the mips are filtered from alive while staging.
+	entry->image = texture->getImage();
+	Image* image = entry->image.Resolve();
+
+	uint32 width = image->getWidth();
+	uint32 height = image->getHeight();
+
+	uint8 numMips = 1;
+
+	while( (width >> numMips) > 0 || (height >> numMips) > 0 )
+		numMips++;
+
+	freeMips(entry);
+
+	for( uint8 i = 1; i < numMips; i++ )
+		entry->mips.pushBack( AllocateGraphics(Array<uint8>) );
+
+	if( resetLevels )
+	{
+		// No level of the image is uploaded yet.
+		texture->numMips = numMips;
+		texture->residentMip = numMips;
+
+		entry->requestedMip = numMips - 1;
+	}
+
+	entry->idleMip = numMips - 1;
+	entry->numIdleFrames = 0;
+
+	mutex.lock();
+	entry->isStaging = true;
+	entry->isStaged = false;
+	entry->isStale = false;
+	mutex.unlock();
+
+	stagingTasks.setTaskPool(pool);
+	stagingTasks.add(&entry->task);
+}
+
+//-----------------------------------//
+
+void TextureStreamer::freeMips(TextureStreamEntry* entry)
+{
+	for( size_t i = 0; i < entry->mips.size(); i++ )
+		Deallocate(entry->mips[i]);
+
+	entry->mips.clear();
+}
+
+//-----------------------------------//
+
+static void FilterMip(const uint8* source, uint32 sourceWidth, uint32 sourceHeight,
+	uint8* dest, uint32 width, uint32 height, uint32 pixelSize)
+{
+	// Box filter of the 2x2 source pixels, clamped at the odd edges.
+	for( uint32 y = 0; y < height; y++ )
+	{
+		uint32 y0 = std::min(y * 2, sourceHeight - 1);
+		uint32 y1 = std::min(y * 2 + 1, sourceHeight - 1);
+
+		const uint8* row0 = source + y0 * sourceWidth * pixelSize;
+		const uint8* row1 = source + y1 * sourceWidth * pixelSize;
+
+		for( uint32 x = 0; x < width; x++ )
+		{
+			uint32 x0 = std::min(x * 2, sourceWidth - 1) * pixelSize;
+			uint32 x1 = std::min(x * 2 + 1, sourceWidth - 1) * pixelSize;
+
+			for( uint32 c = 0; c < pixelSize; c++ )
+			{
+				uint32 sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+				*dest++ = (uint8) ((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+//-----------------------------------//
+
+void TextureStreamer::stage(Task* task)
+{
+	TextureStreamEntry* entry = (TextureStreamEntry*) task->userdata;
+	Image* image = entry->image.Resolve();
+
+	uint32 pixelSize = image->getPixelSize();
+	uint32 width = image->getWidth();
+	uint32 height = image->getHeight();
+	const uint8* source = image->getBuffer().data();
+
+	for( size_t i = 0; i < entry->mips.size(); i++ )
+	{
+		uint32 mipWidth = std::max<uint32>(1, width / 2);
+		uint32 mipHeight = std::max<uint32>(1, height / 2);
+
+		Array<uint8>& mip = *entry->mips[i];
+		mip.resize(mipWidth * mipHeight * pixelSize);
+
+		FilterMip(source, width, height, mip.data(), mipWidth, mipHeight, pixelSize);
+
+		source = mip.data();
+		width = mipWidth;
+		height = mipHeight;
+	}
+
+	mutex.lock();
+	entry->isStaging = false;
+	entry->isStaged = true;
+	mutex.unlock();
+}
+
+//-----------------------------------//
+
+void TextureStreamer::request(Texture* texture, float screenSize)
+{
+	TextureStreamEntry* entry = entries.get((uint64)texture, nullptr);
+	if( !entry ) return;
+
+	// Drop the levels with more texels than the pixels they cover.
+	float size = (float) std::max(texture->width, texture->height);
+	uint8 mip = 0;
+
+	while( mip + 1 < texture->numMips && size * 0.5f >= screenSize )
+	{
+		size *= 0.5f;
+		mip++;
+	}
+
+	entry->requestedMip = std::min(entry->requestedMip, mip);
+}
+
+//-----------------------------------//
+
+bool TextureStreamer::isStreaming(Texture* texture) const
+{
+	return entries.has((uint64)texture);
+}
+
+//-----------------------------------//
+
+void TextureStreamer::update(RenderBackend* backend, FrameStatistics* stats)
+{
+	Array<TextureStreamEntry*> ready;
+	Array<TextureStreamEntry*> stale;
+	Array<TextureStreamEntry*> staged;
+
+	uint32 numStreaming = 0;
+
+	mutex.lock();
+
+	for( auto it = entries.begin(); it != entries.end(); ++it )
+	{
+		TextureStreamEntry* entry = it->value;
+
+		if( entry->isStaging )
+			numStreaming++;
+		else if( entry->isStale )
+			stale.pushBack(entry);
+		else if( entry->isStaged )
+			staged.pushBack(entry);
+
+		if( !entry->isStaging && !entry->isStale )
+			ready.pushBack(entry);
+	}
+
+	mutex.unlock();
+
+	for( size_t i = 0; i < stale.size(); i++ )
+		startStaging(stale[i], taskPool, true);
+
+	uint32 uploadedBytes = uploadLevels(backend, staged);
+
+	for( size_t i = 0; i < ready.size(); i++ )
+	{
+		TextureStreamEntry* entry = ready[i];
+		Texture* texture = entry->texture.get();
+
+		// The texture is not used anymore if only the streamer keeps it.
+		if( ReferenceGetCount(texture) == 1 )
+		{
+			removeEntry(entry);
+			continue;
+		}
+
+		if( entry->requestedMip < texture->residentMip )
+		{
+			// The mips were freed, so they have to be staged again to
+			// upload the detail that is requested now.
+			if( !entry->isStaged )
+				startStaging(entry, taskPool, false);
+
+			entry->idleMip = texture->numMips - 1;
+			entry->numIdleFrames = 0;
+			numStreaming++;
+		}
+		else
+		{
+			entry->idleMip = std::min(entry->idleMip, entry->requestedMip);
+			entry->numIdleFrames++;
+		}
+
+		// The draws of the next frame request their detail again.
+		entry->requestedMip = texture->numMips - 1;
+
+		if( entry->numIdleFrames < ResidencyDelay )
+			continue;
+
+		// Drop the levels finer than what any draw requested.
+		if( entry->idleMip > texture->residentMip )
+		{
+			backend->releaseTextureMips(texture, entry->idleMip);
+			texture->residentMip = entry->idleMip;
+		}
+
+		// The levels that are still needed are uploaded, so the staged
+		// mips are not kept around in memory.
+		mutex.lock();
+		entry->isStaged = false;
+		mutex.unlock();
+
+		freeMips(entry);
+
+		entry->idleMip = texture->numMips - 1;
+		entry->numIdleFrames = 0;
+	}
+
+	if( !stats ) return;
+
+	stats->textureUploadBudget = uploadBudget;
+	stats->numTextureUploadBytes += uploadedBytes;
+	stats->numStreamingTextures = numStreaming;
+}
+
+//-----------------------------------//
+
+uint32 TextureStreamer::uploadLevels(RenderBackend* backend,
+	const Array<TextureStreamEntry*>& staged)
+{
+	// Upload a level of each texture per pass, so all the textures get
+	// their small levels before any gets its detailed ones. At least a
+	// level is uploaded each frame, even if it is bigger than the budget.
+	uint32 uploadedBytes = 0;
+	bool uploaded = true;
+
+	while( uploaded && uploadedBytes < uploadBudget )
+	{
+		uploaded = false;
+
+		for( size_t i = 0; i < staged.size(); i++ )
+		{
+			TextureStreamEntry* entry = staged[i];
+			Texture* texture = entry->texture.get();
+
+			if( texture->residentMip <= entry->requestedMip )
+				continue;
+
+			uint8 level = texture->residentMip - 1;
+
+			Image* image = entry->image.Resolve();
+			uint32 width = std::max<uint32>(1, image->getWidth() >> level);
+			uint32 height = std::max<uint32>(1, image->getHeight() >> level);
+
+			const Array<uint8>& data = level ? *entry->mips[level - 1] : image->getBuffer();
+
+			if( uploadedBytes > 0 && uploadedBytes + data.size() > uploadBudget )
+				continue;
+
+			backend->uploadTextureMip(texture, level, width, height, data.data());
+			texture->residentMip = level;
+
+			uploadedBytes += data.size();
+			uploaded = true;
+		}
+	}
+
+	return uploadedBytes;
+}
+
+//-----------------------------------//
+
+NAMESPACE_GRAPHICS_END
@@ -7,24 +7,36 @@
 
 #include "Graphics/API.h"
 
-#ifdef ENABLE_RENDERER_OPENGL
-
 #include "Graphics/Graphics.h"
 #include "Graphics/UniformBuffer.h"
 #include "Core/Math/Matrix4x3.h"
 #include "Core/Math/Matrix4x4.h"
 #include "Core/Math/Hash.h"
+#include "Core/Concurrency.h"
 
 NAMESPACE_GRAPHICS_BEGIN
 
 //-----------------------------------//
 
+struct UniformSlotRegistry
+{
+	Mutex mutex;
+	HashMap<uint16> slots; // keyed by name hash
+	Array<char*> names;
+};
+
+static UniformSlotRegistry& GetUniformSlotRegistry()
+{
+	static UniformSlotRegistry registry;
+	return registry;
+}
+
 static char* AllocateName(const char* name)
 {
 	if( !name ) return nullptr;
 
 	size_t nameSize = sizeof(char) * strlen(name);
-	char* newName = (char*) AllocatorAllocate(GetFrameAllocator(), nameSize+1, 0);
+	char* newName = (char*) AllocatorAllocate(AllocatorGetHeap(), nameSize+1, 0);
 	memcpy(newName, name, nameSize);
 	newName[nameSize] = '\0';
 	return newName;
@@ -32,77 +44,293 @@ static char* AllocateName(const char* name)
 
 //-----------------------------------//
 
-UniformBufferElement* UniformBuffer::getElement(const char* name, size_t size)
+UniformSlot UniformSlotGet(const char* name)
 {
-	//UniformBufferElements::iterator it = elements.find( name.c_str() );
-	//if( it != elements.end() ) return it->second;
-
-	void* p = AllocatorAllocate(GetFrameAllocator(), sizeof(UniformBufferElement)+size, 0);
-	UniformBufferElement* element = (UniformBufferElement*) p;
-
-	if( !name ) return nullptr;
+	if( !name ) return UniformSlotInvalid;
 
 #ifdef BUILD_DEBUG
 	if( strlen(name) == 0 )
 	{
 		LogAssert("Uniform elements should be named");
-		return nullptr;
+		return UniformSlotInvalid;
 	}
 #endif
 
-	if( !element ) return nullptr;
+	UniformSlotRegistry& registry = GetUniformSlotRegistry();
+	auto key = MurmurHash64(name, strlen(name), 0);
+
+	registry.mutex.lock();
+
+	UniformSlot slot = registry.slots.get(key, UniformSlotInvalid);
+
+	if( slot == UniformSlotInvalid )
+	{
+		slot = (UniformSlot) registry.names.size();
+		registry.names.pushBack( AllocateName(name) );
+		registry.slots.set(key, slot);
+	}
+
+	registry.mutex.unlock();
 
-	element->type = (UniformDataType) 0;
-	element->count = 0;
-	element->name = (char*) name; // AllocateName(name);
+	return slot;
+}
+
+//-----------------------------------//
+
+UniformSlot UniformSlotFind(const char* name)
+{
+	if( !name ) return UniformSlotInvalid;
 
+	UniformSlotRegistry& registry = GetUniformSlotRegistry();
 	auto key = MurmurHash64(name, strlen(name), 0);
-	elements.set(key, element);
-	return element;
+
+	registry.mutex.lock();
+	UniformSlot slot = registry.slots.get(key, UniformSlotInvalid);
+	registry.mutex.unlock();
+
+	return slot;
 }
 
 //-----------------------------------//
 
-void UniformBuffer::removeUniform( const char* slot )
+const char* UniformSlotGetName(UniformSlot slot)
 {
-	auto key = MurmurHash64(slot, strlen(slot), 0);
-	elements.remove(key);
+	UniformSlotRegistry& registry = GetUniformSlotRegistry();
+
+	registry.mutex.lock();
+	const char* name = (slot < registry.names.size()) ? registry.names[slot] : nullptr;
+	registry.mutex.unlock();
+
+	return name;
 }
 
 //-----------------------------------//
 
-void UniformBuffer::setUniform( const char* name, int32 data )
+uint16 UniformSlotGetCount()
 {
-	size_t size = sizeof(int32);
-	UniformBufferElement* element = getElement(name, size);
+	UniformSlotRegistry& registry = GetUniformSlotRegistry();
+
+	registry.mutex.lock();
+	uint16 count = (uint16) registry.names.size();
+	registry.mutex.unlock();
+
+	return count;
+}
+
+//-----------------------------------//
+
+UniformBuffer::UniformBuffer()
+	: lastProgram(nullptr)
+{
+}
+
+//-----------------------------------//
+
+UniformBuffer::~UniformBuffer()
+{
+	for( size_t i = 0; i < elements.size(); i++ )
+		AllocatorDeallocate(elements[i]);
+}
+
+//-----------------------------------//
+
+UniformBufferElement* UniformBuffer::getElement(const char* name, size_t size)
+{
+	return getElement(UniformSlotGet(name), size);
+}
+
+//-----------------------------------//
+
+UniformBufferElement* UniformBuffer::getElement(UniformSlot slot, size_t size)
+{
+	if( slot == UniformSlotInvalid ) return nullptr;
+
+	if( slot >= elements.size() )
+	{
+		size_t numElements = elements.size();
+		elements.resize(slot + 1);
+
+		for( size_t i = numElements; i < elements.size(); i++ )
+			elements[i] = nullptr;
+
+		size_t numWords = (elements.size() + 31) / 32;
+		size_t numDirty = dirty.size();
+		dirty.resize(numWords);
+
+		for( size_t i = numDirty; i < dirty.size(); i++ )
+			dirty[i] = 0;
+	}
+
+	UniformBufferElement* element = elements[slot];
+	if( element && element->capacity >= size ) return element;
+
+	// Grow the element, the old data is going to be overwritten anyway.
+	void* p = AllocatorAllocate(GetRenderAllocator(), sizeof(UniformBufferElement)+size, 0);
+	UniformBufferElement* newElement = (UniformBufferElement*) p;
+	if( !newElement ) return nullptr;
+
+	newElement->name = UniformSlotGetName(slot);
+	newElement->slot = slot;
+	newElement->type = (UniformDataType) 0;
+	newElement->count = 0;
+	newElement->size = 0;
+	newElement->capacity = size;
+
+	AllocatorDeallocate(element);
+	elements[slot] = newElement;
+
+	return newElement;
+}
+
+//-----------------------------------//
+
+UniformBufferElement* UniformBuffer::findElement(UniformSlot slot) const
+{
+	if( slot >= elements.size() ) return nullptr;
+	return elements[slot];
+}
+
+//-----------------------------------//
+
+void UniformBuffer::removeUniform( const char* name )
+{
+	removeUniform( UniformSlotFind(name) );
+}
+
+//-----------------------------------//
+
+void UniformBuffer::removeUniform( UniformSlot slot )
+{
+	if( slot >= elements.size() ) return;
+
+	AllocatorDeallocate(elements[slot]);
+	elements[slot] = nullptr;
+
+	dirty[slot / 32] &= ~(1 << (slot % 32));
+}
+
+//-----------------------------------//
+
+bool UniformBuffer::isDirty( UniformSlot slot ) const
+{
+	if( slot >= elements.size() ) return false;
+	return (dirty[slot / 32] & (1 << (slot % 32))) != 0;
+}
+
+//-----------------------------------//
+
+void UniformBuffer::setDirty( UniformSlot slot )
+{
+	if( slot >= elements.size() ) return;
+	dirty[slot / 32] |= (1 << (slot % 32));
+}
+
+//-----------------------------------//
+
+void UniformBuffer::clearDirty()
+{
+	for( size_t i = 0; i < dirty.size(); i++ )
+		dirty[i] = 0;
+}
+
+//-----------------------------------//
+
+void UniformBuffer::setElement( UniformSlot slot, UniformDataType type, uint16 count,
+	const void* data, size_t size )
+{
+	UniformBufferElement* element = findElement(slot);
+
+	// Most uniforms are set to the same values every frame.
+	if( element && element->type == type && element->count == count &&
+		element->size == size && memcmp(&element->data, data, size) == 0 )
+		return;
+
+	element = getElement(slot, size);
 	if( !element ) return;
-	element->type = UniformDataType::Scalar_I;
-	element->count = 1;
-	memcpy(&element->data, &data, size);
+
+	element->type = type;
+	element->count = count;
+	element->size = size;
+	memcpy(&element->data, data, size);
+
+	setDirty(slot);
+}
+
+//-----------------------------------//
+
+void UniformBuffer::setUniform( UniformSlot slot, int32 data )
+{
+	setElement(slot, UniformDataType::Scalar_I, 1, &data, sizeof(int32));
+}
+
+//-----------------------------------//
+
+void UniformBuffer::setUniform( UniformSlot slot, float data )
+{
+	setElement(slot, UniformDataType::Scalar_F, 1, &data, sizeof(float));
+}
+
+//-----------------------------------//
+
+void UniformBuffer::setUniform( UniformSlot slot, const Array<Vector3>& vec )
+{
+	if( vec.empty() ) return;
+
+	size_t size = sizeof(Vector3)*vec.size();
+	setElement(slot, UniformDataType::Vector3_F, vec.size(), &vec.front(), size);
+}
+
+//-----------------------------------//
+
+void UniformBuffer::setUniform( UniformSlot slot, const Vector3& vec )
+{
+	setElement(slot, UniformDataType::Vector3_F, 1, &vec.x, sizeof(Vector3));
+}
+
+//-----------------------------------//
+
+void UniformBuffer::setUniform( UniformSlot slot, const Matrix4x3& matrix )
+{
+	Matrix4x4 m(matrix);
+	setElement(slot, UniformDataType::Matrix4_F, 1, &m.m11, sizeof(Matrix4x4));
+}
+
+//-----------------------------------//
+
+void UniformBuffer::setUniform( UniformSlot slot, const Matrix4x4& matrix )
+{
+	setElement(slot, UniformDataType::Matrix4_F, 1, &matrix.m11, sizeof(Matrix4x4));
+}
+
+//-----------------------------------//
+
+void UniformBuffer::setUniform( UniformSlot slot, const Array<Matrix4x4>& vec )
+{
+	if( vec.empty() ) return;
+
+	size_t size = sizeof(Matrix4x4)*vec.size();
+	setElement(slot, UniformDataType::Matrix4_F, vec.size(), &vec.front(), size);
+}
+
+//-----------------------------------//
+
+void UniformBuffer::setUniform( const char* name, int32 data )
+{
+	setUniform(UniformSlotGet(name), data);
 }
 
 //-----------------------------------//
 
 void UniformBuffer::setUniform( const char* name, float data )
 {
-	size_t size = sizeof(float);
-	UniformBufferElement* element = getElement(name, size);
-	if( !element ) return;
-	element->type = UniformDataType::Scalar_F;
-	element->count = 1;
-	memcpy(&element->data, &data, size);
+	setUniform(UniformSlotGet(name), data);
 }
 
 //-----------------------------------//
 
 void UniformBuffer::setUniform( const char* name, const Array<Vector3>& vec )
 {
-	size_t size = sizeof(Vector3)*vec.size();
-	UniformBufferElement* element = getElement(name, size);
-	if( !element ) return;
-	element->type = UniformDataType::Vector3_F;
-	element->count = vec.size();
-	memcpy(&element->data, &vec.front(), size);
+	setUniform(UniformSlotGet(name), vec);
 }
 
 //-----------------------------------//
@@ -125,53 +353,30 @@ void UniformBuffer::setUniform( const char* name, const Array<Color>& vec )
 
 void UniformBuffer::setUniform( const char* name, const Vector3& vec )
 {
-	size_t size = sizeof(Vector3);
-	UniformBufferElement* element = getElement(name, size);
-	if( !element ) return;
-	element->type = UniformDataType::Vector3_F;
-	element->count = 1;
-	memcpy(&element->data, &vec.x, size);
+	setUniform(UniformSlotGet(name), vec);
 }
 
 //-----------------------------------//
 
 void UniformBuffer::setUniform( const char* name, const Matrix4x3& matrix )
 {
-	Matrix4x4 m(matrix);
-	size_t size = sizeof(Matrix4x4);
-	UniformBufferElement* element = getElement(name, size);
-	if( !element ) return;
-	element->type = UniformDataType::Matrix4_F;
-	element->count = 1;
-	memcpy(&element->data, &m.m11, size);
+	setUniform(UniformSlotGet(name), matrix);
 }
 
 //-----------------------------------//
 
 void UniformBuffer::setUniform( const char* name, const Matrix4x4& matrix )
 {
-	size_t size = sizeof(Matrix4x4);
-	UniformBufferElement* element = getElement(name, size);
-	if( !element ) return;
-	element->type = UniformDataType::Matrix4_F;
-	element->count = 1;
-	memcpy(&element->data, &matrix.m11, size);
+	setUniform(UniformSlotGet(name), matrix);
 }
 
 //-----------------------------------//
 
 void UniformBuffer::setUniform( const char* name, const Array<Matrix4x4>& vec )
 {
-	size_t size = sizeof(Matrix4x4)*vec.size();
-	UniformBufferElement* element = getElement(name, size);
-	if( !element ) return;
-	element->type = UniformDataType::Matrix4_F;
-	element->count = vec.size();
-	memcpy(&element->data, &vec.front(), size);
+	setUniform(UniformSlotGet(name), vec);
 }
 
 //-----------------------------------//
 
-NAMESPACE_GRAPHICS_END
-
-#endif
\ No newline at end of file
+NAMESPACE_GRAPHICS_END
\ No newline at end of file
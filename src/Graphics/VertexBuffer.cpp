@@ -7,8 +7,6 @@
 
 #include "Graphics/API.h"
 
-#ifdef ENABLE_RENDERER_OPENGL
-
 #include "Graphics/VertexBuffer.h"
 
 NAMESPACE_GRAPHICS_BEGIN
@@ -41,6 +39,4 @@ bool VertexBuffer::isBuilt() const
 
 //-----------------------------------//
 
-NAMESPACE_GRAPHICS_END
-
-#endif
\ No newline at end of file
+NAMESPACE_GRAPHICS_END
\ No newline at end of file
@@ -13,6 +13,7 @@
 
 #include "Pipeline/ImageProcessor.h"
 #include "Pipeline/MeshProcessor.h"
+#include "Pipeline/ShaderProcessor.h"
 
 #include "Pipeline/ImporterMilkshape.h"
 #include "Pipeline/ImporterFBX.h"
@@ -29,6 +30,7 @@ static void ReferenceProcessors()
 {
 	MeshProcessorGetType();
 	ImageProcessorGetType();
+	ShaderProcessorGetType();
 }
 
 //-----------------------------------//
@@ -0,0 +1,93 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Pipeline/API.h"
+#include "Pipeline/ShaderProcessor.h"
+#include "Core/Log.h"
+
+NAMESPACE_PIPELINE_BEGIN
+
+//-----------------------------------//
+
+REFLECT_CHILD_CLASS(ShaderProcessor, ResourceProcessor)
+	FIELD_PRIMITIVE(2, bool, validatePermutations)
+REFLECT_CLASS_END()
+
+//-----------------------------------//
+
+ShaderProcessor::ShaderProcessor()
+	: validatePermutations(true)
+{
+
+}
+
+//-----------------------------------//
+
+ExtensionMetadata* ShaderProcessor::getMetadata()
+{
+	static ExtensionMetadata s_ShaderExtension =
+	{
+		"Shader",
+		"Generates and validates the permutations of a shader.",
+		0
+	};
+
+	return &s_ShaderExtension;
+}
+
+//-----------------------------------//
+
+static bool ValidatePermutation(const ShaderMaterial* shader, ShaderPermutationKey key,
+	const char* stage, const char* source)
+{
+	String text = ShaderPermutationExpand(source, key);
+	String error;
+
+	if( ShaderPermutationValidate(text, error) )
+		return true;
+
+	LogError( "Shader '%s' permutation %u (%s): %s", shader->getPath().c_str(),
+		key, stage, error.c_str() );
+
+	return false;
+}
+
+bool ShaderProcessor::Process(const ResourcePtr& resource)
+{
+	if( resource->getResourceGroup() != ResourceGroup::Shaders )
+		return false;
+
+	const ShaderMaterial* shader = (const ShaderMaterial*) resource.get();
+
+	ShaderPermutationKey features = ShaderPermutationGetFeatures(shader->getVertexSource())
+		| ShaderPermutationGetFeatures(shader->getFragmentSource());
+
+	permutations.clear();
+	ShaderPermutationGetKeys(features, permutations);
+
+	LogInfo( "Shader '%s' has %u permutations", shader->getPath().c_str(),
+		(uint32) permutations.size() );
+
+	if( !validatePermutations )
+		return true;
+
+	bool isValid = true;
+
+	for( size_t i = 0; i < permutations.size(); i++ )
+	{
+		ShaderPermutationKey key = permutations[i];
+
+		isValid &= ValidatePermutation(shader, key, "vertex", shader->getVertexSource());
+		isValid &= ValidatePermutation(shader, key, "fragment", shader->getFragmentSource());
+	}
+
+	return isValid;
+}
+
+//-----------------------------------//
+
+NAMESPACE_PIPELINE_END
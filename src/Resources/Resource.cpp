@@ -23,6 +23,7 @@ REFLECT_ENUM(ResourceStatus)
 	ENUM(Unloaded)
 	ENUM(Loading)
 	ENUM(Loaded)
+	ENUM(Evicted)
 REFLECT_ENUM_END()
 
 REFLECT_ENUM(ResourceGroup)
@@ -48,6 +49,7 @@ REFLECT_CLASS_END()
 Resource::Resource()
 	: status( ResourceStatus::Loaded )
 	, stream(nullptr)
+	, lastAccess(0)
 {
 }
 
@@ -68,6 +70,20 @@ bool Resource::isLoaded() const
 
 //-----------------------------------//
 
+uint64 Resource::getMemoryUsage() const
+{
+	return 0;
+}
+
+//-----------------------------------//
+
+bool Resource::unload()
+{
+	return false;
+}
+
+//-----------------------------------//
+
 ResourceLoader::ResourceLoader()
 {
 }
@@ -15,8 +15,9 @@ NAMESPACE_RESOURCES_BEGIN
 //-----------------------------------//
 
 REFLECT_CLASS(ResourceMetadata)
-	FIELD_PRIMITIVE(0, uint32, hash)
+	FIELD_PRIMITIVE(0, uint32, legacyHash)
 	FIELD_PRIMITIVE(1, string, path)
+	FIELD_PRIMITIVE(2, uint64, hash)
 REFLECT_CLASS_END()
 
 REFLECT_CHILD_CLASS(ResourceDatabase, Object)
@@ -40,8 +41,20 @@ ResourceDatabase::~ResourceDatabase()
 
 void ResourceDatabase::fixUp()
 {
+	// Drop the resources of old databases, which only have a 32-bit hash,
+	// so they are added again when the indexer hashes them.
+	ResourcesCache hashed;
+
 	for( auto metadata : resources )
+	{
+		if( metadata.hash == 0 && metadata.legacyHash != 0 )
+			continue;
+
+		hashed.pushBack(metadata);
 		resourcesCache.set(metadata.hash, metadata);
+	}
+
+	resources = hashed;
 }
 
 //-----------------------------------//
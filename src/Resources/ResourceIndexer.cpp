@@ -18,19 +18,131 @@
 #include "Core/Stream.h"
 #include "Core/Log.h"
 #include "Core/Math/Hash.h"
+#include "Core/Serialization.h"
+#include "Core/SerializationHelpers.h"
 
 NAMESPACE_RESOURCES_BEGIN
 
 //-----------------------------------//
 
-ResourceIndexer::ResourceIndexer()
+REFLECT_CLASS(ResourceIndexEntry)
+	FIELD_PRIMITIVE(0, string, path)
+	FIELD_PRIMITIVE(1, uint64, size)
+	FIELD_PRIMITIVE(2, uint64, modifiedTime)
+	FIELD_PRIMITIVE(3, uint64, hash)
+	FIELD_ENUM(4, ResourceGroup, group)
+REFLECT_CLASS_END()
+
+REFLECT_CHILD_CLASS(ResourceIndexCache, Object)
+	FIELD_VECTOR(0, ResourceIndexEntry, entries)
+REFLECT_CLASS_END()
+
+// Number of files that are indexed by each task.
+static const size_t ResourceIndexBatchSize = 64;
+
+// Size of the chunks used to stream the files when hashing.
+static const size_t ResourceIndexChunkSize = 64 * 1024;
+
+static const uint64 ResourceIndexHashSeed = 0xBEEF;
+
+//-----------------------------------//
+
+ResourceIndexCache::ResourceIndexCache()
+	: isDirty(false)
+{
+}
+
+//-----------------------------------//
+
+void ResourceIndexCache::fixUp()
+{
+	entriesMap.clear();
+
+	for( size_t i = 0; i < entries.size(); ++i )
+	{
+		const Path& path = entries[i].path;
+		auto key = MurmurHash64(path.c_str(), path.size(), 0);
+		entriesMap.set(key, (uint32) i);
+	}
+}
+
+//-----------------------------------//
+
+bool ResourceIndexCache::findEntry(const Path& path, uint64 size,
+	uint64 modifiedTime, ResourceIndexEntry& entry)
+{
+	auto key = MurmurHash64(path.c_str(), path.size(), 0);
+	bool found = false;
+
+	mutex.lock();
+
+	if( entriesMap.has(key) )
+	{
+		const ResourceIndexEntry& cached = entries[entriesMap.get(key, 0)];
+
+		// Different paths can have the same hash, so compare them too.
+		if( cached.path == path && cached.size == size
+			&& cached.modifiedTime == modifiedTime )
+		{
+			entry = cached;
+			found = true;
+		}
+	}
+
+	mutex.unlock();
+
+	return found;
+}
+
+//-----------------------------------//
+
+void ResourceIndexCache::setEntry(const ResourceIndexEntry& entry)
 {
+	auto key = MurmurHash64(entry.path.c_str(), entry.path.size(), 0);
+
+	mutex.lock();
+
+	if( entriesMap.has(key) )
+	{
+		entries[entriesMap.get(key, 0)] = entry;
+	}
+	else
+	{
+		entriesMap.set(key, (uint32) entries.size());
+		entries.pushBack(entry);
+	}
+
+	isDirty = true;
+
+	mutex.unlock();
+}
+
+//-----------------------------------//
+
+ResourceIndexer::ResourceIndexer(const Path& cachePath)
+{
+	cache = AllocateHeap(ResourceIndexCache);
+	setCachePath(cachePath);
 }
 
 //-----------------------------------//
 
 ResourceIndexer::~ResourceIndexer()
 {
+	if( !cachePath.empty() )
+		saveCache(cachePath);
+
+	Deallocate(cache);
+}
+
+//-----------------------------------//
+
+void ResourceIndexer::setCachePath(const Path& path)
+{
+	cachePath = path;
+
+	if( !cachePath.empty() )
+		loadCache(cachePath);
 }
 
 //-----------------------------------//
@@ -43,18 +155,87 @@ void ResourceIndexer::update()
 	{
 		onResourceIndexed(metadata);
 	}
+
+	// Save the cache once all the queued files are indexed, so the next
+	// run only needs to stat them.
+	if( numPendingBatches.read() != 0 || cachePath.empty() )
+		return;
+
+	cache->mutex.lock();
+	bool isDirty = cache->isDirty;
+	cache->mutex.unlock();
+
+	if( !isDirty ) return;
+
+	// Stop saving the cache if the file can't be written.
+	if( !saveCache(cachePath) )
+		cachePath.clear();
 }
 
 //-----------------------------------//
 
-static Task* CreateIndexTask(ResourceIndexer* index, const Path& resPath)
+bool ResourceIndexer::loadCache(const Path& path)
 {
-	Path* path = Allocate(AllocatorGetObject(index), Path);
-	path->assign(resPath);
+	if( !FileExists(path) ) return false;
+
+	Allocator* alloc = AllocatorGetHeap();
+
+	ReflectionHandleContextMap handleContextMap;
+	SerializerBinary serializer(alloc, &handleContextMap);
+
+	Object* object = Serializer::loadObjectFromFile(serializer, path);
+
+	if( !object || !ClassInherits(object->getType(), ResourceIndexCacheGetType()) )
+	{
+		LogWarn("Error loading resource index cache '%s'", path.c_str());
+		Deallocate(object);
+		return false;
+	}
+
+	Deallocate(cache);
+	cache = (ResourceIndexCache*) object;
 
+	LogInfo("Loaded resource index cache with '%d' entries", cache->entries.size());
+
+	return true;
+}
+
+//-----------------------------------//
+
+bool ResourceIndexer::saveCache(const Path& path)
+{
+	Allocator* alloc = AllocatorGetHeap();
+
+	ReflectionHandleContextMap handleContextMap;
+	SerializerBinary serializer(alloc, &handleContextMap);
+
+	cache->mutex.lock();
+
+	if( !cache->isDirty )
+	{
+		cache->mutex.unlock();
+		return true;
+	}
+
+	bool saved = Serializer::saveObjectToFile(serializer, path, cache);
+	cache->isDirty = !saved;
+	cache->mutex.unlock();
+
+	if( !saved )
+		LogWarn("Error saving resource index cache '%s'", path.c_str());
+
+	return saved;
+}
+
+//-----------------------------------//
+
+static Task* CreateIndexTask(ResourceIndexer* index, Array<Path>* batch)
+{
 	Task* task = Allocate(AllocatorGetObject(index), Task);
 	task->callback.Bind(index, &ResourceIndexer::indexResources);
-	task->userdata = path;
+	task->userdata = batch;
+
+	index->numPendingBatches.increment();
 
 	TaskPool* taskPool = GetResourceManager()->getTaskPool();
 	taskPool->add(task, 0);
@@ -68,12 +249,28 @@ void ResourceIndexer::addArchive(Archive* archive)
 {
 	Array<Path> res;
 	archive->enumerateFiles(res);
+
+	Array<Path>* batch = nullptr;
 	
 	for(auto& i : res)
 	{
-		Path fullPath = archive->combinePath(i);
-		CreateIndexTask(this, fullPath);
+		if( !batch )
+		{
+			batch = Allocate(AllocatorGetThis(), Array<Path>);
+			batch->reserve(ResourceIndexBatchSize);
+		}
+
+		batch->pushBack(archive->combinePath(i));
+
+		if( batch->size() == ResourceIndexBatchSize )
+		{
+			CreateIndexTask(this, batch);
+			batch = nullptr;
+		}
 	}
+
+	if( batch )
+		CreateIndexTask(this, batch);
 }
 
 //-----------------------------------//
@@ -94,50 +291,94 @@ static bool GetResourceGroupFromPath(const Path& path, ResourceGroup& group)
 
 //-----------------------------------//
 
-void ResourceIndexer::indexResources(Task* task)
+static bool HashResourceStream(Stream& stream, Array<uint8>& buffer, uint64& hash)
 {
-	Path& tempPath = *((Path*) task->userdata);
-	Path path = tempPath;
-	DeallocateObject(&tempPath);
+	HashStateXX64 state;
+	XXHash64Init(&state, ResourceIndexHashSeed);
 
-	Path basePath = PathGetFile(path);
+	uint64 total = 0;
 
-	ResourceGroup group;
-		
-	if( !GetResourceGroupFromPath(path, group) )
+	while( true )
 	{
-		//LogDebug("Error indexing resource '%s': no loader was found", basePath.c_str());
-		return;
+		int64 read = stream.read(buffer.data(), buffer.size());
+		if( read <= 0 ) break;
+
+		XXHash64Update(&state, buffer.data(), (size_t) read);
+		total += read;
 	}
 
-	//LogDebug("Indexing file '%s'", basePath.c_str());
+	hash = XXHash64Digest(&state);
 
-	FileStream stream(path, StreamOpenMode::Read);
-		
-	if( !stream.isValid )
-	{
-		LogWarn("Error indexing resource '%s': cannot open stream", basePath.c_str());
-		return;
-	}
+	return total > 0;
+}
 
-	Array<byte> data;
-	stream.read(data);
-	stream.close();
+//-----------------------------------//
 
-	if( data.empty() )
+void ResourceIndexer::indexResources(Task* task)
+{
+	Array<Path>* batch = (Array<Path>*) task->userdata;
+	Array<uint8> buffer;
+
+	for( auto& path : *batch )
 	{
-		LogWarn("Resource '%s' is empty", basePath.c_str());
-		return;
-	}
+		Path basePath = PathGetFile(path);
 
-	uint32 hash = MurmurHash2(0xBEEF, &data[0], data.size());
+		ResourceGroup group;
 		
-	ResourceMetadata metadata;
-	metadata.hash = hash;
-	metadata.path = path;
-	metadata.group = group;
+		if( !GetResourceGroupFromPath(path, group) )
+		{
+			//LogDebug("Error indexing resource '%s': no loader was found", basePath.c_str());
+			continue;
+		}
+
+		ResourceIndexEntry entry;
+		entry.path = path;
+		entry.group = group;
+		entry.size = 0;
+		entry.modifiedTime = 0;
+
+		// Unchanged files are resolved from the cache with a single stat.
+		bool hasInfo = FileGetInfo(path, entry.size, entry.modifiedTime);
+
+		if( !hasInfo || !cache->findEntry(path, entry.size, entry.modifiedTime, entry) )
+		{
+			//LogDebug("Indexing file '%s'", basePath.c_str());
+
+			FileStream stream(path, StreamOpenMode::Read);
+		
+			if( !stream.isValid )
+			{
+				LogWarn("Error indexing resource '%s': cannot open stream", basePath.c_str());
+				continue;
+			}
+
+			if( buffer.empty() )
+				buffer.resize(ResourceIndexChunkSize);
+
+			bool hashed = HashResourceStream(stream, buffer, entry.hash);
+			stream.close();
+
+			if( !hashed )
+			{
+				LogWarn("Resource '%s' is empty", basePath.c_str());
+				continue;
+			}
+
+			if( hasInfo )
+				cache->setEntry(entry);
+		}
+		
+		ResourceMetadata metadata;
+		metadata.hash = entry.hash;
+		metadata.path = path;
+		metadata.group = group;
+
+		resourcesIndexed.push_back(metadata);
+	}
+
+	Deallocate(batch);
 
-	resourcesIndexed.push_back(metadata);
+	numPendingBatches.decrement();
 }
 
 //-----------------------------------//
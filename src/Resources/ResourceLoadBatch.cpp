@@ -0,0 +1,193 @@
+/************************************************************************
+*
+* Flood Project © (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Resources/API.h"
+#include "Resources/ResourceLoadBatch.h"
+#include "Core/Task.h"
+
+NAMESPACE_RESOURCES_BEGIN
+
+//-----------------------------------//
+
+ResourceLoadBatch::ResourceLoadBatch()
+	: resourcesDone(0)
+	, resourcesTotal(0)
+	, bytesDone(0)
+	, bytesTotal(0)
+{
+}
+
+//-----------------------------------//
+
+ResourceLoadBatch::~ResourceLoadBatch()
+{
+	assert( isDone() && "Resource load batch destroyed while loading" );
+}
+
+//-----------------------------------//
+
+uint32 ResourceLoadBatch::getResourcesDone() const
+{
+	mutex.lock();
+	uint32 done = resourcesDone;
+	mutex.unlock();
+
+	return done;
+}
+
+//-----------------------------------//
+
+uint32 ResourceLoadBatch::getResourcesTotal() const
+{
+	mutex.lock();
+	uint32 total = resourcesTotal;
+	mutex.unlock();
+
+	return total;
+}
+
+//-----------------------------------//
+
+uint64 ResourceLoadBatch::getBytesDone() const
+{
+	mutex.lock();
+	uint64 done = bytesDone;
+	mutex.unlock();
+
+	return done;
+}
+
+//-----------------------------------//
+
+uint64 ResourceLoadBatch::getBytesTotal() const
+{
+	mutex.lock();
+	uint64 total = bytesTotal;
+	mutex.unlock();
+
+	return total;
+}
+
+//-----------------------------------//
+
+float ResourceLoadBatch::getProgress() const
+{
+	mutex.lock();
+
+	float progress = 1.0f;
+
+	if( bytesTotal > 0 )
+		progress = float(bytesDone) / float(bytesTotal);
+	else if( resourcesTotal > 0 )
+		progress = float(resourcesDone) / float(resourcesTotal);
+
+	mutex.unlock();
+
+	return progress;
+}
+
+//-----------------------------------//
+
+float ResourceLoadBatch::getEstimatedTimeLeft() const
+{
+	mutex.lock();
+
+	float timeLeft = -1.0f;
+
+	if( resourcesDone == resourcesTotal )
+	{
+		timeLeft = 0.0f;
+	}
+	else if( bytesDone > 0 )
+	{
+		// Extrapolate from the average throughput of the batch so far.
+		float elapsed = timer.getElapsed();
+		float bytesPerSecond = float(bytesDone) / elapsed;
+		timeLeft = float(bytesTotal - bytesDone) / bytesPerSecond;
+	}
+
+	mutex.unlock();
+
+	return timeLeft;
+}
+
+//-----------------------------------//
+
+bool ResourceLoadBatch::isDone() const
+{
+	mutex.lock();
+	bool done = resourcesDone == resourcesTotal;
+	mutex.unlock();
+
+	return done;
+}
+
+//-----------------------------------//
+
+void ResourceLoadBatch::wait(TaskPool* helpPool)
+{
+	while( !isDone() )
+	{
+		// Use the waiting thread to decode some of the queued work.
+		if( helpPool && helpPool->runPendingTask() )
+			continue;
+
+		mutex.lock();
+
+		if( resourcesDone != resourcesTotal )
+			finished.wait(mutex);
+
+		mutex.unlock();
+	}
+}
+
+//-----------------------------------//
+
+void ResourceLoadBatch::addResource(uint64 bytes)
+{
+	mutex.lock();
+
+	if( resourcesDone == resourcesTotal )
+		timer.reset();
+
+	resourcesTotal++;
+	bytesTotal += bytes;
+
+	mutex.unlock();
+}
+
+//-----------------------------------//
+
+void ResourceLoadBatch::finishResource(uint64 bytes)
+{
+	mutex.lock();
+
+	resourcesDone++;
+	bytesDone += bytes;
+
+	mutex.unlock();
+
+	finished.wakeAll();
+}
+
+//-----------------------------------//
+
+void ResourceLoadBatch::cancelResource(uint64 bytes)
+{
+	mutex.lock();
+
+	resourcesTotal--;
+	bytesTotal -= bytes;
+
+	mutex.unlock();
+
+	finished.wakeAll();
+}
+
+//-----------------------------------//
+
+NAMESPACE_RESOURCES_END
@@ -39,10 +39,15 @@ ResourceLoadOptions::ResourceLoadOptions()
 	: group(ResourceGroup::General)
 	, stream(nullptr)
 	, resource(nullptr)
+	, priority(0)
+	, deadline(0)
+	, batch(nullptr)
 	, asynchronousLoad(true)
 	, sendLoadEvent(true)
 	, isHighPriority(false)
 	, keepStreamOpen(false)
+	, decodeInChunks(false)
+	, decodeState(nullptr)
 {
 }
 
@@ -69,4 +74,13 @@ ExtensionMetadata* ResourceLoader::getMetadata()
 
 //-----------------------------------//
 
+bool ResourceLoader::decodeChunk(ResourceLoadOptions& options)
+{
+	// Loaders that decode in chunks need to override this.
+	options.decodeInChunks = false;
+	return false;
+}
+
+//-----------------------------------//
+
 NAMESPACE_RESOURCES_END
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "Resources/API.h"
 #include "Resources/ResourceManager.h"
 #include "Resources/ResourceLoader.h"
+#include "Resources/ResourceLoadBatch.h"
 
 #include "Core/Log.h"
 #include "Core/Memory.h"
@@ -18,6 +19,8 @@
 #include "Core/Serialization.h"
 #include "Core/Math/Hash.h"
 
+#include <algorithm>
+
 NAMESPACE_RESOURCES_BEGIN
 
 //-----------------------------------//
@@ -130,6 +133,7 @@ ResourceManager::ResourceManager()
 	, handleManager(nullptr)
 	, numResourcesQueuedLoad(0)
 	, asynchronousLoading(true)
+	, currentFrame(0)
 {
 	handleManager = HandleCreateManager( GetResourcesAllocator() );
 
@@ -150,6 +154,8 @@ ResourceManager::ResourceManager()
 
 	resourceFinishLoadMutex = Allocate(GetResourcesAllocator(), Mutex);
 	resourceFinishLoad = Allocate(GetResourcesAllocator(), Condition);
+	pendingLoadsMutex = Allocate(GetResourcesAllocator(), Mutex);
+	evictionMutex = Allocate(GetResourcesAllocator(), Mutex);
 }
 
 //-----------------------------------//
@@ -161,6 +167,8 @@ ResourceManager::~ResourceManager()
 
 	Deallocate(resourceFinishLoad);
 	Deallocate(resourceFinishLoadMutex);
+	Deallocate(pendingLoadsMutex);
+	Deallocate(evictionMutex);
 }
 
 //-----------------------------------//
@@ -190,7 +198,10 @@ ResourceHandle ResourceManager::getResource(const String& path)
 	Path name = PathGetFile(path);
 	auto key = MurmurHash64(name.c_str(), name.size(), 0);
 
-	return resources.get(key, HandleInvalid);
+	ResourceHandle handle = resources.get(key, HandleInvalid);
+	touchResource(handle.Resolve());
+
+	return handle;
 }
 
 //-----------------------------------//
@@ -225,7 +236,17 @@ ResourceHandle ResourceManager::loadResource(ResourceLoadOptions& options)
 
 	// Check if the resource is already loaded.
 	ResourceHandle handle = getResource(options.name);
-	if( handle ) return handle;
+	
+	if( handle )
+	{
+		// Resources whose load was cancelled are queued again. Evicted
+		// resources were already queued again by getResource.
+		Resource* resource = handle.Resolve();
+		if( resource->getStatus() == ResourceStatus::Unloaded )
+			requeueResource(resource, options);
+
+		return handle;
+	}
 
 	if( !validateResource(options.name) )
 		return ResourceHandle(HandleInvalid);
@@ -336,6 +357,7 @@ Resource* ResourceManager::prepareResource( ResourceLoadOptions& options )
 
 	resource->setStatus( ResourceStatus::Loading );
 	resource->setPath( file );
+	resource->lastAccess.write(currentFrame);
 
 	options.resource = resource;
 
@@ -357,13 +379,29 @@ void ResourceManager::decodeResource( ResourceLoadOptions& options )
 
 	task->callback.Bind(ResourceTaskRun);
 	task->userdata = taskOptions;
+	task->priority = options.priority;
+	task->deadline = options.deadline;
+
+	if( options.isHighPriority && task->priority <= 0 )
+		task->priority = 1;
 
 	numResourcesQueuedLoad.increment();
 
+	if( options.batch )
+		options.batch->addResource(options.stream->size());
+
 #ifdef ENABLE_THREADED_LOADING
 	if( taskPool && asynchronousLoading && options.asynchronousLoad )
 	{
-		taskPool->add(task, options.isHighPriority);
+		// Keep track of the task so the load can be reprioritized.
+		auto base = PathGetFile(options.resource->getPath());
+		auto key = MurmurHash64(base.c_str(), base.size(), 0);
+
+		pendingLoadsMutex->lock();
+		pendingLoads.set(key, task);
+		pendingLoadsMutex->unlock();
+
+		taskPool->add(task);
 		return;
 	}
 #endif
@@ -374,19 +412,106 @@ void ResourceManager::decodeResource( ResourceLoadOptions& options )
 
 //-----------------------------------//
 
-void ResourceManager::loadQueuedResources()
+bool ResourceManager::requeueResource( Resource* resource, ResourceLoadOptions& options )
 {
-	resourceFinishLoadMutex->lock();
-
-	while(numResourcesQueuedLoad.read() > 0 )
+	Stream* stream = archive->openFile(options.name, GetResourcesAllocator());
+	
+	if( !stream )
 	{
-		#pragma TODO("Use a sleep and notify the observers of progress")
-		resourceFinishLoad->wait(*resourceFinishLoadMutex);
+		LogWarn("Resource was not found: '%s'", options.name.c_str());
+		return false;
 	}
 
+	resource->setStatus( ResourceStatus::Loading );
+
+	options.stream = stream;
+	options.resource = resource;
+
+	decodeResource(options);
+
+	return true;
+}
+
+//-----------------------------------//
+
+bool ResourceManager::setLoadPriority(const ResourceHandle& handle, int16 priority)
+{
+	Resource* resource = handle.Resolve();
+	if( !resource || !taskPool ) return false;
+
+	auto base = PathGetFile(resource->getPath());
+	auto key = MurmurHash64(base.c_str(), base.size(), 0);
+
+	pendingLoadsMutex->lock();
+	
+	Task* task = pendingLoads.get(key, nullptr);
+	bool changed = task && taskPool->setPriority(task, priority);
+	
+	pendingLoadsMutex->unlock();
+
+	return changed;
+}
+
+//-----------------------------------//
+
+bool ResourceManager::cancelLoad(const ResourceHandle& handle)
+{
+	Resource* resource = handle.Resolve();
+	if( !resource || !taskPool ) return false;
+
+	auto base = PathGetFile(resource->getPath());
+	auto key = MurmurHash64(base.c_str(), base.size(), 0);
+
+	pendingLoadsMutex->lock();
+	
+	Task* task = pendingLoads.get(key, nullptr);
+	bool cancelled = task && taskPool->cancel(task);
+	
+	if( cancelled )
+		pendingLoads.remove(key);
+	
+	pendingLoadsMutex->unlock();
+
+	if( !cancelled ) return false;
+
+	ResourceLoadOptions* options = (ResourceLoadOptions*) task->userdata;
+	resource->setStatus( ResourceStatus::Unloaded );
+
+	if( options->batch )
+		options->batch->cancelResource(options->stream->size());
+
+	if( !options->keepStreamOpen )
+		Deallocate(options->stream);
+
+	Deallocate(options);
+
+	resourceFinishLoadMutex->lock();
+	if( numResourcesQueuedLoad.decrement() == 0 )
+		resourceFinishLoad->wakeAll();
 	resourceFinishLoadMutex->unlock();
 
-	assert(numResourcesQueuedLoad.read() == 0);
+	LogInfo("Cancelled loading of resource '%s'", resource->getPath().c_str());
+
+	return true;
+}
+
+//-----------------------------------//
+
+void ResourceManager::loadQueuedResources()
+{
+	while( numResourcesQueuedLoad.read() > 0 )
+	{
+		// Decode the queued resources in this thread instead of idling.
+		if( taskPool && taskPool->runPendingTask() )
+			continue;
+
+		resourceFinishLoadMutex->lock();
+
+		if( numResourcesQueuedLoad.read() > 0 )
+			resourceFinishLoad->wait(*resourceFinishLoadMutex);
+
+		resourceFinishLoadMutex->unlock();
+	}
 }
 
 //-----------------------------------//
@@ -399,6 +524,163 @@ void ResourceManager::update()
 	archive->monitor();
 
 	removeUnusedResources();
+
+	enforceMemoryBudgets();
+
+	currentFrame++;
+}
+
+//-----------------------------------//
+
+void ResourceManager::setMemoryBudget(ResourceGroup group, uint64 bytes)
+{
+	if( bytes == 0 )
+		memoryBudgets.remove((uint64) group);
+	else
+		memoryBudgets.set((uint64) group, bytes);
+}
+
+//-----------------------------------//
+
+uint64 ResourceManager::getMemoryBudget(ResourceGroup group) const
+{
+	return memoryBudgets.get((uint64) group, 0);
+}
+
+//-----------------------------------//
+
+uint64 ResourceManager::getMemoryUsage(ResourceGroup group) const
+{
+	uint64 usage = 0;
+
+	for(auto& e : resources)
+	{
+		auto resource = (Resource*) HandleFind(handleManager, e.value.getId());
+		if( !resource || !resource->isLoaded() ) continue;
+
+		if( resource->getResourceGroup() == group )
+			usage += resource->getMemoryUsage();
+	}
+
+	return usage;
+}
+
+//-----------------------------------//
+
+void ResourceManager::touchResource(Resource* resource)
+{
+	if( !resource ) return;
+
+	resource->lastAccess.write(currentFrame);
+
+	// Cancelled loads stay unloaded until they are explicitly loaded again.
+	if( resource->getStatus() != ResourceStatus::Evicted )
+		return;
+
+	// Load the resource again right away so the caller gets it back as
+	// soon as possible. The lock keeps two threads from queueing it twice.
+	evictionMutex->lock();
+
+	if( resource->getStatus() == ResourceStatus::Evicted )
+	{
+		ResourceLoadOptions options;
+		options.name = resource->getPath();
+		options.asynchronousLoad = asynchronousLoading;
+
+		requeueResource(resource, options);
+	}
+
+	evictionMutex->unlock();
+}
+
+//-----------------------------------//
+
+// Number of frames a resource has to be left unused before it is unloaded.
+static const uint32 ResourceEvictionDelay = 60;
+
+// Number of frames between checks of the memory budgets.
+static const uint32 ResourceBudgetInterval = 15;
+
+struct ResourceBudgetGroup
+{
+	uint64 budget;
+	uint64 usage;
+	Array<Resource*> candidates;
+};
+
+static bool ResourceLastAccessSorter(const Resource* lhs, const Resource* rhs)
+{
+	return lhs->lastAccess.read() < rhs->lastAccess.read();
+}
+
+void ResourceManager::enforceMemoryBudgets()
+{
+	if( memoryBudgets.empty() || currentFrame % ResourceBudgetInterval != 0 )
+		return;
+
+	// Sum the usage of all the groups with a budget in a single pass.
+	HashMap<ResourceBudgetGroup*> groups; // keyed by group
+
+	for(auto& budget : memoryBudgets)
+	{
+		ResourceBudgetGroup* group = AllocateHeap(ResourceBudgetGroup);
+		group->budget = budget.value;
+		group->usage = 0;
+		groups.set(budget.key, group);
+	}
+
+	for(auto& e : resources)
+	{
+		auto resource = (Resource*) HandleFind(handleManager, e.value.getId());
+		if( !resource || !resource->isLoaded() ) continue;
+
+		auto group = groups.get((uint64) resource->getResourceGroup(), nullptr);
+		if( !group ) continue;
+
+		group->usage += resource->getMemoryUsage();
+
+		// Resources are only evicted when the manager holds the only handle
+		// to them, so the data is never released under its users, like a
+		// texture that is still streaming its image or a playing sound.
+		bool isUsed = resource->references.read() > 1;
+
+		if( !isUsed && currentFrame - resource->lastAccess.read() >= ResourceEvictionDelay )
+			group->candidates.pushBack(resource);
+	}
+
+	for(auto& e : groups)
+	{
+		ResourceBudgetGroup* group = e.value;
+		Array<Resource*>& candidates = group->candidates;
+
+		std::sort( candidates.begin(), candidates.end(), &ResourceLastAccessSorter );
+
+		for( size_t i = 0; i < candidates.size() && group->usage > group->budget; ++i )
+		{
+			Resource* resource = candidates[i];
+			uint64 size = resource->getMemoryUsage();
+
+			evictionMutex->lock();
+
+			// The resource could have been used since it was picked.
+			bool unloaded = currentFrame - resource->lastAccess.read() >= ResourceEvictionDelay
+				&& resource->references.read() <= 1 && resource->unload();
+
+			if( unloaded )
+				resource->setStatus( ResourceStatus::Evicted );
+
+			evictionMutex->unlock();
+
+			if( !unloaded ) continue;
+
+			group->usage -= size;
+
+			LogInfo("Unloaded resource '%s' to fit the %s memory budget",
+				resource->getPath().c_str(), GetResourceGroupString(resource->getResourceGroup()));
+		}
+
+		Deallocate(group);
+	}
 }
 
 //-----------------------------------//
@@ -418,6 +700,18 @@ void ResourceManager::sendPendingEvents()
 		event.handle = handle;
 		onResourceLoaded( event );
 	}
+
+	while( resourceStreamEvents.try_pop_front(event) )
+	{
+		Resource* resource = event.resource;
+		auto base = PathGetFile(resource->path);
+		auto key = MurmurHash64(base.c_str(), base.size(), 0);
+		
+		event.handle = resources.get(key, HandleInvalid);
+		if( event.handle == HandleInvalid ) continue;
+
+		onResourceStreamed( event );
+	}
 }
 
 //-----------------------------------//
@@ -8,17 +8,23 @@
 #include "Resources/API.h"
 #include "Resources/ResourceManager.h"
 #include "Resources/ResourceLoader.h"
+#include "Resources/ResourceLoadBatch.h"
 
 #include "Core/Log.h"
 #include "Core/Memory.h"
 #include "Core/Stream.h"
 #include "Core/Archive.h"
 #include "Core/Utilities.h"
+#include "Core/Math/Hash.h"
 
 NAMESPACE_RESOURCES_BEGIN
 
 //-----------------------------------//
 
+static bool ResourceChunkTaskQueue(Task* task);
+
+//-----------------------------------//
+
 void ResourceTaskRun(Task* task)
 {
 	ResourceLoadOptions* options = (ResourceLoadOptions*) task->userdata;
@@ -30,6 +36,17 @@ void ResourceTaskRun(Task* task)
 	ResourceManager* res = GetResourceManager();
 	ResourceLoader* loader = res->findLoader( PathGetFileExtension(path) );
 
+	// The load can not be cancelled or reprioritized after this point.
+	auto base = PathGetFile(path);
+	auto key = MurmurHash64(base.c_str(), base.size(), 0);
+
+	res->pendingLoadsMutex->lock();
+	if( res->pendingLoads.get(key, nullptr) == task )
+		res->pendingLoads.remove(key);
+	res->pendingLoadsMutex->unlock();
+
+	uint64 size = stream ? stream->size() : 0;
+
 	bool decoded = loader->decode(*options);
 
 	if( !decoded )
@@ -39,6 +56,7 @@ void ResourceTaskRun(Task* task)
 		goto cleanup;
 	}
 
+	// The resource is usable now, even if its data is decoded in chunks.
 	resource->setStatus( ResourceStatus::Loaded );
 
 	LogInfo("Loaded resource '%s'", path.c_str());
@@ -50,17 +68,112 @@ void ResourceTaskRun(Task* task)
 		res->resourceEvents.push_back(event);
 	}
 
+	if( options->decodeInChunks )
+	{
+		if( options->batch )
+			options->batch->finishResource(size);
+
+		options->batch = nullptr;
+
+		// Queue the decoding of the next chunk.
+		if( ResourceChunkTaskQueue(task) )
+			return;
+
+		while( options->decodeInChunks && ResourceChunkDecode(options) ) {}
+
+		ResourceTaskFinish(options);
+		return;
+	}
+
 cleanup:
 
-	res->numResourcesQueuedLoad.decrement();
-	res->resourceFinishLoad->wakeOne();
+	if( options->batch )
+		options->batch->finishResource(size);
+
+	ResourceTaskFinish(options);
+}
+
+//-----------------------------------//
+
+void ResourceTaskFinish(ResourceLoadOptions* options)
+{
+	ResourceManager* res = GetResourceManager();
+
+	// Only wake the waiting threads when the last queued resource is done.
+	res->resourceFinishLoadMutex->lock();
+	if( res->numResourcesQueuedLoad.decrement() == 0 )
+		res->resourceFinishLoad->wakeAll();
+	res->resourceFinishLoadMutex->unlock();
 
 	if( !options->keepStreamOpen )
-		Deallocate(stream);
+		Deallocate(options->stream);
 
 	Deallocate(options);
 }
 
 //-----------------------------------//
 
+bool ResourceChunkDecode(ResourceLoadOptions* options)
+{
+	Resource* resource = options->resource;
+	const Path& path = resource->getPath();
+
+	ResourceManager* res = GetResourceManager();
+	ResourceLoader* loader = res->findLoader( PathGetFileExtension(path) );
+
+	if( !loader->decodeChunk(*options) )
+	{
+		resource->setStatus( ResourceStatus::Error );
+		LogWarn("Error decoding chunk of resource '%s'", path.c_str());
+		return false;
+	}
+
+	ResourceEvent event;
+	event.resource = resource;
+	res->resourceStreamEvents.push_back(event);
+
+	return true;
+}
+
+//-----------------------------------//
+
+static bool ResourceChunkTaskQueue(Task* task)
+{
+#ifdef ENABLE_THREADED_LOADING
+	ResourceLoadOptions* options = (ResourceLoadOptions*) task->userdata;
+	
+	ResourceManager* res = GetResourceManager();
+	TaskPool* taskPool = res->getTaskPool();
+
+	if( !taskPool || !res->getAsynchronousLoading() || !options->asynchronousLoad )
+		return false;
+
+	// Chunks are queued one at a time so other loads can go in between.
+	task->callback.Bind(ResourceChunkTaskRun);
+	task->deadline = 0;
+
+	taskPool->add(task);
+	return true;
+#else
+	return false;
+#endif
+}
+
+//-----------------------------------//
+
+void ResourceChunkTaskRun(Task* task)
+{
+	ResourceLoadOptions* options = (ResourceLoadOptions*) task->userdata;
+
+	if( !ResourceChunkDecode(options) || !options->decodeInChunks )
+	{
+		ResourceTaskFinish(options);
+		return;
+	}
+
+	ResourceChunkTaskQueue(task);
+}
+
+//-----------------------------------//
+
 NAMESPACE_RESOURCES_END
\ No newline at end of file
@@ -34,6 +34,11 @@ project "Resources"
 		["*"] = { ".", path.join(incdir,"Resources") },
 	}	
 
+	excludes
+	{
+		"Test/**",
+	}
+
 	includedirs
 	{
 		incdir,
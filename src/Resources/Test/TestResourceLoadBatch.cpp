@@ -0,0 +1,92 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Core/API.h"
+#include "Core/Task.h"
+#include "Resources/ResourceLoadBatch.h"
+#include <UnitTest++.h>
+
+using namespace fld;
+
+namespace {
+
+void RunFinishTask(Task* task)
+{
+	ResourceLoadBatch* batch = (ResourceLoadBatch*) task->userdata;
+	batch->finishResource(100);
+}
+
+}
+
+SUITE(Resources)
+{
+	TEST(ResourceLoadBatchProgress)
+	{
+		ResourceLoadBatch batch;
+
+		CHECK( batch.isDone() );
+		CHECK_EQUAL( 1.0f, batch.getProgress() );
+
+		batch.addResource(100);
+		batch.addResource(300);
+		batch.addResource(50);
+
+		CHECK( !batch.isDone() );
+		CHECK_EQUAL( 3u, batch.getResourcesTotal() );
+		CHECK_EQUAL( 450u, batch.getBytesTotal() );
+		CHECK_EQUAL( 0.0f, batch.getProgress() );
+
+		// Nothing is loaded yet, so there is no throughput to estimate from.
+		CHECK_EQUAL( -1.0f, batch.getEstimatedTimeLeft() );
+
+		batch.finishResource(300);
+
+		CHECK( !batch.isDone() );
+		CHECK_EQUAL( 1u, batch.getResourcesDone() );
+		CHECK_EQUAL( 300u, batch.getBytesDone() );
+		CHECK_CLOSE( 300.0f / 450.0f, batch.getProgress(), 0.001f );
+		CHECK( batch.getEstimatedTimeLeft() >= 0.0f );
+
+		// Cancelled resources are removed from the totals.
+		batch.cancelResource(50);
+
+		CHECK_EQUAL( 2u, batch.getResourcesTotal() );
+		CHECK_CLOSE( 0.75f, batch.getProgress(), 0.001f );
+
+		batch.finishResource(100);
+
+		CHECK( batch.isDone() );
+		CHECK_EQUAL( 1.0f, batch.getProgress() );
+		CHECK_EQUAL( 0.0f, batch.getEstimatedTimeLeft() );
+	}
+
+	TEST(ResourceLoadBatchHelpWhileWaiting)
+	{
+		// The pool has no threads, so the batch can only finish if the
+		// waiting thread runs the queued tasks.
+		TaskPool pool(0);
+		ResourceLoadBatch batch;
+
+		const size_t NumTasks = 8;
+		Task tasks[NumTasks];
+
+		for(size_t i = 0; i < NumTasks; ++i)
+		{
+			batch.addResource(100);
+
+			tasks[i].callback.Bind(RunFinishTask);
+			tasks[i].userdata = &batch;
+			pool.add(&tasks[i]);
+		}
+
+		batch.wait(&pool);
+
+		CHECK( batch.isDone() );
+		CHECK_EQUAL( NumTasks, batch.getResourcesDone() );
+		CHECK( pool.tasks.empty() );
+	}
+}
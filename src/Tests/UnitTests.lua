@@ -5,7 +5,7 @@ project "UnitTests"
 	kind "ConsoleApp"
 	debugdir "../Core/Test/"
 	
-	defines { Core.defines }
+	defines { Core.defines, Resources.defines, Graphics.defines, Engine.defines }
 	
 	SetupNativeProjects()
 
@@ -15,6 +15,9 @@ project "UnitTests"
 		"**.cpp",
 		"**.h",
 		"../Core/Test/**",
+		"../Resources/Test/**",
+		"../Graphics/Test/**",
+		"../Engine/Test/**",
 	}
 
 	vpaths
@@ -27,6 +30,6 @@ project "UnitTests"
 		incdir,
 	}
 	
-	libdirs { Core.libdirs, bindir }
+	libdirs { Core.libdirs, Engine.libdirs, bindir }
 	deps { Core.deps, "UnitTest++" }
-	links { Core.name, Core.links }
\ No newline at end of file
+	links { Core.name, Core.links, Resources.name, Graphics.name, Engine.name }
\ No newline at end of file
@@ -0,0 +1,348 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Core/API.h"
+#include "Core/Memory.h"
+#include "Core/Array.h"
+#include "Core/Sort.h"
+#include "Core/Timer.h"
+#include "Core/Math/FrustumCulling.h"
+#include "Core/Math/BoundingTree.h"
+#include "Core/Math/LooseOctree.h"
+#include "Core/Math/HashedGrid.h"
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace fld;
+
+//-----------------------------------//
+
+// xorshift, so the runs do not depend on the platform rand().
+
+static uint64 NextRandom(uint64& state)
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+static float NextRandomFloat(uint32& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return (state & 0xFFFFFF) / float(0x1000000);
+}
+
+static BoundingBox NextRandomBox(uint32& state, float range, float size)
+{
+	Vector3 center;
+	center.x = (NextRandomFloat(state) - 0.5f) * range;
+	center.y = (NextRandomFloat(state) - 0.5f) * range;
+	center.z = (NextRandomFloat(state) - 0.5f) * range;
+
+	Vector3 extent( 0.5f + NextRandomFloat(state) * size );
+
+	return BoundingBox(center - extent, center + extent);
+}
+
+// Props scattered over a flat world, with a few big boxes.
+static BoundingBox NextRandomProp(uint32& state)
+{
+	Vector3 center;
+	center.x = (NextRandomFloat(state) - 0.5f) * 2000.0f;
+	center.y = (NextRandomFloat(state) - 0.5f) * 50.0f;
+	center.z = (NextRandomFloat(state) - 0.5f) * 2000.0f;
+
+	Vector3 extent( 0.5f + NextRandomFloat(state) * 4.0f );
+
+	if( NextRandomFloat(state) < 0.01f )
+		extent = Vector3(100.0f);
+
+	return BoundingBox(center - extent, center + extent);
+}
+
+static bool BoxesOverlap(const BoundingBox& a, const BoundingBox& b)
+{
+	return a.min.x <= b.max.x && a.min.y <= b.max.y && a.min.z <= b.max.z
+		&& a.max.x >= b.min.x && a.max.y >= b.min.y && a.max.z >= b.min.z;
+}
+
+//-----------------------------------//
+
+static void BenchmarkRadixSort()
+{
+	const size_t count = 100000;
+
+	Array<uint64> keys;
+	Array<uint32> values;
+	Array<uint64> tempKeys;
+	Array<uint32> tempValues;
+
+	keys.resize(count);
+	values.resize(count);
+	tempKeys.resize(count);
+	tempValues.resize(count);
+
+	uint64 state = 0x9E3779B97F4A7C15ULL;
+
+	for( size_t i = 0; i < count; ++i )
+	{
+		keys[i] = NextRandom(state) & 0xFFFF0000000003FFULL;
+		values[i] = (uint32) i;
+	}
+
+	Array<uint64> sorted = keys;
+
+	Timer timer;
+	std::sort(sorted.begin(), sorted.end());
+	float stdTime = timer.getElapsed();
+
+	timer.reset();
+	RadixSort(keys.data(), values.data(), count,
+		tempKeys.data(), tempValues.data());
+	float radixTime = timer.getElapsed();
+
+	printf("RadixSort: sorted %u keys in %.3f ms (%.3f ms with std::sort)\n",
+		(uint32) count, radixTime * 1000.0f, stdTime * 1000.0f);
+}
+
+//-----------------------------------//
+
+static void BenchmarkFrustumCulling()
+{
+	const uint32 count = 100000;
+
+	Frustum frustum;
+	frustum.farPlane = 500.0f;
+	frustum.aspectRatio = 16.0f / 9.0f;
+	frustum.updateProjection();
+	frustum.updatePlanes( Matrix4x3::Identity );
+
+	Array<BoundingBox> boxes;
+	boxes.resize(count);
+
+	BoundingBoxArray boxArray;
+	uint32 state = 0x9E3779B9;
+
+	for( uint32 i = 0; i < count; i++ )
+	{
+		boxes[i] = NextRandomBox(state, 1000.0f, 10.0f);
+		boxArray.add(boxes[i]);
+	}
+
+	Array<bool> expected;
+	expected.resize(count);
+
+	Timer timer;
+
+	for( uint32 i = 0; i < count; i++ )
+		expected[i] = frustum.intersects(boxes[i]);
+
+	float scalarTime = timer.getElapsed();
+
+	Array<uint32> visible;
+
+	timer.reset();
+	FrustumCullBoxes(frustum, boxArray, visible);
+	float batchTime = timer.getElapsed();
+
+	uint32 numVisible = 0;
+
+	for( uint32 i = 0; i < count; i++ )
+		numVisible += FrustumCullIsVisible(visible, i);
+
+	printf("FrustumCullBoxes: culled %u boxes in %.3f ms (%.3f ms one at a time), %u visible\n",
+		count, batchTime * 1000.0f, scalarTime * 1000.0f, numVisible);
+}
+
+//-----------------------------------//
+
+static void BenchmarkBoundingTree()
+{
+	const uint32 count = 50000;
+	const uint32 numQueries = 1000;
+
+	BoundingTree tree;
+	uint32 state = 0x9E3779B9;
+
+	Array<BoundingBox> boxes;
+	boxes.resize(count);
+
+	Timer timer;
+
+	for( uint32 i = 0; i < count; i++ )
+	{
+		boxes[i] = NextRandomBox(state, 1000.0f, 5.0f);
+		tree.createProxy(boxes[i], &boxes[i]);
+	}
+
+	float insertTime = timer.getElapsed();
+
+	Array<BoundingBox> queries;
+
+	for( uint32 i = 0; i < numQueries; i++ )
+	{
+		Vector3 center = NextRandomBox(state, 1000.0f, 5.0f).getCenter();
+		queries.pushBack( BoundingBox(center - Vector3(20.0f), center + Vector3(20.0f)) );
+	}
+
+	uint32 numFound = 0;
+	Array<int32> found;
+
+	timer.reset();
+
+	for( uint32 i = 0; i < numQueries; i++ )
+	{
+		found.clear();
+		tree.query(queries[i], found);
+		numFound += found.size();
+	}
+
+	float queryTime = timer.getElapsed();
+
+	printf("BoundingTree: %u inserts in %.3f ms, %u queries in %.3f ms (height %d), %u found\n",
+		count, insertTime * 1000.0f, numQueries, queryTime * 1000.0f,
+		tree.getHeight(), numFound);
+}
+
+//-----------------------------------//
+
+struct SpatialIndexTiming
+{
+	float insert;
+	float move;
+	float query;
+};
+
+static SpatialIndexTiming RunSpatialIndex(SpatialIndex* index, bool bulk)
+{
+	const uint32 count = 20000;
+	uint32 state = 0x2545F491;
+
+	Array<BoundingBox> boxes;
+	boxes.resize(count);
+
+	Array<void*> userdata;
+	userdata.resize(count);
+
+	Array<int32> proxies;
+	proxies.resize(count);
+
+	for( uint32 i = 0; i < count; i++ )
+	{
+		boxes[i] = NextRandomProp(state);
+		userdata[i] = &boxes[i];
+	}
+
+	SpatialIndexTiming timing;
+
+	Timer timer;
+
+	if( !index )
+	{
+		// The linear scan just keeps the boxes.
+	}
+	else if( bulk )
+	{
+		index->createProxies(boxes.data(), userdata.data(), count, proxies.data());
+	}
+	else
+	{
+		for( uint32 i = 0; i < count; i++ )
+			proxies[i] = index->createProxy(boxes[i], userdata[i]);
+	}
+
+	timing.insert = timer.getElapsed();
+
+	// Move a few props a lot and the others a bit.
+	timer.reset();
+
+	for( uint32 i = 0; i < count; i += 2 )
+	{
+		Vector3 offset( NextRandomFloat(state) - 0.5f, 0, NextRandomFloat(state) - 0.5f );
+
+		BoundingBox& box = boxes[i];
+		box = (i % 20 == 0) ? NextRandomProp(state)
+			: BoundingBox(box.min + offset, box.max + offset);
+
+		if( index ) index->moveProxy(proxies[i], box);
+	}
+
+	timing.move = timer.getElapsed();
+
+	// Neighbourhood queries around random points.
+	Array<BoundingBox> queries;
+
+	for( uint32 i = 0; i < 500; i++ )
+	{
+		Vector3 center = NextRandomProp(state).getCenter();
+		queries.pushBack( BoundingBox(center - Vector3(30.0f), center + Vector3(30.0f)) );
+	}
+
+	Array<int32> found;
+
+	timer.reset();
+
+	for( size_t i = 0; i < queries.size(); i++ )
+	{
+		found.clear();
+
+		if( index )
+		{
+			index->query(queries[i], found);
+			continue;
+		}
+
+		for( uint32 j = 0; j < count; j++ )
+		{
+			if( BoxesOverlap(boxes[j], queries[i]) )
+				found.pushBack(j);
+		}
+	}
+
+	timing.query = timer.getElapsed();
+
+	return timing;
+}
+
+static void PrintTiming(const char* name, const SpatialIndexTiming& timing)
+{
+	printf("SpatialIndex: %-12s insert %7.3f ms, move %7.3f ms, 500 queries %7.3f ms\n",
+		name, timing.insert * 1000.0f, timing.move * 1000.0f, timing.query * 1000.0f);
+}
+
+static void BenchmarkSpatialIndex()
+{
+	PrintTiming("LinearScan", RunSpatialIndex(nullptr, false));
+
+	BoundingTree tree;
+	PrintTiming("BoundingTree", RunSpatialIndex(&tree, false));
+
+	BoundingTree bulkTree;
+	PrintTiming("BulkTree", RunSpatialIndex(&bulkTree, true));
+
+	LooseOctree octree( BoundingBox(Vector3(-1024.0f), Vector3(1024.0f)) );
+	PrintTiming("LooseOctree", RunSpatialIndex(&octree, false));
+
+	HashedGrid grid(16.0f);
+	PrintTiming("HashedGrid", RunSpatialIndex(&grid, false));
+}
+
+//-----------------------------------//
+
+int main()
+{
+	BenchmarkRadixSort();
+	BenchmarkFrustumCulling();
+	BenchmarkBoundingTree();
+	BenchmarkSpatialIndex();
+
+	return 0;
+}
@@ -0,0 +1,46 @@
+CoreBenchmark = {}
+CoreBenchmark.name = "CoreBenchmark"
+
+project "CoreBenchmark"
+
+	uuid "EA192486-CA11-40ED-8BAA-65014213FEC7"
+
+	kind "ConsoleApp"
+	debugdir (bindir)
+
+	SetupNativeProjects()
+
+	defines
+	{
+		Core.defines,
+	}
+
+	files
+	{
+		"CoreBenchmark.lua",
+		"**.h",
+		"**.cpp",
+	}
+
+	vpaths
+	{
+		["*"] = { "." },
+	}
+
+	includedirs
+	{
+		incdir,
+		srcdir,
+	}
+
+	libdirs
+	{
+		Core.libdirs,
+	}
+
+	links
+	{
+		Core.name, Core.links,
+	}
+
+	deps { Core.deps }
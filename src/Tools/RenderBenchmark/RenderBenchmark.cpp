@@ -0,0 +1,366 @@
+/************************************************************************
+*
+* Flood Project  (2008-201x)
+* Licensed under the simplified BSD license. All rights reserved.
+*
+************************************************************************/
+
+#include "Engine/API.h"
+#include "Engine/Engine.h"
+#include "Engine/PlatformManager.h"
+#include "Engine/Scene/Scene.h"
+#include "Engine/Scene/Camera.h"
+#include "Engine/Scene/Transform.h"
+#include "Engine/Scene/Tags.h"
+#include "Engine/Geometry/Cube.h"
+#include "Graphics/RenderDevice.h"
+#include "Graphics/RenderView.h"
+#include "Graphics/RecordingRenderBackend.h"
+#include "Graphics/FrameStatistics.h"
+#include "Graphics/BufferManager.h"
+#include "Graphics/RenderContext.h"
+#include "Graphics/ShaderProgramManager.h"
+#include "Resources/ResourceManager.h"
+#include "Core/Archive.h"
+#include "Core/Timer.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace fld;
+
+//-----------------------------------//
+
+/**
+ * Platform without windows or input, so the engine can run headless.
+ */
+
+class BenchmarkPlatform : public PlatformManager
+{
+public:
+
+	void init() OVERRIDE { }
+	void update() OVERRIDE { }
+	WindowManager* getWindowManager() OVERRIDE { return nullptr; }
+	InputManager* getInputManager() OVERRIDE { return nullptr; }
+};
+
+//-----------------------------------//
+
+struct BenchmarkOptions
+{
+	BenchmarkOptions()
+		: numEntities(1000)
+		, numMeshes(16)
+		, numFrames(200)
+		, warmupFrames(10)
+		, logCommands(false)
+		, serialRecording(false)
+		, updateByComponent(false)
+		, deterministic(false)
+		, occlusion(false)
+	{ }
+
+	uint32 numEntities;
+	uint32 numMeshes;
+	uint32 numFrames;
+	uint32 warmupFrames;
+	bool logCommands;
+	bool serialRecording;
+	bool updateByComponent;
+	bool deterministic;
+	bool occlusion;
+};
+
+static void ParseOptions(BenchmarkOptions& options, int argc, char** argv)
+{
+	for( int i = 1; i < argc; i++ )
+	{
+		const char* arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if( strcmp(arg, "-entities") == 0 && hasValue )
+			options.numEntities = atoi(argv[++i]);
+		else if( strcmp(arg, "-meshes") == 0 && hasValue )
+			options.numMeshes = atoi(argv[++i]);
+		else if( strcmp(arg, "-frames") == 0 && hasValue )
+			options.numFrames = atoi(argv[++i]);
+		else if( strcmp(arg, "-warmup") == 0 && hasValue )
+			options.warmupFrames = atoi(argv[++i]);
+		else if( strcmp(arg, "-log") == 0 )
+			options.logCommands = true;
+		else if( strcmp(arg, "-serial") == 0 )
+			options.serialRecording = true;
+		else if( strcmp(arg, "-components") == 0 )
+			options.updateByComponent = true;
+		else if( strcmp(arg, "-deterministic") == 0 )
+			options.deterministic = options.updateByComponent = true;
+		else if( strcmp(arg, "-occlusion") == 0 )
+			options.occlusion = true;
+	}
+
+	if( options.numMeshes == 0 ) options.numMeshes = 1;
+}
+
+//-----------------------------------//
+
+// Builds a grid of entities that share a small set of meshes, like a
+// scene of props would. Each mesh has its own material.
+
+static void BuildScene(Scene* scene, const BenchmarkOptions& options)
+{
+	Array<CubePtr> meshes;
+
+	for( uint32 i = 0; i < options.numMeshes; i++ )
+	{
+		float size = 1.0f + (i % 4) * 0.5f;
+		meshes.pushBack( AllocateHeap(Cube, size, size) );
+	}
+
+	uint32 side = 1;
+	while( side * side < options.numEntities ) side++;
+
+	// Keep the components of each class together in the scene storage.
+	Allocator* transformAlloc = AllocatorGetHeap();
+	Allocator* geometryAlloc = AllocatorGetHeap();
+
+	if( options.updateByComponent )
+	{
+		scene->setUpdateByComponent(true);
+		scene->systems.setDeterministic(options.deterministic);
+		transformAlloc = scene->components.getAllocator(ReflectionGetType(Transform));
+		geometryAlloc = scene->components.getAllocator(ReflectionGetType(Geometry));
+	}
+
+	for( uint32 i = 0; i < options.numEntities; i++ )
+	{
+		Entity* entity = EntityCreate(AllocatorGetHeap());
+		entity->addComponent( TransformCreate(transformAlloc) );
+
+		Vector3 position( float(i % side) * 4.0f, 0.0f, float(i / side) * 4.0f );
+		entity->getTransform()->setPosition(position);
+
+		// Share the renderables of the meshes between the entities.
+		Cube* mesh = meshes[i % meshes.size()].get();
+		const RenderablesVector& renderables = mesh->getRenderables();
+
+		GeometryPtr geometry = Allocate(geometryAlloc, Geometry);
+		
+		for( size_t j = 0; j < renderables.size(); j++ )
+			geometry->addRenderable(renderables[j]);
+
+		entity->addComponent(geometry);
+		scene->entities.add(entity);
+	}
+}
+
+//-----------------------------------//
+
+static Camera* CreateCamera(Scene* scene, RenderView* view, const BenchmarkOptions& options)
+{
+	Entity* entity = EntityCreate(AllocatorGetHeap());
+	entity->setName("Camera");
+	entity->addTransform();
+
+	// Look at the grid from above so most of it is inside the frustum.
+	float extent = sqrtf(float(options.numEntities)) * 4.0f;
+	entity->getTransform()->setPosition( Vector3(extent / 2, extent / 2, -extent / 4) );
+
+	CameraPtr camera = AllocateHeap(Camera);
+	camera->getFrustum().farPlane = extent * 4;
+
+	entity->addComponent(camera);
+	scene->entities.add(entity);
+
+	camera->setView(view);
+
+	if( !options.occlusion )
+		return camera.get();
+
+	// Put a wall between the camera and the middle of the grid, so part
+	// of the grid is hidden behind it.
+	camera->setOcclusionCulling(true);
+
+	Vector3 cameraPosition = entity->getTransform()->getPosition();
+	Vector3 gridCenter( extent / 2, 0, extent / 2 );
+
+	Entity* occluder = EntityCreate(AllocatorGetHeap());
+	occluder->setName("Occluder");
+	occluder->setTag(Tags::Occluder, true);
+	occluder->addTransform();
+	occluder->getTransform()->setPosition( cameraPosition + (gridCenter - cameraPosition) * 0.3f );
+	occluder->addComponent( AllocateHeap(Cube, extent / 4, extent / 4) );
+
+	scene->entities.add(occluder);
+
+	return camera.get();
+}
+
+//-----------------------------------//
+
+static void PrintArenas(const char* name, const Array<BufferArena*>& arenas)
+{
+	for( size_t i = 0; i < arenas.size(); i++ )
+	{
+		const BufferArena* arena = arenas[i];
+
+		printf("%s arena %u: %u/%u bytes, %u buffers\n", name, (uint32) i,
+			arena->usedBytes, arena->capacity, arena->numAllocations);
+	}
+}
+
+//-----------------------------------//
+
+static int RunBenchmark(const BenchmarkOptions& options)
+{
+	BenchmarkPlatform platform;
+
+	Engine* engine = AllocateHeap(Engine, &platform);
+	engine->init();
+
+	ArchiveVirtual archive;
+	archive.mountDirectories("Assets", AllocatorGetHeap());
+
+	ResourceManager* res = engine->getResourceManager();
+	res->setArchive(&archive);
+
+	RecordingRenderBackend* backend = AllocateHeap(RecordingRenderBackend);
+	backend->keepCommands = options.logCommands;
+
+	NullRenderTarget* target = AllocateHeap(NullRenderTarget, Settings(1280, 720));
+	target->setContext( AllocateHeap(NullRenderContext, backend) );
+
+	FrameStatistics stats;
+
+	RenderDevice* device = engine->getRenderDevice();
+	device->setRenderTarget(target);
+	device->setFrameStatistics(&stats);
+
+	// Record the render queue in the calling thread only.
+	if( options.serialRecording )
+		device->setTaskPool(nullptr);
+	target->getContext()->init();
+
+	RenderView* view = target->createView();
+
+	ScenePtr scene = AllocateHeap(Scene);
+	BuildScene(scene.get(), options);
+	Camera* camera = CreateCamera(scene.get(), view, options);
+
+	// Load the shaders and build the buffers before measuring.
+	res->loadQueuedResources();
+
+	Timer timer;
+	float sumTime = 0;
+	float minTime = 1e9f;
+	float maxTime = 0;
+
+	uint64 sumCommands[(size_t) RenderCommandType::Count] = { 0 };
+	uint64 sumStateChanges = 0;
+	uint64 sumStateChangesElided = 0;
+	uint64 sumUploadBytes = 0;
+	uint64 sumTextureUploadBytes = 0;
+	uint64 sumOccludedEntities = 0;
+	float sumOcclusionTime = 0;
+
+	uint32 totalFrames = options.warmupFrames + options.numFrames;
+
+	for( uint32 frame = 0; frame < totalFrames; frame++ )
+	{
+		backend->clearCommands();
+
+		timer.reset();
+
+		engine->update();
+		scene->update(0);
+		camera->render(scene.get());
+		engine->stepFrame();
+
+		float frameTime = timer.getElapsed() * 1000.0f;
+
+		stats.lastFrameTime = frameTime;
+		stats.frameStep();
+
+		if( frame < options.warmupFrames ) continue;
+
+		sumTime += frameTime;
+		if( frameTime < minTime ) minTime = frameTime;
+		if( frameTime > maxTime ) maxTime = frameTime;
+
+		for( size_t i = 0; i < (size_t) RenderCommandType::Count; i++ )
+			sumCommands[i] += backend->getCommandCount((RenderCommandType) i);
+
+		sumStateChanges += stats.lastStateChanges;
+		sumStateChangesElided += stats.lastStateChangesElided;
+		sumUploadBytes += backend->lastFrameUploadBytes;
+		sumTextureUploadBytes += stats.lastTextureUploadBytes;
+		sumOccludedEntities += stats.lastOccludedEntities;
+		sumOcclusionTime += stats.lastOcclusionTime;
+	}
+
+	if( options.logCommands )
+		backend->logCommands();
+
+	uint32 numFrames = options.numFrames ? options.numFrames : 1;
+
+	printf("Entities: %u, meshes: %u, frames: %u\n", options.numEntities,
+		options.numMeshes, options.numFrames);
+
+	printf("CPU frame time: %.3f ms avg, %.3f ms min, %.3f ms max\n",
+		sumTime / numFrames, minTime, maxTime);
+
+	printf("State changes per frame: %llu issued, %llu elided\n",
+		sumStateChanges / numFrames, sumStateChangesElided / numFrames);
+
+	printf("Buffer uploads per frame: %llu bytes\n", sumUploadBytes / numFrames);
+
+	printf("Texture uploads per frame: %llu bytes (budget %u bytes)\n",
+		sumTextureUploadBytes / numFrames, device->getTextureStreamer().getUploadBudget());
+
+	if( options.occlusion )
+	{
+		printf("Occlusion per frame: %llu entities hidden by %u triangles in %.3f ms\n",
+			sumOccludedEntities / numFrames, stats.lastOccluderTriangles,
+			sumOcclusionTime * 1000.0f / numFrames);
+	}
+
+	// The null backend links programs without compiling anything, so the
+	// link time and the program binary cache can only be measured on GL.
+	ProgramManager* programs = target->getContext()->programManager;
+	printf("Programs linked at load: %u (link time not measured on the null backend)\n",
+		programs->getNumPrecompiled());
+
+	BufferManager* buffers = target->getContext()->bufferManager;
+	PrintArenas("Vertex", buffers->getVertexArenas());
+	PrintArenas("Index", buffers->getIndexArenas());
+
+	printf("Commands per frame:\n");
+
+	for( size_t i = 0; i < (size_t) RenderCommandType::Count; i++ )
+	{
+		if( !sumCommands[i] ) continue;
+
+		const char* name = RenderCommandTypeGetName((RenderCommandType) i);
+		printf("  %-20s %llu\n", name, sumCommands[i] / numFrames);
+	}
+
+	scene.reset();
+	view = nullptr;
+
+	device->setRenderTarget(nullptr);
+	Deallocate(target);
+
+	Deallocate(engine);
+
+	return 0;
+}
+
+//-----------------------------------//
+
+int main(int argc, char** argv)
+{
+	BenchmarkOptions options;
+	ParseOptions(options, argc, argv);
+
+	return RunBenchmark(options);
+}
\ No newline at end of file
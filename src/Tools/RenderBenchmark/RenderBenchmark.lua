@@ -0,0 +1,47 @@
+RenderBenchmark = {}
+RenderBenchmark.name = "RenderBenchmark"
+
+project "RenderBenchmark"
+
+	uuid "F50BDD13-66D2-4873-890C-F67AB7C3A949"
+
+	kind "ConsoleApp"
+	debugdir (bindir)
+
+	SetupNativeProjects()
+	
+	defines
+	{
+		Engine.defines,	-- includes Graphics.defines
+	}
+
+	files
+	{
+		"RenderBenchmark.lua",
+		"**.h",
+		"**.cpp",
+	}
+
+	vpaths
+	{
+		["*"] = { "." },
+	}
+
+	includedirs
+	{
+		incdir,
+		srcdir,
+	}
+	
+	libdirs
+	{
+		Engine.libdirs,
+	}
+
+	links
+	{
+		Engine.name, Engine.links,
+		Graphics.name, Graphics.links,
+	}
+
+	deps { Engine.deps }
\ No newline at end of file